@@ -22,6 +22,7 @@
 #include "graphics/mesh.h"
 #include "graphics/shaders.h"
 #include "graphics/texture_atlas.h"
+#include "graphics/render_queue.h"
 
 using namespace openhow;
 
@@ -43,6 +44,12 @@ Map::Map( MapManifest* manifest ) : manifest_( manifest ) {
 
 	std::string pogPath = "maps/" + manifest_->filename + "/" + manifest_->filename + ".pog";
 	LoadSpawns( pogPath );
+
+	// The sky and lighting are only for show
+	if ( g_state.is_headless ) {
+		return;
+	}
+
 	LoadSky();
 
 	UpdateSky();
@@ -129,14 +136,14 @@ void Map::UpdateSkyModel( PLModel* model ) {
 }
 
 void Map::UpdateLighting() {
-	PLShaderProgram* program = Shaders_GetProgram( "generic_textured_lit" )->GetInternalProgram();
+	ShaderProgram* program = Shaders_GetProgram( "generic_textured_lit" );
 	if ( program == nullptr ) {
 		return;
 	}
 
-	plSetNamedShaderUniformVector4( program, "fog_colour", manifest_->fog_colour.ToVec4() );
-	plSetNamedShaderUniformFloat( program, "fog_near", manifest_->fog_intensity );
-	plSetNamedShaderUniformFloat( program, "fog_far", manifest_->fog_distance );
+	program->SetUniform( "fog_colour", manifest_->fog_colour.ToVec4() );
+	program->SetUniform( "fog_near", manifest_->fog_intensity );
+	program->SetUniform( "fog_far", manifest_->fog_distance );
 
 	PLVector3 sun_position( 1.0f, -manifest_->sun_pitch, 0 );
 	PLMatrix4 sun_matrix =
@@ -148,10 +155,10 @@ void Map::UpdateLighting() {
 #if 0
 	debug_sun_position = sun_position;
 #endif
-	plSetNamedShaderUniformVector3( program, "sun_position", sun_position );
-	plSetNamedShaderUniformVector4( program, "sun_colour", manifest_->sun_colour.ToVec4() );
+	program->SetUniform( "sun_position", sun_position );
+	program->SetUniform( "sun_colour", manifest_->sun_colour.ToVec4() );
 
-	plSetNamedShaderUniformVector4( program, "ambient_colour", manifest_->ambient_colour.ToVec4() );
+	program->SetUniform( "ambient_colour", manifest_->ambient_colour.ToVec4() );
 }
 
 void Map::LoadSpawns( const std::string& path ) {
@@ -236,10 +243,12 @@ void Map::LoadSpawns( const std::string& path ) {
 }
 
 void Map::Draw() {
-	Shaders_SetProgramByName( "generic_untextured" );
+	RenderQueue* queue = Display_GetRenderQueue();
+	ShaderProgram* sky_program = Shaders_GetProgram( "generic_untextured" );
 
-	plDrawModel( sky_model_top_ );
-	plDrawModel( sky_model_bottom_ );
+	// Sky is always drawn first, so depth doesn't matter here
+	queue->Submit( RENDER_LAYER_SKY, sky_program, sky_model_top_, sky_model_top_->model_matrix, { 0, 0, 0 } );
+	queue->Submit( RENDER_LAYER_SKY, sky_program, sky_model_bottom_, sky_model_bottom_->model_matrix, { 0, 0, 0 } );
 
 	terrain_->Draw();
 
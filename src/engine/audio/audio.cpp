@@ -17,7 +17,9 @@
 
 #include "../engine.h"
 #include "../frontend.h"
+#include "../memory_tracker.h"
 #include "../model.h"
+#include "../profiler.h"
 
 #include "stb_vorbis.c"
 
@@ -37,6 +39,11 @@ using namespace openhow;
  * todo: stream music and large samples */
 
 static void OALCheckErrors() {
+	// Without a context every call fails, which is expected
+	if ( g_state.is_headless ) {
+		return;
+	}
+
 	ALenum err = alGetError();
 	if ( err != AL_NO_ERROR ) {
 		/* alut is apparently deprecated in OpenAL Soft, yay... */
@@ -224,6 +231,14 @@ static LPALAUXILIARYEFFECTSLOTI alAuxiliaryEffectSloti;
 //static LPALGETAUXILIARYEFFECTSLOTFV alGetAuxiliaryEffectSlotfv;
 
 AudioManager::AudioManager() {
+	plRegisterConsoleCommand( "stopMusic", StopMusicCommand, "Stops the current music track." );
+
+	// OpenAL quietly ignores everything until there's a context
+	if ( g_state.is_headless ) {
+		LogInfo( "Running headless, skipping audio device\n" );
+		return;
+	}
+
 	ALCdevice* device = alcOpenDevice( nullptr );
 	if ( device == nullptr ) {
 		Error( "failed to open audio device, aborting audio initialisation!\n" );
@@ -284,8 +299,6 @@ AudioManager::AudioManager() {
 		alGenAuxiliaryEffectSlots( 1, &reverb_sound_slot );
 		alAuxiliaryEffectSloti( reverb_sound_slot, AL_EFFECTSLOT_EFFECT, reverb_effect_slot );
 	}
-
-	plRegisterConsoleCommand( "stopMusic", StopMusicCommand, "Stops the current music track." );
 }
 
 AudioManager::~AudioManager() {
@@ -313,6 +326,13 @@ AudioManager::~AudioManager() {
 }
 
 const AudioSample* AudioManager::CacheSample( const std::string& path, bool preserve ) {
+	MEMORY_TAG( MEMORY_TAG_AUDIO );
+
+	// Nobody's listening, so there's no point decoding anything
+	if ( g_state.is_headless ) {
+		return nullptr;
+	}
+
 	auto i = samples_.find( path );
 	if ( i != samples_.end() ) {
 		return &( i->second );
@@ -439,20 +459,29 @@ const AudioSample* AudioManager::GetCachedSample( const std::string& path ) {
 }
 
 AudioSource* AudioManager::CreateSource( const std::string& path, float gain, float pitch, bool looping ) {
+	MEMORY_TAG( MEMORY_TAG_AUDIO );
 	return new AudioSource( GetCachedSample( path ), gain, pitch, looping );
 }
 
 AudioSource* AudioManager::CreateSource( const std::string& path, PLVector3 pos, PLVector3 vel, bool reverb, float gain,
 										 float pitch, bool looping ) {
+	MEMORY_TAG( MEMORY_TAG_AUDIO );
 	return new AudioSource( GetCachedSample( path ), pos, vel, reverb, gain, pitch, looping );
 }
 
 AudioSource* AudioManager::CreateSource( const AudioSample* sample, PLVector3 pos, PLVector3 vel, bool reverb,
 										 float gain, float pitch, bool looping ) {
+	MEMORY_TAG( MEMORY_TAG_AUDIO );
 	return new AudioSource( sample, pos, vel, reverb, gain, pitch, looping );
 }
 
 void AudioManager::Tick() {
+	PROFILE_SCOPE( "Audio" );
+
+	if ( g_state.is_headless ) {
+		return;
+	}
+
 	PLVector3 position = { 0, 0, 0 }, angles = { 0, 0, 0 };
 
 	Camera* camera = Engine::Game()->GetCamera();
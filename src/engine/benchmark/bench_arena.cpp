@@ -0,0 +1,102 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../frame_arena.h"
+
+#include "benchmark.h"
+
+#define BENCHMARK_NUM_NODES     16384
+#define BENCHMARK_NUM_VECTORS   256
+#define BENCHMARK_VECTOR_SIZE   64
+
+/* Each pair below does the same work, once on the heap and once in the
+ * frame arena, in the shape of the transient containers built each frame */
+
+static uint32_t GetKey( unsigned int index ) {
+	uint32_t key = 0x4E4F4445 + index * 2654435761U;
+	key ^= key >> 15U;
+	return key;
+}
+
+template< typename M >
+static void FillMap( M& map ) {
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_NODES; ++i ) {
+		map[ GetKey( i ) % ( BENCHMARK_NUM_NODES / 2 ) ] += i;
+	}
+}
+
+static void Benchmark_MapHeap( BenchmarkTimer& timer ) {
+	timer.Start();
+	{
+		std::map<uint32_t, uint32_t> map;
+		FillMap( map );
+	}
+	timer.Stop();
+
+	timer.SetItems( BENCHMARK_NUM_NODES );
+}
+
+REGISTER_BENCHMARK( "arena.map_heap_baseline", Benchmark_MapHeap )
+
+static void Benchmark_MapArena( BenchmarkTimer& timer ) {
+	timer.Start();
+	{
+		ArenaScope scope( Arena_GetFrame() );
+		ArenaMap<uint32_t, uint32_t> map( std::less<uint32_t>(), Arena_GetFrame() );
+		FillMap( map );
+	}
+	timer.Stop();
+
+	timer.SetItems( BENCHMARK_NUM_NODES );
+}
+
+REGISTER_BENCHMARK( "arena.map", Benchmark_MapArena )
+
+/* Lots of small short-lived vectors, grown without reserving */
+template< typename V, typename F >
+static void FillVectors( F create ) {
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_VECTORS; ++i ) {
+		V vector = create();
+		for ( unsigned int j = 0; j < BENCHMARK_VECTOR_SIZE; ++j ) {
+			vector.push_back( static_cast<float>(i + j) );
+		}
+	}
+}
+
+static void Benchmark_VectorHeap( BenchmarkTimer& timer ) {
+	timer.Start();
+	FillVectors<std::vector<float>>( []() { return std::vector<float>(); } );
+	timer.Stop();
+
+	timer.SetItems( BENCHMARK_NUM_VECTORS * BENCHMARK_VECTOR_SIZE );
+}
+
+REGISTER_BENCHMARK( "arena.vector_heap_baseline", Benchmark_VectorHeap )
+
+static void Benchmark_VectorArena( BenchmarkTimer& timer ) {
+	timer.Start();
+	{
+		ArenaScope scope( Arena_GetFrame() );
+		FillVectors<ArenaVector<float>>( []() { return ArenaVector<float>( Arena_GetFrame() ); } );
+	}
+	timer.Stop();
+
+	timer.SetItems( BENCHMARK_NUM_VECTORS * BENCHMARK_VECTOR_SIZE );
+}
+
+REGISTER_BENCHMARK( "arena.vector", Benchmark_VectorArena )
@@ -0,0 +1,154 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../graphics/font.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+/* A frame's worth of text, about what the console has on screen when it's
+ * full, drawn and flushed with the fixture's font. The baseline goes
+ * through the same glyphs the way they used to be drawn, one mesh upload
+ * and draw for each.
+ */
+
+#define FONT_LINES          40
+#define FONT_LINE_LENGTH    50
+#define FONT_CHARACTERS     ( FONT_LINES * FONT_LINE_LENGTH )
+
+static BitmapFont* GetFont() {
+	static BitmapFont* font = nullptr;
+	if ( font == nullptr ) {
+		font = LoadBitmapFont( FIXTURE_FONT, FIXTURE_FONT );
+		if ( font == nullptr ) {
+			Error( "Failed to load the fixture font!\n" );
+		}
+	}
+	return font;
+}
+
+static const std::vector<std::string>& GetLines() {
+	static std::vector<std::string> lines;
+	if ( lines.empty() ) {
+		uint32_t seed = 0x54455854;
+		for ( unsigned int i = 0; i < FONT_LINES; ++i ) {
+			std::string line;
+			for ( unsigned int j = 0; j < FONT_LINE_LENGTH; ++j ) {
+				line += static_cast<char>('!' + Fixture_Random( &seed ) % FIXTURE_FONT_GLYPHS);
+			}
+			lines.push_back( line );
+		}
+	}
+	return lines;
+}
+
+/**
+ * Strings are clipped against the UI camera, which doesn't exist headless.
+ */
+class FontCameraScope {
+public:
+	FontCameraScope() : old_camera_( g_state.ui_camera ) {
+		g_state.ui_camera = plCreateCamera();
+		g_state.ui_camera->viewport.w = 640;
+		g_state.ui_camera->viewport.h = 480;
+	}
+	~FontCameraScope() {
+		plDestroyCamera( g_state.ui_camera );
+		g_state.ui_camera = old_camera_;
+	}
+
+private:
+	PLCamera* old_camera_;
+};
+
+static void Benchmark_FontDraw( BenchmarkTimer& timer ) {
+	BenchmarkGraphicsScope scope;
+	FontCameraScope camera_scope;
+
+	BitmapFont* font = GetFont();
+	const std::vector<std::string>& lines = GetLines();
+
+	// Font_Flush only goes through the fonts it knows about
+	BitmapFont* old_font = g_fonts[ FONT_SMALL ];
+	g_fonts[ FONT_SMALL ] = font;
+
+	timer.Start();
+	for ( unsigned int i = 0; i < FONT_LINES; ++i ) {
+		Font_DrawBitmapString( font, 0, static_cast<int>(i * FIXTURE_FONT_GLYPH_HEIGHT), 1, 1.f,
+							   PL_COLOUR_GREEN, lines[ i ].c_str() );
+	}
+	Font_Flush();
+	timer.Stop();
+
+	g_fonts[ FONT_SMALL ] = old_font;
+
+	timer.SetItems( FONT_CHARACTERS );
+}
+
+REGISTER_BENCHMARK( "font.draw", Benchmark_FontDraw )
+
+static void Benchmark_FontDrawPerGlyph( BenchmarkTimer& timer ) {
+	BenchmarkGraphicsScope scope;
+	FontCameraScope camera_scope;
+
+	BitmapFont* font = GetFont();
+	const std::vector<std::string>& lines = GetLines();
+
+	static PLMesh* mesh = nullptr;
+	if ( mesh == nullptr ) {
+		mesh = plCreateMesh( PL_MESH_TRIANGLE_STRIP, PL_DRAW_DYNAMIC, 2, 4 );
+	}
+
+	timer.Start();
+	plSetBlendMode( PL_BLEND_ADDITIVE );
+	for ( unsigned int i = 0; i < FONT_LINES; ++i ) {
+		int x = 0;
+		int y = static_cast<int>(i * FIXTURE_FONT_GLYPH_HEIGHT);
+		for ( char character : lines[ i ] ) {
+			const BitmapChar* glyph = &font->chars[ character - 33 ];
+
+			plSetTexture( font->texture, 0 );
+			plClearMesh( mesh );
+			plSetMeshUniformColour( mesh, PL_COLOUR_GREEN );
+
+			plSetMeshVertexPosition( mesh, 0, PLVector3( x, y, 0 ) );
+			plSetMeshVertexPosition( mesh, 1, PLVector3( x, y + glyph->h, 0 ) );
+			plSetMeshVertexPosition( mesh, 2, PLVector3( x + glyph->w, y, 0 ) );
+			plSetMeshVertexPosition( mesh, 3, PLVector3( x + glyph->w, y + glyph->h, 0 ) );
+
+			float tw = ( float ) glyph->w / font->width;
+			float th = ( float ) glyph->h / font->height;
+			plSetMeshVertexST( mesh, 0, glyph->s, glyph->t );
+			plSetMeshVertexST( mesh, 1, glyph->s, glyph->t + th );
+			plSetMeshVertexST( mesh, 2, glyph->s + tw, glyph->t );
+			plSetMeshVertexST( mesh, 3, glyph->s + tw, glyph->t + th );
+
+			plSetNamedShaderUniformMatrix4( NULL, "pl_model", plMatrix4Identity(), false );
+			plUploadMesh( mesh );
+			plDrawMesh( mesh );
+
+			x += glyph->w + 1;
+		}
+	}
+	plSetBlendMode( PL_BLEND_DEFAULT );
+	timer.Stop();
+
+	timer.SetItems( FONT_CHARACTERS );
+}
+
+REGISTER_BENCHMARK( "font.draw_per_glyph_baseline", Benchmark_FontDrawPerGlyph )
@@ -0,0 +1,53 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../manifest_cache.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+/* Registers the fixture's manifests as if for the first time, and then
+ * again as the next run would, with the cache written out and read back.
+ */
+
+static void Benchmark_RegisterCold( BenchmarkTimer& timer ) {
+	ManifestCache_Clear();
+
+	timer.Start();
+	Engine::Game()->RegisterMapManifests( "manifests" );
+	timer.Stop();
+
+	timer.SetItems( FIXTURE_NUM_MANIFESTS );
+}
+
+REGISTER_BENCHMARK( "manifests.register_cold", Benchmark_RegisterCold )
+
+static void Benchmark_RegisterWarm( BenchmarkTimer& timer ) {
+	ManifestCache_Clear();
+	Engine::Game()->RegisterMapManifests( "manifests" );
+	ManifestCache_Save();
+
+	timer.Start();
+	ManifestCache_Load();
+	Engine::Game()->RegisterMapManifests( "manifests" );
+	timer.Stop();
+
+	timer.SetItems( FIXTURE_NUM_MANIFESTS );
+}
+
+REGISTER_BENCHMARK( "manifests.register_warm", Benchmark_RegisterWarm )
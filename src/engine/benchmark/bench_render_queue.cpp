@@ -0,0 +1,88 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+#include "../terrain.h"
+#include "../graphics/render_queue.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+/* Sorts a frame's worth of commands, far more than any level has in it,
+ * against a std::stable_sort of the same keys. Only the sort is timed in
+ * both. The programs are never drawn with, so they only need to be
+ * distinct.
+ */
+
+#define RENDER_QUEUE_COMMANDS   50000
+
+static void SubmitCommands( RenderQueue& queue ) {
+	static PLModel model = {};
+	static PLMatrix4 transform = {};
+
+	uint32_t seed = 0x534F5254;
+	for ( unsigned int i = 0; i < RENDER_QUEUE_COMMANDS; ++i ) {
+		unsigned int layer = Fixture_Random( &seed ) % 4;
+		ShaderProgram* program = reinterpret_cast<ShaderProgram*>(static_cast<uintptr_t>(
+			( Fixture_Random( &seed ) % 32 + 1 ) * 16 ));
+		bool translucent = ( Fixture_Random( &seed ) % 8 ) == 0;
+		PLVector3 origin = {
+			static_cast<float>(Fixture_Random( &seed ) % TERRAIN_PIXEL_WIDTH ),
+			static_cast<float>(Fixture_Random( &seed ) % 2048 ),
+			static_cast<float>(Fixture_Random( &seed ) % TERRAIN_PIXEL_WIDTH ) };
+		queue.Submit( layer, program, &model, transform, origin, translucent );
+	}
+}
+
+static void Benchmark_RenderQueueSort( BenchmarkTimer& timer ) {
+	RenderQueue queue;
+	queue.SetViewOrigin( { TERRAIN_PIXEL_WIDTH / 2, 1024, TERRAIN_PIXEL_WIDTH / 2 } );
+	SubmitCommands( queue );
+
+	timer.Start();
+	queue.Sort();
+	timer.Stop();
+
+	timer.SetItems( RENDER_QUEUE_COMMANDS );
+}
+
+REGISTER_BENCHMARK( "render_queue.sort", Benchmark_RenderQueueSort )
+
+static void Benchmark_RenderQueueSortStd( BenchmarkTimer& timer ) {
+	RenderQueue queue;
+	queue.SetViewOrigin( { TERRAIN_PIXEL_WIDTH / 2, 1024, TERRAIN_PIXEL_WIDTH / 2 } );
+	SubmitCommands( queue );
+
+	// Not sorted yet, so these are still in the order they went in
+	std::vector<std::pair<uint64_t, unsigned int>> keys;
+	for ( unsigned int i = 0; i < queue.GetNumCommands(); ++i ) {
+		keys.emplace_back( queue.GetSortedKey( i ), i );
+	}
+
+	timer.Start();
+	std::stable_sort( keys.begin(), keys.end(), []( const std::pair<uint64_t, unsigned int>& a,
+													 const std::pair<uint64_t, unsigned int>& b ) {
+		return a.first < b.first;
+	} );
+	timer.Stop();
+
+	timer.SetItems( RENDER_QUEUE_COMMANDS );
+}
+
+REGISTER_BENCHMARK( "render_queue.sort_std_baseline", Benchmark_RenderQueueSortStd )
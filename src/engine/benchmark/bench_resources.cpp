@@ -0,0 +1,130 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../graphics/texture_atlas.h"
+#include "../script/script_config.h"
+
+#define STB_VORBIS_HEADER_ONLY
+#include "../audio/stb_vorbis.c"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+PLModel* Model_LoadVtxFile( const char* path );
+
+static void Benchmark_LoadVtx( BenchmarkTimer& timer ) {
+	BenchmarkGraphicsScope scope;
+
+	timer.Start();
+	PLModel* model = Model_LoadVtxFile( Fixture_GetModelPath().c_str() );
+	timer.Stop();
+
+	if ( model == nullptr ) {
+		Error( "Failed to load benchmark model!\n" );
+	}
+
+	timer.SetItems( model->levels[ 0 ].meshes[ 0 ]->num_triangles );
+	plDestroyModel( model );
+}
+
+REGISTER_BENCHMARK( "model.load_vtx", Benchmark_LoadVtx )
+
+static void Benchmark_FinalizeAtlas( BenchmarkTimer& timer ) {
+	BenchmarkGraphicsScope scope;
+
+	TextureAtlas atlas( 512, 8 );
+	for ( const auto& path : Fixture_GetImagePaths() ) {
+		if ( !atlas.AddImage( path, true ) ) {
+			Error( "Failed to add \"%s\" to atlas!\n", path.c_str() );
+		}
+	}
+
+	timer.Start();
+	atlas.Finalize();
+	timer.Stop();
+
+	timer.SetItems( FIXTURE_NUM_IMAGES );
+}
+
+REGISTER_BENCHMARK( "atlas.finalize", Benchmark_FinalizeAtlas )
+
+static void Benchmark_DecodeOgg( BenchmarkTimer& timer ) {
+	const std::vector<uint8_t>& ogg = Fixture_GetOgg();
+
+	int channels, sample_rate;
+	short* output = nullptr;
+
+	timer.Start();
+	int samples = stb_vorbis_decode_memory( ogg.data(), static_cast<int>(ogg.size()), &channels, &sample_rate, &output );
+	timer.Stop();
+
+	if ( samples <= 0 ) {
+		Error( "Failed to decode benchmark audio!\n" );
+	}
+
+	free( output );
+
+	timer.SetItems( static_cast<uint64_t>(samples) );
+}
+
+REGISTER_BENCHMARK( "audio.decode_ogg", Benchmark_DecodeOgg )
+
+/* Parses the buffer and then reads back every property, like the manifests do */
+static void Benchmark_ParseJson( BenchmarkTimer& timer ) {
+	unsigned int num_properties = 0;
+
+	timer.Start();
+	ScriptConfig config;
+	config.ParseBuffer( Fixture_GetJson().c_str() );
+
+	unsigned int num_objects = config.GetArrayLength();
+	for ( unsigned int i = 0; i < num_objects; ++i ) {
+		config.EnterChildNode( i );
+
+		config.GetStringProperty( "name" );
+		config.GetStringProperty( "author" );
+		config.GetStringProperty( "description" );
+		config.GetArrayStrings( "modes" );
+		config.GetColourProperty( "ambientColour" );
+		config.GetFloatProperty( "sunYaw" );
+		config.GetFloatProperty( "sunPitch" );
+		config.GetIntegerProperty( "fogIntensity" );
+		config.GetStringProperty( "temperature" );
+		num_properties += 9;
+
+		unsigned int num_spawns = config.GetArrayLength( "spawns" );
+		config.EnterChildNode( "spawns" );
+		for ( unsigned int j = 0; j < num_spawns; ++j ) {
+			config.EnterChildNode( j );
+			config.GetStringProperty( "class" );
+			config.GetIntegerProperty( "team" );
+			config.GetVector3Property( "position" );
+			config.GetBooleanProperty( "isActive" );
+			config.LeaveChildNode();
+			num_properties += 4;
+		}
+		config.LeaveChildNode();
+
+		config.LeaveChildNode();
+	}
+	timer.Stop();
+
+	timer.SetItems( num_properties );
+}
+
+REGISTER_BENCHMARK( "script.parse_json", Benchmark_ParseJson )
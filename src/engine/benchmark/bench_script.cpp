@@ -0,0 +1,170 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <duktape.h>
+
+#include "../engine.h"
+#include "../memory_tracker.h"
+#include "../script/script_config.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+/* Parses the same text with both the JSON parser configs now use and
+ * with Duktape, which they used before, charging both to the script
+ * tag so that their peak memory can be compared too.
+ */
+
+static std::vector<std::string> mod_scripts;
+
+static void AddModScript( const char* path ) {
+	PLFile* file = plOpenFile( path, false );
+	if ( file == nullptr ) {
+		LogWarn( "Failed to open \"%s\"!\n%s\n", path, plGetError() );
+		return;
+	}
+
+	std::string text( plGetFileSize( file ), '\0' );
+	plReadFile( file, &text[ 0 ], 1, text.size() );
+	plCloseFile( file );
+
+	mod_scripts.push_back( text );
+}
+
+/* Everything under mods, if the benchmark's being run from where the game is */
+static const std::vector<std::string>& GetModScripts() {
+	static bool is_loaded = false;
+	if ( is_loaded ) {
+		return mod_scripts;
+	}
+
+	plScanDirectory( "mods", "json", AddModScript, true );
+	plScanDirectory( "mods", "mod", AddModScript, true );
+	plScanDirectory( "mods", "map", AddModScript, true );
+	if ( mod_scripts.empty() ) {
+		LogWarn( "No scripts found under mods, using the fixture instead!\n" );
+		mod_scripts.push_back( Fixture_GetJson() );
+	} else {
+		LogInfo( "Found %u scripts under mods\n", static_cast<unsigned int>(mod_scripts.size()) );
+	}
+
+	is_loaded = true;
+	return mod_scripts;
+}
+
+static uint64_t GetScriptMemory() {
+	MemoryStats stats;
+	Memory_GetStats( MEMORY_TAG_SCRIPT, &stats );
+	return stats.live_bytes;
+}
+
+static uint64_t GetScriptPeakMemory() {
+	MemoryStats stats;
+	Memory_GetStats( MEMORY_TAG_SCRIPT, &stats );
+	return stats.peak_bytes;
+}
+
+static void ParseScripts( BenchmarkTimer& timer, const std::vector<std::string>& scripts ) {
+	uint64_t base = GetScriptMemory();
+	uint64_t peak = 0;
+	uint64_t bytes = 0;
+	for ( const auto& script : scripts ) {
+		Memory_ResetPeaks();
+
+		timer.Start();
+		{
+			ScriptConfig config;
+			config.ParseBuffer( script.c_str() );
+		}
+		timer.Stop();
+
+		peak = std::max( peak, GetScriptPeakMemory() - base );
+		bytes += script.size();
+	}
+
+	timer.SetItems( bytes );
+	timer.SetPeakMemory( peak );
+}
+
+static void* AllocateScriptMemory( void* user_data, duk_size_t size ) {
+	u_unused( user_data );
+	return Memory_Allocate( size, MEMORY_TAG_SCRIPT );
+}
+
+static void* ReallocateScriptMemory( void* user_data, void* ptr, duk_size_t size ) {
+	u_unused( user_data );
+	return Memory_Reallocate( ptr, size, MEMORY_TAG_SCRIPT );
+}
+
+static void FreeScriptMemory( void* user_data, void* ptr ) {
+	u_unused( user_data );
+	Memory_Free( ptr );
+}
+
+/* A heap for each, as ScriptConfig used to do */
+static void ParseScriptsDuktape( BenchmarkTimer& timer, const std::vector<std::string>& scripts ) {
+	uint64_t base = GetScriptMemory();
+	uint64_t peak = 0;
+	uint64_t bytes = 0;
+	for ( const auto& script : scripts ) {
+		Memory_ResetPeaks();
+
+		timer.Start();
+		duk_context* context = duk_create_heap( AllocateScriptMemory, ReallocateScriptMemory, FreeScriptMemory,
+												nullptr, nullptr );
+		if ( context == nullptr ) {
+			Error( "Failed to create Duktape heap!\n" );
+		}
+
+		duk_push_string( context, script.c_str() );
+		duk_json_decode( context, -1 );
+		duk_destroy_heap( context );
+		timer.Stop();
+
+		peak = std::max( peak, GetScriptPeakMemory() - base );
+		bytes += script.size();
+	}
+
+	timer.SetItems( bytes );
+	timer.SetPeakMemory( peak );
+}
+
+static void Benchmark_ParseMods( BenchmarkTimer& timer ) {
+	ParseScripts( timer, GetModScripts() );
+}
+
+REGISTER_BENCHMARK( "script.parse_mods", Benchmark_ParseMods )
+
+static void Benchmark_ParseModsDuktape( BenchmarkTimer& timer ) {
+	ParseScriptsDuktape( timer, GetModScripts() );
+}
+
+REGISTER_BENCHMARK( "script.parse_mods_duktape_baseline", Benchmark_ParseModsDuktape )
+
+static void Benchmark_ParseFixture( BenchmarkTimer& timer ) {
+	ParseScripts( timer, { Fixture_GetJson() } );
+}
+
+REGISTER_BENCHMARK( "script.parse_fixture", Benchmark_ParseFixture )
+
+static void Benchmark_ParseFixtureDuktape( BenchmarkTimer& timer ) {
+	ParseScriptsDuktape( timer, { Fixture_GetJson() } );
+}
+
+REGISTER_BENCHMARK( "script.parse_fixture_duktape_baseline", Benchmark_ParseFixtureDuktape )
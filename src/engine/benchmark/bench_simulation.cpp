@@ -0,0 +1,424 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+#include "../particle.h"
+#include "../profiler.h"
+#include "../snapshot.h"
+#include "../terrain.h"
+#include "../Map.h"
+#include "../graphics/render_queue.h"
+#include "../game/actor_manager.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+#define BENCHMARK_NUM_PIGS              512
+#define BENCHMARK_NUM_EMITTERS          16
+#define BENCHMARK_EMITTER_PARTICLES     1024
+#define BENCHMARK_PARTICLE_TICKS        10
+#define BENCHMARK_SORT_PARTICLES        100000
+#define BENCHMARK_SORT_REPEATS          10
+#define BENCHMARK_NUM_EXPLOSIONS        1000
+#define BENCHMARK_EXPLOSION_WAVE        100
+#define BENCHMARK_NUM_BODIES            256
+#define BENCHMARK_PHYSICS_TICKS         30
+#define BENCHMARK_CHURN_BODIES          5000
+#define BENCHMARK_CHURN_WAVE            250
+#define BENCHMARK_NUM_SCOPES            100000
+
+using namespace openhow;
+
+/************************************************************/
+/* Actors */
+
+/* Spawned on first use and kept for the rest of the run */
+static const std::vector<Actor*>& GetPigs() {
+	static std::vector<Actor*> pigs;
+	if ( !pigs.empty() ) {
+		return pigs;
+	}
+
+	Fixture_GetMap();
+
+	uint32_t seed = 0x50494753;
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_PIGS; ++i ) {
+		seed = seed * 1664525U + 1013904223U;
+
+		Actor* actor = ActorManager::GetInstance()->CreateActor( "gr_me" );
+		actor->SetPosition( PLVector3(
+			static_cast<float>(seed % TERRAIN_PIXEL_WIDTH ), 1024.0f,
+			static_cast<float>(( seed >> 12U ) % TERRAIN_PIXEL_WIDTH) ) );
+		actor->SetHealth( 100 );
+		actor->Activate();
+		pigs.push_back( actor );
+	}
+
+	return pigs;
+}
+
+static void Benchmark_TickActors( BenchmarkTimer& timer ) {
+	GetPigs();
+
+	timer.Start();
+	ActorManager::GetInstance()->TickActors();
+	timer.Stop();
+
+	timer.SetItems( BENCHMARK_NUM_PIGS );
+}
+
+REGISTER_BENCHMARK( "actors.tick", Benchmark_TickActors )
+
+static void Benchmark_WriteSnapshot( BenchmarkTimer& timer ) {
+	const std::vector<Actor*>& pigs = GetPigs();
+
+	SnapshotWriter writer;
+	timer.Start();
+	for ( auto& pig : pigs ) {
+		pig->WriteSnapshot( writer );
+	}
+	timer.Stop();
+
+	timer.SetItems( writer.GetSize() );
+}
+
+REGISTER_BENCHMARK( "snapshot.write_actors", Benchmark_WriteSnapshot )
+
+static void Benchmark_ReadSnapshot( BenchmarkTimer& timer ) {
+	const std::vector<Actor*>& pigs = GetPigs();
+
+	SnapshotWriter writer;
+	for ( auto& pig : pigs ) {
+		pig->WriteSnapshot( writer );
+	}
+
+	SnapshotReader reader( writer.GetData(), writer.GetSize() );
+	timer.Start();
+	for ( auto& pig : pigs ) {
+		pig->ReadSnapshot( reader );
+	}
+	timer.Stop();
+
+	if ( !reader.IsValid() ) {
+		Error( "Failed to read back actor snapshot!\n" );
+	}
+
+	timer.SetItems( writer.GetSize() );
+}
+
+REGISTER_BENCHMARK( "snapshot.read_actors", Benchmark_ReadSnapshot )
+
+/************************************************************/
+/* Particles */
+
+/* Run until they're all alive, so each tick is the same amount of work */
+static std::vector<ParticleSystem*> CreateParticleSystems() {
+	std::vector<ParticleSystem*> systems;
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_EMITTERS; ++i ) {
+		ParticleSystem* system = GetParticleSystemSlot();
+		if ( system == nullptr ) {
+			Error( "Failed to get particle system slot!\n" );
+		}
+
+		system->position = PLVector3( 1024.0f * static_cast<float>(i), 512.0f, 2048.0f );
+
+		PSEmitter* emitter = AddParticleEmitter( system, BENCHMARK_EMITTER_PARTICLES );
+		emitter->is_looping = true;
+		emitter->lifetime = 60.0f;
+		emitter->spawn_rate = BENCHMARK_EMITTER_PARTICLES * TICKS_PER_SECOND;
+		emitter->velocity = PLVector3( 0, 200.0f, 0 );
+		emitter->velocity_spread = PLVector3( 100.0f, 50.0f, 100.0f );
+		emitter->gravity = PLVector3( 0, -98.0f, 0 );
+
+		systems.push_back( system );
+	}
+
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		SimulateParticles();
+	}
+
+	return systems;
+}
+
+static void DestroyParticleSystems( std::vector<ParticleSystem*>& systems ) {
+	for ( auto& system : systems ) {
+		ClearParticleSystemSlot( system );
+	}
+	systems.clear();
+}
+
+static void Benchmark_SimulateParticles( BenchmarkTimer& timer ) {
+	std::vector<ParticleSystem*> systems = CreateParticleSystems();
+
+	timer.Start();
+	for ( unsigned int i = 0; i < BENCHMARK_PARTICLE_TICKS; ++i ) {
+		SimulateParticles();
+	}
+	timer.Stop();
+
+	timer.SetItems( static_cast<uint64_t>(GetNumActiveParticles()) * BENCHMARK_PARTICLE_TICKS );
+	DestroyParticleSystems( systems );
+}
+
+REGISTER_BENCHMARK( "particles.simulate", Benchmark_SimulateParticles )
+
+static const PLVector3 view_origin( 0, 1024.0f, 0 );
+static const PLVector3 view_forward( 0.6f, -0.2f, 0.77f );
+
+/* Far more particles than are ever allowed to be alive at once, so the
+ * emitter's storage is set up here rather than going through a system */
+struct SortParticles {
+	std::vector<float> position_x, position_y, position_z;
+	std::vector<unsigned int> draw_order;
+	PSEmitter emitter;
+};
+
+static SortParticles* GetSortParticles() {
+	static SortParticles particles;
+	if ( !particles.draw_order.empty() ) {
+		return &particles;
+	}
+
+	particles.position_x.resize( BENCHMARK_SORT_PARTICLES );
+	particles.position_y.resize( BENCHMARK_SORT_PARTICLES );
+	particles.position_z.resize( BENCHMARK_SORT_PARTICLES );
+	particles.draw_order.resize( BENCHMARK_SORT_PARTICLES );
+
+	uint32_t seed = 0x534F5254;
+	for ( unsigned int i = 0; i < BENCHMARK_SORT_PARTICLES; ++i ) {
+		particles.position_x[ i ] = static_cast<float>(Fixture_Random( &seed ) % TERRAIN_PIXEL_WIDTH);
+		particles.position_y[ i ] = static_cast<float>(Fixture_Random( &seed ) % 2048);
+		particles.position_z[ i ] = static_cast<float>(Fixture_Random( &seed ) % TERRAIN_PIXEL_WIDTH);
+	}
+
+	particles.emitter = PSEmitter();
+	particles.emitter.particles.position_x = particles.position_x.data();
+	particles.emitter.particles.position_y = particles.position_y.data();
+	particles.emitter.particles.position_z = particles.position_z.data();
+	particles.emitter.particles.draw_order = particles.draw_order.data();
+	particles.emitter.num_particles = particles.emitter.max_particles = BENCHMARK_SORT_PARTICLES;
+
+	return &particles;
+}
+
+/* From scratch, rather than the near sorted order from the last draw */
+static void Benchmark_SortParticles( BenchmarkTimer& timer ) {
+	SortParticles* particles = GetSortParticles();
+
+	for ( unsigned int i = 0; i < BENCHMARK_SORT_REPEATS; ++i ) {
+		particles->emitter.particles.num_ordered = 0;
+
+		timer.Start();
+		SortParticleEmitter( &particles->emitter, view_origin, view_forward );
+		timer.Stop();
+	}
+
+	timer.SetItems( static_cast<uint64_t>(BENCHMARK_SORT_PARTICLES) * BENCHMARK_SORT_REPEATS );
+}
+
+REGISTER_BENCHMARK( "particles.sort", Benchmark_SortParticles )
+
+/**
+ * The same work done with std::stable_sort, to keep the one above honest;
+ * the same keys are built and sorted, and the order written back.
+ */
+static void Benchmark_SortParticlesBaseline( BenchmarkTimer& timer ) {
+	SortParticles* particles = GetSortParticles();
+	PSParticleData* p = &particles->emitter.particles;
+
+	std::vector<std::pair<uint16_t, unsigned int>> entries;
+	for ( unsigned int i = 0; i < BENCHMARK_SORT_REPEATS; ++i ) {
+		timer.Start();
+		entries.resize( BENCHMARK_SORT_PARTICLES );
+		for ( unsigned int j = 0; j < BENCHMARK_SORT_PARTICLES; ++j ) {
+			float depth =
+				( p->position_x[ j ] - view_origin.x ) * view_forward.x +
+				( p->position_y[ j ] - view_origin.y ) * view_forward.y +
+				( p->position_z[ j ] - view_origin.z ) * view_forward.z;
+			entries[ j ].first = GetParticleSortKey( depth, RENDER_KEY_MAX_DEPTH );
+			entries[ j ].second = j;
+		}
+
+		std::stable_sort( entries.begin(), entries.end(), []( const std::pair<uint16_t, unsigned int>& a,
+															  const std::pair<uint16_t, unsigned int>& b ) {
+			return a.first < b.first;
+		} );
+
+		for ( unsigned int j = 0; j < BENCHMARK_SORT_PARTICLES; ++j ) {
+			p->draw_order[ j ] = entries[ j ].second;
+		}
+		timer.Stop();
+	}
+
+	timer.SetItems( static_cast<uint64_t>(BENCHMARK_SORT_PARTICLES) * BENCHMARK_SORT_REPEATS );
+}
+
+REGISTER_BENCHMARK( "particles.sort_std_baseline", Benchmark_SortParticlesBaseline )
+
+/* Fire, smoke and sparks, all one-shot, like the game's explosions */
+static const PSTemplate* GetExplosionTemplate() {
+	static PSTemplate pst;
+	if ( pst.num_emitters > 0 ) {
+		return &pst;
+	}
+
+	strcpy( pst.name, "explosion" );
+
+	const unsigned int counts[] = { 24, 12, 48 };
+	for ( unsigned int count : counts ) {
+		PSEmitter* emitter = &pst.emitters[ pst.num_emitters++ ].properties;
+		emitter->type = PS_EMITTER_TYPE_SPRITE;
+		emitter->max_particles = count;
+		emitter->lifetime = 1.0f;
+		emitter->start_size = 16.0f;
+		emitter->end_size = 64.0f;
+		emitter->start_colour = emitter->end_colour = PLColour( 255, 255, 255, 255 );
+		emitter->velocity_spread = PLVector3( 200.0f, 200.0f, 200.0f );
+	}
+
+	return &pst;
+}
+
+/* Explosions go off a wave at a time, each wave having played out before
+ * the next, so all but the first are spawned into storage from the pool */
+static void Benchmark_SpawnParticles( BenchmarkTimer& timer ) {
+	const PSTemplate* pst = GetExplosionTemplate();
+
+	std::vector<ParticleSystem*> systems;
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_EXPLOSIONS; i += BENCHMARK_EXPLOSION_WAVE ) {
+		timer.Start();
+		for ( unsigned int j = 0; j < BENCHMARK_EXPLOSION_WAVE; ++j ) {
+			PLVector3 position( 64.0f * static_cast<float>(j), 512.0f, 64.0f * static_cast<float>(i) );
+			ParticleSystem* system = InstantiateParticleTemplate( pst, position );
+			if ( system == nullptr ) {
+				Error( "Failed to spawn explosion!\n" );
+			}
+			systems.push_back( system );
+		}
+		timer.Stop();
+
+		DestroyParticleSystems( systems );
+	}
+
+	timer.SetItems( BENCHMARK_NUM_EXPLOSIONS );
+}
+
+REGISTER_BENCHMARK( "particles.spawn", Benchmark_SpawnParticles )
+
+/************************************************************/
+/* Physics */
+
+static void TickPhysics( BenchmarkTimer& timer, const char* substeps ) {
+	Fixture_GetMap();
+
+	std::string old_substeps = cv_physics_substeps->s_value;
+	plSetConsoleVariable( cv_physics_substeps, substeps );
+
+	// Dropped onto the hills, so there's plenty of contact to resolve
+	std::vector<IPhysicsBody*> bodies;
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_BODIES; ++i ) {
+		PLVector3 position(
+			4096.0f + static_cast<float>(( i % 16 ) * 256),
+			1024.0f + static_cast<float>(i % 3) * 128.0f,
+			4096.0f + static_cast<float>(( i / 16 ) * 256) );
+		bodies.push_back( Engine::Physics()->CreatePhysicsBody(
+			PhysicsPrimitiveType::SPHERE, PLVector3( 48.0f, 48.0f, 48.0f ), 10.0f, position ) );
+	}
+
+	timer.Start();
+	for ( unsigned int i = 0; i < BENCHMARK_PHYSICS_TICKS; ++i ) {
+		Engine::Physics()->Tick();
+	}
+	timer.Stop();
+
+	for ( auto& body : bodies ) {
+		Engine::Physics()->DestroyPhysicsBody( body );
+	}
+
+	plSetConsoleVariable( cv_physics_substeps, old_substeps.c_str() );
+
+	timer.SetItems( BENCHMARK_NUM_BODIES * BENCHMARK_PHYSICS_TICKS );
+}
+
+static void Benchmark_TickPhysics1( BenchmarkTimer& timer ) { TickPhysics( timer, "1" ); }
+static void Benchmark_TickPhysics4( BenchmarkTimer& timer ) { TickPhysics( timer, "4" ); }
+static void Benchmark_TickPhysics8( BenchmarkTimer& timer ) { TickPhysics( timer, "8" ); }
+
+REGISTER_BENCHMARK( "physics.tick_substeps_1", Benchmark_TickPhysics1 )
+REGISTER_BENCHMARK( "physics.tick_substeps_4", Benchmark_TickPhysics4 )
+REGISTER_BENCHMARK( "physics.tick_substeps_8", Benchmark_TickPhysics8 )
+
+/**
+ * Bodies come and go in waves, like debris would, so once the pool's
+ * filled up every one should come out of it, and the physics library
+ * shouldn't need to allocate anything more for them.
+ */
+static void Benchmark_ChurnPhysics( BenchmarkTimer& timer ) {
+	Fixture_GetMap();
+
+	std::vector<IPhysicsBody*> bodies;
+	bodies.reserve( BENCHMARK_CHURN_WAVE );
+
+	uint64_t num_allocations = 0;
+
+	timer.Start();
+	for ( unsigned int i = 0; i < BENCHMARK_CHURN_BODIES; i += BENCHMARK_CHURN_WAVE ) {
+		for ( unsigned int j = 0; j < BENCHMARK_CHURN_WAVE; ++j ) {
+			PLVector3 position(
+				4096.0f + static_cast<float>(( j % 16 ) * 256),
+				1024.0f,
+				4096.0f + static_cast<float>(( j / 16 ) * 256) );
+			bodies.push_back( Engine::Physics()->CreatePhysicsBody(
+				PhysicsPrimitiveType::SPHERE, PLVector3( 48.0f, 48.0f, 48.0f ), 10.0f, position ) );
+		}
+
+		Engine::Physics()->Tick();
+		num_allocations += Engine::Physics()->GetStats().num_allocations;
+
+		for ( auto& body : bodies ) {
+			Engine::Physics()->DestroyPhysicsBody( body );
+		}
+		bodies.clear();
+	}
+	timer.Stop();
+
+	// Retiring the last wave is picked up by whichever tick comes next
+	timer.SetItems( BENCHMARK_CHURN_BODIES );
+	timer.SetAllocations( num_allocations );
+}
+
+REGISTER_BENCHMARK( "physics.pool_churn", Benchmark_ChurnPhysics )
+
+/************************************************************/
+/* Profiler */
+
+/* What an empty scope costs, which is what every instrumented function pays */
+static void Benchmark_ProfileScope( BenchmarkTimer& timer ) {
+	timer.Start();
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_SCOPES; ++i ) {
+		PROFILE_SCOPE( "Benchmark" );
+	}
+	timer.Stop();
+
+	PROFILE_FRAME();
+
+	timer.SetItems( BENCHMARK_NUM_SCOPES );
+}
+
+REGISTER_BENCHMARK( "profiler.scope", Benchmark_ProfileScope )
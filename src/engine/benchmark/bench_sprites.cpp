@@ -0,0 +1,76 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../graphics/sprite_batch.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+/* Submits and builds a heavy frame's worth of particles and billboards,
+ * spread over a handful of textures and both blend modes. Only the CPU
+ * side is timed, as there's nothing to draw with; items/s over a
+ * thousand gives sprites per millisecond.
+ */
+
+#define SPRITES_PER_FRAME   10000
+#define SPRITES_TEXTURES    8
+
+static void Benchmark_SpritesBuild( BenchmarkTimer& timer ) {
+	static SpriteBatcher batcher;
+
+	struct SpriteInput {
+		PLTexture* texture;
+		SpriteBatcher::BlendMode blend;
+		PLVector3 position;
+		float size;
+		PLColour colour;
+	};
+
+	static std::vector<SpriteInput> sprites;
+	if ( sprites.empty() ) {
+		uint32_t seed = 0x53505254;
+		for ( unsigned int i = 0; i < SPRITES_PER_FRAME; ++i ) {
+			SpriteInput sprite;
+			sprite.texture = reinterpret_cast<PLTexture*>(static_cast<uintptr_t>(
+				( Fixture_Random( &seed ) % SPRITES_TEXTURES + 1 ) * 16 ));
+			sprite.blend = ( Fixture_Random( &seed ) % 4 ) == 0 ?
+						   SpriteBatcher::BLEND_DEFAULT : SpriteBatcher::BLEND_ADDITIVE;
+			sprite.position = PLVector3(
+				static_cast<float>(Fixture_Random( &seed ) % 4096),
+				static_cast<float>(Fixture_Random( &seed ) % 1024),
+				static_cast<float>(Fixture_Random( &seed ) % 4096) );
+			sprite.size = static_cast<float>(Fixture_Random( &seed ) % 64 + 1);
+			sprite.colour = PLColour( 255, 255, 255, Fixture_Random( &seed ) % 256 );
+			sprites.push_back( sprite );
+		}
+	}
+
+	timer.Start();
+	batcher.SetView( PLVector3( 0.6f, -0.4f, 0.69282f ) );
+	for ( const auto& sprite : sprites ) {
+		batcher.SubmitBillboard( sprite.texture, sprite.blend, sprite.position, sprite.size, sprite.colour );
+	}
+	batcher.Build();
+	timer.Stop();
+
+	batcher.Clear();
+
+	timer.SetItems( SPRITES_PER_FRAME );
+}
+
+REGISTER_BENCHMARK( "sprites.build", Benchmark_SpritesBuild )
@@ -0,0 +1,92 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+PLModel* Model_LoadVtxFile( const char* path );
+
+/* What the pig models cost. They used to all be loaded while the game
+ * manager was being created, and now only the classes are registered,
+ * with the models the mode's pigs use loaded when it starts. The fixture
+ * model stands in for each of the pigs.
+ */
+
+static void Benchmark_PigModelsEager( BenchmarkTimer& timer ) {
+	BenchmarkGraphicsScope scope;
+
+	for ( unsigned int i = 0; i < FIXTURE_NUM_PIG_CLASSES; ++i ) {
+		timer.Start();
+		PLModel* model = Model_LoadVtxFile( Fixture_GetModelPath().c_str() );
+		timer.Stop();
+
+		if ( model == nullptr ) {
+			Error( "Failed to load benchmark model!\n" );
+		}
+
+		plDestroyModel( model );
+	}
+
+	timer.SetItems( FIXTURE_NUM_PIG_CLASSES );
+}
+
+REGISTER_BENCHMARK( "startup.pig_models_eager_baseline", Benchmark_PigModelsEager )
+
+static void Benchmark_PigModels( BenchmarkTimer& timer ) {
+	BenchmarkGraphicsScope scope;
+
+	// Four teams of grunts, gunners and commandos, plus a spy nobody's playing as
+	static const char* classes[] = { "gr_me", "hv_me", "sb_me" };
+	std::vector<ActorSpawn> spawns;
+	for ( unsigned int i = 0; i < 24; ++i ) {
+		ActorSpawn spawn;
+		spawn.class_name = classes[ i % 3 ];
+		spawn.team = static_cast<uint8_t>(i % 4);
+		spawns.push_back( spawn );
+	}
+	ActorSpawn spy;
+	spy.class_name = "sp_me";
+	spy.team = 4;
+	spawns.push_back( spy );
+
+	timer.Start();
+	Engine::Game()->RegisterClassManifest( Fixture_GetClassesPath() );
+	std::vector<std::string> models = Engine::Game()->GetPigModelsInUse( spawns, 4 );
+	std::vector<PLModel*> loaded;
+	for ( unsigned int i = 0; i < models.size(); ++i ) {
+		loaded.push_back( Model_LoadVtxFile( Fixture_GetModelPath().c_str() ) );
+	}
+	timer.Stop();
+
+	if ( models.size() != 3 ) {
+		Error( "Expected 3 pig models to be used, got %u!\n", static_cast<unsigned int>(models.size()) );
+	}
+
+	for ( auto model : loaded ) {
+		if ( model == nullptr ) {
+			Error( "Failed to load benchmark model!\n" );
+		}
+
+		plDestroyModel( model );
+	}
+
+	timer.SetItems( FIXTURE_NUM_PIG_CLASSES );
+}
+
+REGISTER_BENCHMARK( "startup.pig_models", Benchmark_PigModels )
@@ -0,0 +1,166 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+
+#include "../engine.h"
+#include "../terrain.h"
+#include "../Map.h"
+#include "../graphics/mesh.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+#define BENCHMARK_NUM_TRACES    4096
+
+/* Headless, which is just the heights and the collision */
+static void Benchmark_LoadPmg( BenchmarkTimer& timer ) {
+	Terrain* terrain = Fixture_GetMap()->GetTerrain();
+
+	timer.Start();
+	terrain->LoadPmg( Fixture_GetPmgPath() );
+	timer.Stop();
+
+	timer.SetItems( TERRAIN_CHUNKS );
+}
+
+REGISTER_BENCHMARK( "terrain.load_pmg", Benchmark_LoadPmg )
+
+/* Same again, but with the chunk models, overview and normals */
+static void Benchmark_LoadPmgMeshes( BenchmarkTimer& timer ) {
+	Terrain* terrain;
+	{
+		BenchmarkGraphicsScope scope;
+		terrain = new Terrain( Fixture_GetTilesetPath() );
+
+		timer.Start();
+		terrain->LoadPmg( Fixture_GetPmgPath() );
+		timer.Stop();
+	}
+
+	// Takes the collision with it, so put back the map's
+	delete terrain;
+	Fixture_GetMap()->GetTerrain()->Update();
+
+	timer.SetItems( TERRAIN_CHUNKS );
+}
+
+REGISTER_BENCHMARK( "terrain.load_pmg_meshes", Benchmark_LoadPmgMeshes )
+
+/* Laid out like the terrain chunks, which is what it's usually given */
+static void Benchmark_GenerateNormals( BenchmarkTimer& timer ) {
+	std::list<PLMesh*> meshes;
+	for ( unsigned int chunk = 0; chunk < TERRAIN_CHUNKS; ++chunk ) {
+		PLMesh* mesh = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_DYNAMIC, TERRAIN_CHUNK_TILES * 2,
+									 TERRAIN_CHUNK_TILES * 4 );
+		if ( mesh == nullptr ) {
+			Error( "Failed to create mesh (%s)!\n", plGetError() );
+		}
+
+		unsigned int chunk_x = chunk % TERRAIN_CHUNK_ROW, chunk_y = chunk / TERRAIN_CHUNK_ROW;
+		unsigned int cur_vertex = 0, cur_index = 0;
+		for ( unsigned int tile = 0; tile < TERRAIN_CHUNK_TILES; ++tile ) {
+			unsigned int tile_x = chunk_x * TERRAIN_CHUNK_ROW_TILES + tile % TERRAIN_CHUNK_ROW_TILES;
+			unsigned int tile_y = chunk_y * TERRAIN_CHUNK_ROW_TILES + tile / TERRAIN_CHUNK_ROW_TILES;
+			for ( unsigned int i = 0; i < 4; ++i ) {
+				float x = static_cast<float>(tile_x + i % 2);
+				float z = static_cast<float>(tile_y + i / 2);
+				plSetMeshVertexPosition( mesh, cur_vertex + i, {
+					x * TERRAIN_TILE_PIXEL_WIDTH,
+					400.0f * sinf( x * 0.2f ) * cosf( z * 0.3f ),
+					z * TERRAIN_TILE_PIXEL_WIDTH } );
+			}
+
+			plSetMeshTrianglePosition( mesh, &cur_index, cur_vertex, cur_vertex + 2, cur_vertex + 1 );
+			plSetMeshTrianglePosition( mesh, &cur_index, cur_vertex + 1, cur_vertex + 2, cur_vertex + 3 );
+			cur_vertex += 4;
+		}
+
+		meshes.push_back( mesh );
+	}
+
+	timer.Start();
+	Mesh_GenerateFragmentedMeshNormals( meshes );
+	timer.Stop();
+
+	for ( auto& mesh : meshes ) {
+		plDestroyMesh( mesh );
+	}
+
+	timer.SetItems( TERRAIN_CHUNKS * TERRAIN_CHUNK_TILES * 4 );
+}
+
+REGISTER_BENCHMARK( "mesh.generate_normals", Benchmark_GenerateNormals )
+
+/* Rays from above the hills down at a shallow angle, the same set each time */
+static void GetTrace( unsigned int index, PLVector3* start, PLVector3* end ) {
+	uint32_t seed = 0x54524143 + index * 2654435761U;
+	seed ^= seed >> 15U;
+	seed *= 0x2C1B3C6DU;
+	seed ^= seed >> 12U;
+
+	float x = static_cast<float>(seed % TERRAIN_PIXEL_WIDTH);
+	float z = static_cast<float>(( seed >> 8U ) % TERRAIN_PIXEL_WIDTH);
+	float yaw = plDegreesToRadians( static_cast<float>(seed % 360) );
+
+	*start = PLVector3( x, 2000.0f, z );
+	*end = PLVector3( x + cosf( yaw ) * 8192.0f, -2000.0f, z + sinf( yaw ) * 8192.0f );
+}
+
+static void Benchmark_Trace( BenchmarkTimer& timer ) {
+	Terrain* terrain = Fixture_GetMap()->GetTerrain();
+
+	unsigned int num_hits = 0;
+	timer.Start();
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_TRACES; ++i ) {
+		PLVector3 start, end;
+		GetTrace( i, &start, &end );
+
+		Terrain::TraceHit hit;
+		if ( terrain->Trace( start, end, &hit ) ) {
+			num_hits++;
+		}
+	}
+	timer.Stop();
+
+	u_unused( num_hits );
+	timer.SetItems( BENCHMARK_NUM_TRACES );
+}
+
+REGISTER_BENCHMARK( "terrain.trace", Benchmark_Trace )
+
+static void Benchmark_TraceSphere( BenchmarkTimer& timer ) {
+	Terrain* terrain = Fixture_GetMap()->GetTerrain();
+
+	unsigned int num_hits = 0;
+	timer.Start();
+	for ( unsigned int i = 0; i < BENCHMARK_NUM_TRACES; ++i ) {
+		PLVector3 start, end;
+		GetTrace( i, &start, &end );
+
+		Terrain::TraceHit hit;
+		if ( terrain->TraceSphere( start, end, 64.0f, &hit ) ) {
+			num_hits++;
+		}
+	}
+	timer.Stop();
+
+	u_unused( num_hits );
+	timer.SetItems( BENCHMARK_NUM_TRACES );
+}
+
+REGISTER_BENCHMARK( "terrain.trace_sphere", Benchmark_TraceSphere )
@@ -0,0 +1,314 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <map>
+
+#include "../engine.h"
+#include "../memory_tracker.h"
+#include "../startup.h"
+#include "../script/script_config.h"
+
+#include "benchmark.h"
+#include "fixtures.h"
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+/* Runs every registered benchmark, or just those that match -filter,
+ * against the generated fixtures and writes the results out as JSON.
+ *
+ * -filter <text>       only run benchmarks with this in their name
+ * -time <ms>           how long to spend collecting samples for each
+ * -out <path>          where to write the results (benchmark.json)
+ * -compare <path>      results from a previous run to compare against
+ * -fixtures <path>     where to generate the fixtures
+ *
+ * The engine's started up headless beforehand, and how long each phase
+ * of that took is reported alongside, under startup.
+ */
+
+#define BENCHMARK_DEFAULT_TIME      500
+#define BENCHMARK_MIN_ITERATIONS    5
+#define BENCHMARK_MAX_ITERATIONS    10000
+
+using namespace openhow;
+
+struct BenchmarkResult {
+	std::string name;
+	unsigned int iterations{ 0 };
+	double min{ 0 };
+	double median{ 0 };
+	double mean{ 0 };
+	double p99{ 0 };
+	uint64_t items{ 0 };
+	double items_per_second{ 0 };
+	uint64_t peak_memory{ 0 };
+	uint64_t allocations{ 0 };
+};
+
+static std::map<std::string, BenchmarkFunction>& GetBenchmarks() {
+	// Registrations run before main, so this can't be a plain global
+	static std::map<std::string, BenchmarkFunction> benchmarks;
+	return benchmarks;
+}
+
+BenchmarkRegistration::BenchmarkRegistration( const char* name, BenchmarkFunction function ) {
+	GetBenchmarks()[ name ] = function;
+}
+
+BenchmarkGraphicsScope::BenchmarkGraphicsScope() {
+	g_state.is_headless = false;
+}
+
+BenchmarkGraphicsScope::~BenchmarkGraphicsScope() {
+	g_state.is_headless = true;
+}
+
+static BenchmarkResult RunBenchmark( const std::string& name, BenchmarkFunction function, double duration ) {
+	// Warm up the caches and anything loaded on first use
+	BenchmarkTimer warmup;
+	function( warmup );
+
+	std::vector<double> samples;
+	uint64_t items = warmup.GetItems();
+	uint64_t peak_memory = warmup.GetPeakMemory();
+	uint64_t allocations = warmup.GetAllocations();
+	double total = 0;
+	while ( ( total < duration || samples.size() < BENCHMARK_MIN_ITERATIONS ) &&
+		samples.size() < BENCHMARK_MAX_ITERATIONS ) {
+		BenchmarkTimer timer;
+		function( timer );
+		samples.push_back( timer.GetElapsed() );
+		items = timer.GetItems();
+		peak_memory = std::max( peak_memory, timer.GetPeakMemory() );
+		// The last, rather than the most, as the first few are filling up pools
+		allocations = timer.GetAllocations();
+		total += timer.GetElapsed();
+	}
+
+	std::sort( samples.begin(), samples.end() );
+
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = static_cast<unsigned int>(samples.size());
+	result.min = samples.front();
+	result.median = samples[ samples.size() / 2 ];
+	result.mean = total / samples.size();
+	result.p99 = samples[ std::min( samples.size() - 1, samples.size() * 99 / 100 ) ];
+	result.items = items;
+	result.peak_memory = peak_memory;
+	result.allocations = allocations;
+	if ( result.median > 0 ) {
+		result.items_per_second = static_cast<double>(items) / ( result.median / 1000.0 );
+	}
+
+	return result;
+}
+
+static BenchmarkResult MakeStartupResult( const std::string& name, double ms, uint64_t items ) {
+	BenchmarkResult result;
+	result.name = name;
+	result.iterations = 1;
+	result.min = result.median = result.mean = result.p99 = ms;
+	result.items = items;
+	if ( ms > 0 ) {
+		result.items_per_second = static_cast<double>(items) / ( ms / 1000.0 );
+	}
+	return result;
+}
+
+/**
+ * Startup only happens the once, so rather than being sampled like the
+ * others, each phase goes in as a single iteration with the bytes it
+ * read as its items. Comparing against an earlier run catches a phase
+ * that's got slower, or one that's started reading more than it did.
+ */
+static void AddStartupResults( std::vector<BenchmarkResult>& results, const char* filter ) {
+	std::vector<BenchmarkResult> startup;
+	for ( const auto& phase : Startup_GetPhases() ) {
+		std::string name = std::string( "startup.phase." ) + phase.name;
+		std::transform( name.begin(), name.end(), name.begin(), []( char c ) {
+			return ( c == ' ' ) ? '_' : static_cast<char>(tolower( c ));
+		} );
+		startup.push_back( MakeStartupResult( name, phase.wall_ms, phase.read_bytes ) );
+	}
+
+	startup.push_back( MakeStartupResult( "startup.total", Startup_GetTotalTime(), 0 ) );
+	startup.push_back( MakeStartupResult( "startup.critical_path", Startup_GetCriticalPathTime(), 0 ) );
+
+	for ( const auto& result : startup ) {
+		if ( filter == nullptr || result.name.find( filter ) != std::string::npos ) {
+			results.push_back( result );
+		}
+	}
+}
+
+static bool WriteResults( const std::string& path, const std::vector<BenchmarkResult>& results ) {
+	FILE* fp = fopen( path.c_str(), "w" );
+	if ( fp == nullptr ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return false;
+	}
+
+	fprintf( fp, "{\n  \"engine\": \"%s\",\n  \"benchmarks\": [\n", engine->GetVersionString().c_str() );
+	for ( size_t i = 0; i < results.size(); ++i ) {
+		const BenchmarkResult& result = results[ i ];
+		fprintf( fp, "    { \"name\": \"%s\", \"iterations\": %u, "
+					 "\"min_ms\": %.6f, \"median_ms\": %.6f, \"mean_ms\": %.6f, \"p99_ms\": %.6f, "
+					 "\"items\": %llu, \"items_per_second\": %.1f, \"peak_bytes\": %llu, \"allocations\": %llu }%s\n",
+				 result.name.c_str(), result.iterations,
+				 result.min, result.median, result.mean, result.p99,
+				 static_cast<unsigned long long>(result.items), result.items_per_second,
+				 static_cast<unsigned long long>(result.peak_memory),
+				 static_cast<unsigned long long>(result.allocations),
+				 ( i + 1 < results.size() ) ? "," : "" );
+	}
+	fprintf( fp, "  ]\n}\n" );
+	fclose( fp );
+
+	LogInfo( "Wrote results to \"%s\"\n", path.c_str() );
+	return true;
+}
+
+static std::map<std::string, double> ReadResults( const std::string& path ) {
+	std::map<std::string, double> medians;
+	try {
+		ScriptConfig config( path );
+		config.EnterChildNode( "benchmarks" );
+		unsigned int num_benchmarks = config.GetArrayLength();
+		for ( unsigned int i = 0; i < num_benchmarks; ++i ) {
+			config.EnterChildNode( i );
+			medians[ config.GetStringProperty( "name" ) ] = config.GetFloatProperty( "median_ms" );
+			config.LeaveChildNode();
+		}
+	} catch ( const std::exception& e ) {
+		LogWarn( "Failed to read previous results, \"%s\"!\n%s\n", path.c_str(), e.what() );
+	}
+
+	return medians;
+}
+
+static void PrintResults( const std::vector<BenchmarkResult>& results, const std::map<std::string, double>& baseline ) {
+	LogInfo( "%-32s %8s %10s %10s %10s %14s %10s %8s %8s\n",
+			 "benchmark", "iters", "min ms", "median ms", "p99 ms", "items/s", "peak KB", "allocs", "change" );
+	for ( const auto& result : results ) {
+		char change[16] = "";
+		auto i = baseline.find( result.name );
+		if ( i != baseline.end() && i->second > 0 ) {
+			snprintf( change, sizeof( change ), "%+.1f%%", ( result.median - i->second ) / i->second * 100.0 );
+		}
+
+		char peak[16] = "";
+		if ( result.peak_memory > 0 ) {
+			snprintf( peak, sizeof( peak ), "%.1f", result.peak_memory / 1024.0 );
+		}
+
+		char allocations[24] = "";
+		if ( result.allocations > 0 ) {
+			snprintf( allocations, sizeof( allocations ), "%llu", static_cast<unsigned long long>(result.allocations) );
+		}
+
+		LogInfo( "%-32s %8u %10.3f %10.3f %10.3f %14.0f %10s %8s %8s\n",
+				 result.name.c_str(), result.iterations, result.min, result.median, result.p99,
+				 result.items_per_second, peak, allocations, change );
+	}
+}
+
+static void* u_malloc( size_t size ) {
+	return u_alloc( 1, size, true );
+}
+
+static void* u_calloc( size_t num, size_t size ) {
+	return u_alloc( num, size, true );
+}
+
+int main( int argc, char** argv ) {
+	pl_malloc = u_malloc;
+	pl_calloc = u_calloc;
+
+	plInitialize( argc, argv );
+	// Graphics without a mode, so meshes and textures can be created but never go anywhere
+	plInitializeSubSystems( PL_SUBSYSTEM_IO | PL_SUBSYSTEM_GRAPHICS );
+
+	plRegisterStandardPackageLoaders();
+
+	plMountLocalLocation( plGetWorkingDirectory() );
+
+	char appDataPath[PL_SYSTEM_MAX_PATH];
+	plGetApplicationDataDirectory( ENGINE_APP_NAME, appDataPath, PL_SYSTEM_MAX_PATH );
+	plCreatePath( appDataPath );
+	plMountLocalLocation( appDataPath );
+
+	std::string log_path = std::string( appDataPath ) + "/benchmark";
+	u_init_logs( log_path.c_str() );
+
+	g_state.is_headless = true;
+
+	if ( SDL_Init( SDL_INIT_TIMER | SDL_INIT_EVENTS ) != 0 ) {
+		LogWarn( "Failed to initialize SDL2!\n%s\n", SDL_GetError() );
+		return EXIT_FAILURE;
+	}
+
+	const char* arg = plGetCommandLineArgumentValue( "-fixtures" );
+	if ( !Fixture_Generate( arg != nullptr ? arg : "benchmark_fixtures" ) ) {
+		LogWarn( "Failed to generate fixtures!\n" );
+		return EXIT_FAILURE;
+	}
+
+	engine = new Engine();
+	engine->Initialize();
+
+	// Fetched now, while headless, so it's never uploaded
+	Engine::Resource()->GetFallbackTexture();
+
+	const char* filter = plGetCommandLineArgumentValue( "-filter" );
+	arg = plGetCommandLineArgumentValue( "-time" );
+	double duration = ( arg != nullptr ) ? strtod( arg, nullptr ) : BENCHMARK_DEFAULT_TIME;
+
+	std::vector<BenchmarkResult> results;
+	// Startup's already been and gone, with the engine running headless
+	AddStartupResults( results, filter );
+
+	for ( const auto& benchmark : GetBenchmarks() ) {
+		if ( filter != nullptr && benchmark.first.find( filter ) == std::string::npos ) {
+			continue;
+		}
+
+		LogInfo( "Running \"%s\"...\n", benchmark.first.c_str() );
+		results.push_back( RunBenchmark( benchmark.first, benchmark.second, duration ) );
+	}
+
+	std::map<std::string, double> baseline;
+	if ( ( arg = plGetCommandLineArgumentValue( "-compare" ) ) != nullptr ) {
+		baseline = ReadResults( arg );
+	}
+
+	PrintResults( results, baseline );
+
+	arg = plGetCommandLineArgumentValue( "-out" );
+	bool status = WriteResults( arg != nullptr ? arg : "benchmark.json", results );
+
+	delete engine;
+
+	Memory_Shutdown();
+
+	SDL_Quit();
+	plShutdown();
+
+	return status ? EXIT_SUCCESS : EXIT_FAILURE;
+}
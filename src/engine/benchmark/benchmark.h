@@ -0,0 +1,75 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/* Each benchmark is a function that runs a single iteration, timing
+ * only the part it's interested in, so that any setup or tidying up
+ * either side is left out. The runner calls it over and over until
+ * it's collected enough samples; see benchmark.cpp for the options.
+ */
+
+class BenchmarkTimer {
+public:
+	void Start() { start_ = std::chrono::steady_clock::now(); }
+	void Stop() {
+		elapsed_ += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start_ ).count();
+	}
+
+	// Whatever was processed by the iteration, i.e. triangles or rays,
+	// which is used to work out the throughput
+	void SetItems( uint64_t items ) { items_ = items; }
+	// Optional, the most memory the iteration had allocated at once
+	void SetPeakMemory( uint64_t bytes ) { peak_memory_ = bytes; }
+	// Optional, how many allocations the iteration made
+	void SetAllocations( uint64_t allocations ) { allocations_ = allocations; }
+
+	double GetElapsed() const { return elapsed_; }
+	uint64_t GetItems() const { return items_; }
+	uint64_t GetPeakMemory() const { return peak_memory_; }
+	uint64_t GetAllocations() const { return allocations_; }
+
+private:
+	std::chrono::steady_clock::time_point start_;
+	double elapsed_{ 0 };
+	uint64_t items_{ 0 };
+	uint64_t peak_memory_{ 0 };
+	uint64_t allocations_{ 0 };
+};
+
+typedef void ( * BenchmarkFunction )( BenchmarkTimer& timer );
+
+class BenchmarkRegistration {
+public:
+	BenchmarkRegistration( const char* name, BenchmarkFunction function );
+};
+
+#define REGISTER_BENCHMARK( NAME, FUNCTION ) \
+    static BenchmarkRegistration _reg_benchmark_ ## FUNCTION( ( NAME ), FUNCTION ); // NOLINT(cert-err58-cpp)
+
+/* Builds everything a draw would need, with nothing there to draw it.
+ * The benchmark runs headless, and there's no graphics mode, so any
+ * uploads are left unbound and it's only the CPU side that's timed.
+ */
+class BenchmarkGraphicsScope {
+public:
+	BenchmarkGraphicsScope();
+	~BenchmarkGraphicsScope();
+};
@@ -0,0 +1,818 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "../engine.h"
+#include "../frame_arena.h"
+#include "../journal.h"
+#include "../particle.h"
+#include "../savegame.h"
+#include "../terrain.h"
+#include "../Map.h"
+#include "../loaders/loaders.h"
+
+#include "fixtures.h"
+
+using namespace openhow;
+
+static struct {
+	std::string directory;
+
+	std::string json;
+	std::vector<uint8_t> ogg;
+} fixtures;
+
+/* xorshift, so the fixtures come out the same everywhere */
+uint32_t Fixture_Random( uint32_t* seed ) {
+	*seed ^= *seed << 13U;
+	*seed ^= *seed >> 17U;
+	*seed ^= *seed << 5U;
+	return *seed;
+}
+
+template<typename T>
+static void WriteValue( std::ofstream& output, const T& value ) {
+	output.write( reinterpret_cast<const char*>(&value), sizeof( T ) );
+}
+
+static bool CreateDirectory( const std::string& path ) {
+	if ( !plCreatePath( path.c_str() ) ) {
+		LogWarn( "Failed to create \"%s\" (%s)!\n", path.c_str(), plGetError() );
+		return false;
+	}
+
+	return true;
+}
+
+/************************************************************/
+/* Images */
+
+static bool WriteImage( const std::string& path, unsigned int width, unsigned int height, uint32_t seed ) {
+	int base[3] = {
+		static_cast<int>(Fixture_Random( &seed ) % 224),
+		static_cast<int>(Fixture_Random( &seed ) % 224),
+		static_cast<int>(Fixture_Random( &seed ) % 224) };
+
+	// Checks, with a bit of noise so nothing compresses down to nothing
+	std::vector<uint8_t> pixels( width * height * 4 );
+	for ( unsigned int y = 0, i = 0; y < height; ++y ) {
+		for ( unsigned int x = 0; x < width; ++x, i += 4 ) {
+			uint8_t shade = ( ( ( x / 8 ) + ( y / 8 ) ) & 1 ) ? 32 : 0;
+			uint8_t noise = Fixture_Random( &seed ) % 16;
+			for ( unsigned int j = 0; j < 3; ++j ) {
+				pixels[ i + j ] = static_cast<uint8_t>(std::min( base[ j ] + shade + noise, 255 ));
+			}
+			pixels[ i + 3 ] = 255;
+		}
+	}
+
+	PLImage* image = plCreateImage( pixels.data(), width, height, PL_COLOURFORMAT_RGBA, PL_IMAGEFORMAT_RGBA8 );
+	if ( image == nullptr ) {
+		LogWarn( "Failed to create image for \"%s\" (%s)!\n", path.c_str(), plGetError() );
+		return false;
+	}
+
+	bool status = plWriteImage( image, path.c_str() );
+	plDestroyImage( image );
+	if ( !status ) {
+		LogWarn( "Failed to write \"%s\" (%s)!\n", path.c_str(), plGetError() );
+	}
+
+	return status;
+}
+
+/************************************************************/
+/* Terrain */
+
+static int16_t GetFixtureHeight( unsigned int x, unsigned int y ) {
+	float height =
+		600.0f * sinf( static_cast<float>(x) * 0.11f ) +
+		400.0f * cosf( static_cast<float>(y) * 0.07f ) +
+		150.0f * sinf( static_cast<float>(x + y) * 0.31f );
+	return static_cast<int16_t>(height);
+}
+
+/**
+ * Heights are taken from a function over the whole map rather
+ * than each chunk, so the edges of neighbouring chunks line up.
+ */
+static bool WritePmg( const std::string& path ) {
+	std::ofstream output( path, std::ios::binary );
+	if ( !output.is_open() ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return false;
+	}
+
+	uint32_t seed = 0x504D4721;
+	for ( unsigned int chunk_y = 0; chunk_y < TERRAIN_CHUNK_ROW; ++chunk_y ) {
+		for ( unsigned int chunk_x = 0; chunk_x < TERRAIN_CHUNK_ROW; ++chunk_x ) {
+			uint16_t offsets[4] = {
+				static_cast<uint16_t>(chunk_x * TERRAIN_CHUNK_PIXEL_WIDTH / 4), 0,
+				static_cast<uint16_t>(chunk_y * TERRAIN_CHUNK_PIXEL_WIDTH / 4), 0 };
+			output.write( reinterpret_cast<const char*>(offsets), sizeof( offsets ) );
+
+			for ( unsigned int vertex_y = 0; vertex_y <= TERRAIN_CHUNK_ROW_TILES; ++vertex_y ) {
+				for ( unsigned int vertex_x = 0; vertex_x <= TERRAIN_CHUNK_ROW_TILES; ++vertex_x ) {
+					unsigned int x = chunk_x * TERRAIN_CHUNK_ROW_TILES + vertex_x;
+					unsigned int y = chunk_y * TERRAIN_CHUNK_ROW_TILES + vertex_y;
+					WriteValue<int16_t>( output, GetFixtureHeight( x, y ) );
+					WriteValue<uint16_t>( output, static_cast<uint16_t>(96 + ( x * 7 + y * 3 ) % 128) );
+				}
+			}
+
+			WriteValue<uint32_t>( output, 0 );
+
+			for ( unsigned int i = 0; i < TERRAIN_CHUNK_TILES; ++i ) {
+				uint8_t unused[6] = {};
+				output.write( reinterpret_cast<const char*>(unused), sizeof( unused ) );
+
+				uint32_t r = Fixture_Random( &seed );
+				uint8_t type = r % 12;
+				if ( ( r >> 8U ) % 64 == 0 ) {
+					type |= Terrain::Tile::BEHAVIOUR_MINE;
+				}
+
+				WriteValue<uint8_t>( output, type );
+				WriteValue<uint8_t>( output, 0 );
+				WriteValue<int16_t>( output, 0 );
+				WriteValue<uint8_t>( output, static_cast<uint8_t>(( r >> 16U ) % 8) );
+				WriteValue<uint32_t>( output, ( r >> 20U ) % FIXTURE_NUM_TILES );
+				WriteValue<uint8_t>( output, 0 );
+			}
+		}
+	}
+
+	return output.good();
+}
+
+static bool WriteMap() {
+	std::string path = Fixture_GetPath( "maps/" FIXTURE_MAP ".map" );
+	std::ofstream output( path );
+	if ( !output.is_open() ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return false;
+	}
+
+	output <<
+		   "{\n"
+		   "  \"name\": \"Benchmark\",\n"
+		   "  \"author\": \"none\",\n"
+		   "  \"description\": \"Generated for the benchmarks\",\n"
+		   "  \"modes\": [\"singleplayer\"],\n"
+		   "  \"time\": \"day\"\n"
+		   "}\n";
+	output.close();
+
+	if ( !CreateDirectory( Fixture_GetTilesetPath() ) ) {
+		return false;
+	}
+
+	for ( unsigned int i = 0; i < FIXTURE_NUM_TILES; ++i ) {
+		if ( !WriteImage( Fixture_GetTilesetPath() + std::to_string( i ) + ".png", 32, 32, 0x54494C45 + i ) ) {
+			return false;
+		}
+	}
+
+	return WritePmg( Fixture_GetPmgPath() );
+}
+
+/**
+ * Lots of small manifests, written out the same way the
+ * editor does, for timing how long it takes to register them.
+ */
+static bool WriteManifests() {
+	uint32_t seed = 0x4D414E49;
+	for ( unsigned int i = 0; i < FIXTURE_NUM_MANIFESTS; ++i ) {
+		MapManifest manifest;
+		manifest.name = "$map_bench_" + std::to_string( i );
+		manifest.description = "Generated for the benchmarks";
+		manifest.modes = { "singleplayer", "deathmatch" };
+		manifest.sun_yaw = ( Fixture_Random( &seed ) % 6283 ) / 1000.0f;
+		manifest.sun_pitch = ( Fixture_Random( &seed ) % 1570 ) / 1000.0f;
+		manifest.fog_intensity = static_cast<float>(Fixture_Random( &seed ) % 100);
+
+		std::string path = Fixture_GetPath( "manifests/" ) + std::to_string( i ) + ".map";
+		std::ofstream output( path );
+		if ( !output.is_open() ) {
+			LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+			return false;
+		}
+
+		output << manifest.Serialize();
+	}
+
+	return true;
+}
+
+/**
+ * The same nine models the game used to load up front.
+ */
+static bool WriteClasses() {
+	static const char* keys[ FIXTURE_NUM_PIG_CLASSES ] = { "ac", "sb", "gr", "hv", "le", "me", "sa", "sn", "sp" };
+
+	std::string path = Fixture_GetClassesPath();
+	std::ofstream output( path );
+	if ( !output.is_open() ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return false;
+	}
+
+	output << "[\n";
+	for ( unsigned int i = 0; i < FIXTURE_NUM_PIG_CLASSES; ++i ) {
+		output << "  { \"key\": \"" << keys[ i ] << "\", \"label\": \"$" << keys[ i ] << "Class\", "
+			   << "\"model\": \"pigs/" << keys[ i ] << "_hi\" }"
+			   << ( ( i < FIXTURE_NUM_PIG_CLASSES - 1 ) ? ",\n" : "\n" );
+	}
+	output << "]\n";
+
+	return output.good();
+}
+
+/************************************************************/
+/* Fonts */
+
+/**
+ * Glyphs are laid out in rows from the top left, as in the originals,
+ * and the tab has the same 16 byte header in front of them.
+ */
+static bool WriteFont() {
+	const unsigned int width = 256;
+	const unsigned int height = 64;
+
+	std::string path = Fixture_GetPath( "frontend/text/" FIXTURE_FONT ".tab" );
+	std::ofstream output( path, std::ios::binary );
+	if ( !output.is_open() ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return false;
+	}
+
+	for ( unsigned int i = 0; i < 16; ++i ) {
+		WriteValue< uint8_t >( output, 0 );
+	}
+
+	uint16_t x = 0, y = 0;
+	for ( unsigned int i = 0; i < FIXTURE_FONT_GLYPHS; ++i ) {
+		uint16_t w = FIXTURE_FONT_GLYPH_WIDTH( i );
+		if ( x + w > width ) {
+			x = 0;
+			y += FIXTURE_FONT_GLYPH_HEIGHT;
+		}
+
+		WriteValue( output, x );
+		WriteValue( output, y );
+		WriteValue( output, w );
+		WriteValue< uint16_t >( output, FIXTURE_FONT_GLYPH_HEIGHT );
+		x += w;
+	}
+
+	if ( !output.good() ) {
+		return false;
+	}
+
+	return WriteImage( Fixture_GetPath( "frontend/text/" FIXTURE_FONT ".png" ), width, height, 0x464F4E54 );
+}
+
+/************************************************************/
+/* Models */
+
+static bool WriteModel() {
+	std::string path = Fixture_GetModelPath();
+	std::ofstream output( path, std::ios::binary );
+	if ( !output.is_open() ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return false;
+	}
+
+	// Rings of vertices from pole to pole, with the seam doubled up
+	const unsigned int rings = FIXTURE_MODEL_RINGS, segments = FIXTURE_MODEL_SEGMENTS;
+	for ( unsigned int ring = 0; ring <= rings; ++ring ) {
+		float pitch = plDegreesToRadians( 180.0f * static_cast<float>(ring) / rings );
+		for ( unsigned int segment = 0; segment <= segments; ++segment ) {
+			float yaw = plDegreesToRadians( 360.0f * static_cast<float>(segment) / segments );
+			int16_t coord[3] = {
+				static_cast<int16_t>(200.0f * sinf( pitch ) * cosf( yaw )),
+				static_cast<int16_t>(200.0f * cosf( pitch )),
+				static_cast<int16_t>(200.0f * sinf( pitch ) * sinf( yaw )) };
+			output.write( reinterpret_cast<const char*>(coord), sizeof( coord ) );
+			WriteValue<uint16_t>( output, static_cast<uint16_t>(ring * 15 / rings) );
+		}
+	}
+	output.close();
+
+	std::vector<FacTriangle> triangles;
+	for ( unsigned int ring = 0; ring < rings; ++ring ) {
+		for ( unsigned int segment = 0; segment < segments; ++segment ) {
+			auto a = static_cast<uint16_t>(ring * ( segments + 1 ) + segment);
+			auto b = static_cast<uint16_t>(a + segments + 1);
+			auto u = static_cast<int8_t>(( segment * 64 / segments ) % 64);
+			auto v = static_cast<int8_t>(( ring * 64 / rings ) % 64);
+			uint32_t texture = ( ring / 6 ) % FIXTURE_NUM_MODEL_TEXTURES;
+
+			FacTriangle triangle = {};
+			triangle.texture_index = texture;
+			triangle.vertex_indices[ 0 ] = a;
+			triangle.vertex_indices[ 1 ] = b;
+			triangle.vertex_indices[ 2 ] = static_cast<uint16_t>(a + 1);
+			int8_t first[6] = { u, v, u, static_cast<int8_t>(v + 2), static_cast<int8_t>(u + 2), v };
+			memcpy( triangle.uv_coords, first, sizeof( first ) );
+			triangles.push_back( triangle );
+
+			triangle.vertex_indices[ 0 ] = static_cast<uint16_t>(a + 1);
+			triangle.vertex_indices[ 1 ] = b;
+			triangle.vertex_indices[ 2 ] = static_cast<uint16_t>(b + 1);
+			int8_t second[6] = {
+				static_cast<int8_t>(u + 2), v, u, static_cast<int8_t>(v + 2),
+				static_cast<int8_t>(u + 2), static_cast<int8_t>(v + 2) };
+			memcpy( triangle.uv_coords, second, sizeof( second ) );
+			triangles.push_back( triangle );
+		}
+	}
+
+	FacTextureIndex textures[FIXTURE_NUM_MODEL_TEXTURES] = {};
+	for ( unsigned int i = 0; i < FIXTURE_NUM_MODEL_TEXTURES; ++i ) {
+		snprintf( textures[ i ].name, sizeof( textures[ i ].name ), "bench%u", i );
+
+		std::string texture_path = Fixture_GetPath( "models/" ) + textures[ i ].name + ".png";
+		if ( !WriteImage( texture_path, 64, 64, 0x4D4F444C + i ) ) {
+			return false;
+		}
+	}
+
+	FacHandle fac;
+	fac.triangles = triangles.data();
+	fac.num_triangles = static_cast<unsigned int>(triangles.size());
+	fac.texture_table = textures;
+	fac.texture_table_size = FIXTURE_NUM_MODEL_TEXTURES;
+
+	std::string fac_path = path.substr( 0, path.size() - 3 ) + "fac";
+	Fac_WriteFile( &fac, fac_path.c_str() );
+	return plFileExists( fac_path.c_str() );
+}
+
+static bool WriteImages() {
+	std::vector<std::string> paths = Fixture_GetImagePaths();
+	for ( unsigned int i = 0; i < paths.size(); ++i ) {
+		// Mostly small, with the odd larger one, much like the game's own
+		unsigned int width = 16U << ( i % 4 );
+		unsigned int height = 16U << ( ( i / 4 ) % 3 );
+		if ( !WriteImage( paths[ i ], width, height, 0x494D4147 + i ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/************************************************************/
+/* Scripts */
+
+/**
+ * Objects shaped like the map manifests, each with a list
+ * of spawns, so there's a bit of everything to parse.
+ */
+static std::string GenerateJson() {
+	uint32_t seed = 0x4A534F4E;
+
+	std::stringstream stream;
+	stream << "[\n";
+	for ( unsigned int i = 0; i < FIXTURE_NUM_JSON_OBJECTS; ++i ) {
+		stream <<
+			   "  {\n"
+			   "    \"name\": \"$map_bench_" << i << "\",\n"
+			   "    \"author\": \"none\",\n"
+			   "    \"description\": \"Generated map number " << i << ", with \\\"quotes\\\" and \\u00e9scapes\",\n"
+			   "    \"modes\": [\"singleplayer\", \"deathmatch\", \"survival\"],\n"
+			   "    \"ambientColour\": \"" << Fixture_Random( &seed ) % 256 << " " << Fixture_Random( &seed ) % 256 << " "
+			   << Fixture_Random( &seed ) % 256 << "\",\n"
+			   "    \"sunYaw\": " << ( Fixture_Random( &seed ) % 6283 ) / 1000.0f << ",\n"
+			   "    \"sunPitch\": \"" << ( Fixture_Random( &seed ) % 1570 ) / 1000.0f << "\",\n"
+			   "    \"fogIntensity\": " << Fixture_Random( &seed ) % 100 << ",\n"
+			   "    \"temperature\": \"" << ( ( i & 1 ) ? "hot" : "cold" ) << "\",\n"
+			   "    \"spawns\": [\n";
+
+		for ( unsigned int j = 0; j < 8; ++j ) {
+			stream <<
+				   "      { \"class\": \"gr_me\", \"team\": " << j % 4 <<
+				   ", \"position\": \"" << Fixture_Random( &seed ) % 32768 << " " << Fixture_Random( &seed ) % 1024 << " "
+				   << Fixture_Random( &seed ) % 32768 << "\", \"isActive\": " << ( ( j & 1 ) ? "true" : "false" ) << " }"
+				   << ( j < 7 ? ",\n" : "\n" );
+		}
+
+		stream << "    ]\n  }" << ( i + 1 < FIXTURE_NUM_JSON_OBJECTS ? ",\n" : "\n" );
+	}
+	stream << "]\n";
+
+	return stream.str();
+}
+
+/************************************************************/
+/* Audio */
+
+/* There's no encoder to hand, so this writes out a Vorbis stream by
+ * hand. It's about as simple as one can be while still using every
+ * stage of the decoder: mono, short blocks only, a flat floor and a
+ * single scalar codebook for the residue. The spectrum is a slowly
+ * sweeping peak over a little noise.
+ */
+
+#define OGG_BLOCK_EXPONENT      8
+#define OGG_BLOCK_SIZE          ( 1U << OGG_BLOCK_EXPONENT )
+#define OGG_PARTITION_SIZE      16
+#define OGG_SAMPLE_RATE         22050
+#define OGG_VALUE_BITS          5
+#define OGG_VALUE_BIAS          15      // Values run from -15 to 16
+#define OGG_FLOOR               180
+#define OGG_PACKETS_PER_PAGE    32
+
+class OggBitWriter {
+public:
+	// Least significant bit first, as everything in Vorbis is
+	void Write( uint32_t value, unsigned int num_bits ) {
+		for ( unsigned int i = 0; i < num_bits; ++i, ++num_bits_ ) {
+			if ( ( num_bits_ & 7U ) == 0 ) {
+				bytes_.push_back( 0 );
+			}
+			if ( ( value >> i ) & 1U ) {
+				bytes_.back() |= static_cast<uint8_t>(1U << ( num_bits_ & 7U ));
+			}
+		}
+	}
+
+	// Huffman codewords are read a bit at a time from the top
+	void WriteCodeword( uint32_t codeword, unsigned int length ) {
+		for ( unsigned int i = length; i > 0; --i ) {
+			Write( ( codeword >> ( i - 1 ) ) & 1U, 1 );
+		}
+	}
+
+	void WriteString( const char* string ) {
+		for ( ; *string != '\0'; ++string ) {
+			Write( static_cast<uint8_t>(*string), 8 );
+		}
+	}
+
+	void WriteHeader( uint8_t type ) {
+		Write( type, 8 );
+		WriteString( "vorbis" );
+	}
+
+	const std::vector<uint8_t>& GetBytes() const { return bytes_; }
+
+private:
+	std::vector<uint8_t> bytes_;
+	unsigned int num_bits_{ 0 };
+};
+
+// Vorbis' own float format, for whole numbers
+static uint32_t PackVorbisFloat( int value ) {
+	return ( value < 0 ? 0x80000000U : 0 ) | ( 788U << 21U ) | static_cast<uint32_t>(std::abs( value ));
+}
+
+static std::vector<uint8_t> WriteVorbisIdentification() {
+	OggBitWriter writer;
+	writer.WriteHeader( 1 );
+	writer.Write( 0, 32 );                  // version
+	writer.Write( 1, 8 );                   // channels
+	writer.Write( OGG_SAMPLE_RATE, 32 );
+	writer.Write( 0, 32 );                  // maximum, nominal and minimum bitrates
+	writer.Write( 0, 32 );
+	writer.Write( 0, 32 );
+	writer.Write( OGG_BLOCK_EXPONENT, 4 );  // short and long block sizes
+	writer.Write( OGG_BLOCK_EXPONENT, 4 );
+	writer.Write( 1, 1 );
+	return writer.GetBytes();
+}
+
+static std::vector<uint8_t> WriteVorbisComment() {
+	static const char vendor[] = "OpenHoW";
+
+	OggBitWriter writer;
+	writer.WriteHeader( 3 );
+	writer.Write( sizeof( vendor ) - 1, 32 );
+	writer.WriteString( vendor );
+	writer.Write( 0, 32 );                  // user comments
+	writer.Write( 1, 1 );
+	return writer.GetBytes();
+}
+
+static std::vector<uint8_t> WriteVorbisSetup() {
+	OggBitWriter writer;
+	writer.WriteHeader( 5 );
+
+	writer.Write( 2 - 1, 8 );
+
+	// Residue classes, either nothing or values
+	writer.Write( 0x564342, 24 );
+	writer.Write( 1, 16 );                  // dimensions
+	writer.Write( 2, 24 );                  // entries
+	writer.Write( 0, 2 );                   // unordered, not sparse
+	writer.Write( 1 - 1, 5 );
+	writer.Write( 1 - 1, 5 );
+	writer.Write( 0, 4 );                   // no lookup
+
+	// Residue values
+	writer.Write( 0x564342, 24 );
+	writer.Write( 1, 16 );
+	writer.Write( 1U << OGG_VALUE_BITS, 24 );
+	writer.Write( 0, 2 );
+	for ( unsigned int i = 0; i < ( 1U << OGG_VALUE_BITS ); ++i ) {
+		writer.Write( OGG_VALUE_BITS - 1, 5 );
+	}
+	writer.Write( 1, 4 );                   // lookup with a minimum and step
+	writer.Write( PackVorbisFloat( -OGG_VALUE_BIAS ), 32 );
+	writer.Write( PackVorbisFloat( 1 ), 32 );
+	writer.Write( OGG_VALUE_BITS - 1, 4 );
+	writer.Write( 0, 1 );
+	for ( unsigned int i = 0; i < ( 1U << OGG_VALUE_BITS ); ++i ) {
+		writer.Write( i, OGG_VALUE_BITS );
+	}
+
+	// Time domain transforms, unused
+	writer.Write( 1 - 1, 6 );
+	writer.Write( 0, 16 );
+
+	// Floor 1, with one point between the ends and no books for it
+	writer.Write( 1 - 1, 6 );
+	writer.Write( 1, 16 );
+	writer.Write( 1, 5 );                   // partitions
+	writer.Write( 0, 4 );                   // partition class
+	writer.Write( 1 - 1, 3 );               // class dimensions
+	writer.Write( 0, 2 );                   // subclasses
+	writer.Write( 0, 8 );                   // no subclass book
+	writer.Write( 1 - 1, 2 );               // multiplier
+	writer.Write( OGG_BLOCK_EXPONENT - 1, 4 );
+	writer.Write( OGG_BLOCK_SIZE / 4, OGG_BLOCK_EXPONENT - 1 );
+
+	// Residue 1, covering the whole spectrum
+	writer.Write( 1 - 1, 6 );
+	writer.Write( 1, 16 );
+	writer.Write( 0, 24 );
+	writer.Write( OGG_BLOCK_SIZE / 2, 24 );
+	writer.Write( OGG_PARTITION_SIZE - 1, 24 );
+	writer.Write( 2 - 1, 6 );               // classifications
+	writer.Write( 0, 8 );                   // class book
+	writer.Write( 0, 4 );                   // first class is empty
+	writer.Write( 1, 4 );                   // the second has values on the first pass
+	writer.Write( 1, 8 );
+
+	// Mapping, with a single submap
+	writer.Write( 1 - 1, 6 );
+	writer.Write( 0, 16 );
+	writer.Write( 0, 1 );
+	writer.Write( 0, 1 );
+	writer.Write( 0, 2 );
+	writer.Write( 0, 8 );
+	writer.Write( 0, 8 );
+	writer.Write( 0, 8 );
+
+	// Mode
+	writer.Write( 1 - 1, 6 );
+	writer.Write( 0, 1 );
+	writer.Write( 0, 16 );
+	writer.Write( 0, 16 );
+	writer.Write( 0, 8 );
+
+	writer.Write( 1, 1 );
+	return writer.GetBytes();
+}
+
+static std::vector<uint8_t> WriteVorbisAudio( unsigned int index, uint32_t* seed ) {
+	OggBitWriter writer;
+	writer.Write( 0, 1 );                   // audio packet, and only the one mode
+
+	writer.Write( 1, 1 );
+	writer.Write( OGG_FLOOR, 8 );
+	writer.Write( OGG_FLOOR, 8 );
+
+	int peak = 8 + static_cast<int>(( index / 4 ) % 100);
+	for ( unsigned int partition = 0; partition < OGG_BLOCK_SIZE / 2 / OGG_PARTITION_SIZE; ++partition ) {
+		writer.WriteCodeword( 1, 1 );
+		for ( unsigned int i = 0; i < OGG_PARTITION_SIZE; ++i ) {
+			int distance = std::abs( static_cast<int>(partition * OGG_PARTITION_SIZE + i) - peak );
+			int value = static_cast<int>(Fixture_Random( seed ) % 3) - 1;
+			if ( distance < 4 ) {
+				value += ( 4 - distance ) * 3;
+			}
+
+			writer.WriteCodeword( static_cast<uint32_t>(value + OGG_VALUE_BIAS), OGG_VALUE_BITS );
+		}
+	}
+
+	return writer.GetBytes();
+}
+
+static uint32_t GetOggCrc( const uint8_t* data, size_t size ) {
+	static uint32_t table[256];
+	if ( table[ 1 ] == 0 ) {
+		for ( uint32_t i = 0; i < 256; ++i ) {
+			uint32_t r = i << 24U;
+			for ( unsigned int j = 0; j < 8; ++j ) {
+				r = ( r & 0x80000000U ) ? ( r << 1U ) ^ 0x04C11DB7U : r << 1U;
+			}
+			table[ i ] = r;
+		}
+	}
+
+	uint32_t crc = 0;
+	for ( size_t i = 0; i < size; ++i ) {
+		crc = ( crc << 8U ) ^ table[ ( ( crc >> 24U ) & 0xFFU ) ^ data[ i ] ];
+	}
+	return crc;
+}
+
+static void WriteOggPage( std::vector<uint8_t>& out, const std::vector<std::vector<uint8_t>>& packets,
+						  uint8_t flags, uint64_t granule, uint32_t sequence ) {
+	std::vector<uint8_t> lacing;
+	for ( const auto& packet : packets ) {
+		size_t size = packet.size();
+		for ( ; size >= 255; size -= 255 ) {
+			lacing.push_back( 255 );
+		}
+		lacing.push_back( static_cast<uint8_t>(size) );
+	}
+
+	auto write_integer = [ &out ]( uint64_t value, unsigned int size ) {
+		for ( unsigned int i = 0; i < size; ++i ) {
+			out.push_back( static_cast<uint8_t>(value >> ( i * 8 )) );
+		}
+	};
+
+	size_t start = out.size();
+	write_integer( 0x5367674F, 4 );         // "OggS"
+	write_integer( 0, 1 );
+	write_integer( flags, 1 );
+	write_integer( granule, 8 );
+	write_integer( 0x486F5721, 4 );         // serial
+	write_integer( sequence, 4 );
+	write_integer( 0, 4 );                  // crc, filled in below
+	write_integer( lacing.size(), 1 );
+	out.insert( out.end(), lacing.begin(), lacing.end() );
+	for ( const auto& packet : packets ) {
+		out.insert( out.end(), packet.begin(), packet.end() );
+	}
+
+	uint32_t crc = GetOggCrc( &out[ start ], out.size() - start );
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		out[ start + 22 + i ] = static_cast<uint8_t>(crc >> ( i * 8 ));
+	}
+}
+
+static std::vector<uint8_t> GenerateOgg( unsigned int seconds ) {
+	std::vector<uint8_t> out;
+	WriteOggPage( out, { WriteVorbisIdentification() }, 0x02, 0, 0 );
+	WriteOggPage( out, { WriteVorbisComment(), WriteVorbisSetup() }, 0, 0, 1 );
+
+	// The first block only primes the overlap, after that each gives half a block
+	unsigned int num_packets = seconds * OGG_SAMPLE_RATE / ( OGG_BLOCK_SIZE / 2 ) + 1;
+	uint32_t seed = 0x4F676753;
+	uint32_t sequence = 2;
+
+	std::vector<std::vector<uint8_t>> packets;
+	for ( unsigned int i = 0; i < num_packets; ++i ) {
+		packets.push_back( WriteVorbisAudio( i, &seed ) );
+
+		bool is_last = ( i + 1 == num_packets );
+		if ( packets.size() == OGG_PACKETS_PER_PAGE || is_last ) {
+			WriteOggPage( out, packets, is_last ? 0x04 : 0, static_cast<uint64_t>(i) * ( OGG_BLOCK_SIZE / 2 ),
+						  sequence++ );
+			packets.clear();
+		}
+	}
+
+	return out;
+}
+
+/************************************************************/
+
+bool Fixture_Generate( const std::string& directory ) {
+	fixtures.directory = directory;
+	if ( !fixtures.directory.empty() && fixtures.directory.back() != '/' ) {
+		fixtures.directory += '/';
+	}
+
+	LogInfo( "Generating fixtures under \"%s\"...\n", fixtures.directory.c_str() );
+
+	if ( !CreateDirectory( Fixture_GetPath( "maps/" ) ) ||
+		!CreateDirectory( Fixture_GetPath( "models/" ) ) ||
+		!CreateDirectory( Fixture_GetPath( "images/" ) ) ||
+		!CreateDirectory( Fixture_GetPath( "manifests/" ) ) ||
+		!CreateDirectory( Fixture_GetPath( "frontend/text/" ) ) ) {
+		return false;
+	}
+
+	if ( !WriteMap() || !WriteManifests() || !WriteClasses() || !WriteFont() || !WriteModel() ||
+		!WriteImages() ) {
+		return false;
+	}
+
+	fixtures.json = GenerateJson();
+	fixtures.ogg = GenerateOgg( FIXTURE_OGG_SECONDS );
+
+	// So the engine can find the map like it would any other
+	plMountLocalLocation( fixtures.directory.c_str() );
+
+	return true;
+}
+
+std::string Fixture_GetPath( const std::string& path ) {
+	return fixtures.directory + path;
+}
+
+std::string Fixture_GetPmgPath() {
+	return Fixture_GetPath( "maps/" FIXTURE_MAP "/" FIXTURE_MAP ".pmg" );
+}
+
+std::string Fixture_GetTilesetPath() {
+	return Fixture_GetPath( "maps/" FIXTURE_MAP "/tiles/" );
+}
+
+std::string Fixture_GetModelPath() {
+	return Fixture_GetPath( "models/bench.vtx" );
+}
+
+std::string Fixture_GetClassesPath() {
+	return Fixture_GetPath( "classes.json" );
+}
+
+std::vector<std::string> Fixture_GetImagePaths() {
+	std::vector<std::string> paths;
+	for ( unsigned int i = 0; i < FIXTURE_NUM_IMAGES; ++i ) {
+		paths.push_back( Fixture_GetPath( "images/" ) + std::to_string( i ) + ".png" );
+	}
+	return paths;
+}
+
+const std::string& Fixture_GetJson() {
+	return fixtures.json;
+}
+
+const std::vector<uint8_t>& Fixture_GetOgg() {
+	return fixtures.ogg;
+}
+
+Map* Fixture_GetMap() {
+	Map* map = Engine::Game()->GetCurrentMap();
+	if ( map != nullptr ) {
+		return map;
+	}
+
+	Engine::Game()->RegisterMapManifest( "maps/" FIXTURE_MAP ".map" );
+	Engine::Game()->LoadMap( FIXTURE_MAP );
+	if ( ( map = Engine::Game()->GetCurrentMap() ) == nullptr ) {
+		Error( "Failed to load the benchmark map!\n" );
+	}
+
+	return map;
+}
+
+void Fixture_TickGame( unsigned int num_ticks ) {
+	for ( unsigned int i = 0; i < num_ticks; ++i ) {
+		g_state.sim_ticks++;
+
+		Arena_BeginTick();
+		Journal_BeginTick();
+
+		Engine::Physics()->Tick();
+		Engine::Game()->Tick();
+		SimulateParticles();
+
+		Journal_EndTick();
+		Save_EndTick();
+	}
+}
+
+Terrain* Fixture_CreateTerrain( float ( * height )( float x, float z ) ) {
+	auto* terrain = new Terrain( Fixture_GetTilesetPath() );
+	for ( unsigned int tile_y = 0; tile_y < TERRAIN_ROW_TILES; ++tile_y ) {
+		for ( unsigned int tile_x = 0; tile_x < TERRAIN_ROW_TILES; ++tile_x ) {
+			Terrain::Tile* tile = terrain->GetTile( PLVector2(
+				( tile_x + 0.5f ) * TERRAIN_TILE_PIXEL_WIDTH, ( tile_y + 0.5f ) * TERRAIN_TILE_PIXEL_WIDTH ) );
+			for ( unsigned int i = 0; i < 4; ++i ) {
+				tile->height[ i ] = height(
+					static_cast<float>(( tile_x + i % 2 ) * TERRAIN_TILE_PIXEL_WIDTH),
+					static_cast<float>(( tile_y + i / 2 ) * TERRAIN_TILE_PIXEL_WIDTH) );
+			}
+		}
+	}
+
+	terrain->Update();
+	return terrain;
+}
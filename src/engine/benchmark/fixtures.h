@@ -0,0 +1,83 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Stand-ins for the game's data, so the benchmarks can be run without
+ * a copy of the game. Everything is generated from a fixed seed, so
+ * each run works on exactly the same input. The directory is mounted,
+ * so the engine can find the map the same way it would any other.
+ *
+ * maps/bench.map                manifest for the map below
+ * maps/bench/bench.pmg          rolling hills with a mix of tiles
+ * maps/bench/tiles/<n>.png      the map's tileset
+ * manifests/<n>.map             plenty more map manifests, for registering
+ * models/bench.vtx/.fac         a textured sphere, with its textures alongside
+ * images/<n>.png                assorted sizes, for packing into an atlas
+ * classes.json                  a class for each of the original pig models
+ * frontend/text/bench.tab/.png  a bitmap font, with glyphs of varying widths
+ */
+
+#define FIXTURE_MAP             "bench"
+#define FIXTURE_NUM_TILES       16
+#define FIXTURE_NUM_MANIFESTS   1000
+#define FIXTURE_NUM_IMAGES      64
+#define FIXTURE_NUM_MODEL_TEXTURES  4
+#define FIXTURE_NUM_PIG_CLASSES 9
+#define FIXTURE_FONT            "bench"
+#define FIXTURE_FONT_GLYPHS     90      // '!' through to 'z'
+#define FIXTURE_FONT_GLYPH_WIDTH( N )   ( 4 + ( N ) % 5 )
+#define FIXTURE_FONT_GLYPH_HEIGHT       8
+#define FIXTURE_MODEL_RINGS     24
+#define FIXTURE_MODEL_SEGMENTS  32
+#define FIXTURE_NUM_JSON_OBJECTS    256
+#define FIXTURE_OGG_SECONDS     10
+
+bool Fixture_Generate( const std::string& directory );
+
+// Same sequence everywhere for a given seed, which mustn't be zero
+uint32_t Fixture_Random( uint32_t* seed );
+
+// Paths to the files written out, relative to the working directory
+std::string Fixture_GetPath( const std::string& path );
+std::string Fixture_GetPmgPath();
+std::string Fixture_GetTilesetPath();
+std::string Fixture_GetModelPath();
+std::string Fixture_GetClassesPath();
+std::vector<std::string> Fixture_GetImagePaths();
+
+// Kept in memory, as they're only ever parsed from a buffer
+const std::string& Fixture_GetJson();
+const std::vector<uint8_t>& Fixture_GetOgg();
+
+class Map;
+// Loads the map on first use, and keeps it around for the rest of the run
+Map* Fixture_GetMap();
+
+// Runs the simulation through the same steps as the engine's loop, less
+// the input, networking and audio, so there's nothing to wait on
+void Fixture_TickGame( unsigned int num_ticks );
+
+class Terrain;
+// Every tile corner is given the height at its position, so the terrain
+// matches the surface exactly wherever it's flat or a plane. This takes
+// over the physics' terrain collision, which goes with it once deleted.
+Terrain* Fixture_CreateTerrain( float ( * height )( float x, float z ) );
@@ -134,6 +134,10 @@ static void DebugModeCallback(const PLConsoleVariable* variable) {
 }
 
 static void GraphicsVsyncCallback(const PLConsoleVariable* var) {
+  if (g_state.is_headless) {
+    return;
+  }
+
   System_SetSwapInterval(var->b_value ? 1 : 0);
 }
 
@@ -188,6 +192,19 @@ PLConsoleVariable* cv_audio_volume_music = nullptr;
 PLConsoleVariable* cv_audio_voices = nullptr;
 PLConsoleVariable* cv_audio_mode = nullptr;
 
+PLConsoleVariable* cv_physics_substeps = nullptr;
+PLConsoleVariable* cv_physics_sleep_speed = nullptr;
+PLConsoleVariable* cv_physics_sleep_spin = nullptr;
+PLConsoleVariable* cv_physics_gravity = nullptr;
+PLConsoleVariable* cv_physics_continuous = nullptr;
+
+PLConsoleVariable* cv_net_port = nullptr;
+PLConsoleVariable* cv_net_snapshot_interval = nullptr;
+PLConsoleVariable* cv_net_sim_latency = nullptr;
+PLConsoleVariable* cv_net_sim_loss = nullptr;
+
+PLConsoleVariable* cv_journal_checksum_interval = nullptr;
+
 static void ConsoleBufferUpdate(int level, const char* msg) {
   size_t len = strlen(msg);
   u_assert(len < MAX_OUTPUT_BUFFER_SIZE);
@@ -259,6 +276,20 @@ void Console_Initialize(void) {
 	rvar( cv_audio_mode, true, "1", pl_int_var, nullptr, "0 = mono, 1 = stereo" );
 	rvar( cv_audio_voices, true, "true", pl_bool_var, nullptr, "enable/disable pig voices" );
 
+	rvar( cv_physics_substeps, true, "4", pl_int_var, nullptr, "Number of physics steps per tick, 1 to 16" );
+	rvar( cv_physics_sleep_speed, true, "2", pl_float_var, nullptr, "Speed a body must stay under before it can sleep" );
+	rvar( cv_physics_sleep_spin, true, "0.1", pl_float_var, nullptr, "Angular speed, in radians, a body must stay under before it can sleep" );
+	// Not archived, as everyone in a game needs to agree on it
+	rvar( cv_physics_gravity, false, "1024", pl_float_var, nullptr, "Downward acceleration, in units per second squared" );
+	rvar( cv_physics_continuous, false, "true", pl_bool_var, nullptr, "Continuous collision for bodies spawned from now on, so fast ones can't pass through anything" );
+
+	rvar( cv_net_port, true, "9090", pl_int_var, nullptr, "Port used when hosting over UDP" );
+	rvar( cv_net_snapshot_interval, true, "1", pl_int_var, nullptr, "Ticks between snapshots sent to clients" );
+	rvar( cv_net_sim_latency, false, "0", pl_int_var, nullptr, "Milliseconds to hold back outgoing packets, rounded up to whole ticks, for testing" );
+	rvar( cv_net_sim_loss, false, "0", pl_float_var, nullptr, "Fraction of outgoing packets to drop, for testing" );
+
+	rvar( cv_journal_checksum_interval, true, "25", pl_int_var, nullptr, "Ticks between state checksums written while recording a journal" );
+
   plRegisterConsoleCommand("open", OpenCommand, "Opens the specified file");
   plRegisterConsoleCommand("exit", QuitCommand, "Closes the game");
   plRegisterConsoleCommand("quit", QuitCommand, "Closes the game");
@@ -275,6 +306,9 @@ void Console_Initialize(void) {
 }
 
 static void DrawInputPane() {
+  /* anything queued up before now goes under the pane */
+  Font_Flush();
+
   plSetTexture(nullptr, 0);
   plSetBlendMode(PL_BLEND_DEFAULT);
 
@@ -290,8 +324,6 @@ static void DrawInputPane() {
       PLColour(0, 0, 0, 0)
   ));
 
-  plSetBlendMode(PL_BLEND_ADDITIVE);
-
   unsigned int x = 20;
   unsigned int y = scr_h - font->chars[0].h;
 
@@ -313,10 +345,6 @@ static void DrawInputPane() {
     unsigned int w = font->chars[0].w;
     Font_DrawBitmapString(font, x + w + 10, y, 1, 1.f, PL_COLOUR_GREEN, pl_strtoupper(msg_buf));
   }
-
-  /* DrawBitmapString disables blend - no need to call again here */
-
-  plSetBlendMode(PL_BLEND_DEFAULT);
 }
 
 static void DrawOutputPane() {
@@ -55,6 +55,19 @@ extern PLConsoleVariable *cv_audio_volume_music;
 extern PLConsoleVariable *cv_audio_voices;
 extern PLConsoleVariable *cv_audio_mode;
 
+extern PLConsoleVariable *cv_physics_substeps;
+extern PLConsoleVariable *cv_physics_sleep_speed;
+extern PLConsoleVariable *cv_physics_sleep_spin;
+extern PLConsoleVariable *cv_physics_gravity;
+extern PLConsoleVariable *cv_physics_continuous;
+
+extern PLConsoleVariable *cv_net_port;
+extern PLConsoleVariable *cv_net_snapshot_interval;
+extern PLConsoleVariable *cv_net_sim_latency;
+extern PLConsoleVariable *cv_net_sim_loss;
+
+extern PLConsoleVariable *cv_journal_checksum_interval;
+
 /************************************************************/
 
 void Console_Initialize(void);
@@ -0,0 +1,99 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../memory_tracker.h"
+#include "window_memory.h"
+
+MemoryWindow::MemoryWindow() = default;
+MemoryWindow::~MemoryWindow() = default;
+
+static void DisplayBytes( uint64_t bytes ) {
+	if ( bytes >= 1024 * 1024 ) {
+		ImGui::Text( "%.2f MB", bytes / ( 1024.0 * 1024.0 ) );
+	} else {
+		ImGui::Text( "%.1f KB", bytes / 1024.0 );
+	}
+}
+
+void MemoryWindow::Display() {
+	ImGui::SetNextWindowSize( ImVec2( 480, 260 ), ImGuiCond_Once );
+	ImGui::Begin( dname( "Memory" ), &status_, ED_DEFAULT_WINDOW_FLAGS );
+
+#if !MEMORY_TRACKING_ENABLED
+	ImGui::TextColored( ImVec4( 1.0f, 0, 0, 1.0f ), "Memory tracking was compiled out..." );
+	ImGui::End();
+	return;
+#endif
+
+	ImGui::Columns( 5, nullptr, false );
+	ImGui::SetColumnWidth( 0, 100 );
+
+	ImGui::TextDisabled( "Tag" );
+	ImGui::NextColumn();
+	ImGui::TextDisabled( "Live" );
+	ImGui::NextColumn();
+	ImGui::TextDisabled( "Peak" );
+	ImGui::NextColumn();
+	ImGui::TextDisabled( "Allocations" );
+	ImGui::NextColumn();
+	ImGui::TextDisabled( "Total" );
+	ImGui::NextColumn();
+
+	MemoryStats total = { "Total", 0, 0, 0, 0 };
+	for ( unsigned int i = 0; i < MAX_MEMORY_TAGS; ++i ) {
+		MemoryStats stats;
+		Memory_GetStats( static_cast<MemoryTag>(i), &stats );
+		total.live_bytes += stats.live_bytes;
+		total.live_allocations += stats.live_allocations;
+		total.total_allocations += stats.total_allocations;
+
+		ImGui::TextUnformatted( stats.name );
+		ImGui::NextColumn();
+		DisplayBytes( stats.live_bytes );
+		ImGui::NextColumn();
+		DisplayBytes( stats.peak_bytes );
+		ImGui::NextColumn();
+		ImGui::Text( "%llu", static_cast<unsigned long long>(stats.live_allocations) );
+		ImGui::NextColumn();
+		ImGui::Text( "%llu", static_cast<unsigned long long>(stats.total_allocations) );
+		ImGui::NextColumn();
+	}
+
+	ImGui::Separator();
+
+	// Peaks for each tag are hit at different times, so there's no total for those
+	ImGui::TextUnformatted( total.name );
+	ImGui::NextColumn();
+	DisplayBytes( total.live_bytes );
+	ImGui::NextColumn();
+	ImGui::NextColumn();
+	ImGui::Text( "%llu", static_cast<unsigned long long>(total.live_allocations) );
+	ImGui::NextColumn();
+	ImGui::Text( "%llu", static_cast<unsigned long long>(total.total_allocations) );
+	ImGui::NextColumn();
+
+	ImGui::Columns( 1 );
+
+	ImGui::Separator();
+
+	if ( ImGui::Button( "Reset Peaks" ) ) {
+		Memory_ResetPeaks();
+	}
+
+	ImGui::End();
+}
@@ -75,12 +75,9 @@ void ModelViewer::DrawViewport() {
 	shaderProgram->Enable();
 
 	if ( !viewDebugNormals ) {
-		plSetNamedShaderUniformVector3( shaderProgram->GetInternalProgram(), "sun_position",
-			PLVector3( 0.5f, 0.2f, 0.6f ) );
-		plSetNamedShaderUniformVector4( shaderProgram->GetInternalProgram(), "sun_colour",
-			PLColour( 255, 255, 255, 255 ).ToVec4() );
-		plSetNamedShaderUniformVector4( shaderProgram->GetInternalProgram(), "ambient_colour",
-			PLColour( 128, 128, 128, 255 ).ToVec4() );
+		shaderProgram->SetUniform( "sun_position", PLVector3( 0.5f, 0.2f, 0.6f ) );
+		shaderProgram->SetUniform( "sun_colour", PLColour( 255, 255, 255, 255 ).ToVec4() );
+		shaderProgram->SetUniform( "ambient_colour", PLColour( 128, 128, 128, 255 ).ToVec4() );
 	}
 
 	PLVector3 angles(
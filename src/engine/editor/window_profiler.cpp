@@ -0,0 +1,100 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "window_profiler.h"
+
+ProfilerWindow::ProfilerWindow() = default;
+ProfilerWindow::~ProfilerWindow() = default;
+
+void ProfilerWindow::DisplayStats( const std::vector<ProfileStats>& stats, const char* format ) {
+	ImGui::Columns( 5, nullptr, false );
+	ImGui::SetColumnWidth( 0, 160 );
+
+	ImGui::TextDisabled( "Name" );
+	ImGui::NextColumn();
+	ImGui::TextDisabled( "Last" );
+	ImGui::NextColumn();
+	ImGui::TextDisabled( "Min" );
+	ImGui::NextColumn();
+	ImGui::TextDisabled( "Median" );
+	ImGui::NextColumn();
+	ImGui::TextDisabled( "P99" );
+	ImGui::NextColumn();
+
+	for ( const auto& i : stats ) {
+		ImGui::TextUnformatted( i.name );
+		ImGui::NextColumn();
+		ImGui::Text( format, i.last );
+		ImGui::NextColumn();
+		ImGui::Text( format, i.min );
+		ImGui::NextColumn();
+		ImGui::Text( format, i.median );
+		ImGui::NextColumn();
+		ImGui::Text( format, i.p99 );
+		ImGui::NextColumn();
+	}
+
+	ImGui::Columns( 1 );
+}
+
+void ProfilerWindow::Display() {
+	ImGui::SetNextWindowSize( ImVec2( 480, 420 ), ImGuiCond_Once );
+	ImGui::Begin( dname( "Profiler" ), &status_, ED_DEFAULT_WINDOW_FLAGS );
+
+#if !PROFILER_ENABLED
+	ImGui::TextColored( ImVec4( 1.0f, 0, 0, 1.0f ), "Profiler was compiled out..." );
+	ImGui::End();
+	return;
+#endif
+
+	bool is_paused = Profiler_IsPaused();
+	if ( ImGui::Checkbox( "Paused", &is_paused ) ) {
+		Profiler_SetPaused( is_paused );
+	}
+
+	// Statistics are only gathered while running, so leave them be while paused
+	ProfileStats frame;
+	Profiler_GetFrameStats( &frame );
+	if ( !is_paused ) {
+		Profiler_GetZoneStats( zones_ );
+		Profiler_GetCounterStats( counters_ );
+	}
+
+	ImGui::Text( "Frame %.2fms (min %.2fms, median %.2fms, p99 %.2fms)",
+				 frame.last, frame.min, frame.median, frame.p99 );
+
+	ImGui::Separator();
+
+	if ( ImGui::CollapsingHeader( "Zones (ms)", ImGuiTreeNodeFlags_DefaultOpen ) ) {
+		DisplayStats( zones_, "%.3f" );
+	}
+
+	if ( ImGui::CollapsingHeader( "Counters", ImGuiTreeNodeFlags_DefaultOpen ) ) {
+		DisplayStats( counters_, "%.0f" );
+	}
+
+	ImGui::Separator();
+
+	ImGui::InputText( "##export_path", export_path_, sizeof( export_path_ ) );
+	ImGui::SameLine();
+	if ( ImGui::Button( "Export Trace" ) ) {
+		Profiler_ExportTrace( export_path_, PROFILER_MAX_FRAMES );
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,38 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "base_window.h"
+#include "../profiler.h"
+
+class ProfilerWindow : public BaseWindow {
+public:
+	ProfilerWindow();
+	~ProfilerWindow() override;
+
+	void Display() override;
+
+protected:
+private:
+	void DisplayStats( const std::vector<ProfileStats>& stats, const char* format );
+
+	std::vector<ProfileStats> zones_;
+	std::vector<ProfileStats> counters_;
+
+	char export_path_[ 256 ]{ "profile.json" };
+};
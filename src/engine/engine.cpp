@@ -15,6 +15,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
 #include "engine.h"
 #include "language.h"
 #include "mod_support.h"
@@ -24,18 +26,31 @@
 #include "frontend.h"
 #include "Map.h"
 #include "imgui_layer.h"
+#include "particle.h"
+#include "journal.h"
+#include "savegame.h"
+#include "headless.h"
+#include "profiler.h"
+#include "frame_arena.h"
+#include "manifest_cache.h"
+#include "memory_tracker.h"
+#include "startup.h"
 
 #include "graphics/display.h"
 #include "game/actor_manager.h"
+#include "net/net.h"
 
 EngineState g_state;
 
 openhow::Engine *openhow::engine;
 
 openhow::Engine::Engine() {
+	startup_ticks_ = System_GetTicks();
+
 	g_state.draw_ticks = 0;
 
 	g_state.last_draw_ms = 0;
+	g_state.sim_interpolation = 1.0f;
 	g_state.last_sys_tick = 0;
 	g_state.sim_ticks = 0;
 	g_state.sys_ticks = 0;
@@ -46,7 +61,15 @@ openhow::Engine::Engine() {
 }
 
 openhow::Engine::~Engine() {
-	Display_Shutdown();
+	Save_Shutdown();
+	Journal_Shutdown();
+	ManifestCache_Shutdown();
+	Profiler_Shutdown();
+	Net_Shutdown();
+	ShutdownParticles();
+	if ( !g_state.is_headless ) {
+		Display_Shutdown();
+	}
 
 	Config_Save( Config_GetUserConfigPath() );
 
@@ -56,14 +79,28 @@ openhow::Engine::~Engine() {
 
 	IPhysicsInterface::DestroyInstance( physics_interface_ );
 	LanguageManager::DestroyInstance();
+
+	Arena_Shutdown();
 }
 
 void openhow::Engine::Initialize() {
 	LogInfo( "Initializing Engine (%s)...\n", GetVersionString().c_str() );
 
+	// Each phase lists those it needs to have run first, see startup.h.
+	// That's everything the phase uses itself, even where another of its
+	// dependencies implies it, e.g. anything read from the mods names "Mods".
+
+	Startup_BeginPhase( "Console" );
 	Console_Initialize();
 
+	Startup_BeginPhase( "Core", { "Console" } );
+	Profiler_Initialize();
+	Memory_Initialize();
+	Arena_Initialize();
+	ManifestCache_Initialize();
+
 	// load in the manifests
+	Startup_BeginPhase( "Mods", { "Core" } );
 	Mod_RegisterMods();
 
 	// check for any command line arguments
@@ -76,30 +113,67 @@ void openhow::Engine::Initialize() {
 	Mod_SetMod( var );
 
 	// Initialize the language manager
+	Startup_BeginPhase( "Language", { "Mods" } );
 	LanguageManager::GetInstance()->SetLanguage( "eng" );
 
 	/* this MUST be done after all vars have been
 	 * initialized, otherwise, right now, certain
 	 * vars will not be loaded/saved! */
+	Startup_BeginPhase( "Config", { "Console" } );
 	Config_Load( CONFIG_FILENAME );
 
 	// now initialize all other sub-systems
 
+	Startup_BeginPhase( "Input", { "Console" } );
 	Input_Initialize();
-	Display_Initialize();
+	Startup_BeginPhase( "Display", { "Config", "Mods" } );
+	if ( !g_state.is_headless ) {
+		Display_Initialize();
+	}
+	Startup_BeginPhase( "Particles", { "Console" } );
+	InitParticles();
+	Startup_BeginPhase( "Resources", { "Display" } );
 	resource_manager_ = new hwResourceManager();
+	Startup_BeginPhase( "Audio", { "Console" } );
 	audio_manager_ = new AudioManager();
+	Startup_BeginPhase( "Game", { "Config", "Display" } );
 	game_manager_ = new GameManager();
-	FE_Initialize();
+	Startup_BeginPhase( "Frontend", { "Resources", "Language", "Mods" } );
+	if ( !g_state.is_headless ) {
+		FE_Initialize();
+	}
 
 	// Setup our interface to the physics engine, this handles the abstraction
+	Startup_BeginPhase( "Physics", { "Console" } );
 	physics_interface_ = IPhysicsInterface::CreateInstance();
 
+	Startup_BeginPhase( "Services", { "Console" } );
+	Net_Initialize();
+	Journal_Initialize();
+	Save_Initialize();
+
 	// Ensure that our manifest list is updated
+	Startup_BeginPhase( "Maps", { "Game", "Mods" } );
 	Game()->RegisterMapManifests();
+	Startup_BeginPhase( "Teams", { "Game", "Language", "Mods" } );
 	Game()->RegisterTeamManifest( "scripts/teams.json" );
+	Startup_BeginPhase( "Classes", { "Game", "Mods" } );
+	Game()->RegisterClassManifest( "scripts/classes.json" );
+
+	// Everything's registered, so write out anything that was parsed
+	Startup_BeginPhase( "Manifest Cache", { "Mods", "Maps" } );
+	ManifestCache_Save();
 
 	plParseConsoleString( "fsListMounted" );
+
+	if ( g_state.is_headless ) {
+		// Anything it starts up straight away needs everything a game does
+		Startup_BeginPhase( "Headless",
+							{ "Game", "Resources", "Audio", "Physics", "Services", "Maps", "Teams", "Classes" } );
+		Headless_Initialize();
+	}
+
+	Startup_Finish();
 }
 
 std::string openhow::Engine::GetVersionString() {
@@ -110,7 +184,18 @@ std::string openhow::Engine::GetVersionString() {
 		GIT_BRANCH + ":" + GIT_COMMIT_HASH + "-" + GIT_COMMIT_COUNT;
 }
 
+/**
+ * Fast forwarded replays and headless runs aren't tied to the clock,
+ * so they tick as quick as they can.
+ */
+static bool IsTickUnlocked() {
+	return Journal_IsFastForwarding() || ( g_state.is_headless && !Headless_IsRealtime() );
+}
+
 bool openhow::Engine::IsRunning() {
+	PROFILE_FRAME();
+	Arena_BeginFrame();
+
 	System_PollEvents();
 
 	static unsigned int next_tick = 0;
@@ -118,24 +203,69 @@ bool openhow::Engine::IsRunning() {
 		next_tick = System_GetTicks();
 	}
 
+	unsigned int max_loops = IsTickUnlocked() ? MAX_UNLOCKED_TICKS : MAX_FRAMESKIP;
 	unsigned int loops = 0;
-	while ( System_GetTicks() > next_tick && loops < MAX_FRAMESKIP ) {
+	while ( ( IsTickUnlocked() || System_GetTicks() > next_tick ) && loops < max_loops ) {
+		PROFILE_SCOPE( "Tick" );
+
 		g_state.sys_ticks = System_GetTicks();
 		g_state.sim_ticks++;
 
-		Client_ProcessInput(); // todo: kill this
+		Arena_BeginTick();
+
+		Journal_BeginTick();
+
+		if ( !g_state.is_headless ) {
+			Client_ProcessInput(); // todo: kill this
+		}
+
+		Net_ReadPackets();
 
 		Physics()->Tick();
 		Game()->Tick();
+		SimulateParticles();
 		Audio()->Tick();
 
+		Journal_EndTick();
+		Save_EndTick();
+
+		Net_SendPackets();
+
+		if ( g_state.is_headless && !Headless_Tick() ) {
+			return false;
+		}
+
 		g_state.last_sys_tick = System_GetTicks();
+		if ( IsTickUnlocked() ) {
+			// Otherwise we'd be left waiting for the clock to catch up
+			next_tick = g_state.last_sys_tick;
+		}
 		next_tick += SKIP_TICKS;
 		loops++;
 	}
 
+	if ( g_state.is_headless ) {
+		// Nothing to draw, so rather than spin, wait for the next tick
+		unsigned int now = System_GetTicks();
+		if ( !IsTickUnlocked() && next_tick > now ) {
+			System_Sleep( next_tick - now );
+		}
+		return true;
+	}
+
 	double deltaTime = ( double ) ( System_GetTicks() + SKIP_TICKS - next_tick ) / ( double ) ( SKIP_TICKS );
 	Display_Draw( deltaTime );
 
+	if ( startup_time_ == 0 ) {
+		startup_time_ = std::max( System_GetTicks() - startup_ticks_, 1U );
+		LogInfo( "Reached the first interactive frame in %ums\n", startup_time_ );
+	}
+
+	PROFILE_COUNTER( "Actors Drawn", g_state.gfx.num_actors_drawn );
+	PROFILE_COUNTER( "Chunks Drawn", g_state.gfx.num_chunks_drawn );
+	PROFILE_COUNTER( "Triangles", g_state.gfx.num_triangles_total );
+	PROFILE_COUNTER( "State Changes", g_state.gfx.num_state_changes );
+	PROFILE_COUNTER( "Sprite Draws", g_state.gfx.num_sprite_draws );
+
 	return true;
 }
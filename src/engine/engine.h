@@ -49,6 +49,7 @@
 #define TICKS_PER_SECOND    25
 #define SKIP_TICKS          (1000 / TICKS_PER_SECOND)
 #define MAX_FRAMESKIP       5
+#define MAX_UNLOCKED_TICKS  250     // Most ticks run per frame when not tied to the clock
 
 #ifdef __cplusplus
 #include "resource_manager.h"
@@ -84,7 +85,13 @@ class Engine {
 
   bool IsRunning();
 
+  // How long it took to get to the first frame, or 0 if we've not drawn one yet
+  unsigned int GetStartupTime() const { return startup_time_; }
+
  private:
+  unsigned int startup_ticks_{0};
+  unsigned int startup_time_{0};
+
   GameManager* game_manager_{nullptr};
 	AudioManager* audio_manager_{ nullptr };
 	hwResourceManager* resource_manager_{ nullptr };
@@ -101,6 +108,8 @@ typedef struct BaseGameMode BaseGameMode;
 typedef struct EngineState {
   struct PLCamera* ui_camera;    // camera used for UI elements, orthographic
 
+  bool is_headless;  // no window, graphics, audio or ui; only the simulation runs
+
   unsigned int sys_ticks;
   unsigned int last_sys_tick;
 
@@ -109,10 +118,16 @@ typedef struct EngineState {
   unsigned int draw_ticks;
   unsigned int last_draw_ms;
 
+  float sim_interpolation;  // how far the current frame is between the last two ticks, 0 to 1
+
   struct {
     unsigned int num_chunks_drawn;
     unsigned int num_actors_drawn;
     unsigned int num_triangles_total;
+    unsigned int num_draw_calls_saved;  // Model draws folded into an existing batch
+    unsigned int num_state_changes;
+    unsigned int num_state_changes_avoided;
+    unsigned int num_sprite_draws;
   } gfx;
 } EngineState;
 extern EngineState g_state;
@@ -123,6 +138,7 @@ PL_EXTERN_C
 /* System */
 
 unsigned int System_GetTicks(void);
+void System_Sleep(unsigned int ms);
 
 enum PromptLevel {
   PROMPT_LEVEL_DEFAULT,
@@ -0,0 +1,149 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine.h"
+#include "frame_arena.h"
+#include "memory_tracker.h"
+#include "profiler.h"
+
+LinearArena::LinearArena( size_t capacity ) : capacity_( capacity ) {
+	buffer_ = static_cast<uint8_t*>(Memory_Allocate( capacity, MEMORY_TAG_ARENAS ));
+	if ( buffer_ == nullptr ) {
+		Error( "Failed to allocate %u bytes for arena!\n", static_cast<unsigned int>(capacity) );
+	}
+}
+
+LinearArena::~LinearArena() {
+	Reset();
+	Memory_Free( buffer_ );
+}
+
+void* LinearArena::Allocate( size_t size, size_t alignment ) {
+	u_assert( alignment <= alignof( std::max_align_t ) && ( alignment & ( alignment - 1 ) ) == 0,
+			  "Unsupported arena alignment, %u!\n", static_cast<unsigned int>(alignment) );
+
+	size_t start = ( offset_ + alignment - 1 ) & ~( alignment - 1 );
+	if ( start + size <= capacity_ ) {
+		offset_ = start + size;
+		if ( offset_ > peak_ ) {
+			peak_ = offset_;
+		}
+		return buffer_ + start;
+	}
+
+	// Out of room, so fall back to the heap until the next reset
+	void* ptr = Memory_Allocate( size, MEMORY_TAG_ARENAS );
+	if ( ptr == nullptr ) {
+		Error( "Failed to allocate %u bytes for arena overflow!\n", static_cast<unsigned int>(size) );
+	}
+
+	if ( num_overflows_ == 0 ) {
+		LogWarn( "Arena of %u bytes overflowed, falling back to the heap!\n", static_cast<unsigned int>(capacity_) );
+	}
+
+	overflow_.push_back( ptr );
+	num_overflows_++;
+	overflow_bytes_ += size;
+
+	return ptr;
+}
+
+void LinearArena::Reset() {
+	for ( auto& ptr : overflow_ ) {
+		Memory_Free( ptr );
+	}
+	overflow_.clear();
+	offset_ = 0;
+}
+
+ArenaScope::ArenaScope( LinearArena* arena ) :
+	arena_( arena ), offset_( arena->offset_ ), num_overflow_( arena->overflow_.size() ) {}
+
+ArenaScope::~ArenaScope() {
+	for ( size_t i = num_overflow_; i < arena_->overflow_.size(); ++i ) {
+		Memory_Free( arena_->overflow_[ i ] );
+	}
+	arena_->overflow_.resize( num_overflow_ );
+	arena_->offset_ = offset_;
+}
+
+/************************************************************/
+
+static LinearArena* frame_arenas[ 2 ] = { nullptr, nullptr };
+static LinearArena* tick_arenas[ 2 ] = { nullptr, nullptr };
+static unsigned int cur_frame_arena = 0;
+static unsigned int cur_tick_arena = 0;
+
+LinearArena* Arena_GetFrame() {
+	u_assert( frame_arenas[ cur_frame_arena ] != nullptr, "Arenas haven't been initialized!\n" );
+	return frame_arenas[ cur_frame_arena ];
+}
+
+LinearArena* Arena_GetTick() {
+	u_assert( tick_arenas[ cur_tick_arena ] != nullptr, "Arenas haven't been initialized!\n" );
+	return tick_arenas[ cur_tick_arena ];
+}
+
+void Arena_BeginFrame() {
+	PROFILE_COUNTER( "Frame Arena KB", Arena_GetFrame()->GetUsed() / 1024.0 );
+
+	cur_frame_arena ^= 1U;
+	Arena_GetFrame()->Reset();
+}
+
+void Arena_BeginTick() {
+	cur_tick_arena ^= 1U;
+	Arena_GetTick()->Reset();
+}
+
+static void PrintArenaStats( const char* name, const LinearArena* arena ) {
+	LogInfo( "%-8s %10.1f %10.1f %10.1f %10u %12.1f\n", name,
+			 arena->GetCapacity() / 1024.0, arena->GetUsed() / 1024.0, arena->GetPeak() / 1024.0,
+			 arena->GetNumOverflows(), arena->GetOverflowBytes() / 1024.0 );
+}
+
+static void StatsCommand( unsigned int argc, char* argv[] ) {
+	u_unused( argc );
+	u_unused( argv );
+
+	LogInfo( "%-8s %10s %10s %10s %10s %12s\n", "arena", "size KB", "used KB", "peak KB", "overflows", "overflow KB" );
+	for ( unsigned int i = 0; i < 2; ++i ) {
+		PrintArenaStats( "frame", frame_arenas[ i ] );
+	}
+	for ( unsigned int i = 0; i < 2; ++i ) {
+		PrintArenaStats( "tick", tick_arenas[ i ] );
+	}
+}
+
+void Arena_Initialize() {
+	for ( unsigned int i = 0; i < 2; ++i ) {
+		frame_arenas[ i ] = new LinearArena( ARENA_FRAME_SIZE );
+		tick_arenas[ i ] = new LinearArena( ARENA_TICK_SIZE );
+	}
+
+	plRegisterConsoleCommand( "arenaStats", StatsCommand,
+							  "Prints the size, use and overflows of the frame and tick arenas" );
+}
+
+void Arena_Shutdown() {
+	for ( unsigned int i = 0; i < 2; ++i ) {
+		delete frame_arenas[ i ];
+		frame_arenas[ i ] = nullptr;
+		delete tick_arenas[ i ];
+		tick_arenas[ i ] = nullptr;
+	}
+}
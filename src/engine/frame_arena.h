@@ -0,0 +1,126 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+/* Linear arenas for transient data, which are bumped along as they're
+ * allocated from and only ever freed all at once. There's a pair for
+ * frames and a pair for ticks; each Arena_BeginFrame or Arena_BeginTick
+ * swaps over to the other of its pair and resets it, so anything from
+ * the previous frame or tick is still valid for one more.
+ *
+ * When an arena runs out, allocations go to the heap instead and are
+ * released on the next reset, with the overflow counted so the sizes
+ * can be tuned. These are only for use on the main thread.
+ */
+
+#define ARENA_FRAME_SIZE    ( 4U * 1024U * 1024U )
+#define ARENA_TICK_SIZE     ( 1U * 1024U * 1024U )
+
+class LinearArena {
+public:
+	explicit LinearArena( size_t capacity );
+	~LinearArena();
+
+	LinearArena( const LinearArena& ) = delete;
+	LinearArena& operator=( const LinearArena& ) = delete;
+
+	void* Allocate( size_t size, size_t alignment = alignof( std::max_align_t ) );
+	void Reset();
+
+	size_t GetCapacity() const { return capacity_; }
+	size_t GetUsed() const { return offset_; }
+	size_t GetPeak() const { return peak_; }
+	unsigned int GetNumOverflows() const { return num_overflows_; }
+	uint64_t GetOverflowBytes() const { return overflow_bytes_; }
+
+private:
+	friend class ArenaScope;
+
+	uint8_t* buffer_;
+	size_t capacity_;
+	size_t offset_{ 0 };
+	size_t peak_{ 0 };
+
+	// Heap allocations made once the buffer was full, freed on reset
+	std::vector<void*> overflow_;
+	unsigned int num_overflows_{ 0 };
+	uint64_t overflow_bytes_{ 0 };
+};
+
+/* Rewinds the arena back to where it was when the scope was entered,
+ * for when transient data doesn't need to last until the next reset */
+class ArenaScope {
+public:
+	explicit ArenaScope( LinearArena* arena );
+	~ArenaScope();
+
+	ArenaScope( const ArenaScope& ) = delete;
+	ArenaScope& operator=( const ArenaScope& ) = delete;
+
+private:
+	LinearArena* arena_;
+	size_t offset_;
+	size_t num_overflow_;
+};
+
+/* For standard containers, deallocate does nothing as the
+ * memory is handed back when the arena is reset or rewound */
+template< typename T >
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	ArenaAllocator( LinearArena* arena ) : arena_( arena ) {}
+	template< typename U >
+	ArenaAllocator( const ArenaAllocator<U>& other ) : arena_( other.arena_ ) {}
+
+	T* allocate( size_t n ) {
+		return static_cast<T*>(arena_->Allocate( n * sizeof( T ), alignof( T ) ));
+	}
+	void deallocate( T*, size_t ) {}
+
+	template< typename U >
+	bool operator==( const ArenaAllocator<U>& other ) const { return arena_ == other.arena_; }
+	template< typename U >
+	bool operator!=( const ArenaAllocator<U>& other ) const { return arena_ != other.arena_; }
+
+	LinearArena* arena_;
+};
+
+template< typename T >
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+template< typename T, typename C = std::less<T> >
+using ArenaSet = std::set<T, C, ArenaAllocator<T>>;
+template< typename K, typename V, typename C = std::less<K> >
+using ArenaMap = std::map<K, V, C, ArenaAllocator<std::pair<const K, V>>>;
+
+LinearArena* Arena_GetFrame();
+LinearArena* Arena_GetTick();
+
+void Arena_BeginFrame();
+void Arena_BeginTick();
+
+void Arena_Initialize();
+void Arena_Shutdown();
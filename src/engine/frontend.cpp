@@ -279,6 +279,10 @@ void FE_Draw(void) {
   frontend_width = Display_GetViewportWidth(&g_state.ui_camera->viewport);
   frontend_height = Display_GetViewportHeight(&g_state.ui_camera->viewport);
 
+  /* text is only drawn once flushed, so make sure nothing
+   * from before ends up drawn over the top of the menus */
+  Font_Flush();
+
   /* render and handle the main menu */
   if (frontend_state != FE_MODE_GAME) { // todo: what's going on here... ?
     switch (frontend_state) {
@@ -17,6 +17,8 @@
 
 #include "../engine.h"
 #include "../frontend.h"
+#include "../memory_tracker.h"
+#include "../profiler.h"
 
 #include "actor_manager.h"
 #include "actors/actor.h"
@@ -24,10 +26,12 @@
 /************************************************************/
 
 ActorSet ActorManager::actors_;
+std::map<unsigned int, Actor*> ActorManager::actor_ids_;
+unsigned int ActorManager::next_id_ = 1;
 std::map<std::string, ActorManager::actor_ctor_func> ActorManager::actor_classes_
     __attribute__((init_priority (1000)));
 
-Actor* ActorManager::CreateActor(const std::string& class_name) {
+Actor* ActorManager::ConstructActor(const std::string& class_name) {
   auto i = actor_classes_.find(class_name);
   if (i == actor_classes_.end()) {
     // TODO: make this throw an error rather than continue...
@@ -36,17 +40,59 @@ Actor* ActorManager::CreateActor(const std::string& class_name) {
   }
 
   Actor* actor = i->second();
+  actor->spawn_class_name_ = class_name;
+  return actor;
+}
+
+Actor* ActorManager::CreateActor(const std::string& class_name) {
+  MEMORY_TAG(MEMORY_TAG_ACTORS);
+
+  Actor* actor = ConstructActor(class_name);
+  if (actor == nullptr) {
+    return nullptr;
+  }
+
+  actor->net_id_ = next_id_++;
+  actor->spawn_tick_ = g_state.sim_ticks;
+  actor_ids_.insert(std::make_pair(actor->net_id_, actor));
+
   actors_.insert(actor);
   return actor;
 }
 
 void ActorManager::DestroyActor(Actor* actor) {
   u_assert(actor != nullptr, "attempted to delete a null actor!\n");
+  RecordDestroyed(actor);
   actors_.erase(actor);
   delete actor;
 }
 
+Actor* ActorManager::GetActorById(unsigned int id) const {
+  auto i = actor_ids_.find(id);
+  if (i == actor_ids_.end()) {
+    return nullptr;
+  }
+
+  return i->second;
+}
+
+void ActorManager::RecordDestroyed(Actor* actor) {
+  if (actor_ids_.erase(actor->net_id_) == 0) {
+    return;
+  }
+
+  if (destroyed_.size() >= ACTOR_DESTROY_HISTORY) {
+    destroyed_history_start_ = destroyed_.front().tick;
+    destroyed_.pop_front();
+  }
+
+  destroyed_.push_back({actor->net_id_, g_state.sim_ticks});
+}
+
 void ActorManager::TickActors() {
+  PROFILE_SCOPE("Actors");
+  MEMORY_TAG(MEMORY_TAG_ACTORS);
+
   for (auto const& actor: actors_) {
     if(!actor->IsActivated()) {
       continue;
@@ -75,6 +121,7 @@ void ActorManager::DrawActors() {
 
 void ActorManager::DestroyActors() {
   for (auto& actor: actors_) {
+    RecordDestroyed(actor);
     delete actor;
   }
 
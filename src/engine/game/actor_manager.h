@@ -17,9 +17,20 @@
 
 #pragma once
 
+#include <deque>
+
 #include "actors/actor.h"
 
-typedef std::set<Actor*> ActorSet;
+// Kept in the order they were created, rather than by address,
+// so they're always ticked in the same order from one run to the next
+struct ActorIdCompare {
+  bool operator()(const Actor* a, const Actor* b) const {
+    return a->GetId() < b->GetId();
+  }
+};
+typedef std::set<Actor*, ActorIdCompare> ActorSet;
+
+#define ACTOR_DESTROY_HISTORY   1024    // Destroyed actors remembered, for replication
 
 class ActorManager {
  protected:
@@ -38,6 +49,20 @@ class ActorManager {
   Actor* CreateActor(const std::string& class_name);
   void DestroyActor(Actor* actor);
 
+  // Creates an actor without handing it over to the manager, so it
+  // won't be ticked or drawn; the caller is responsible for deleting it
+  static Actor* ConstructActor(const std::string& class_name);
+
+  Actor* GetActorById(unsigned int id) const;
+
+  struct DestroyedActor {
+    unsigned int id;
+    unsigned int tick;
+  };
+  const std::deque<DestroyedActor>& GetDestroyedActors() const { return destroyed_; }
+  // Anything destroyed after this tick is guaranteed to be in the history
+  unsigned int GetDestroyedHistoryStart() const { return destroyed_history_start_; }
+
   void TickActors();
   void DrawActors();
   void DestroyActors();
@@ -56,7 +81,14 @@ class ActorManager {
   };
 
  private:
+  void RecordDestroyed(Actor* actor);
+
   static ActorSet actors_;
+  static std::map<unsigned int, Actor*> actor_ids_;
+  static unsigned int next_id_;
+
+  std::deque<DestroyedActor> destroyed_;
+  unsigned int destroyed_history_start_{0};
 };
 
 #define REGISTER_ACTOR(NAME, CLASS) \
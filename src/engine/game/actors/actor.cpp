@@ -16,7 +16,6 @@
  */
 
 #include "../../engine.h"
-#include "../../input.h"
 #include "../../Map.h"
 
 #include "../actor_manager.h"
@@ -30,10 +29,11 @@ Actor::Actor() :
 	INIT_PROPERTY( input_forward, PROP_PUSH, 0.00 ),
 	INIT_PROPERTY( input_yaw, PROP_PUSH, 0.00 ),
 	INIT_PROPERTY( input_pitch, PROP_PUSH, 0.00 ),
-	INIT_PROPERTY( position_, PROP_LOCAL | PROP_WRITE, PLVector3( 0, 0, 0 ) ),
+	INIT_PROPERTY( position_, PROP_WRITE, PLVector3( 0, 0, 0 ) ),
 	INIT_PROPERTY( fallback_position_, PROP_LOCAL | PROP_WRITE, PLVector3( 0, 0, 0 ) ),
-	INIT_PROPERTY( angles_, PROP_LOCAL | PROP_WRITE, PLVector3( 0, 0, 0 ) ),
-	INIT_PROPERTY( bounds_, PROP_LOCAL | PROP_WRITE, PLVector3( 0, 0, 0 ) ) {}
+	INIT_PROPERTY( angles_, PROP_WRITE, PLVector3( 0, 0, 0 ) ),
+	INIT_PROPERTY( bounds_, PROP_WRITE, PLVector3( 0, 0, 0 ) ),
+	INIT_PROPERTY( health_, PROP_WRITE, 0 ) {}
 
 Actor::~Actor() {
   for(auto actor : children_) {
@@ -63,12 +63,44 @@ void Actor::Deserialize(const ActorSpawn& spawn){
   SetAngles(spawn.angles);
 }
 
+static void WriteVector(SnapshotWriter& writer, const PLVector3& vector) {
+  writer.WriteFloat(vector.x);
+  writer.WriteFloat(vector.y);
+  writer.WriteFloat(vector.z);
+}
+
+static PLVector3 ReadVector(SnapshotReader& reader) {
+  PLVector3 vector;
+  vector.x = reader.ReadFloat();
+  vector.y = reader.ReadFloat();
+  vector.z = reader.ReadFloat();
+  return vector;
+}
+
+void Actor::SaveState(SnapshotWriter& writer) {
+  writer.WriteByte(is_visible_);
+  writer.WriteByte(is_activated_);
+  WriteVector(writer, velocity_);
+  WriteVector(writer, old_velocity_);
+  WriteVector(writer, old_position_);
+  WriteVector(writer, old_angles_);
+}
+
+void Actor::RestoreState(SnapshotReader& reader) {
+  is_visible_ = reader.ReadByte() != 0;
+  is_activated_ = reader.ReadByte() != 0;
+  velocity_ = ReadVector(reader);
+  old_velocity_ = ReadVector(reader);
+  old_position_ = ReadVector(reader);
+  old_angles_ = ReadVector(reader);
+}
+
 const IPhysicsBody* Actor::CreatePhysicsBody() {
   if(physics_body_ != nullptr) {
     return physics_body_;
   }
 
-  physics_body_ = Engine::Physics()->CreatePhysicsBody();
+  physics_body_ = Engine::Physics()->CreatePhysicsBody(PhysicsPrimitiveType::BOX, bounds_, 0, position_);
   if(physics_body_ == nullptr) {
     return nullptr;
   }
@@ -90,7 +122,7 @@ void Actor::AddHealth(int16_t health) {
     return;
   }
 
-  health_ += health;
+  health_ = health_ + health;
 }
 
 bool Actor::Possessed(const Player* player) {
@@ -135,32 +167,11 @@ void Actor::HandleInput() {
     return;
   }
 
-  PLVector2 cl = Input_GetJoystickState(player->GetControllerSlot(), INPUT_JOYSTICK_LEFT);
-  PLVector2 cr = Input_GetJoystickState(player->GetControllerSlot(), INPUT_JOYSTICK_RIGHT);
-
-  if (Input_GetActionState(player->GetControllerSlot(), ACTION_MOVE_FORWARD)) {
-    input_forward = 1.0f;
-  } else if (Input_GetActionState(player->GetControllerSlot(), ACTION_MOVE_BACKWARD)) {
-    input_forward = -1.0f;
-  } else {
-    input_forward = -cl.y / 327.0f;
-  }
-
-  if (Input_GetActionState(player->GetControllerSlot(), ACTION_TURN_LEFT)) {
-    input_yaw = -1.0f;
-  } else if (Input_GetActionState(player->GetControllerSlot(), ACTION_TURN_RIGHT)) {
-    input_yaw = 1.0f;
-  } else {
-    input_yaw = cr.x / 327.0f;
-  }
-
-  if (Input_GetActionState(player->GetControllerSlot(), ACTION_AIM_UP)) {
-    input_pitch = 1.0f;
-  } else if (Input_GetActionState(player->GetControllerSlot(), ACTION_AIM_DOWN)) {
-    input_pitch = -1.0f;
-  } else {
-    input_pitch = -cr.y / 327.0f;
-  }
+  // Networked players have their commands filled in by the server
+  const PlayerCommand& command = player->GetCommand();
+  input_forward = command.forward;
+  input_yaw = command.yaw;
+  input_pitch = command.pitch;
 }
 
 /**
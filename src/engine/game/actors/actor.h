@@ -85,12 +85,16 @@ class Actor: public PropertyOwner {
 
   virtual const char* GetClassName() { return "Actor"; }
 
+  // Unique for the lifetime of the process, zero if the actor isn't managed
+  unsigned int GetId() const { return net_id_; }
+  unsigned int GetSpawnTick() const { return spawn_tick_; }
+
   virtual void Tick() {}  // simulation tick, called per-frame
   virtual void Draw() {}  // draw tick, called per-frame
 
   virtual void SetHealth(int16_t health) { health_ = health; }
   virtual void AddHealth(int16_t health);
-  int16_t GetHealth() { return health_; }
+  int16_t GetHealth() { return static_cast<int16_t>(health_); }
 
   virtual bool IsVisible() { return is_visible_; }
 
@@ -107,6 +111,14 @@ class Actor: public PropertyOwner {
   virtual ActorSpawn Serialize() { return ActorSpawn(); }
   virtual void Deserialize(const ActorSpawn& spawn);
 
+  // Anything a saved game needs that isn't held in a property. Restoring
+  // happens after the properties and children have been put back
+  virtual void SaveState(SnapshotWriter& writer);
+  virtual void RestoreState(SnapshotReader& reader);
+
+  // Name the actor was registered under, as passed to ActorManager::CreateActor
+  const std::string& GetSpawnClassName() const { return spawn_class_name_; }
+
   virtual void Activate() { is_activated_ = true; }
   virtual void Deactivate() { is_activated_ = false; }
   virtual bool IsActivated() { return is_activated_; }
@@ -149,7 +161,7 @@ protected:
 	std::string reference_name_{ "actor" };
 
 private:
-	int16_t health_{ 0 };
+	NumericProperty<int> health_;
 
 	IPhysicsBody* physics_body_{ nullptr };
 
@@ -157,4 +169,9 @@ private:
 
   Actor* parent_{nullptr};
   std::vector<Actor*> children_;
+
+  friend class ActorManager;
+  std::string spawn_class_name_;
+  unsigned int net_id_{0};
+  unsigned int spawn_tick_{0};
 };
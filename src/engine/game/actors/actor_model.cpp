@@ -17,6 +17,7 @@
 
 #include "../../engine.h"
 #include "../../model.h"
+#include "../../graphics/model_queue.h"
 #include "actor_model.h"
 
 using namespace openhow;
@@ -31,6 +32,13 @@ void AModel::Draw() {
 		return;
 	}
 
+	// Simulated bodies are drawn between their last two ticks
+	if ( physics_body_ != nullptr && physics_body_->HasTransform() ) {
+		PLMatrix4 mat = physics_body_->GetInterpolatedTransform( g_state.sim_interpolation );
+		Display_GetModelQueue()->Submit( model_, mat, PLVector3( mat.m[ 12 ], mat.m[ 13 ], mat.m[ 14 ] ) );
+		return;
+	}
+
 	PLVector3 angles(
 		plDegreesToRadians( angles_.GetValue().x ),
 		plDegreesToRadians( angles_.GetValue().y ),
@@ -43,10 +51,11 @@ void AModel::Draw() {
 	mat.Rotate( angles.x, { 0, 0, 1 } );
 	mat.Translate( position_ );
 
-	Model_Draw( model_, mat );
+	Display_GetModelQueue()->Submit( model_, mat, position_.GetValue() );
 }
 
 void AModel::SetModel( const std::string& path ) {
+	model_path_ = path;
 	model_ = Engine::Resource()->LoadModel( "chars/" + path, false );
 	u_assert( model_ != nullptr );
 }
@@ -54,3 +63,21 @@ void AModel::SetModel( const std::string& path ) {
 void AModel::ShowModel( bool show ) {
 	show_model_ = show;
 }
+
+void AModel::SaveState( SnapshotWriter& writer ) {
+	SuperClass::SaveState( writer );
+
+	writer.WriteString( model_path_ );
+	writer.WriteByte( show_model_ );
+}
+
+void AModel::RestoreState( SnapshotReader& reader ) {
+	SuperClass::RestoreState( reader );
+
+	std::string path = reader.ReadString();
+	if ( !path.empty() && path != model_path_ ) {
+		SetModel( path );
+	}
+
+	show_model_ = reader.ReadByte() != 0;
+}
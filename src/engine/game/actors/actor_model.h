@@ -31,9 +31,13 @@ class AModel : public Actor {
 
   virtual void SetModel(const std::string &path);
 
+  void SaveState(SnapshotWriter &writer) override;
+  void RestoreState(SnapshotReader &reader) override;
+
  protected:
   PLModel *model_{nullptr};
 
  private:
+  std::string model_path_;
   bool show_model_{true};
 };
@@ -179,7 +179,7 @@ void APig::Deserialize( const ActorSpawn& spawn ) {
 	SetPosition( { position_.GetValue().x, map->GetTerrain()->GetMaxHeight(), position_.GetValue().z } );
 
 	SetHealth( 100 );
-	SetModel( "pigs/ac_hi" ); // temp
+	SetModel( Engine::Game()->GetPigModel( spawn.class_name ) );
 	SetTeam( spawn.team );
 	//SetClass(pig_class);
 
@@ -194,6 +194,46 @@ void APig::Deserialize( const ActorSpawn& spawn ) {
 	parachute_->Deploy();
 }
 
+void APig::SaveState( SnapshotWriter& writer ) {
+	SuperClass::SaveState( writer );
+
+	writer.WriteVarint( team_ );
+	writer.WriteVarint( personality_ );
+	writer.WriteVarint( class_ );
+	writer.WriteFloat( aim_pitch_ );
+	writer.WriteByte( upper_face_frame_ );
+	writer.WriteByte( lower_face_frame_ );
+
+	SaveInventory( writer );
+}
+
+void APig::RestoreState( SnapshotReader& reader ) {
+	SuperClass::RestoreState( reader );
+
+	team_ = static_cast<unsigned int>(reader.ReadVarint());
+	personality_ = static_cast<unsigned int>(reader.ReadVarint());
+	class_ = static_cast<unsigned int>(reader.ReadVarint());
+	aim_pitch_ = reader.ReadFloat();
+	upper_face_frame_ = static_cast<decltype( upper_face_frame_ )>(reader.ReadByte());
+	lower_face_frame_ = static_cast<decltype( lower_face_frame_ )>(reader.ReadByte());
+
+	RestoreInventory( reader );
+
+	// Our weapons come back as children, so pick them up again
+	for ( auto child : GetChildren() ) {
+		if ( parachute_ == nullptr ) {
+			parachute_ = dynamic_cast<AParachuteWeapon*>(child);
+			if ( parachute_ != nullptr ) {
+				continue;
+			}
+		}
+
+		if ( weapon_ == nullptr ) {
+			weapon_ = dynamic_cast<AWeapon*>(child);
+		}
+	}
+}
+
 bool APig::Possessed( const Player* player ) {
 	// TODO
 	PlayVoiceSample( VoiceCategory::READY );
@@ -61,6 +61,9 @@ class APig : public AAnimatedModel, public InventoryManager {
 
   void Deserialize(const ActorSpawn& spawn) override;
 
+  void SaveState(SnapshotWriter& writer) override;
+  void RestoreState(SnapshotReader& reader) override;
+
  private:
   AWeapon* weapon_{nullptr};
   AParachuteWeapon* parachute_{nullptr};
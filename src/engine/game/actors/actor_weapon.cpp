@@ -28,3 +28,15 @@ void AWeapon::Deploy() {
 
   is_deployed_ = true;
 }
+
+void AWeapon::SaveState(SnapshotWriter& writer) {
+  SuperClass::SaveState(writer);
+
+  writer.WriteByte(is_deployed_);
+}
+
+void AWeapon::RestoreState(SnapshotReader& reader) {
+  SuperClass::RestoreState(reader);
+
+  is_deployed_ = reader.ReadByte() != 0;
+}
@@ -29,6 +29,9 @@ class AWeapon : public AModel {
   virtual void Fire(const PLVector3& pos, const PLVector3& dir);
   virtual void Deploy();
 
+  void SaveState(SnapshotWriter& writer) override;
+  void RestoreState(SnapshotReader& reader) override;
+
  protected:
 
   bool is_deployed_{ false };
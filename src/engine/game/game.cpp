@@ -15,10 +15,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+
 #include "../engine.h"
 #include "../frontend.h"
 #include "../Map.h"
 #include "../language.h"
+#include "../journal.h"
+#include "../manifest_cache.h"
+#include "../profiler.h"
+#include "../snapshot.h"
 
 #include "actor_manager.h"
 #include "mode_base.h"
@@ -33,6 +39,9 @@
 
 using namespace openhow;
 
+// What pigs used before they had classes to go by
+#define PIG_DEFAULT_MODEL   "pigs/ac_hi"
+
 std::string MapManifest::Serialize() {
 	std::stringstream output;
 	output << "{";
@@ -88,17 +97,6 @@ GameManager::GameManager() {
 	plRegisterConsoleCommand( "GiveItem", GiveItemCommand, "Gives a specified item to the current occupied pig." );
 	plRegisterConsoleCommand( "SpawnModel", SpawnModelCommand, "Creates a model at your current position." );
 
-	// Load in all the data we'll retain in memory
-	Engine::Resource()->LoadModel( "chars/pigs/ac_hi", true, true );
-	Engine::Resource()->LoadModel( "chars/pigs/sb_hi", true, true );
-	Engine::Resource()->LoadModel( "chars/pigs/gr_hi", true, true );
-	Engine::Resource()->LoadModel( "chars/pigs/hv_hi", true, true );
-	Engine::Resource()->LoadModel( "chars/pigs/le_hi", true, true );
-	Engine::Resource()->LoadModel( "chars/pigs/me_hi", true, true );
-	Engine::Resource()->LoadModel( "chars/pigs/sa_hi", true, true );
-	Engine::Resource()->LoadModel( "chars/pigs/sn_hi", true, true );
-	Engine::Resource()->LoadModel( "chars/pigs/sp_hi", true, true );
-
 	camera_ = new Camera( { 0, 0, 0 }, { 0, 0, 0 } );
 }
 
@@ -109,6 +107,8 @@ GameManager::~GameManager() {
 }
 
 void GameManager::Tick() {
+	PROFILE_SCOPE( "Game" );
+
 	if ( pauseSim && simSteps == 0 ) {
 		return;
 	}
@@ -120,17 +120,17 @@ void GameManager::Tick() {
 	}
 
 	if ( ambient_emit_delay_ < g_state.sim_ticks ) {
-		const AudioSample* sample = ambient_samples_[ rand() % MAX_AMBIENT_SAMPLES ];
+		const AudioSample* sample = ambient_samples_[ Sim_Random() % MAX_AMBIENT_SAMPLES ];
 		if ( sample != nullptr ) {
 			PLVector3 position = {
-				plGenerateRandomf( TERRAIN_PIXEL_WIDTH ),
+				Sim_RandomFloat( TERRAIN_PIXEL_WIDTH ),
 				map_->GetTerrain()->GetMaxHeight(),
-				plGenerateRandomf( TERRAIN_PIXEL_WIDTH )
+				Sim_RandomFloat( TERRAIN_PIXEL_WIDTH )
 			};
 			Engine::Audio()->PlayLocalSound( sample, position, { 0, 0, 0 }, true, 0.5f );
 		}
 
-		ambient_emit_delay_ = g_state.sim_ticks + TICKS_PER_SECOND + rand() % ( 7 * TICKS_PER_SECOND );
+		ambient_emit_delay_ = g_state.sim_ticks + TICKS_PER_SECOND + Sim_Random() % ( 7 * TICKS_PER_SECOND );
 	}
 
 	mode_->Tick();
@@ -218,54 +218,246 @@ void GameManager::RegisterTeamManifest( const std::string& path ) {
 	}
 }
 
-void GameManager::RegisterMapManifest( const std::string& path ) {
-	LogInfo( "Registering map \"%s\"...\n", path.c_str() );
+/**
+ * Registers the pig classes. Their models aren't loaded until a mode
+ * starts, and then only for the classes it uses. See RequirePigModels.
+ */
+void GameManager::RegisterClassManifest( const std::string& path ) {
+	LogInfo( "Registering class manifest \"%s\"...\n", path.c_str() );
+
+	pig_classes_.clear();
 
-	MapManifest manifest;
 	try {
 		ScriptConfig config( path );
-		manifest.name = config.GetStringProperty( "name", manifest.name );
-		manifest.author = config.GetStringProperty( "author", manifest.author );
-		manifest.description = config.GetStringProperty( "description", manifest.description );
-		manifest.tile_directory = config.GetStringProperty( "tileDirectory", manifest.tile_directory );
-		manifest.modes = config.GetArrayStrings( "modes" );
-		manifest.ambient_colour = config.GetColourProperty( "ambientColour", manifest.ambient_colour );
-		manifest.sky_colour_top = config.GetColourProperty( "skyColourTop", manifest.sky_colour_top );
-		manifest.sky_colour_bottom = config.GetColourProperty( "skyColourBottom", manifest.sky_colour_bottom );
-		manifest.sun_colour = config.GetColourProperty( "sunColour", manifest.sun_colour );
-		manifest.sun_yaw = config.GetFloatProperty( "sunYaw", manifest.sun_yaw );
-		manifest.sun_pitch = config.GetFloatProperty( "sunPitch", manifest.sun_pitch );
-		manifest.temperature = config.GetStringProperty( "temperature", manifest.temperature );
-		manifest.weather = config.GetStringProperty( "weather", manifest.weather );
-		manifest.time = config.GetStringProperty( "time", manifest.time );
-
-		// Fog
-		manifest.fog_colour = config.GetColourProperty( "fogColour", manifest.fog_colour );
-		manifest.fog_intensity = config.GetFloatProperty( "fogIntensity", manifest.fog_intensity );
-		manifest.fog_distance = config.GetFloatProperty( "fogDistance", manifest.fog_distance );
+		unsigned int num_classes = config.GetArrayLength();
+		for ( unsigned int i = 0; i < num_classes; ++i ) {
+			config.EnterChildNode( i );
+
+			PigClass pig_class;
+			pig_class.key = config.GetStringProperty( "key", pig_class.key );
+			pig_class.label = config.GetStringProperty( "label", pig_class.label );
+			pig_class.model = config.GetStringProperty( "model", pig_class.model );
+			pig_classes_.push_back( pig_class );
+
+			config.LeaveChildNode();
+		}
 	} catch ( const std::exception& e ) {
-		LogWarn( "Failed to read map config, \"%s\"!\n%s\n", path.c_str(), e.what() );
+		LogWarn( "Failed to read class config, \"%s\"!\n%s\n", path.c_str(), e.what() );
+	}
+}
+
+/**
+ * Returns the registered class whose key matches the start of the
+ * given actor class, e.g. "sb" for "sb_me", or null if there's none.
+ */
+const PigClass* GameManager::FindPigClass( const std::string& class_name ) const {
+	std::string key = class_name.substr( 0, class_name.find( '_' ) );
+	for ( const auto& pig_class : pig_classes_ ) {
+		if ( pig_class.key == key && !pig_class.model.empty() ) {
+			return &pig_class;
+		}
+	}
+
+	return nullptr;
+}
+
+/**
+ * Returns the model used by pigs of the given actor class, e.g. "sb_me",
+ * going by the registered class with the matching key.
+ */
+std::string GameManager::GetPigModel( const std::string& class_name ) const {
+	const PigClass* pig_class = FindPigClass( class_name );
+	if ( pig_class != nullptr ) {
+		return pig_class->model;
+	}
+
+	LogWarn( "No pig class for \"%s\", using the default model!\n", class_name.c_str() );
+	return PIG_DEFAULT_MODEL;
+}
+
+/**
+ * Returns the models needed for the pigs that will be spawned on the
+ * given number of teams. Each is only listed the once, as some classes
+ * share a model, e.g. the heavy weapon stages.
+ */
+std::vector<std::string> GameManager::GetPigModelsInUse( const std::vector<ActorSpawn>& spawns,
+														 unsigned int num_teams ) const {
+	std::vector<std::string> models;
+	for ( const auto& spawn : spawns ) {
+		if ( spawn.team >= num_teams ) {
+			continue;
+		}
+
+		const PigClass* pig_class = FindPigClass( spawn.class_name );
+		if ( pig_class == nullptr ||
+			std::find( models.begin(), models.end(), pig_class->model ) != models.end() ) {
+			continue;
+		}
+
+		models.push_back( pig_class->model );
+	}
+
+	return models;
+}
+
+/**
+ * Loads the models for the pigs the current map spawns on the given
+ * number of teams, before the mode starts spawning them. The classes
+ * nobody's using are left unloaded.
+ */
+void GameManager::RequirePigModels( unsigned int num_teams ) {
+	// Nothing's drawn when headless, so there's nothing worth loading
+	if ( g_state.is_headless || map_ == nullptr ) {
+		return;
+	}
+
+	std::vector<std::string> models = GetPigModelsInUse( map_->GetSpawns(), num_teams );
+	if ( models.empty() ) {
+		return;
+	}
+
+	PROFILE_SCOPE( "Load Pig Models" );
+
+	LogInfo( "Loading %u of %u pig models...\n", static_cast<unsigned int>(models.size()),
+			 static_cast<unsigned int>(pig_classes_.size()) );
+	for ( const auto& model : models ) {
+		Engine::Resource()->LoadModel( "chars/" + model, true, true );
+	}
+}
+
+static void WriteColour( SnapshotWriter& writer, const PLColour& colour ) {
+	writer.WriteByte( colour.r );
+	writer.WriteByte( colour.g );
+	writer.WriteByte( colour.b );
+	writer.WriteByte( colour.a );
+}
+
+static PLColour ReadColour( SnapshotReader& reader ) {
+	PLColour colour;
+	colour.r = reader.ReadByte();
+	colour.g = reader.ReadByte();
+	colour.b = reader.ReadByte();
+	colour.a = reader.ReadByte();
+	return colour;
+}
+
+/**
+ * Runs on one of the manifest cache's worker threads,
+ * so shouldn't touch anything beyond the manifest.
+ */
+static void ParseMapManifest( const std::string& path, const char* text, SnapshotWriter& writer,
+							  std::vector<std::string>& warnings ) {
+	u_unused( path );
+
+	ScriptConfig config;
+	config.ParseBuffer( text );
+
+	MapManifest manifest;
+	manifest.name = config.GetStringProperty( "name", manifest.name, true );
+	if ( manifest.name == "none" ) {
+		warnings.emplace_back( "No name provided for map!" );
+	}
+	manifest.author = config.GetStringProperty( "author", manifest.author );
+	manifest.description = config.GetStringProperty( "description", manifest.description );
+	manifest.tile_directory = config.GetStringProperty( "tileDirectory", manifest.tile_directory );
+	manifest.modes = config.GetArrayStrings( "modes", true );
+	manifest.ambient_colour = config.GetColourProperty( "ambientColour", manifest.ambient_colour );
+	manifest.sky_colour_top = config.GetColourProperty( "skyColourTop", manifest.sky_colour_top );
+	manifest.sky_colour_bottom = config.GetColourProperty( "skyColourBottom", manifest.sky_colour_bottom );
+	manifest.sun_colour = config.GetColourProperty( "sunColour", manifest.sun_colour );
+	manifest.sun_yaw = config.GetFloatProperty( "sunYaw", manifest.sun_yaw );
+	manifest.sun_pitch = config.GetFloatProperty( "sunPitch", manifest.sun_pitch );
+	manifest.temperature = config.GetStringProperty( "temperature", manifest.temperature );
+	manifest.weather = config.GetStringProperty( "weather", manifest.weather );
+	manifest.time = config.GetStringProperty( "time", manifest.time );
+
+	// Fog
+	manifest.fog_colour = config.GetColourProperty( "fogColour", manifest.fog_colour );
+	manifest.fog_intensity = config.GetFloatProperty( "fogIntensity", manifest.fog_intensity );
+	manifest.fog_distance = config.GetFloatProperty( "fogDistance", manifest.fog_distance );
+
+	writer.WriteString( manifest.name );
+	writer.WriteString( manifest.author );
+	writer.WriteString( manifest.description );
+	writer.WriteString( manifest.tile_directory );
+	writer.WriteVarint( manifest.modes.size() );
+	for ( const auto& mode : manifest.modes ) {
+		writer.WriteString( mode );
+	}
+	WriteColour( writer, manifest.ambient_colour );
+	WriteColour( writer, manifest.sky_colour_top );
+	WriteColour( writer, manifest.sky_colour_bottom );
+	WriteColour( writer, manifest.sun_colour );
+	writer.WriteFloat( manifest.sun_yaw );
+	writer.WriteFloat( manifest.sun_pitch );
+	writer.WriteString( manifest.temperature );
+	writer.WriteString( manifest.weather );
+	writer.WriteString( manifest.time );
+	WriteColour( writer, manifest.fog_colour );
+	writer.WriteFloat( manifest.fog_intensity );
+	writer.WriteFloat( manifest.fog_distance );
+}
+
+void GameManager::AddMapManifest( const ManifestResult& result ) {
+	MapManifest manifest;
+	if ( result.error.empty() ) {
+		SnapshotReader reader( result.data.data(), result.data.size() );
+		manifest.name = reader.ReadString();
+		manifest.author = reader.ReadString();
+		manifest.description = reader.ReadString();
+		manifest.tile_directory = reader.ReadString();
+		size_t num_modes = reader.ReadVarint();
+		for ( size_t i = 0; i < num_modes && reader.IsValid(); ++i ) {
+			manifest.modes.push_back( reader.ReadString() );
+		}
+		manifest.ambient_colour = ReadColour( reader );
+		manifest.sky_colour_top = ReadColour( reader );
+		manifest.sky_colour_bottom = ReadColour( reader );
+		manifest.sun_colour = ReadColour( reader );
+		manifest.sun_yaw = reader.ReadFloat();
+		manifest.sun_pitch = reader.ReadFloat();
+		manifest.temperature = reader.ReadString();
+		manifest.weather = reader.ReadString();
+		manifest.time = reader.ReadString();
+		manifest.fog_colour = ReadColour( reader );
+		manifest.fog_intensity = reader.ReadFloat();
+		manifest.fog_distance = reader.ReadFloat();
+	} else {
+		LogWarn( "Failed to read map config, \"%s\"!\n%s\n", result.path.c_str(), result.error.c_str() );
+	}
+
+	for ( const auto& warning : result.warnings ) {
+		LogWarn( "%s (\"%s\")\n", warning.c_str(), result.path.c_str() );
 	}
 
 	char temp_buf[64];
-	plStripExtension( temp_buf, sizeof( temp_buf ), plGetFileName( path.c_str() ) );
+	plStripExtension( temp_buf, sizeof( temp_buf ), plGetFileName( result.path.c_str() ) );
 
-	manifest.filepath = path;
+	manifest.filepath = result.path;
 	manifest.filename = temp_buf;
 
 	map_manifests_.insert( std::make_pair( temp_buf, manifest ) );
 }
 
-static void RegisterManifestInterface( const char* path ) {
-	Engine::Game()->RegisterMapManifest( path );
+void GameManager::RegisterMapManifest( const std::string& path ) {
+	LogInfo( "Registering map \"%s\"...\n", path.c_str() );
+
+	for ( const auto& result : ManifestCache_Parse( "map", { path }, ParseMapManifest ) ) {
+		AddMapManifest( result );
+	}
 }
 
 /**
  * Scans the campaigns directory for .map files and indexes them.
  */
-void GameManager::RegisterMapManifests() {
+void GameManager::RegisterMapManifests( const char* directory ) {
 	map_manifests_.clear();
-	plScanDirectory( "maps", "map", RegisterManifestInterface, false );
+
+	std::vector<ManifestResult> results =
+		ManifestCache_Parse( "map", ManifestCache_Scan( directory, "map" ), ParseMapManifest );
+	for ( const auto& result : results ) {
+		AddMapManifest( result );
+	}
 }
 
 /**
@@ -349,7 +541,13 @@ void GameManager::MapCommand( unsigned int argc, char** argv ) {
 
 	// Set up a mode with some defaults.
 	GameModeDescriptor descriptor = GameModeDescriptor();
-	Engine::Game()->StartMode( argv[ 1 ], { new Player( PlayerType::LOCAL ) }, descriptor );
+	PlayerPtrVector players = { new Player( PlayerType::LOCAL ) };
+	// Anything extra is left for clients to claim once they connect
+	int num_networked = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 0;
+	for ( int i = 0; i < num_networked; ++i ) {
+		players.push_back( new Player( PlayerType::NETWORKED ) );
+	}
+	Engine::Game()->StartMode( argv[ 1 ], players, descriptor );
 }
 
 /**
@@ -457,12 +655,14 @@ void GameManager::StartMode( const std::string& map,
 		return;
 	}
 
+	RequirePigModels( static_cast<unsigned int>(players.size()) );
+
 	std::string sample_ext = "d";
 	if ( map_->GetManifest()->time != "day" ) {
 		sample_ext = "n";
 	}
 
-	ambient_emit_delay_ = g_state.sim_ticks + plGenerateRandomd( 100 ) + 1;
+	ambient_emit_delay_ = g_state.sim_ticks + Sim_Random() % 100 + 1;
 	for ( unsigned int i = 1, idx = 0; i < 4; ++i ) {
 		std::string snum = std::to_string( i );
 		std::string path = "audio/amb_";
@@ -517,3 +717,21 @@ void GameManager::EndMode() {
 bool GameManager::IsModeActive() {
 	return ( mode_ != nullptr );
 }
+
+/**
+ * The ambient delay is kept relative to the current tick,
+ * so a restored game carries on the same whenever it's loaded.
+ */
+void GameManager::SaveState( SnapshotWriter& writer ) {
+	u_assert( mode_ != nullptr, "Attempted to save without an active mode!\n" );
+
+	writer.WriteSignedVarint( static_cast<int64_t>(ambient_emit_delay_) - g_state.sim_ticks );
+	mode_->SaveState( writer );
+}
+
+void GameManager::RestoreState( SnapshotReader& reader ) {
+	u_assert( mode_ != nullptr, "Attempted to restore without an active mode!\n" );
+
+	ambient_emit_delay_ = static_cast<double>(g_state.sim_ticks + reader.ReadSignedVarint());
+	mode_->RestoreState( reader );
+}
@@ -145,6 +145,13 @@ struct Team : PropertyOwner {
 	std::array<CharacterSlot, 8> slots;
 };
 
+/* Only what's needed to know which models the classes use, for now */
+struct PigClass {
+	std::string key;    // Start of the actor classes that use it, i.e. "gr" for "gr_me"
+	std::string label;
+	std::string model;
+};
+
 struct MapManifest {
 	std::string filepath; // path to manifest
 	std::string filename; // name of the manifest
@@ -189,6 +196,7 @@ struct GameModeDescriptor {
 typedef std::vector<Player*> PlayerPtrVector;
 
 class Map;
+struct ManifestResult;
 
 class GameManager {
 private:
@@ -214,7 +222,7 @@ public:
 
 	void RegisterTeamManifest( const std::string& path );
 	void RegisterMapManifest( const std::string& path );
-	void RegisterMapManifests();
+	void RegisterMapManifests( const char* directory = "maps" );
 
 	typedef std::map<std::string, MapManifest> MapManifestMap;
 	MapManifest* GetMapManifest( const std::string& name );
@@ -225,12 +233,29 @@ public:
 	typedef std::vector<Team> TeamVector;
 	const TeamVector& GetDefaultTeams() { return default_teams_; }
 
+	// Pigs
+
+	void RegisterClassManifest( const std::string& path );
+
+	typedef std::vector<PigClass> PigClassVector;
+	const PigClassVector& GetPigClasses() { return pig_classes_; }
+
+	const PigClass* FindPigClass( const std::string& class_name ) const;
+	std::string GetPigModel( const std::string& class_name ) const;
+
+	std::vector<std::string> GetPigModelsInUse( const std::vector<ActorSpawn>& spawns, unsigned int num_teams ) const;
+	void RequirePigModels( unsigned int num_teams );
+
 	Map* GetCurrentMap() { return map_; }
 
 	IGameMode* GetMode() { return mode_; }
 
 	bool IsModeActive();
 
+	// State of the manager and its mode, for saved games
+	void SaveState( SnapshotWriter& writer );
+	void RestoreState( SnapshotReader& reader );
+
 	void StepSimulation( unsigned int steps = 1 ) {
 		simSteps = steps;
 	}
@@ -274,11 +299,14 @@ private:
 
 	IGameMode* mode_{ nullptr };
 
+	void AddMapManifest( const ManifestResult& result );
 	std::map<std::string, MapManifest> map_manifests_;
 
 	TeamVector default_teams_;
 	PlayerPtrVector players_;
 
+	PigClassVector pig_classes_;
+
 #define MAX_AMBIENT_SAMPLES 8
 	double ambient_emit_delay_{ 0 };
 	const struct AudioSample* ambient_samples_[MAX_AMBIENT_SAMPLES]{};
@@ -19,25 +19,84 @@
 #include "actor_manager.h"
 #include "inventory.h"
 
+InventoryManager::~InventoryManager() {
+  ClearItems();
+}
+
 /**
  * Clear the inventory of items.
  */
 void InventoryManager::ClearItems() {
+  for (auto& item : items_) {
+    delete item.second;
+  }
+
   items_.clear();
 }
 
 void InventoryManager::AddInventoryItem(ItemIdentifier identifier, unsigned int quantity) {
-#if 0
-  u_assert(identifier != InventoryItem::Identifier::INVALID_ID, "Attempted to add a null item to inventory!\n");
+  if (identifier == ItemIdentifier::NONE || quantity == 0) {
+    LogWarn("Attempted to add an invalid item to inventory!\n");
+    return;
+  }
+
+  InventoryItem* item = GetItem(identifier);
+  if (item == nullptr) {
+    item = new InventoryItem();
+    item->id_ = identifier;
+    items_.insert(std::make_pair(identifier, item));
+  }
+
+  item->quantity_ += quantity;
+
+  LogDebug("Added %u of item %d to inventory\n", quantity, static_cast<int>(identifier));
+}
+
+void InventoryManager::RemoveItem(ItemIdentifier identifier, unsigned int quantity) {
+  auto i = items_.find(identifier);
+  if (i == items_.end()) {
+    return;
+  }
 
-  LogDebug("Added %s to inventory\n", item->GetInventoryDescription().c_str());
+  if (i->second->quantity_ > quantity) {
+    i->second->quantity_ -= quantity;
+    return;
+  }
 
-  items_.emplace(std::pair<std::string, InventoryItem*>(item->GetInventoryDescription(), item));
-#endif
+  delete i->second;
+  items_.erase(i);
 }
 
 InventoryItem* InventoryManager::GetItem(ItemIdentifier identifier) {
-  return nullptr;
+  auto i = items_.find(identifier);
+  if (i == items_.end()) {
+    return nullptr;
+  }
+
+  return i->second;
+}
+
+void InventoryManager::SaveInventory(SnapshotWriter& writer) const {
+  writer.WriteVarint(items_.size());
+  for (const auto& item : items_) {
+    writer.WriteVarint(static_cast<unsigned int>(item.first));
+    writer.WriteVarint(item.second->quantity_);
+  }
+}
+
+void InventoryManager::RestoreInventory(SnapshotReader& reader) {
+  ClearItems();
+
+  unsigned int num_items = static_cast<unsigned int>(reader.ReadVarint());
+  for (unsigned int i = 0; i < num_items && reader.IsValid(); ++i) {
+    auto identifier = static_cast<ItemIdentifier>(reader.ReadVarint());
+    unsigned int quantity = static_cast<unsigned int>(reader.ReadVarint());
+    if (!reader.IsValid()) {
+      break;
+    }
+
+    AddInventoryItem(identifier, quantity);
+  }
 }
 
 /// Inventory Items
@@ -102,7 +102,7 @@ enum class ItemIdentifier {
 class InventoryItem {
  public:
   InventoryItem() = default;
-  ~InventoryItem() = default;
+  virtual ~InventoryItem() = default;
 
   virtual void Equipped(Actor* actor);
 
@@ -111,15 +111,20 @@ class InventoryItem {
   virtual std::string GetInventoryDescription() const { return "invalid"; }
   virtual PLTexture* GetInventoryIcon();
 
+  ItemIdentifier GetIdentifier() const { return id_; }
+  unsigned int GetQuantity() const { return quantity_; }
+
  protected:
   unsigned int quantity_{ 0 };
   ItemIdentifier id_{ ItemIdentifier::NONE };
 
  private:
+  friend class InventoryManager;
 };
 
 class InventoryManager {
  public:
+  ~InventoryManager();
 
   InventoryItem* GetItem(ItemIdentifier identifier);
   void AddInventoryItem(ItemIdentifier identifier, unsigned int quantity);
@@ -127,6 +132,10 @@ class InventoryManager {
 
   void ClearItems();
 
+  // Written out as each item's identifier and quantity, for saved games
+  void SaveInventory(SnapshotWriter& writer) const;
+  void RestoreInventory(SnapshotReader& reader);
+
  protected:
  private:
   std::map<ItemIdentifier, InventoryItem*> items_;
@@ -17,6 +17,7 @@
 
 #include "../engine.h"
 #include "../Map.h"
+#include "../journal.h"
 
 #include "mode_base.h"
 #include "actor_manager.h"
@@ -40,7 +41,7 @@ void BaseGameMode::StartRound() {
 	SpawnActors();
 
 	// Play the deployment music
-	Engine::Audio()->PlayMusic( "music/track" + std::to_string( std::rand() % 4 + 27 ) + ".ogg" );
+	Engine::Audio()->PlayMusic( "music/track" + std::to_string( Sim_Random() % 4 + 27 ) + ".ogg" );
 
 	StartTurn( GetCurrentPlayer() );
 
@@ -48,13 +49,17 @@ void BaseGameMode::StartRound() {
 }
 
 void BaseGameMode::RestartRound() {
-	DestroyActors();
+	EndRound();
 
 	StartRound();
 }
 
 void BaseGameMode::EndRound() {
 	DestroyActors();
+
+	round_started_ = false;
+	turn_started_ = false;
+	num_turn_ticks = 0;
 }
 
 void BaseGameMode::Tick() {
@@ -73,6 +78,10 @@ void BaseGameMode::Tick() {
 		return;
 	}
 
+	if ( player->GetType() == PlayerType::LOCAL ) {
+		player->SetCommand( player->SampleCommand() );
+	}
+
 	actor->HandleInput();
 
 	// temp: force the camera at the actor pos
@@ -140,6 +149,11 @@ void BaseGameMode::SpawnActors() {
 }
 
 void BaseGameMode::DestroyActors() {
+	// Players hang on to their pigs, which are about to go
+	for ( auto player : Engine::Game()->GetPlayers() ) {
+		player->ClearChildren();
+	}
+
 	ActorManager::GetInstance()->DestroyActors();
 }
 
@@ -214,3 +228,21 @@ void BaseGameMode::CyclePlayers() {
 void BaseGameMode::AssignActorToPlayer( Actor* target, Player* owner ) {
 	owner->AddChild( target );
 }
+
+void BaseGameMode::SaveState( SnapshotWriter& writer ) {
+	writer.WriteByte( mode_started_ );
+	writer.WriteByte( round_started_ );
+	writer.WriteByte( turn_started_ );
+	writer.WriteVarint( current_player_ );
+	writer.WriteVarint( max_turn_ticks );
+	writer.WriteVarint( num_turn_ticks );
+}
+
+void BaseGameMode::RestoreState( SnapshotReader& reader ) {
+	mode_started_ = reader.ReadByte() != 0;
+	round_started_ = reader.ReadByte() != 0;
+	turn_started_ = reader.ReadByte() != 0;
+	current_player_ = static_cast<unsigned int>(reader.ReadVarint());
+	max_turn_ticks = static_cast<unsigned int>(reader.ReadVarint());
+	num_turn_ticks = static_cast<unsigned int>(reader.ReadVarint());
+}
@@ -44,6 +44,9 @@ class BaseGameMode : public IGameMode {
 
   void AssignActorToPlayer(Actor* target, Player* owner) override;
 
+  void SaveState(SnapshotWriter& writer) override;
+  void RestoreState(SnapshotReader& reader) override;
+
  protected:
   void StartTurn(Player* player) override;
   void EndTurn(Player* player) override;
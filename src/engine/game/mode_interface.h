@@ -52,6 +52,10 @@ class IGameMode {
 
   virtual void AssignActorToPlayer(Actor* target, Player* owner) = 0;
 
+  // Round and turn state, for saved games
+  virtual void SaveState(SnapshotWriter& writer) = 0;
+  virtual void RestoreState(SnapshotReader& reader) = 0;
+
  protected:
   virtual void StartTurn(Player* player) = 0;
   virtual void EndTurn(Player* player) = 0;
@@ -16,12 +16,47 @@
  */
 
 #include "../engine.h"
+#include "../input.h"
 
 #include "player.h"
 
 Player::Player(PlayerType type) : type_(type) {}
 Player::~Player() = default;
 
+PlayerCommand Player::SampleCommand() const {
+  PlayerCommand command;
+  command.sequence = command_.sequence + 1;
+
+  PLVector2 cl = Input_GetJoystickState(input_slot, INPUT_JOYSTICK_LEFT);
+  PLVector2 cr = Input_GetJoystickState(input_slot, INPUT_JOYSTICK_RIGHT);
+
+  if (Input_GetActionState(input_slot, ACTION_MOVE_FORWARD)) {
+    command.forward = 1.0f;
+  } else if (Input_GetActionState(input_slot, ACTION_MOVE_BACKWARD)) {
+    command.forward = -1.0f;
+  } else {
+    command.forward = -cl.y / 327.0f;
+  }
+
+  if (Input_GetActionState(input_slot, ACTION_TURN_LEFT)) {
+    command.yaw = -1.0f;
+  } else if (Input_GetActionState(input_slot, ACTION_TURN_RIGHT)) {
+    command.yaw = 1.0f;
+  } else {
+    command.yaw = cr.x / 327.0f;
+  }
+
+  if (Input_GetActionState(input_slot, ACTION_AIM_UP)) {
+    command.pitch = 1.0f;
+  } else if (Input_GetActionState(input_slot, ACTION_AIM_DOWN)) {
+    command.pitch = -1.0f;
+  } else {
+    command.pitch = -cr.y / 327.0f;
+  }
+
+  return command;
+}
+
 void Player::PossessCurrentChild() {
   Actor* child = children_[current_child_];
   if(child == nullptr) {
@@ -84,3 +119,8 @@ void Player::AddChild(Actor* actor) {
 void Player::RemoveChild(Actor* actor) {
   // todo
 }
+
+void Player::ClearChildren() {
+  children_.clear();
+  current_child_ = 0;
+}
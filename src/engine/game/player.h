@@ -23,21 +23,45 @@ enum class PlayerType {
   COMPUTER,
 };
 
+/**
+ * Everything a player asked their current child to do over one tick.
+ * Local players sample these from the input devices, while networked
+ * players receive them from their client.
+ */
+struct PlayerCommand {
+  unsigned int sequence{ 0 };  // Increases by one for every command sampled
+  float forward{ 0 };          // -1.0 = backwards, +1.0 = forwards
+  float yaw{ 0 };              // -1.0 = left, +1.0 = right
+  float pitch{ 0 };            // -1.0 = down, +1.0 = up
+};
+
 class Player {
  public:
   Player(PlayerType type);
   ~Player();
 
+  PlayerType GetType() const { return type_; }
+
+  // Reads the controller for this player's slot into the next command
+  PlayerCommand SampleCommand() const;
+  void SetCommand(const PlayerCommand& command) { command_ = command; }
+  const PlayerCommand& GetCommand() const { return command_; }
+
   unsigned int GetNumChildren() { return children_.size(); }
 
   void AddChild(Actor* actor);
   void RemoveChild(Actor* actor);
+  void ClearChildren();
 
   void PossessCurrentChild();
   void DepossessCurrentChild();
 
   Actor* GetCurrentChild();
 
+  const std::vector<Actor*>& GetChildren() const { return children_; }
+  unsigned int GetCurrentChildIndex() const { return current_child_; }
+  void SetCurrentChildIndex(unsigned int index) { current_child_ = index; }
+
   void CycleChildren(bool forward = true);
 
   void SetControllerSlot(unsigned int slot) { input_slot = slot; }
@@ -53,6 +77,8 @@ class Player {
   PlayerType type_;
   Team team_;
 
+  PlayerCommand command_;
+
   std::vector<Actor*> children_;
   unsigned int current_child_{ 0 };
 };
@@ -22,7 +22,12 @@
 using namespace openhow;
 
 Camera::Camera(const PLVector3& pos, const PLVector3& angles) {
-  camera_ = plCreateCamera();
+  if (g_state.is_headless) {
+    // The game still moves it about, but it's never set up for drawing
+    camera_ = static_cast<PLCamera*>(u_alloc(1, sizeof(PLCamera), true));
+  } else {
+    camera_ = plCreateCamera();
+  }
   if (camera_ == nullptr) {
     Error("Failed to create camera object!\n%s\n", plGetError());
   }
@@ -36,6 +41,11 @@ Camera::Camera(const PLVector3& pos, const PLVector3& angles) {
 }
 
 Camera::~Camera() {
+  if (g_state.is_headless) {
+    u_free(camera_);
+    return;
+  }
+
   plDestroyCamera(camera_);
 }
 
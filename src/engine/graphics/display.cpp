@@ -23,12 +23,17 @@
 #include "../imgui_layer.h"
 #include "../frontend.h"
 #include "../Map.h"
+#include "../particle.h"
+#include "../profiler.h"
 
 #include "../game/actor_manager.h"
 
 #include "font.h"
 #include "shaders.h"
 #include "display.h"
+#include "model_queue.h"
+#include "render_queue.h"
+#include "sprite_batch.h"
 
 using namespace openhow;
 
@@ -43,6 +48,7 @@ static std::vector<VideoPreset> vidPresets;
 
 static PLConsoleVariable *cv_display_show_camerapos;
 static PLConsoleVariable *cv_display_show_viewportinfo;
+static PLConsoleVariable *cv_display_show_drawstats;
 
 #if 0
 void PrintTextureCacheSizeCommand(unsigned int argc, char *argv[]) {
@@ -79,6 +85,7 @@ void DrawTextureCache(unsigned int id) {
 			h = (unsigned int) cv_display_height->i_value;
 		}
 
+		Font_Flush();
 		plDrawTexturedRectangle(0, 0, w, h, index->texture);
 #if 1
 		for(unsigned int i = 0; i < index->num_textures; ++i) {
@@ -232,6 +239,7 @@ void Display_Initialize() {
 	cv_display_show_camerapos = plRegisterConsoleVariable( "display_show_camerapos", "0", pl_bool_var, nullptr, "" );
 	cv_display_show_viewportinfo =
 		plRegisterConsoleVariable( "display_show_viewportinfo", "0", pl_bool_var, nullptr, "" );
+	cv_display_show_drawstats = plRegisterConsoleVariable( "display_show_drawstats", "0", pl_bool_var, nullptr, "" );
 
 	// check the command line for any arguments
 	const char *var;
@@ -297,6 +305,8 @@ void Display_Initialize() {
 }
 
 void Display_Shutdown() {
+	Display_GetSpriteBatcher()->DestroySegments();
+
 	Shaders_Shutdown();
 }
 
@@ -352,7 +362,7 @@ static void DrawFPSOverlay() {
 
 	char ms_count[32];
 	sprintf( ms_count, "FPS %d/S (%d/MS)", fps, ms );
-	unsigned int str_w = ( font->chars[ 0 ].w * 2 ) * strlen( ms_count );
+	int str_w = Font_GetStringWidth( font, 0, ms_count );
 
 	PLColour colour;
 	if ( fps < 20 ) {
@@ -365,6 +375,8 @@ static void DrawFPSOverlay() {
 
 	int x = w - str_w;
 	int y = h - ( font->chars[ 0 ].h * 2 );
+	// The other overlays' text was queued first, so it needs to go down before the backdrop
+	Font_Flush();
 	plDrawFilledRectangle( plCreateRectangle(
 		PLVector2( x, y ),
 		PLVector2( str_w, font->chars[ 0 ].h ),
@@ -396,6 +408,37 @@ static void DrawCameraInfoOverlay() {
 	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, cam_pos );
 }
 
+static void DrawStatsOverlay() {
+	if ( !cv_display_show_drawstats->b_value ) {
+		return;
+	}
+
+	Font_DrawBitmapString( g_fonts[ FONT_CHARS2 ], 20, 90, 2, 1.f, PL_COLOUR_WHITE, "DRAW STATS" );
+	int y = 116;
+	char stat[64];
+	snprintf( stat, sizeof( stat ), "CHUNKS DRAWN : %d", g_state.gfx.num_chunks_drawn );
+	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y, 0, 1.f, PL_COLOUR_WHITE, stat );
+	snprintf( stat, sizeof( stat ), "ACTORS DRAWN : %d", g_state.gfx.num_actors_drawn );
+	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, stat );
+	snprintf( stat, sizeof( stat ), "DRAWS BATCHED : %d", g_state.gfx.num_draw_calls_saved );
+	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, stat );
+	snprintf( stat, sizeof( stat ), "SPRITE DRAWS : %d", g_state.gfx.num_sprite_draws );
+	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, stat );
+	snprintf( stat, sizeof( stat ), "PARTICLES : %u", GetNumActiveParticles() );
+	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, stat );
+	snprintf( stat, sizeof( stat ), "STATE CHANGES : %d (%d AVOIDED)",
+			  g_state.gfx.num_state_changes, g_state.gfx.num_state_changes_avoided );
+	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, stat );
+
+	const PhysicsStats& physics = Engine::Physics()->GetStats();
+	snprintf( stat, sizeof( stat ), "BODIES : %u ACTIVE, %u SLEEPING (%u POOLED)",
+			  physics.num_active_bodies, physics.num_sleeping_bodies, physics.num_pooled_bodies );
+	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, stat );
+	snprintf( stat, sizeof( stat ), "PHYSICS : %.2fMS, %u ALLOCS, %u SHAPES",
+			  physics.solver_time, physics.num_allocations, physics.num_shapes );
+	Font_DrawBitmapString( g_fonts[ FONT_SMALL ], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, stat );
+}
+
 static void DrawDebugOverlay() {
 	if ( cv_debug_mode->i_value <= 0 ) {
 		return;
@@ -411,15 +454,7 @@ static void DrawDebugOverlay() {
 	DrawDisplayInfo();
 	DrawCameraInfoOverlay();
 
-#if 0
-	Font_DrawBitmapString(g_fonts[FONT_CHARS2], 20, 24, 2, 1.f, PL_COLOUR_WHITE, "DRAW STATS");
-	unsigned int y = 50;
-	char cam_pos[32];
-	snprintf(cam_pos, sizeof(cam_pos), "CHUNKS DRAWN : %d", g_state.gfx.num_chunks_drawn);
-	Font_DrawBitmapString(g_fonts[FONT_SMALL], 20, y, 0, 1.f, PL_COLOUR_WHITE, cam_pos);
-	snprintf(cam_pos, sizeof(cam_pos), "ACTORS DRAWN : %d", g_state.gfx.num_actors_drawn);
-	Font_DrawBitmapString(g_fonts[FONT_SMALL], 20, y += 15, 0, 1.f, PL_COLOUR_WHITE, cam_pos);
-#endif
+	DrawStatsOverlay();
 
 	if ( cv_debug_input->i_value > 0 ) {
 		switch ( cv_debug_input->i_value ) {
@@ -523,16 +558,55 @@ void DrawMap() {
 	map->Draw();
 }
 
+/**
+ * Program everything falls back on between passes; resolved once, as
+ * the handle stays valid across shader rebuilds.
+ */
+static ShaderHandle GetDefaultProgram() {
+	static ShaderHandle handle = Shaders_GetHandle( "generic_textured" );
+	return handle;
+}
+
 void Display_DrawScene() {
+	PROFILE_SCOPE( "Draw Scene" );
+
 	if ( cv_graphics_alpha_to_coverage->b_value ) {
 		plEnableGraphicsState( PL_GFX_STATE_ALPHATOCOVERAGE );
 	}
 
-	Shaders_SetProgramByName( "generic_textured" );
+	Camera* camera = Engine::Game()->GetCamera();
+
+	RenderQueue* render_queue = Display_GetRenderQueue();
+	render_queue->SetViewOrigin( camera->GetPosition() );
+
+	SpriteBatcher* sprite_batcher = Display_GetSpriteBatcher();
+	sprite_batcher->SetView( camera->GetForward() );
 
 	DrawMap();
 	ActorManager::GetInstance()->DrawActors();
-	//DrawParticles(cur_delta);
+
+	// Actors only submit their models, so group them by model before handing them over
+	ModelRenderQueue* model_queue = Display_GetModelQueue();
+	model_queue->Build();
+	model_queue->Flush( render_queue, RENDER_LAYER_ACTORS, Shaders_GetProgram( GetDefaultProgram() ) );
+	g_state.gfx.num_draw_calls_saved = model_queue->GetNumDrawCallsSaved();
+	model_queue->Clear();
+
+	render_queue->Sort();
+	render_queue->Draw();
+	g_state.gfx.num_state_changes = render_queue->GetNumStateChanges();
+	g_state.gfx.num_state_changes_avoided = render_queue->GetNumStateChangesAvoided();
+	render_queue->Clear();
+
+	// Sprites go last, as they're usually blended
+	DrawParticles( 0 );
+	sprite_batcher->Build();
+	sprite_batcher->Draw();
+	g_state.gfx.num_sprite_draws = sprite_batcher->GetNumDraws();
+	sprite_batcher->Clear();
+
+	// Anything drawn immediately below expects the default program
+	Shaders_SetProgram( GetDefaultProgram() );
 
 	/* debug methods */
 	Engine::Audio()->DrawSources();
@@ -543,15 +617,17 @@ void Display_DrawScene() {
 }
 
 void Display_DrawInterface() {
-	Shaders_SetProgramByName( "generic_textured" );
+	Shaders_SetProgram( GetDefaultProgram() );
 
 	plSetupCamera( g_state.ui_camera );
 	plSetDepthBufferMode( PL_DEPTHBUFFER_DISABLE );
 	FE_Draw();
+
+	Font_Flush();
 }
 
 void Display_DrawDebug() {
-	Shaders_SetProgramByName( "generic_textured" );
+	Shaders_SetProgram( GetDefaultProgram() );
 
 	plSetupCamera( g_state.ui_camera );
 
@@ -559,12 +635,17 @@ void Display_DrawDebug() {
 	DrawFPSOverlay();
 
 	Console_Draw();
+
+	Font_Flush();
 }
 
 void Display_Draw( double delta ) {
+	PROFILE_SCOPE( "Draw" );
+
 	ImGuiImpl_SetupFrame();
 
 	cur_delta = delta;
+	g_state.sim_interpolation = static_cast<float>(std::max( 0.0, std::min( delta, 1.0 ) ));
 	g_state.draw_ticks = System_GetTicks();
 
 	plSetClearColour( ( PLColour ) { 0, 0, 0, 255 } );
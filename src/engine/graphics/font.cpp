@@ -21,10 +21,58 @@
 
 #include "font.h"
 #include "display.h"
+#include "mesh.h"
 
 BitmapFont* g_fonts[NUM_FONTS];
 
-PLMesh* font_mesh = nullptr;
+static PLMesh* CreateBatchMesh() {
+	PLMesh* mesh = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_DYNAMIC,
+								 FONT_BATCH_MAX_GLYPHS * 2, FONT_BATCH_MAX_GLYPHS * 4 );
+	if ( mesh == nullptr ) {
+		Error( "failed to create font mesh, %s, aborting!\n", plGetError() );
+	}
+
+	// Quad layout never changes, so the indices only need setting up once
+	unsigned int cur_index = 0;
+	for ( unsigned int i = 0, vert = 0; i < FONT_BATCH_MAX_GLYPHS; ++i, vert += 4 ) {
+		plSetMeshTrianglePosition( mesh, &cur_index, vert, vert + 1, vert + 2 );
+		plSetMeshTrianglePosition( mesh, &cur_index, vert + 2, vert + 1, vert + 3 );
+	}
+
+	return mesh;
+}
+
+static void FlushFont( BitmapFont* font ) {
+	if ( font->num_batched == 0 ) {
+		return;
+	}
+
+	plSetBlendMode( PL_BLEND_ADDITIVE );
+
+	plSetTexture( font->texture, 0 );
+	plSetNamedShaderUniformMatrix4( NULL, "pl_model", plMatrix4Identity(), false );
+	// Only what's been written this time round, rather than the whole buffer
+	Mesh_DrawRange( font->batch_mesh, font->num_batched * 2, font->num_batched * 4 );
+
+	plSetBlendMode( PL_BLEND_DEFAULT );
+
+	font->num_batched = 0;
+}
+
+/**
+ * Draws all of the text queued up so far, one draw per font. Text is
+ * only drawn once flushed, so this needs calling before drawing anything
+ * else that the text is meant to go under, or over.
+ */
+void Font_Flush( void ) {
+	for ( auto& font : g_fonts ) {
+		if ( font == nullptr ) {
+			continue;
+		}
+
+		FlushFont( font );
+	}
+}
 
 void Font_DrawBitmapCharacter( BitmapFont* font, int x, int y, float scale, PLColour colour, uint8_t character ) {
 	if ( font == nullptr || scale == 0 ) {
@@ -47,36 +95,37 @@ void Font_DrawBitmapCharacter( BitmapFont* font, int x, int y, float scale, PLCo
 		Error( "attempted to draw bitmap font with invalid texture, aborting!\n" );
 	}
 
-	if ( font_mesh == nullptr ) {
+	if ( font->batch_mesh == nullptr ) {
 		Error( "attempted to draw font before font init, aborting!\n" );
 	}
 
-	plSetTexture( font->texture, 0 );
+	if ( font->num_batched >= FONT_BATCH_MAX_GLYPHS ) {
+		FlushFont( font );
+	}
 
-	plClearMesh( font_mesh );
+	const BitmapChar* bitmap_char = &font->chars[ character ];
+	float w = bitmap_char->w * scale;
+	float h = bitmap_char->h * scale;
+	float tw = ( float ) bitmap_char->w / font->width;
+	float th = ( float ) bitmap_char->h / font->height;
 
-	plSetMeshUniformColour( font_mesh, colour );
+	PLMesh* mesh = font->batch_mesh;
+	unsigned int vert = font->num_batched * 4;
+	plSetMeshVertexPosition( mesh, vert, PLVector3( x, y, 0 ) );
+	plSetMeshVertexPosition( mesh, vert + 1, PLVector3( x, y + h, 0 ) );
+	plSetMeshVertexPosition( mesh, vert + 2, PLVector3( x + w, y, 0 ) );
+	plSetMeshVertexPosition( mesh, vert + 3, PLVector3( x + w, y + h, 0 ) );
 
-	BitmapChar* bitmap_char = &font->chars[ character ];
-	plSetMeshVertexPosition( font_mesh, 0, PLVector3( x, y, 0 ) );
-	plSetMeshVertexPosition( font_mesh, 1, PLVector3( x, y + ( bitmap_char->h * scale ), 0 ) );
-	plSetMeshVertexPosition( font_mesh, 2, PLVector3( x + ( bitmap_char->w * scale ), y, 0 ) );
-	plSetMeshVertexPosition( font_mesh,
-							 3,
-							 PLVector3( x + ( bitmap_char->w * scale ), y + ( bitmap_char->h * scale ), 0 ) );
+	plSetMeshVertexST( mesh, vert, bitmap_char->s, bitmap_char->t );
+	plSetMeshVertexST( mesh, vert + 1, bitmap_char->s, bitmap_char->t + th );
+	plSetMeshVertexST( mesh, vert + 2, bitmap_char->s + tw, bitmap_char->t );
+	plSetMeshVertexST( mesh, vert + 3, bitmap_char->s + tw, bitmap_char->t + th );
 
-	float tw = ( float ) bitmap_char->w / font->width;
-	float th = ( float ) bitmap_char->h / font->height;
-	float tx = ( float ) bitmap_char->x / font->width;
-	float ty = ( float ) bitmap_char->y / font->height;
-	plSetMeshVertexST( font_mesh, 0, tx, ty );
-	plSetMeshVertexST( font_mesh, 1, tx, ty + th );
-	plSetMeshVertexST( font_mesh, 2, tx + tw, ty );
-	plSetMeshVertexST( font_mesh, 3, tx + tw, ty + th );
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		plSetMeshVertexColour( mesh, vert + i, colour );
+	}
 
-	plSetNamedShaderUniformMatrix4( NULL, "pl_model", plMatrix4Identity(), false );
-	plUploadMesh( font_mesh );
-	plDrawMesh( font_mesh );
+	font->num_batched++;
 }
 
 void Font_DrawBitmapString( BitmapFont* font, int x, int y, unsigned int spacing, float scale, PLColour colour,
@@ -89,8 +138,7 @@ void Font_DrawBitmapString( BitmapFont* font, int x, int y, unsigned int spacing
 		return;
 	}
 
-	auto num_chars = strlen( msg );
-	if ( num_chars == 0 ) {
+	if ( msg == nullptr || msg[ 0 ] == '\0' ) {
 		return;
 	}
 
@@ -98,23 +146,44 @@ void Font_DrawBitmapString( BitmapFont* font, int x, int y, unsigned int spacing
 		Error( "attempted to draw bitmap font with invalid texture, aborting!\n" );
 	}
 
-	plSetBlendMode( PL_BLEND_ADDITIVE );
-
 	int n_x = x;
 	int n_y = y;
-	for ( size_t i = 0; i < num_chars; ++i ) {
-		Font_DrawBitmapCharacter( font, n_x, n_y, scale, colour, ( uint8_t ) msg[ i ] );
-		if ( msg[ i ] >= 33 && msg[ i ] <= 122 ) {
-			n_x += font->chars[ msg[ i ] - 33 ].w + spacing;
-		} else if ( msg[ i ] == '\n' ) {
+	for ( const char* c = msg; *c != '\0'; ++c ) {
+		auto character = ( uint8_t ) *c;
+		if ( character == '\n' ) {
 			n_y += font->chars[ 0 ].h;
 			n_x = x;
-		} else {
-			n_x += 5;
+			continue;
 		}
+
+		Font_DrawBitmapCharacter( font, n_x, n_y, scale, colour, character );
+		n_x += font->advance[ character ] + ( character >= 33 && character <= 122 ? spacing : 0 );
 	}
+}
 
-	plSetBlendMode( PL_BLEND_DEFAULT );
+/**
+ * Returns the width of the widest line in the given string, in pixels.
+ */
+int Font_GetStringWidth( BitmapFont* font, unsigned int spacing, const char* msg ) {
+	if ( font == nullptr || msg == nullptr ) {
+		return 0;
+	}
+
+	int width = 0, line_width = 0;
+	for ( const char* c = msg; *c != '\0'; ++c ) {
+		auto character = ( uint8_t ) *c;
+		if ( character == '\n' ) {
+			line_width = 0;
+			continue;
+		}
+
+		line_width += font->advance[ character ] + ( character >= 33 && character <= 122 ? spacing : 0 );
+		if ( line_width > width ) {
+			width = line_width;
+		}
+	}
+
+	return width;
 }
 
 BitmapFont* LoadBitmapFont( const char* name, const char* tab_name ) {
@@ -165,6 +234,8 @@ BitmapFont* LoadBitmapFont( const char* name, const char* tab_name ) {
 		font->chars[ i ].h = tab_indices[ i ].h;
 		font->chars[ i ].x = tab_indices[ i ].x - origin_x;
 		font->chars[ i ].y = tab_indices[ i ].y - origin_y;
+		font->chars[ i ].s = ( float ) font->chars[ i ].x / font->width;
+		font->chars[ i ].t = ( float ) font->chars[ i ].y / font->height;
 #if 0 // debug
 		print(
 				"font char %d: w(%d) h(%d) x(%d) y(%d)\n",
@@ -177,6 +248,17 @@ BitmapFont* LoadBitmapFont( const char* name, const char* tab_name ) {
 #endif
 	}
 
+	// cache the advance for each character, so strings don't need to work it out per glyph
+	for ( unsigned int i = 0; i < 256; ++i ) {
+		if ( i >= 33 && i <= 122 && ( i - 33 ) < font->num_chars ) {
+			font->advance[ i ] = font->chars[ i - 33 ].w;
+		} else {
+			font->advance[ i ] = 5;
+		}
+	}
+
+	font->batch_mesh = CreateBatchMesh();
+
 	// upload the texture to the GPU
 
 	font->texture = plCreateTexture();
@@ -192,14 +274,15 @@ BitmapFont* LoadBitmapFont( const char* name, const char* tab_name ) {
 	return font;
 }
 
+void DestroyBitmapFont( BitmapFont* font ) {
+	plDestroyMesh( font->batch_mesh );
+	plDestroyTexture( font->texture );
+	free( font );
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 void CacheFontData() {
-	font_mesh = plCreateMesh( PL_MESH_TRIANGLE_STRIP, PL_DRAW_DYNAMIC, 2, 4 );
-	if ( font_mesh == nullptr ) {
-		Error( "failed to create font mesh, %s, aborting!\n", plGetError() );
-	}
-
 	g_fonts[ FONT_BIG ] = LoadBitmapFont( "big", "big" );
 	g_fonts[ FONT_BIG_CHARS ] = LoadBitmapFont( "bigchars", "bigchars" );
 	g_fonts[ FONT_CHARS2 ] = LoadBitmapFont( "chars2l", "chars2" );
@@ -218,7 +301,6 @@ void ClearFontData() {
 			break;
 		}
 
-		plDestroyTexture( g_font->texture );
-		free( g_font );
+		DestroyBitmapFont( g_font );
 	}
 }
\ No newline at end of file
@@ -38,8 +38,15 @@ typedef struct BitmapFont {
     unsigned int height;
 
     PLTexture *texture;
+
+    int advance[256];           // cached horizontal advance per character, minus spacing
+
+    PLMesh *batch_mesh;         // glyph quads queued up for this frame
+    unsigned int num_batched;
 } BitmapFont;
 
+#define FONT_BATCH_MAX_GLYPHS   2048
+
 enum {
     FONT_BIG,
     FONT_BIG_CHARS,
@@ -67,6 +74,12 @@ extern BitmapFont *g_fonts[NUM_FONTS];
 void CacheFontData();
 void ClearFontData();
 
+BitmapFont *LoadBitmapFont(const char *name, const char *tab_name);
+void DestroyBitmapFont(BitmapFont *font);
+
 void Font_DrawBitmapCharacter(BitmapFont *font, int x, int y, float scale, PLColour colour, uint8_t character);
 void Font_DrawBitmapString(BitmapFont *font, int x, int y, unsigned int spacing, float scale, PLColour colour,
                            const char *msg);
+
+int Font_GetStringWidth(BitmapFont *font, unsigned int spacing, const char *msg);
+void Font_Flush(void);
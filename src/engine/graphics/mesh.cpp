@@ -15,26 +15,31 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <list>
-#include <map>
-#include <set>
 
 #include <PL/platform_mesh.h>
 #include <PL/pl_math_vector.h>
 
+#include "../frame_arena.h"
+
 void Mesh_GenerateFragmentedMeshNormals(const std::list<PLMesh*>& meshes) {
+    // Everything below is thrown away once we're done, so keep it off the heap
+    LinearArena *arena = Arena_GetFrame();
+    ArenaScope arena_scope(arena);
+
     struct Position {
         PLVector3 sum_normals;
-        std::set<PLVertex*> vertices;
+        ArenaSet<PLVertex*> vertices;
         unsigned int num_faces;
 
-        Position(const PLVector3 &normal, PLVertex *output):
-            sum_normals(normal), num_faces(1) {
+        Position(const PLVector3 &normal, PLVertex *output, LinearArena *arena):
+            sum_normals(normal), vertices(std::less<PLVertex*>(), arena), num_faces(1) {
           vertices.insert(output);
         }
     };
 
-    std::map<PLVector3, Position> positions;
+    ArenaMap<PLVector3, Position> positions(std::less<PLVector3>(), arena);
 
     for (auto & mesh : meshes) {
       for (unsigned int i = 0, idx = 0; i < mesh->num_triangles; ++i, idx += 3) {
@@ -59,7 +64,7 @@ void Mesh_GenerateFragmentedMeshNormals(const std::list<PLMesh*>& meshes) {
             ni->second.vertices.insert(vertex);
             ++(ni->second.num_faces);
           } else {
-            positions.insert(std::make_pair(vertex->position, Position(normal, vertex)));
+            positions.insert(std::make_pair(vertex->position, Position(normal, vertex, arena)));
           }
         }
       }
@@ -73,3 +78,21 @@ void Mesh_GenerateFragmentedMeshNormals(const std::list<PLMesh*>& meshes) {
         }
     }
 }
+
+/**
+ * Uploads and draws only the first part of a mesh, for dynamic meshes
+ * that are filled up from the start and rarely used in full.
+ *
+ * The range is drawn through a shallow copy of the mesh, which shares its
+ * vertex/index data and buffer handles (created up front by plCreateMesh),
+ * so the counts on the shared mesh are never touched.
+ */
+void Mesh_DrawRange(const PLMesh* mesh, unsigned int num_triangles, unsigned int num_verts) {
+    PLMesh range = *mesh;
+    range.num_triangles = std::min(num_triangles, mesh->num_triangles);
+    range.num_indices = std::min(num_triangles * 3, mesh->num_indices);
+    range.num_verts = std::min(num_verts, mesh->num_verts);
+
+    plUploadMesh(&range);
+    plDrawMesh(&range);
+}
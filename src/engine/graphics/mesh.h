@@ -21,3 +21,4 @@
 #include <PL/platform_mesh.h>
 
 void Mesh_GenerateFragmentedMeshNormals(const std::list<PLMesh*>& meshes);
+void Mesh_DrawRange(const PLMesh* mesh, unsigned int num_triangles, unsigned int num_verts);
@@ -0,0 +1,105 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+
+#include "model_queue.h"
+#include "render_queue.h"
+
+ModelRenderQueue::ModelRenderQueue() {
+	// Enough for every pig in a full match plus a little scenery
+	submissions_.reserve( 64 );
+	instances_.reserve( 64 );
+	batches_.reserve( 16 );
+}
+
+ModelRenderQueue::~ModelRenderQueue() = default;
+
+void ModelRenderQueue::Submit( PLModel* model,
+							   const PLMatrix4& transform,
+							   const PLVector3& origin,
+							   const PLColour& tint ) {
+	u_assert( model != nullptr, "Attempted to submit a null model to the render queue!\n" );
+
+	Submission submission;
+	submission.model = model;
+	submission.order = static_cast<unsigned int>(submissions_.size());
+	submission.instance.transform = transform;
+	submission.instance.origin = origin;
+	submission.instance.tint = tint;
+	submissions_.push_back( submission );
+}
+
+/**
+ * Groups the submissions for this frame into per-model batches,
+ * with the instance data for each batch laid out contiguously.
+ */
+void ModelRenderQueue::Build() {
+	batches_.clear();
+	instances_.clear();
+	num_draw_calls_saved_ = 0;
+
+	if ( submissions_.empty() ) {
+		return;
+	}
+
+	std::sort( submissions_.begin(), submissions_.end(), []( const Submission& a, const Submission& b ) {
+		if ( a.model != b.model ) {
+			return a.model < b.model;
+		}
+		return a.order < b.order;
+	} );
+
+	for ( const auto& submission : submissions_ ) {
+		if ( batches_.empty() || batches_.back().model != submission.model ) {
+			batches_.push_back( { submission.model, static_cast<unsigned int>(instances_.size()), 0 } );
+		} else {
+			// Folded into the batch for this model
+			num_draw_calls_saved_++;
+		}
+
+		instances_.push_back( submission.instance );
+		batches_.back().num_instances++;
+	}
+}
+
+/**
+ * Hands the batches over to the given render queue, which takes
+ * care of ordering them against everything else in the scene.
+ */
+void ModelRenderQueue::Flush( RenderQueue* queue, unsigned int layer, ShaderProgram* program ) {
+	for ( const auto& batch : batches_ ) {
+		for ( unsigned int i = 0; i < batch.num_instances; ++i ) {
+			const Instance& instance = instances_[ batch.first_instance + i ];
+			queue->Submit( layer, program, batch.model, instance.transform, instance.origin, false, instance.tint );
+		}
+	}
+}
+
+void ModelRenderQueue::Clear() {
+	submissions_.clear();
+}
+
+/**
+ * Queue used for drawing actor models in the scene.
+ */
+ModelRenderQueue* Display_GetModelQueue() {
+	static ModelRenderQueue scene_queue;
+	return &scene_queue;
+}
@@ -0,0 +1,76 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+class RenderQueue;
+class ShaderProgram;
+
+/**
+ * Collects model submissions over a frame so that identical models
+ * can be drawn back-to-back as a single batch, rather than in
+ * whatever order the actors happen to be stored in.
+ */
+class ModelRenderQueue {
+public:
+	struct Instance {
+		PLMatrix4 transform;
+		PLVector3 origin;
+		PLColour tint;
+	};
+
+	struct Batch {
+		PLModel* model;
+		unsigned int first_instance;  // Offset into the instance buffer
+		unsigned int num_instances;
+	};
+
+	ModelRenderQueue();
+	~ModelRenderQueue();
+
+	void Submit( PLModel* model,
+				 const PLMatrix4& transform,
+				 const PLVector3& origin,
+				 const PLColour& tint = { 255, 255, 255, 255 } );
+
+	// Sorts submissions into per-model batches; doesn't touch the GPU
+	void Build();
+	void Flush( RenderQueue* queue, unsigned int layer, ShaderProgram* program );
+	void Clear();
+
+	const std::vector<Batch>& GetBatches() const { return batches_; }
+	const std::vector<Instance>& GetInstances() const { return instances_; }
+
+	unsigned int GetNumSubmitted() const { return static_cast<unsigned int>(submissions_.size()); }
+	unsigned int GetNumDrawCallsSaved() const { return num_draw_calls_saved_; }
+
+private:
+	struct Submission {
+		PLModel* model;
+		unsigned int order;  // Keeps the sort stable for identical models
+		Instance instance;
+	};
+
+	std::vector<Submission> submissions_;
+
+	std::vector<Batch> batches_;
+	std::vector<Instance> instances_;
+
+	unsigned int num_draw_calls_saved_{ 0 };
+};
+
+ModelRenderQueue* Display_GetModelQueue();
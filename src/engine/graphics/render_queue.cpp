@@ -0,0 +1,236 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+
+#include "../engine.h"
+#include "../terrain.h"
+
+#include "shaders.h"
+#include "render_queue.h"
+
+RenderQueue::RenderQueue() {
+	commands_.reserve( 512 );
+	sorted_.reserve( 512 );
+	scratch_.reserve( 512 );
+}
+
+RenderQueue::~RenderQueue() = default;
+
+uint64_t RenderQueue::BuildSortKey( unsigned int layer,
+									bool translucent,
+									unsigned int shader,
+									unsigned int texture,
+									float depth ) {
+	const uint64_t depth_max = ( 1ULL << RENDER_KEY_DEPTH_BITS ) - 1;
+	const uint64_t shader_max = ( 1ULL << RENDER_KEY_SHADER_BITS ) - 1;
+	const uint64_t texture_max = ( 1ULL << RENDER_KEY_TEXTURE_BITS ) - 1;
+
+	if ( depth < 0 ) {
+		depth = 0;
+	} else if ( depth > RENDER_KEY_MAX_DEPTH ) {
+		depth = RENDER_KEY_MAX_DEPTH;
+	}
+
+	uint64_t q_depth = static_cast<uint64_t>(( depth / RENDER_KEY_MAX_DEPTH ) * depth_max);
+	uint64_t q_shader = shader > shader_max ? shader_max : shader;
+	uint64_t q_texture = texture > texture_max ? texture_max : texture;
+
+	uint64_t key = static_cast<uint64_t>(layer & 0xF) << 60;
+	if ( translucent ) {
+		key |= 1ULL << 59;
+		key |= ( depth_max - q_depth ) << ( RENDER_KEY_SHADER_BITS + RENDER_KEY_TEXTURE_BITS );
+		key |= q_shader << RENDER_KEY_TEXTURE_BITS;
+		key |= q_texture;
+	} else {
+		key |= q_shader << ( RENDER_KEY_TEXTURE_BITS + RENDER_KEY_DEPTH_BITS );
+		key |= q_texture << RENDER_KEY_DEPTH_BITS;
+		key |= q_depth;
+	}
+
+	return key;
+}
+
+unsigned int RenderQueue::GetShaderIndex( ShaderProgram* program ) {
+	auto i = shader_indices_.find( program );
+	if ( i != shader_indices_.end() ) {
+		return i->second;
+	}
+
+	unsigned int index = static_cast<unsigned int>(shader_indices_.size());
+	shader_indices_.insert( std::make_pair( program, index ) );
+	return index;
+}
+
+static PLTexture* GetModelTexture( PLModel* model ) {
+	PLModelLod* lod = plGetModelLodLevel( model, 0 );
+	if ( lod == nullptr || lod->num_meshes == 0 ) {
+		return nullptr;
+	}
+
+	return lod->meshes[ 0 ]->texture;
+}
+
+unsigned int RenderQueue::GetTextureIndex( PLModel* model ) {
+	PLTexture* texture = GetModelTexture( model );
+	auto i = texture_indices_.find( texture );
+	if ( i != texture_indices_.end() ) {
+		return i->second;
+	}
+
+	unsigned int index = static_cast<unsigned int>(texture_indices_.size());
+	texture_indices_.insert( std::make_pair( texture, index ) );
+	return index;
+}
+
+void RenderQueue::Submit( unsigned int layer,
+						  ShaderProgram* program,
+						  PLModel* model,
+						  const PLMatrix4& transform,
+						  const PLVector3& origin,
+						  bool translucent,
+						  const PLColour& tint ) {
+	u_assert( layer < MAX_RENDER_LAYERS, "Invalid render layer, %d!\n", layer );
+	if ( program == nullptr || model == nullptr ) {
+		return;
+	}
+
+	float dx = origin.x - view_origin_.x;
+	float dy = origin.y - view_origin_.y;
+	float dz = origin.z - view_origin_.z;
+	float depth = std::sqrt( dx * dx + dy * dy + dz * dz );
+
+	if ( commands_.empty() || program != commands_.back().program ) {
+		num_submitted_changes_++;
+	}
+
+	SortEntry entry;
+	entry.key = BuildSortKey( layer, translucent, GetShaderIndex( program ), GetTextureIndex( model ), depth );
+	entry.index = static_cast<unsigned int>(commands_.size());
+	sorted_.push_back( entry );
+
+	commands_.push_back( { program, model, transform, tint } );
+}
+
+/**
+ * LSD radix sort over the 64-bit keys, eight bits at a time.
+ * Passes where every key shares the same byte are skipped, which
+ * is most of them given how sparse the keys tend to be.
+ */
+void RenderQueue::RadixSort( std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch ) {
+	size_t num_entries = entries.size();
+	if ( num_entries < 2 ) {
+		return;
+	}
+
+	scratch.resize( num_entries );
+
+	SortEntry* src = entries.data();
+	SortEntry* dst = scratch.data();
+	for ( unsigned int shift = 0; shift < 64; shift += 8 ) {
+		size_t counts[256] = {};
+		for ( size_t i = 0; i < num_entries; ++i ) {
+			counts[ ( src[ i ].key >> shift ) & 0xFF ]++;
+		}
+
+		if ( counts[ ( src[ 0 ].key >> shift ) & 0xFF ] == num_entries ) {
+			continue;
+		}
+
+		size_t offset = 0;
+		for ( size_t& count : counts ) {
+			size_t c = count;
+			count = offset;
+			offset += c;
+		}
+
+		for ( size_t i = 0; i < num_entries; ++i ) {
+			dst[ counts[ ( src[ i ].key >> shift ) & 0xFF ]++ ] = src[ i ];
+		}
+
+		std::swap( src, dst );
+	}
+
+	if ( src != entries.data() ) {
+		memcpy( entries.data(), src, sizeof( SortEntry ) * num_entries );
+	}
+}
+
+void RenderQueue::Sort() {
+	RadixSort( sorted_, scratch_ );
+}
+
+static bool CompareColour( const PLColour& a, const PLColour& b ) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static void SetModelTint( PLModel* model, const PLColour& tint ) {
+	PLModelLod* lod = plGetModelLodLevel( model, 0 );
+	if ( lod == nullptr ) {
+		return;
+	}
+
+	for ( unsigned int i = 0; i < lod->num_meshes; ++i ) {
+		plSetMeshUniformColour( lod->meshes[ i ], tint );
+	}
+}
+
+void RenderQueue::Draw() {
+	static const PLColour default_tint = { 255, 255, 255, 255 };
+
+	ShaderProgram* current_program = nullptr;
+	num_state_changes_ = 0;
+	for ( const auto& entry : sorted_ ) {
+		Command& command = commands_[ entry.index ];
+		if ( command.program != current_program ) {
+			command.program->Enable();
+			current_program = command.program;
+			num_state_changes_++;
+		}
+
+		bool tinted = !CompareColour( command.tint, default_tint );
+		if ( tinted ) {
+			SetModelTint( command.model, command.tint );
+		}
+
+		command.model->model_matrix = command.transform;
+		plDrawModel( command.model );
+
+		if ( tinted ) {
+			SetModelTint( command.model, default_tint );
+		}
+	}
+
+	num_state_changes_avoided_ = num_submitted_changes_ > num_state_changes_ ? num_submitted_changes_ - num_state_changes_ : 0;
+}
+
+void RenderQueue::Clear() {
+	commands_.clear();
+	sorted_.clear();
+	num_submitted_changes_ = 0;
+
+	shader_indices_.clear();
+	texture_indices_.clear();
+}
+
+/**
+ * Queue used for drawing the world and everything in it.
+ */
+RenderQueue* Display_GetRenderQueue() {
+	static RenderQueue scene_queue;
+	return &scene_queue;
+}
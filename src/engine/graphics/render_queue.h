@@ -0,0 +1,112 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+class ShaderProgram;
+
+enum RenderLayer {
+	RENDER_LAYER_SKY,
+	RENDER_LAYER_WORLD,
+	RENDER_LAYER_ACTORS,
+	RENDER_LAYER_EFFECTS,
+
+	MAX_RENDER_LAYERS = 16
+};
+
+/* Sort key layout, most significant bits first
+ *
+ *  opaque:       layer (4) | 0 | shader (11) | texture (16) | depth (24)
+ *  translucent:  layer (4) | 1 | inverted depth (24) | shader (11) | texture (16)
+ *
+ * Opaque geometry is grouped by state and then drawn front-to-back,
+ * translucent geometry is always drawn back-to-front.
+ */
+#define RENDER_KEY_DEPTH_BITS     24
+#define RENDER_KEY_SHADER_BITS    11
+#define RENDER_KEY_TEXTURE_BITS   16
+
+#define RENDER_KEY_MAX_DEPTH      ( TERRAIN_PIXEL_WIDTH * 2 )
+
+class RenderQueue {
+public:
+	struct Command {
+		ShaderProgram* program;
+		PLModel* model;
+		PLMatrix4 transform;
+		PLColour tint;
+	};
+
+	RenderQueue();
+	~RenderQueue();
+
+	static uint64_t BuildSortKey( unsigned int layer,
+								  bool translucent,
+								  unsigned int shader,
+								  unsigned int texture,
+								  float depth );
+
+	void SetViewOrigin( const PLVector3& origin ) { view_origin_ = origin; }
+
+	void Submit( unsigned int layer,
+				 ShaderProgram* program,
+				 PLModel* model,
+				 const PLMatrix4& transform,
+				 const PLVector3& origin,
+				 bool translucent = false,
+				 const PLColour& tint = { 255, 255, 255, 255 } );
+
+	// Sorts the submitted commands by key; doesn't touch the GPU
+	void Sort();
+	void Draw();
+	void Clear();
+
+	unsigned int GetNumCommands() const { return static_cast<unsigned int>(commands_.size()); }
+	const Command& GetSortedCommand( unsigned int i ) const { return commands_[ sorted_[ i ].index ]; }
+	uint64_t GetSortedKey( unsigned int i ) const { return sorted_[ i ].key; }
+
+	// Program switches made by the last draw, and those saved over drawing in the order submitted
+	unsigned int GetNumStateChanges() const { return num_state_changes_; }
+	unsigned int GetNumStateChangesAvoided() const { return num_state_changes_avoided_; }
+
+private:
+	struct SortEntry {
+		uint64_t key;
+		unsigned int index;
+	};
+
+	unsigned int GetShaderIndex( ShaderProgram* program );
+	unsigned int GetTextureIndex( PLModel* model );
+
+	static void RadixSort( std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch );
+
+	std::vector<Command> commands_;
+	std::vector<SortEntry> sorted_;
+	std::vector<SortEntry> scratch_;
+
+	// Per-frame state ids, assigned in order of first use
+	std::map<ShaderProgram*, unsigned int> shader_indices_;
+	std::map<PLTexture*, unsigned int> texture_indices_;
+
+	PLVector3 view_origin_;
+
+	unsigned int num_submitted_changes_{ 0 };
+	unsigned int num_state_changes_{ 0 };
+	unsigned int num_state_changes_avoided_{ 0 };
+};
+
+RenderQueue* Display_GetRenderQueue();
@@ -19,11 +19,85 @@
 #include "../script/script_config.h"
 #include "shaders.h"
 
-static std::map<std::string, ShaderProgram*> programs;
+// Handles index into this, and stay the same for the lifetime of the
+// application so that they survive the cache being rebuilt
+static std::vector<ShaderProgram*> programs;
+static std::map<std::string, ShaderHandle> programHandles;
 static ShaderProgram* fallbackShaderProgram = nullptr;
 
 // For resetting following rebuild
-static std::string lastProgramName;
+static ShaderHandle lastProgram = SHADER_INVALID_HANDLE;
+
+/************************************************************/
+/* Backend */
+
+static PLShaderProgram* Platform_CreateProgram() {
+	return plCreateShaderProgram();
+}
+
+static void Platform_DestroyProgram( PLShaderProgram* program ) {
+	plDestroyShaderProgram( program, true );
+}
+
+static bool Platform_RegisterStage( PLShaderProgram* program, const char* path, PLShaderType type ) {
+	return plRegisterShaderStageFromDisk( program, path, type );
+}
+
+static void Platform_LinkProgram( PLShaderProgram* program ) {
+	plLinkShaderProgram( program );
+}
+
+static void Platform_SetProgram( PLShaderProgram* program ) {
+	plSetShaderProgram( program );
+}
+
+static int Platform_GetUniformSlot( PLShaderProgram* program, const char* name ) {
+	return plGetShaderUniformSlot( program, name );
+}
+
+static void Platform_SetUniformFloat( PLShaderProgram* program, int slot, float value ) {
+	plSetShaderUniformFloat( program, slot, value );
+}
+
+static void Platform_SetUniformVector3( PLShaderProgram* program, int slot, const PLVector3& value ) {
+	plSetShaderUniformVector3( program, slot, value );
+}
+
+static void Platform_SetUniformVector4( PLShaderProgram* program, int slot, const PLVector4& value ) {
+	plSetShaderUniformVector4( program, slot, value );
+}
+
+static void Platform_SetUniformMatrix4( PLShaderProgram* program, int slot, const PLMatrix4& value ) {
+	plSetShaderUniformMatrix4( program, slot, value, false );
+}
+
+static const ShaderBackend platformBackend = {
+	Platform_CreateProgram,
+	Platform_DestroyProgram,
+	Platform_RegisterStage,
+	Platform_LinkProgram,
+	Platform_SetProgram,
+	Platform_GetUniformSlot,
+	Platform_SetUniformFloat,
+	Platform_SetUniformVector3,
+	Platform_SetUniformVector4,
+	Platform_SetUniformMatrix4,
+};
+
+static const ShaderBackend* backend = &platformBackend;
+
+void Shaders_SetBackend( const ShaderBackend* newBackend ) {
+	backend = ( newBackend != nullptr ) ? newBackend : &platformBackend;
+}
+
+/************************************************************/
+
+static struct {
+	unsigned int uniformLookups;    // Uniform slots fetched from the driver
+	unsigned int uniformCacheHits;  // Uniform slots served from the cache
+	unsigned int uniformUploads;
+	unsigned int uniformUploadsSkipped;
+} shaderStats;
 
 /**
  * Validate the default shader set has been loaded.
@@ -74,19 +148,30 @@ static void Shaders_CacheShaderProgram( const char* path ) {
 		}
 
 		ShaderProgram* program = new ShaderProgram( vertPath, fragPath );
-		programs.insert( std::pair<std::string, ShaderProgram*>( shortFileName, program ));
+
+		auto i = programHandles.find( shortFileName );
+		if ( i == programHandles.end() ) {
+			programHandles.insert( std::make_pair( shortFileName, static_cast<ShaderHandle>(programs.size()) ) );
+			programs.push_back( program );
+		} else {
+			delete programs[ i->second ];
+			programs[ i->second ] = program;
+		}
 	} catch ( const std::exception& error ) {
 		LogWarn( "Failed to register shader program (%s)!\n", error.what());
 	}
 }
 
 static void Shaders_ClearPrograms() {
-	for ( const auto& program : programs ) {
-		program.second->Disable();
-		delete program.second;
-	}
+	for ( auto& program : programs ) {
+		if ( program == nullptr ) {
+			continue;
+		}
 
-	programs.clear();
+		program->Disable();
+		delete program;
+		program = nullptr;
+	}
 }
 
 static void Shaders_CachePrograms() {
@@ -102,7 +187,7 @@ static void Cmd_ListShaderPrograms( unsigned int argc, char* argv[] ) {
 	u_unused( argv );
 
 	std::string list = "\n";
-	for ( const auto& program : programs ) {
+	for ( const auto& program : programHandles ) {
 		list += program.first + "\n";
 	}
 
@@ -120,15 +205,20 @@ static void Cmd_RebuildShaderPrograms( unsigned int argc, char* argv[] ) {
 	u_unused( argc );
 	u_unused( argv );
 
-	for ( const auto& program : programs ) {
+	for ( const auto& program : programHandles ) {
+		ShaderProgram* shaderProgram = programs[ program.second ];
+		if ( shaderProgram == nullptr ) {
+			continue;
+		}
+
 		try {
-			program.second->Rebuild();
+			shaderProgram->Rebuild();
 		} catch ( const std::exception& exception ) {
 			LogWarn( "Failed to rebuild shader program, \"%s\" (%s)!\n", program.first.c_str(), exception.what());
 		}
 	}
 
-	Shaders_SetProgramByName( lastProgramName );
+	Shaders_SetProgram( lastProgram );
 }
 
 static void Cmd_RebuildShaderProgram( unsigned int argc, char* argv[] ) {
@@ -158,12 +248,41 @@ static void Cmd_RebuildShaderProgram( unsigned int argc, char* argv[] ) {
 	}
 }
 
+static void Cmd_Shaders( unsigned int argc, char* argv[] ) {
+	u_unused( argc );
+	u_unused( argv );
+
+	std::string list = "\n";
+	for ( const auto& program : programHandles ) {
+		ShaderProgram* shaderProgram = programs[ program.second ];
+		list += std::to_string( program.second ) + " " + program.first;
+		if ( shaderProgram == nullptr ) {
+			list += " (not loaded)\n";
+			continue;
+		}
+
+		list += " (" + std::to_string( shaderProgram->GetNumUniforms() ) + " uniforms)\n";
+	}
+
+	LogInfo( "%s\n"
+			 "uniform lookups:         %u\n"
+			 "uniform cache hits:      %u\n"
+			 "uniform uploads:         %u\n"
+			 "uniform uploads skipped: %u\n",
+			 list.c_str(),
+			 shaderStats.uniformLookups,
+			 shaderStats.uniformCacheHits,
+			 shaderStats.uniformUploads,
+			 shaderStats.uniformUploadsSkipped );
+}
+
 void Shaders_Initialize() {
 	plRegisterConsoleCommand( "listShaderPrograms", Cmd_ListShaderPrograms, "Lists all of the cached shader programs" );
 	plRegisterConsoleCommand( "rebuildShaderPrograms", Cmd_RebuildShaderPrograms, "Rebuild all shader programs" );
 	plRegisterConsoleCommand( "rebuildShaderProgram", Cmd_RebuildShaderProgram, "Rebuild specified shader program" );
 	plRegisterConsoleCommand( "rebuildShaderProgramCache", Cmd_RebuildShaderProgramCache,
 		"Rebuild shader program cache" );
+	plRegisterConsoleCommand( "shaders", Cmd_Shaders, "Lists shader program handles and uniform cache statistics" );
 
 	Shaders_CachePrograms();
 }
@@ -172,27 +291,49 @@ void Shaders_Shutdown() {
 	Shaders_ClearPrograms();
 }
 
-ShaderProgram* Shaders_GetProgram( const std::string& name ) {
-	const auto& i = programs.find( name );
-	if ( i == programs.end()) {
+/**
+ * Resolves the given name to a handle, which stays valid even if the
+ * shader cache is rebuilt.
+ */
+ShaderHandle Shaders_GetHandle( const std::string& name ) {
+	const auto& i = programHandles.find( name );
+	if ( i == programHandles.end()) {
 		LogWarn( "Failed to find shader program, \"%s\"!\n", name.c_str());
-		return nullptr;
+		return SHADER_INVALID_HANDLE;
 	}
 
 	return i->second;
 }
 
-void Shaders_SetProgramByName( const std::string& name ) {
-	ShaderProgram* shaderProgram = Shaders_GetProgram( name );
+ShaderProgram* Shaders_GetProgram( ShaderHandle handle ) {
+	if ( handle >= programs.size() ) {
+		return nullptr;
+	}
+
+	return programs[ handle ];
+}
+
+ShaderProgram* Shaders_GetProgram( const std::string& name ) {
+	return Shaders_GetProgram( Shaders_GetHandle( name ) );
+}
+
+void Shaders_SetProgram( ShaderHandle handle ) {
+	ShaderProgram* shaderProgram = Shaders_GetProgram( handle );
 	if ( shaderProgram == nullptr ) {
 		shaderProgram = fallbackShaderProgram;
+	} else {
+		lastProgram = handle;
 	}
 
 	shaderProgram->Enable();
 }
 
+void Shaders_SetProgramByName( const std::string& name ) {
+	Shaders_SetProgram( Shaders_GetHandle( name ) );
+}
+
 ShaderProgram::ShaderProgram( const std::string& vertPath, const std::string& fragPath ) {
-	shaderProgram = plCreateShaderProgram();
+	shaderProgram = backend->CreateProgram();
 	if ( shaderProgram == nullptr ) {
 		throw std::runtime_error( plGetError());
 	}
@@ -201,23 +342,23 @@ ShaderProgram::ShaderProgram( const std::string& vertPath, const std::string& fr
 		RegisterShaderStage( vertPath.c_str(), PL_SHADER_TYPE_VERTEX );
 		RegisterShaderStage( fragPath.c_str(), PL_SHADER_TYPE_FRAGMENT );
 	} catch ( ... ) {
-		plDestroyShaderProgram( shaderProgram, true );
+		backend->DestroyProgram( shaderProgram );
 		throw;
 	}
 
-	plLinkShaderProgram( shaderProgram );
+	backend->LinkProgram( shaderProgram );
 
 	this->vertPath = vertPath;
 	this->fragPath = fragPath;
 }
 
 ShaderProgram::~ShaderProgram() {
-	plDestroyShaderProgram( shaderProgram, true );
+	backend->DestroyProgram( shaderProgram );
 }
 
 void ShaderProgram::Rebuild() {
-	PLShaderProgram* newShaderProgram = plCreateShaderProgram();
-	if ( newShaderProgram ) {
+	PLShaderProgram* newShaderProgram = backend->CreateProgram();
+	if ( newShaderProgram == nullptr ) {
 		throw std::runtime_error( plGetError());
 	}
 
@@ -228,26 +369,129 @@ void ShaderProgram::Rebuild() {
 		RegisterShaderStage( vertPath.c_str(), PL_SHADER_TYPE_VERTEX );
 		RegisterShaderStage( fragPath.c_str(), PL_SHADER_TYPE_FRAGMENT );
 	} catch ( const std::exception& exception ) {
-		plDestroyShaderProgram( shaderProgram, true );
+		backend->DestroyProgram( shaderProgram );
 		shaderProgram = oldProgram;
 		throw;
 	}
 
-	plLinkShaderProgram( shaderProgram );
+	backend->LinkProgram( shaderProgram );
+
+	backend->DestroyProgram( oldProgram );
 
-	plDestroyShaderProgram( oldProgram, true );
+	// Slots are likely to have moved and the new program has none of our values
+	for ( auto& uniform : uniforms ) {
+		uniform.slot = SHADER_UNIFORM_UNRESOLVED;
+		uniform.isSet = false;
+	}
 }
 
 void ShaderProgram::Enable() {
-	plSetShaderProgram( shaderProgram );
+	backend->SetProgram( shaderProgram );
 }
 
 void ShaderProgram::Disable() {
-	plSetShaderProgram( nullptr );
+	backend->SetProgram( nullptr );
 }
 
 void ShaderProgram::RegisterShaderStage( const char* path, PLShaderType type ) {
-	if ( !plRegisterShaderStageFromDisk( shaderProgram, path, type ) ) {
+	if ( !backend->RegisterStage( shaderProgram, path, type ) ) {
 		throw std::runtime_error( plGetError() );
 	}
 }
+
+int ShaderProgram::GetUniformIndex( const std::string& name ) {
+	const auto& i = uniformIndices.find( name );
+	if ( i != uniformIndices.end() ) {
+		return i->second;
+	}
+
+	Uniform uniform;
+	uniform.name = name;
+
+	int index = static_cast<int>(uniforms.size());
+	uniforms.push_back( uniform );
+	uniformIndices.insert( std::make_pair( name, index ) );
+
+	return index;
+}
+
+ShaderProgram::Uniform* ShaderProgram::GetUniform( int index ) {
+	if ( index < 0 || index >= static_cast<int>(uniforms.size()) ) {
+		return nullptr;
+	}
+
+	Uniform* uniform = &uniforms[ index ];
+	if ( uniform->slot == SHADER_UNIFORM_UNRESOLVED ) {
+		uniform->slot = backend->GetUniformSlot( shaderProgram, uniform->name.c_str() );
+		if ( uniform->slot < 0 ) {
+			// Kept, so that it's not looked up again every time it's set
+			uniform->slot = SHADER_UNIFORM_MISSING;
+		}
+		shaderStats.uniformLookups++;
+	} else {
+		shaderStats.uniformCacheHits++;
+	}
+
+	if ( uniform->slot == SHADER_UNIFORM_MISSING ) {
+		// Not used by this program, or optimised out
+		return nullptr;
+	}
+
+	return uniform;
+}
+
+/**
+ * Compares the value against what was last uploaded, and stores it if
+ * it differs.
+ * @return True if the value needs uploading.
+ */
+bool ShaderProgram::UpdateShadow( Uniform* uniform, const float* value, unsigned int numFloats ) {
+	if ( uniform->isSet && memcmp( uniform->shadow, value, sizeof( float ) * numFloats ) == 0 ) {
+		shaderStats.uniformUploadsSkipped++;
+		return false;
+	}
+
+	memcpy( uniform->shadow, value, sizeof( float ) * numFloats );
+	uniform->isSet = true;
+
+	shaderStats.uniformUploads++;
+	return true;
+}
+
+void ShaderProgram::SetUniform( int index, float value ) {
+	Uniform* uniform = GetUniform( index );
+	if ( uniform == nullptr || !UpdateShadow( uniform, &value, 1 ) ) {
+		return;
+	}
+
+	backend->SetUniformFloat( shaderProgram, uniform->slot, value );
+}
+
+void ShaderProgram::SetUniform( int index, const PLVector3& value ) {
+	Uniform* uniform = GetUniform( index );
+	float v[] = { value.x, value.y, value.z };
+	if ( uniform == nullptr || !UpdateShadow( uniform, v, 3 ) ) {
+		return;
+	}
+
+	backend->SetUniformVector3( shaderProgram, uniform->slot, value );
+}
+
+void ShaderProgram::SetUniform( int index, const PLVector4& value ) {
+	Uniform* uniform = GetUniform( index );
+	float v[] = { value.x, value.y, value.z, value.w };
+	if ( uniform == nullptr || !UpdateShadow( uniform, v, 4 ) ) {
+		return;
+	}
+
+	backend->SetUniformVector4( shaderProgram, uniform->slot, value );
+}
+
+void ShaderProgram::SetUniform( int index, const PLMatrix4& value ) {
+	Uniform* uniform = GetUniform( index );
+	if ( uniform == nullptr || !UpdateShadow( uniform, value.m, 16 ) ) {
+		return;
+	}
+
+	backend->SetUniformMatrix4( shaderProgram, uniform->slot, value );
+}
@@ -19,6 +19,33 @@
 
 typedef struct PLShaderProgram PLShaderProgram;
 
+typedef unsigned int ShaderHandle;
+#define SHADER_INVALID_HANDLE   ( ( ShaderHandle ) -1 )
+
+#define SHADER_UNIFORM_MISSING      -1  // Not in the program, as the platform library reports it
+#define SHADER_UNIFORM_UNRESOLVED   -2  // Not looked up yet
+
+/* Everything ShaderProgram asks of the platform library goes through
+ * here, so that it can be swapped out for something that doesn't need
+ * a graphics context, i.e. for testing.
+ */
+struct ShaderBackend {
+	PLShaderProgram* ( * CreateProgram )();
+	void ( * DestroyProgram )( PLShaderProgram* program );
+	bool ( * RegisterStage )( PLShaderProgram* program, const char* path, PLShaderType type );
+	void ( * LinkProgram )( PLShaderProgram* program );
+	void ( * SetProgram )( PLShaderProgram* program );
+
+	int ( * GetUniformSlot )( PLShaderProgram* program, const char* name );
+	void ( * SetUniformFloat )( PLShaderProgram* program, int slot, float value );
+	void ( * SetUniformVector3 )( PLShaderProgram* program, int slot, const PLVector3& value );
+	void ( * SetUniformVector4 )( PLShaderProgram* program, int slot, const PLVector4& value );
+	void ( * SetUniformMatrix4 )( PLShaderProgram* program, int slot, const PLMatrix4& value );
+};
+
+// Passing null goes back to the platform library
+void Shaders_SetBackend( const ShaderBackend* backend );
+
 class ShaderProgram {
 public:
 	ShaderProgram( const std::string& vertPath, const std::string& fragPath );
@@ -29,21 +56,53 @@ public:
 	void Enable();
 	void Disable();
 
+	// Resolves the uniform once and returns an index for the setters below
+	int GetUniformIndex( const std::string& name );
+
+	void SetUniform( int index, float value );
+	void SetUniform( int index, const PLVector3& value );
+	void SetUniform( int index, const PLVector4& value );
+	void SetUniform( int index, const PLMatrix4& value );
+
+	template< typename T >
+	void SetUniform( const std::string& name, const T& value ) {
+		SetUniform( GetUniformIndex( name ), value );
+	}
+
 	// This is awful, but we need it for passing shader programs into
 	// the platform library. Urgh...
 	PLShaderProgram* GetInternalProgram() const { return shaderProgram; }
 
+	unsigned int GetNumUniforms() const { return static_cast<unsigned int>(uniforms.size()); }
+
 private:
 	void RegisterShaderStage( const char* path, PLShaderType type );
 
+	struct Uniform {
+		std::string name;
+		int slot{ SHADER_UNIFORM_UNRESOLVED };
+		bool isSet{ false };
+		float shadow[16]{};  // Last value uploaded
+	};
+
+	Uniform* GetUniform( int index );
+	bool UpdateShadow( Uniform* uniform, const float* value, unsigned int numFloats );
+
 	std::string vertPath;
 	std::string fragPath;
 
 	PLShaderProgram* shaderProgram{ nullptr };
+
+	std::vector<Uniform> uniforms;
+	std::map<std::string, int> uniformIndices;
 };
 
+ShaderHandle Shaders_GetHandle( const std::string& name );
+
+ShaderProgram* Shaders_GetProgram( ShaderHandle handle );
 ShaderProgram* Shaders_GetProgram( const std::string& name );
 
+void Shaders_SetProgram( ShaderHandle handle );
 void Shaders_SetProgramByName( const std::string& name );
 
 void Shaders_Initialize();
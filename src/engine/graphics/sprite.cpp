@@ -18,20 +18,13 @@
 #include "../engine.h"
 
 #include "sprite.h"
-#include "display.h"
-#include "shaders.h"
+#include "sprite_batch.h"
 
 Sprite::Sprite( SpriteType type, PLTexture* texture, PLColour colour, float scale ) :
 	type_( type ),
 	colour_( colour ),
-	scale_( scale ) {
-	mesh_ = plCreateMeshRectangle( -64, -64, 64, 64, colour_ );
-	mesh_->texture = texture;
-
-	defaultProgram = Shaders_GetProgram( "generic_textured" );
-
-	matrix_.Identity();
-}
+	scale_( scale ),
+	texture_( texture ) {}
 
 Sprite::~Sprite() = default;
 
@@ -50,6 +43,9 @@ void Sprite::Tick() {
 #endif
 }
 
+/**
+ * Queues the sprite up with the scene's sprite batcher.
+ */
 void Sprite::Draw() {
 	if ( !cv_graphics_draw_sprites->b_value ) {
 		return;
@@ -59,31 +55,17 @@ void Sprite::Draw() {
 		return;
 	}
 
-	defaultProgram->Enable();
-
-	matrix_.Identity();
-	matrix_ *= PLVector3( scale_, scale_, scale_ );
-	matrix_.Translate( { 32 * scale_, 32 * scale_, 0 } );
-	matrix_.Rotate( angles_.x, { 1, 0, 0 } );
-	matrix_.Rotate( angles_.y, { 0, 1, 0 } );
-	matrix_.Rotate( angles_.z, { 0, 0, 1 } );
-	matrix_.Translate( position_ );
-
-	//matrix_ = matrix_ * PLVector3( scale_, scale_, scale_ );
-
-	plSetTexture( mesh_->texture, 0 );
-
-	plSetNamedShaderUniformMatrix4( NULL, "pl_model", matrix_, true );
-
-	plUploadMesh( mesh_ );
+	// Matches the size and offset of the rectangle sprites used to be drawn with
+	float size = 128.0f * scale_;
+	PLVector2 offset( 32.0f * scale_, 32.0f * scale_ );
 
-	plSetCullMode( PL_CULL_NONE );
-
-	plDrawMesh( mesh_ );
-
-	plSetCullMode( PL_CULL_POSTIVE );
-
-	plSetTexture( NULL, 0 );
+	SpriteBatcher::BlendMode blend = additive_ ? SpriteBatcher::BLEND_ADDITIVE : SpriteBatcher::BLEND_DEFAULT;
+	SpriteBatcher* batcher = Display_GetSpriteBatcher();
+	if ( type_ == TYPE_BILLBOARD ) {
+		batcher->SubmitBillboard( texture_, blend, position_, size, colour_, offset );
+	} else {
+		batcher->SubmitOriented( texture_, blend, position_, angles_, size, colour_, offset );
+	}
 }
 
 #if 0
@@ -107,16 +89,9 @@ void Sprite::SetAngles( const PLVector3& angles ) {
 }
 
 void Sprite::SetColour( const PLColour& colour ) {
-	plSetMeshUniformColour( mesh_, colour );
 	colour_ = colour;
 }
 
 void Sprite::SetTexture( PLTexture* texture ) {
-	// a lot of this will change once the rc manager is introduced...
-
-	if ( texture == mesh_->texture ) {
-		return;
-	}
-
-	mesh_->texture = texture;
+	texture_ = texture;
 }
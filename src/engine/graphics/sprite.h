@@ -17,12 +17,11 @@
 
 #pragma once
 
-class ShaderProgram;
-
 class Sprite {
 public:
 	enum SpriteType {
 		TYPE_DEFAULT,    // Depth-tested, scaled manually and oriented
+		TYPE_BILLBOARD,  // Depth-tested, scaled manually and always faces the camera
 	} type_{ TYPE_DEFAULT };
 
 	Sprite( SpriteType type, PLTexture* texture, PLColour colour = { 255, 255, 255, 255 }, float scale = 1.0f );
@@ -42,6 +41,8 @@ public:
 
 	void SetTexture( PLTexture* texture );
 
+	void SetAdditive( bool additive ) { additive_ = additive; }
+
 	//const SpriteAnimation* GetCurrentAnimation() { return current_animation_; }
 	//void SetAnimation(SpriteAnimation* anim);
 
@@ -55,11 +56,10 @@ private:
 	PLColour colour_{ 255, 255, 255, 255 };
 	float scale_{ 1.0f };
 
-	ShaderProgram* defaultProgram;
+	bool additive_{ false };
 
 	unsigned int current_frame_{ 0 };
 	double frame_delay_{ 0 };
 
-	PLMesh* mesh_{ nullptr };
-	PLMatrix4 matrix_{};
+	PLTexture* texture_{ nullptr };
 };
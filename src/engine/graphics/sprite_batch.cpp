@@ -0,0 +1,260 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "../engine.h"
+
+#include "sprite_batch.h"
+#include "shaders.h"
+#include "mesh.h"
+
+SpriteBatcher::SpriteBatcher() {
+	sprites_.reserve( SPRITE_BATCH_SEGMENT_SIZE );
+	vertices_.reserve( SPRITE_BATCH_SEGMENT_SIZE * 4 );
+}
+
+SpriteBatcher::~SpriteBatcher() = default;
+
+/**
+ * Frees up the streaming meshes; they'll be recreated on demand.
+ */
+void SpriteBatcher::DestroySegments() {
+	for ( auto& segment : segments_ ) {
+		if ( segment.mesh != nullptr ) {
+			plDestroyMesh( segment.mesh );
+			segment.mesh = nullptr;
+		}
+	}
+
+	current_segment_ = 0;
+}
+
+static PLVector3 Scale( const PLVector3& v, float s ) {
+	return PLVector3( v.x * s, v.y * s, v.z * s );
+}
+
+// Moves a point along the given (unit) right and up axes
+static PLVector3 Offset( const PLVector3& p, const PLVector3& right, const PLVector3& up, const PLVector2& offset ) {
+	return PLVector3(
+		p.x + right.x * offset.x + up.x * offset.y,
+		p.y + right.y * offset.x + up.y * offset.y,
+		p.z + right.z * offset.x + up.z * offset.y );
+}
+
+static PLVector3 Cross( const PLVector3& a, const PLVector3& b ) {
+	return PLVector3(
+		a.y * b.z - a.z * b.y,
+		a.z * b.x - a.x * b.z,
+		a.x * b.y - a.y * b.x );
+}
+
+static PLVector3 Normalize( const PLVector3& v ) {
+	float length = std::sqrt( v.x * v.x + v.y * v.y + v.z * v.z );
+	if ( length <= 0 ) {
+		return v;
+	}
+	return Scale( v, 1.0f / length );
+}
+
+/**
+ * Works out the camera's right and up axes, used for billboards.
+ */
+void SpriteBatcher::SetView( const PLVector3& forward ) {
+	PLVector3 right = Cross( forward, PLVector3( 0, 1, 0 ) );
+	if ( right.x == 0 && right.y == 0 && right.z == 0 ) {
+		// Looking straight up or down
+		right = PLVector3( 1, 0, 0 );
+	}
+
+	view_right_ = Normalize( right );
+	view_up_ = Normalize( Cross( view_right_, forward ) );
+}
+
+void SpriteBatcher::SubmitBillboard( PLTexture* texture,
+									 BlendMode blend,
+									 const PLVector3& position,
+									 float size,
+									 const PLColour& colour,
+									 const PLVector2& offset ) {
+	if ( size <= 0 ) {
+		return;
+	}
+
+	float half_size = size / 2;
+
+	SpriteRecord sprite;
+	sprite.texture = texture;
+	sprite.blend = blend;
+	sprite.order = static_cast<unsigned int>(sprites_.size());
+	sprite.position = Offset( position, view_right_, view_up_, offset );
+	sprite.right = Scale( view_right_, half_size );
+	sprite.up = Scale( view_up_, half_size );
+	sprite.colour = colour;
+	sprites_.push_back( sprite );
+}
+
+void SpriteBatcher::SubmitOriented( PLTexture* texture,
+									BlendMode blend,
+									const PLVector3& position,
+									const PLVector3& angles,
+									float size,
+									const PLColour& colour,
+									const PLVector2& offset ) {
+	if ( size <= 0 ) {
+		return;
+	}
+
+	float half_size = size / 2;
+
+	// Rotate the unit axes about x, then y, then z, same as Sprite used to
+	float cx = std::cos( angles.x ), sx = std::sin( angles.x );
+	float cy = std::cos( angles.y ), sy = std::sin( angles.y );
+	float cz = std::cos( angles.z ), sz = std::sin( angles.z );
+
+	PLVector3 right( cy * cz, cy * sz, -sy );
+	PLVector3 up( sx * sy * cz - cx * sz, sx * sy * sz + cx * cz, sx * cy );
+
+	SpriteRecord sprite;
+	sprite.texture = texture;
+	sprite.blend = blend;
+	sprite.order = static_cast<unsigned int>(sprites_.size());
+	sprite.position = Offset( position, right, up, offset );
+	sprite.right = Scale( right, half_size );
+	sprite.up = Scale( up, half_size );
+	sprite.colour = colour;
+	sprites_.push_back( sprite );
+}
+
+/**
+ * Orders the sprites by blend mode and texture, then generates the
+ * four corners of every quad into one contiguous vertex stream.
+ * Alpha blended sprites are left in the order they were submitted,
+ * so that callers can hand them over back to front.
+ */
+void SpriteBatcher::Build() {
+	batches_.clear();
+	vertices_.clear();
+
+	if ( sprites_.empty() ) {
+		return;
+	}
+
+	std::sort( sprites_.begin(), sprites_.end(), []( const SpriteRecord& a, const SpriteRecord& b ) {
+		if ( a.blend != b.blend ) {
+			return a.blend < b.blend;
+		}
+		if ( a.blend == BLEND_ADDITIVE && a.texture != b.texture ) {
+			return a.texture < b.texture;
+		}
+		return a.order < b.order;
+	} );
+
+	vertices_.resize( sprites_.size() * 4 );
+
+	Vertex* vertex = vertices_.data();
+	for ( unsigned int i = 0; i < sprites_.size(); ++i, vertex += 4 ) {
+		const SpriteRecord& sprite = sprites_[ i ];
+		if ( batches_.empty() || batches_.back().texture != sprite.texture || batches_.back().blend != sprite.blend ) {
+			batches_.push_back( { sprite.texture, sprite.blend, i, 0 } );
+		}
+		batches_.back().num_sprites++;
+
+		const PLVector3& p = sprite.position;
+		const PLVector3& r = sprite.right;
+		const PLVector3& u = sprite.up;
+
+		// Same corner order the font batches use; 0 1 2, 2 1 3
+		vertex[ 0 ] = { PLVector3( p.x - r.x - u.x, p.y - r.y - u.y, p.z - r.z - u.z ), 0, 1, sprite.colour };
+		vertex[ 1 ] = { PLVector3( p.x - r.x + u.x, p.y - r.y + u.y, p.z - r.z + u.z ), 0, 0, sprite.colour };
+		vertex[ 2 ] = { PLVector3( p.x + r.x - u.x, p.y + r.y - u.y, p.z + r.z - u.z ), 1, 1, sprite.colour };
+		vertex[ 3 ] = { PLVector3( p.x + r.x + u.x, p.y + r.y + u.y, p.z + r.z + u.z ), 1, 0, sprite.colour };
+	}
+}
+
+SpriteBatcher::Segment* SpriteBatcher::NextSegment() {
+	Segment* segment = &segments_[ current_segment_ ];
+	current_segment_ = ( current_segment_ + 1 ) % SPRITE_BATCH_NUM_SEGMENTS;
+
+	if ( segment->mesh == nullptr ) {
+		segment->mesh = plCreateMesh( PL_MESH_TRIANGLES, PL_DRAW_DYNAMIC,
+									  SPRITE_BATCH_SEGMENT_SIZE * 2, SPRITE_BATCH_SEGMENT_SIZE * 4 );
+		if ( segment->mesh == nullptr ) {
+			Error( "Failed to create sprite batch mesh, %s, aborting!\n", plGetError() );
+		}
+
+		unsigned int cur_index = 0;
+		for ( unsigned int i = 0, vert = 0; i < SPRITE_BATCH_SEGMENT_SIZE; ++i, vert += 4 ) {
+			plSetMeshTrianglePosition( segment->mesh, &cur_index, vert, vert + 1, vert + 2 );
+			plSetMeshTrianglePosition( segment->mesh, &cur_index, vert + 2, vert + 1, vert + 3 );
+		}
+	}
+
+	return segment;
+}
+
+void SpriteBatcher::Draw() {
+	num_draws_ = 0;
+
+	if ( batches_.empty() ) {
+		return;
+	}
+
+	static ShaderHandle program = Shaders_GetHandle( "generic_textured" );
+	Shaders_SetProgram( program );
+	plSetNamedShaderUniformMatrix4( NULL, "pl_model", plMatrix4Identity(), false );
+	plSetCullMode( PL_CULL_NONE );
+
+	for ( const auto& batch : batches_ ) {
+		plSetBlendMode( batch.blend == BLEND_ADDITIVE ? PL_BLEND_ADDITIVE : PL_BLEND_DEFAULT );
+		plSetTexture( batch.texture, 0 );
+
+		// Large batches are split across as many segments as they need
+		for ( unsigned int offset = 0; offset < batch.num_sprites; offset += SPRITE_BATCH_SEGMENT_SIZE ) {
+			unsigned int num_sprites = std::min( batch.num_sprites - offset, ( unsigned int ) SPRITE_BATCH_SEGMENT_SIZE );
+
+			Segment* segment = NextSegment();
+			const Vertex* src = &vertices_[ ( batch.first_sprite + offset ) * 4 ];
+			for ( unsigned int i = 0; i < num_sprites * 4; ++i ) {
+				plSetMeshVertexPosition( segment->mesh, i, src[ i ].position );
+				plSetMeshVertexST( segment->mesh, i, src[ i ].s, src[ i ].t );
+				plSetMeshVertexColour( segment->mesh, i, src[ i ].colour );
+			}
+
+			// Whatever's left over from the last time round is never uploaded
+			Mesh_DrawRange( segment->mesh, num_sprites * 2, num_sprites * 4 );
+			num_draws_++;
+		}
+	}
+
+	plSetTexture( NULL, 0 );
+	plSetCullMode( PL_CULL_POSTIVE );
+	plSetBlendMode( PL_BLEND_DEFAULT );
+}
+
+void SpriteBatcher::Clear() {
+	sprites_.clear();
+}
+
+/**
+ * Batcher used for sprites in the scene.
+ */
+SpriteBatcher* Display_GetSpriteBatcher() {
+	static SpriteBatcher scene_batcher;
+	return &scene_batcher;
+}
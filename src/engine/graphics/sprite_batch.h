@@ -0,0 +1,116 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#define SPRITE_BATCH_SEGMENT_SIZE   256     // Sprites per streaming segment
+#define SPRITE_BATCH_NUM_SEGMENTS   16      // Segments in the ring
+
+/**
+ * Collects sprites over a frame and streams them to the GPU in as
+ * few draws as possible, grouped by texture and blend mode. Order
+ * only matters for alpha blended sprites, so those are drawn in the
+ * order they were submitted.
+ *
+ * Vertices are written into a ring of fixed-size dynamic meshes, so
+ * a segment isn't rewritten until the rest of the ring has been used.
+ */
+class SpriteBatcher {
+public:
+	enum BlendMode {
+		BLEND_DEFAULT,
+		BLEND_ADDITIVE,
+	};
+
+	struct Vertex {
+		PLVector3 position;
+		float s, t;
+		PLColour colour;
+	};
+
+	struct Batch {
+		PLTexture* texture;
+		BlendMode blend;
+		unsigned int first_sprite;
+		unsigned int num_sprites;
+	};
+
+	SpriteBatcher();
+	~SpriteBatcher();
+
+	void SetView( const PLVector3& forward );
+
+	// Quad that always faces the camera; offset moves its centre along its own right/up axes
+	void SubmitBillboard( PLTexture* texture,
+						  BlendMode blend,
+						  const PLVector3& position,
+						  float size,
+						  const PLColour& colour,
+						  const PLVector2& offset = PLVector2( 0, 0 ) );
+	// Quad with a fixed orientation, angles in radians
+	void SubmitOriented( PLTexture* texture,
+						 BlendMode blend,
+						 const PLVector3& position,
+						 const PLVector3& angles,
+						 float size,
+						 const PLColour& colour,
+						 const PLVector2& offset = PLVector2( 0, 0 ) );
+
+	// Sorts and generates the vertex stream; doesn't touch the GPU
+	void Build();
+	void Draw();
+	void Clear();
+
+	void DestroySegments();
+
+	const std::vector<Batch>& GetBatches() const { return batches_; }
+	const std::vector<Vertex>& GetVertices() const { return vertices_; }
+
+	unsigned int GetNumSprites() const { return static_cast<unsigned int>(sprites_.size()); }
+	unsigned int GetNumDraws() const { return num_draws_; }
+
+private:
+	struct SpriteRecord {
+		PLTexture* texture;
+		BlendMode blend;
+		unsigned int order;
+		PLVector3 position;
+		PLVector3 right;  // Half-extents of the quad
+		PLVector3 up;
+		PLColour colour;
+	};
+
+	struct Segment {
+		PLMesh* mesh{ nullptr };
+	};
+
+	Segment* NextSegment();
+
+	std::vector<SpriteRecord> sprites_;
+	std::vector<Vertex> vertices_;
+	std::vector<Batch> batches_;
+
+	PLVector3 view_right_{ 1, 0, 0 };
+	PLVector3 view_up_{ 0, 1, 0 };
+
+	Segment segments_[SPRITE_BATCH_NUM_SEGMENTS];
+	unsigned int current_segment_{ 0 };
+
+	unsigned int num_draws_{ 0 };
+};
+
+SpriteBatcher* Display_GetSpriteBatcher();
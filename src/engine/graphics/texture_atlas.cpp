@@ -16,6 +16,7 @@
  */
 
 #include "../engine.h"
+#include "../memory_tracker.h"
 
 #include "display.h"
 #include "texture_atlas.h"
@@ -40,6 +41,8 @@ TextureAtlas::~TextureAtlas() {
 }
 
 bool TextureAtlas::AddImage(const std::string &path, bool absolute) {
+  MEMORY_TAG(MEMORY_TAG_TEXTURES);
+
   const auto image = images_by_name_.find(path);
   if(image != images_by_name_.end()) {
     return true;
@@ -71,6 +74,8 @@ void TextureAtlas::AddImages(const std::vector<std::string> &textures) {
 }
 
 void TextureAtlas::Finalize() {
+  MEMORY_TAG(MEMORY_TAG_TEXTURES);
+
   if(images_by_height_.empty()) {
     LogWarn("Failed to finalize texture atlas, no textures loaded!\n");
     return;
@@ -146,7 +151,7 @@ void TextureAtlas::Finalize() {
     texture->image = nullptr;
   }
 
-#ifdef _DEBUG
+#if defined(_DEBUG) && !defined(OPENHOW_BENCHMARK) && !defined(OPENHOW_TESTS)
   static unsigned int gen_id = 0;
   if(plCreatePath("./debug/generated/")) {
     char buf[PL_SYSTEM_MAX_PATH];
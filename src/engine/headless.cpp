@@ -0,0 +1,145 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "engine.h"
+#include "headless.h"
+#include "journal.h"
+
+#include "net/net.h"
+
+using namespace openhow;
+
+static struct {
+	bool is_realtime{ false };
+	bool is_replay{ false };
+
+	unsigned int num_rounds{ 0 };
+	unsigned int round_ticks{ 0 };
+
+	unsigned int cur_round{ 0 };
+	unsigned int cur_round_tick{ 0 };
+	unsigned int round_start_ms{ 0 };
+
+	unsigned int total_ticks{ 0 };
+	unsigned int start_ms{ 0 };
+} headless;
+
+static unsigned int GetArgumentInteger( const char* name, unsigned int default_value ) {
+	const char* arg = plGetCommandLineArgumentValue( name );
+	if ( arg == nullptr ) {
+		return default_value;
+	}
+
+	int value = atoi( arg );
+	if ( value <= 0 ) {
+		LogWarn( "Invalid value for %s, \"%s\", using %u!\n", name, arg, default_value );
+		return default_value;
+	}
+
+	return static_cast<unsigned int>(value);
+}
+
+static double GetTicksPerSecond( unsigned int ticks, unsigned int ms ) {
+	return ms > 0 ? ticks * 1000.0 / ms : 0.0;
+}
+
+void Headless_Initialize() {
+	LogInfo( "Running headless\n" );
+
+	headless.is_realtime = plHasCommandLineArgument( "-realtime" );
+
+	if ( plHasCommandLineArgument( "-listen" ) ) {
+		// Clients run at the usual rate, so there's no keeping up with a server that doesn't
+		if ( !headless.is_realtime ) {
+			LogInfo( "Listening, so ticking in realtime\n" );
+			headless.is_realtime = true;
+		}
+
+		Net_Listen( "udp" );
+	}
+
+	const char* arg;
+	if ( ( arg = plGetCommandLineArgumentValue( "-replay" ) ) != nullptr ) {
+		if ( !Journal_Replay( arg, !headless.is_realtime ) ) {
+			Error( "Failed to replay journal, \"%s\"!\n", arg );
+		}
+
+		headless.is_replay = true;
+		return;
+	}
+
+	if ( ( arg = plGetCommandLineArgumentValue( "-map" ) ) == nullptr ) {
+		return;
+	}
+
+	std::string command = std::string( "map " ) + arg;
+	plParseConsoleString( command.c_str() );
+	if ( !Engine::Game()->IsModeActive() ) {
+		Error( "Failed to start map, \"%s\"!\n", arg );
+	}
+
+	headless.num_rounds = GetArgumentInteger( "-rounds", 1 );
+	headless.round_ticks = GetArgumentInteger( "-round_ticks", HEADLESS_DEFAULT_ROUND_TICKS );
+
+	LogInfo( "Playing %u rounds of %u ticks on \"%s\"\n", headless.num_rounds, headless.round_ticks, arg );
+
+	headless.start_ms = headless.round_start_ms = System_GetTicks();
+}
+
+bool Headless_IsRealtime() {
+	return headless.is_realtime;
+}
+
+bool Headless_Tick() {
+	// The journal reports on itself once it's done
+	if ( headless.is_replay ) {
+		return Journal_IsReplaying();
+	}
+
+	if ( headless.num_rounds == 0 ) {
+		return true;
+	}
+
+	headless.total_ticks++;
+	if ( ++headless.cur_round_tick < headless.round_ticks ) {
+		return true;
+	}
+
+	unsigned int now = System_GetTicks();
+	LogInfo( "Round %u of %u: %u ticks in %ums (%.1f ticks/sec)\n",
+			 headless.cur_round + 1, headless.num_rounds, headless.cur_round_tick, now - headless.round_start_ms,
+			 GetTicksPerSecond( headless.cur_round_tick, now - headless.round_start_ms ) );
+
+	if ( ++headless.cur_round >= headless.num_rounds ) {
+		LogInfo( "Finished %u rounds: %u ticks in %ums (%.1f ticks/sec)\n",
+				 headless.num_rounds, headless.total_ticks, now - headless.start_ms,
+				 GetTicksPerSecond( headless.total_ticks, now - headless.start_ms ) );
+		return false;
+	}
+
+	IGameMode* mode = Engine::Game()->GetMode();
+	if ( mode == nullptr ) {
+		LogWarn( "Mode ended before the last round!\n" );
+		return false;
+	}
+
+	mode->RestartRound();
+
+	headless.cur_round_tick = 0;
+	headless.round_start_ms = System_GetTicks();
+	return true;
+}
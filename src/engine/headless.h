@@ -0,0 +1,40 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/* Drives the game when it's run with -headless, as there's nobody
+ * around to pick a map from the menu. It's set up from the command line:
+ *
+ * -map <name>          map to start with the default mode
+ * -rounds <n>          rounds to play before quitting, defaults to 1
+ * -round_ticks <n>     length of each round, defaults to a minute
+ * -replay <file>       plays back a journal instead, then quits
+ * -listen              hosts the game over UDP; implies -realtime
+ * -realtime            ticks at the usual rate, rather than as fast as possible
+ *
+ * Without a map or journal it'll carry on ticking until it's stopped.
+ */
+
+#define HEADLESS_DEFAULT_ROUND_TICKS    ( 60 * TICKS_PER_SECOND )
+
+void Headless_Initialize();
+
+bool Headless_IsRealtime();
+
+// Called after each tick; returns false once the run is over
+bool Headless_Tick();
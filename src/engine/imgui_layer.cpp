@@ -32,6 +32,8 @@
 #include "editor/window_terrain_import.h"
 #include "editor/window_actor_tree.h"
 #include "editor/window_new_game.h"
+#include "editor/window_profiler.h"
+#include "editor/window_memory.h"
 
 #include "language.h"
 
@@ -482,6 +484,12 @@ void UI_DisplayDebugMenu( void ) {
 			if ( ImGui::MenuItem( "Show Console", "`" ) ) {
 				windows.push_back( new ConsoleWindow() );
 			}
+			if ( ImGui::MenuItem( "Profiler..." ) ) {
+				windows.push_back( new ProfilerWindow() );
+			}
+			if ( ImGui::MenuItem( "Memory..." ) ) {
+				windows.push_back( new MemoryWindow() );
+			}
 
 #if 0
 			static int tc = 0;
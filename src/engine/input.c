@@ -35,7 +35,7 @@ struct {
 
   struct {
     bool button_states[INPUT_MAX_KEYS];
-    int axis_states[SDL_CONTROLLER_AXIS_MAX];
+    int axis_states[INPUT_MAX_AXES];
     int bindings[INPUT_MAX_ACTIONS];
     SDL_GameController *pnt;
   } controllers[INPUT_MAX_CONTROLLERS];
@@ -175,6 +175,10 @@ bool Input_GetActionState(unsigned int controller, int action) {
 
 void Input_SetAxisState(unsigned int controller, unsigned int axis, int status) {
   u_assert(controller < INPUT_MAX_CONTROLLERS);
+  if (axis >= INPUT_MAX_AXES) {
+    return;
+  }
+
   /* todo: make deadzone configurable */
   if (status < 3500 && status > -3500) status = 0;
   input_state.controllers[controller].axis_states[axis] = (status / 100);
@@ -210,3 +214,28 @@ void Input_AddTextCharacter(const char *c) {
 
   input_state.InputTextCallback(c);
 }
+
+void Input_GetState(InputState *out) {
+  u_assert(out != NULL, "Invalid input state!\n");
+  memset(out, 0, sizeof(InputState));
+  memcpy(out->key_states, input_state.keyboard.key_states, sizeof(out->key_states));
+  for (unsigned int i = 0; i < INPUT_MAX_CONTROLLERS; ++i) {
+    memcpy(out->controllers[i].button_states, input_state.controllers[i].button_states,
+           sizeof(out->controllers[i].button_states));
+    memcpy(out->controllers[i].axis_states, input_state.controllers[i].axis_states,
+           sizeof(out->controllers[i].axis_states));
+  }
+}
+
+/* overrides whatever the devices last reported, without
+ * going through the focus callbacks */
+void Input_SetState(const InputState *state) {
+  u_assert(state != NULL, "Invalid input state!\n");
+  memcpy(input_state.keyboard.key_states, state->key_states, sizeof(state->key_states));
+  for (unsigned int i = 0; i < INPUT_MAX_CONTROLLERS; ++i) {
+    memcpy(input_state.controllers[i].button_states, state->controllers[i].button_states,
+           sizeof(state->controllers[i].button_states));
+    memcpy(input_state.controllers[i].axis_states, state->controllers[i].axis_states,
+           sizeof(state->controllers[i].axis_states));
+  }
+}
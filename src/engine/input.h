@@ -18,6 +18,7 @@
 #pragma once
 
 #define INPUT_MAX_CONTROLLERS   4
+#define INPUT_MAX_AXES          6
 
 enum {
   ACTION_MOVE_FORWARD,
@@ -124,6 +125,16 @@ enum {
   INPUT_MAX_KEYS
 };
 
+/* everything the simulation can read back from
+ * the devices, used to record and replay games */
+typedef struct InputState {
+  bool key_states[INPUT_MAX_KEYS];
+  struct {
+    bool button_states[INPUT_MAX_BUTTONS];
+    int axis_states[INPUT_MAX_AXES];
+  } controllers[INPUT_MAX_CONTROLLERS];
+} InputState;
+
 PL_EXTERN_C
 
 void Input_Initialize(void);
@@ -144,4 +155,7 @@ void Input_SetMouseState(int x, int y, int button, bool status);
 
 void Input_AddTextCharacter(const char *c);
 
+void Input_GetState(InputState *out);
+void Input_SetState(const InputState *state);
+
 PL_EXTERN_C_END
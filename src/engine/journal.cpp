@@ -0,0 +1,498 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include "engine.h"
+#include "input.h"
+#include "journal.h"
+#include "snapshot.h"
+
+#include "game/actor_manager.h"
+
+#define FNV_OFFSET  2166136261U
+#define FNV_PRIME   16777619U
+
+// Every input value the simulation can see, flattened out
+#define JOURNAL_NUM_INPUTS  ( INPUT_MAX_KEYS + INPUT_MAX_CONTROLLERS * ( INPUT_MAX_BUTTONS + INPUT_MAX_AXES ) )
+
+struct JournalFrame {
+	unsigned int tick;
+	std::vector<std::pair<unsigned int, int>> changes;
+};
+
+enum class JournalMode {
+	IDLE,
+	RECORDING,
+	REPLAYING,
+};
+
+static struct {
+	JournalMode mode{ JournalMode::IDLE };
+
+	std::string path;
+	std::string map_name;
+	uint32_t seed{ 0 };
+
+	unsigned int start_tick{ 0 };
+	unsigned int end_tick{ 0 };
+
+	std::vector<JournalFrame> frames;
+	std::map<unsigned int, uint32_t> checksums;
+
+	std::vector<int> inputs;
+
+	// Replay only
+	bool is_fast_forward{ false };
+	size_t next_frame{ 0 };
+	unsigned int num_divergences{ 0 };
+	unsigned int replay_start_ms{ 0 };
+} journal;
+
+static uint32_t random_state = 1;
+
+void Sim_SeedRandom( uint32_t seed ) {
+	// Xorshift gets stuck on zero
+	random_state = ( seed != 0 ) ? seed : 1;
+}
+
+uint32_t Sim_GetRandomState() {
+	return random_state;
+}
+
+uint32_t Sim_Random() {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+float Sim_RandomFloat( float max ) {
+	return static_cast<float>(Sim_Random() >> 8) / 16777216.0f * max;
+}
+
+static void FlattenInput( const InputState& state, std::vector<int>& out ) {
+	out.clear();
+	out.reserve( JOURNAL_NUM_INPUTS );
+
+	for ( bool key : state.key_states ) {
+		out.push_back( key ? 1 : 0 );
+	}
+
+	for ( const auto& controller : state.controllers ) {
+		for ( bool button : controller.button_states ) {
+			out.push_back( button ? 1 : 0 );
+		}
+		for ( int axis : controller.axis_states ) {
+			out.push_back( axis );
+		}
+	}
+}
+
+static void UnflattenInput( const std::vector<int>& values, InputState* out ) {
+	u_assert( values.size() == JOURNAL_NUM_INPUTS, "Invalid number of input values, %d!\n", static_cast<int>(values.size()) );
+
+	size_t i = 0;
+	for ( bool& key : out->key_states ) {
+		key = values[ i++ ] != 0;
+	}
+
+	for ( auto& controller : out->controllers ) {
+		for ( bool& button : controller.button_states ) {
+			button = values[ i++ ] != 0;
+		}
+		for ( int& axis : controller.axis_states ) {
+			axis = values[ i++ ];
+		}
+	}
+}
+
+static void HashBytes( uint32_t& hash, const void* data, size_t size ) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for ( size_t i = 0; i < size; ++i ) {
+		hash = ( hash ^ bytes[ i ] ) * FNV_PRIME;
+	}
+}
+
+/**
+ * Hashes the properties of every actor along with the RNG. Ids keep
+ * counting up from one game to the next, so they're left out; the
+ * order the actors come in is enough.
+ */
+uint32_t Journal_GetStateChecksum() {
+	uint32_t checksum = FNV_OFFSET;
+
+	uint32_t random = Sim_GetRandomState();
+	HashBytes( checksum, &random, sizeof( random ) );
+
+	for ( auto actor : ActorManager::GetInstance()->GetActors() ) {
+		std::string class_name = actor->GetClassName();
+		HashBytes( checksum, class_name.data(), class_name.size() );
+
+		for ( const auto& property : actor->GetProperties() ) {
+			std::string value = property.second->Serialise();
+			HashBytes( checksum, property.first.data(), property.first.size() );
+			HashBytes( checksum, value.data(), value.size() );
+		}
+	}
+
+	return checksum;
+}
+
+static bool WriteJournal() {
+	SnapshotWriter writer;
+	writer.WriteBytes( reinterpret_cast<const uint8_t*>(JOURNAL_IDENTIFIER), 4 );
+	writer.WriteVarint( JOURNAL_VERSION );
+	writer.WriteString( journal.map_name );
+	writer.WriteVarint( journal.seed );
+
+	// Interleaved so the file reads in tick order
+	auto checksum = journal.checksums.begin();
+	for ( const auto& frame : journal.frames ) {
+		for ( ; checksum != journal.checksums.end() && checksum->first < frame.tick; ++checksum ) {
+			writer.WriteByte( JOURNAL_CHECKSUM );
+			writer.WriteVarint( checksum->first );
+			writer.WriteVarint( checksum->second );
+		}
+
+		writer.WriteByte( JOURNAL_INPUT );
+		writer.WriteVarint( frame.tick );
+		writer.WriteVarint( frame.changes.size() );
+		unsigned int last_index = 0;
+		for ( const auto& change : frame.changes ) {
+			writer.WriteVarint( change.first - last_index );
+			writer.WriteSignedVarint( change.second );
+			last_index = change.first;
+		}
+	}
+
+	for ( ; checksum != journal.checksums.end(); ++checksum ) {
+		writer.WriteByte( JOURNAL_CHECKSUM );
+		writer.WriteVarint( checksum->first );
+		writer.WriteVarint( checksum->second );
+	}
+
+	writer.WriteByte( JOURNAL_END );
+	writer.WriteVarint( journal.end_tick );
+
+	std::ofstream output( journal.path, std::ios::binary );
+	if ( !output.is_open() ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", journal.path.c_str() );
+		return false;
+	}
+
+	output.write( reinterpret_cast<const char*>(writer.GetData()), writer.GetSize() );
+	return output.good();
+}
+
+static bool ReadJournal( const std::string& path ) {
+	PLFile* file = plOpenFile( path.c_str(), false );
+	if ( file == nullptr ) {
+		LogWarn( "Failed to open journal, \"%s\"!\n", path.c_str() );
+		return false;
+	}
+
+	std::vector<uint8_t> buffer( plGetFileSize( file ) );
+	size_t size = plReadFile( file, buffer.data(), 1, buffer.size() );
+	plCloseFile( file );
+
+	if ( size < 4 || memcmp( buffer.data(), JOURNAL_IDENTIFIER, 4 ) != 0 ) {
+		LogWarn( "Invalid journal, \"%s\"!\n", path.c_str() );
+		return false;
+	}
+
+	SnapshotReader reader( buffer.data() + 4, size - 4 );
+	uint64_t version = reader.ReadVarint();
+	if ( version != JOURNAL_VERSION ) {
+		LogWarn( "Unsupported journal version, %d, expected %d!\n", static_cast<int>(version), JOURNAL_VERSION );
+		return false;
+	}
+
+	// Nothing's kept unless the whole thing reads back
+	std::string map_name = reader.ReadString();
+	uint32_t seed = static_cast<uint32_t>(reader.ReadVarint());
+	std::vector<JournalFrame> frames;
+	std::map<unsigned int, uint32_t> checksums;
+	unsigned int end_tick = 0;
+
+	bool is_done = false;
+	while ( !is_done && reader.IsValid() ) {
+		uint8_t type = reader.ReadByte();
+		unsigned int tick = static_cast<unsigned int>(reader.ReadVarint());
+		switch ( type ) {
+			case JOURNAL_INPUT: {
+				JournalFrame frame;
+				frame.tick = tick;
+
+				unsigned int num_changes = static_cast<unsigned int>(reader.ReadVarint());
+				unsigned int index = 0;
+				for ( unsigned int i = 0; i < num_changes && reader.IsValid(); ++i ) {
+					index += static_cast<unsigned int>(reader.ReadVarint());
+					int value = static_cast<int>(reader.ReadSignedVarint());
+					if ( index >= JOURNAL_NUM_INPUTS ) {
+						reader.Invalidate();
+						break;
+					}
+					frame.changes.push_back( std::make_pair( index, value ) );
+				}
+
+				frames.push_back( frame );
+				break;
+			}
+			case JOURNAL_CHECKSUM:
+				checksums[ tick ] = static_cast<uint32_t>(reader.ReadVarint());
+				break;
+			case JOURNAL_END:
+				end_tick = tick;
+				is_done = true;
+				break;
+			default:
+				reader.Invalidate();
+				break;
+		}
+	}
+
+	if ( !reader.IsValid() ) {
+		LogWarn( "Journal is malformed or incomplete, \"%s\"!\n", path.c_str() );
+		return false;
+	}
+
+	journal.map_name = map_name;
+	journal.seed = seed;
+	journal.frames.swap( frames );
+	journal.checksums.swap( checksums );
+	journal.end_tick = end_tick;
+	return true;
+}
+
+/**
+ * Starts up the map from scratch, with the RNG seeded, so
+ * recording and replaying both begin from the same place.
+ */
+static bool StartJournalMap() {
+	Sim_SeedRandom( journal.seed );
+
+	std::string command = "map " + journal.map_name;
+	plParseConsoleString( command.c_str() );
+	if ( !openhow::Engine::Game()->IsModeActive() ) {
+		LogWarn( "Failed to start \"%s\" for the journal!\n", journal.map_name.c_str() );
+		return false;
+	}
+
+	journal.start_tick = g_state.sim_ticks;
+	journal.inputs.assign( JOURNAL_NUM_INPUTS, 0 );
+	return true;
+}
+
+bool Journal_Record( const std::string& path, const std::string& map_name ) {
+	Journal_Stop();
+
+	journal.path = path;
+	journal.map_name = map_name;
+	journal.seed = System_GetTicks();
+	journal.frames.clear();
+	journal.checksums.clear();
+	journal.end_tick = 0;
+
+	if ( !StartJournalMap() ) {
+		return false;
+	}
+
+	journal.mode = JournalMode::RECORDING;
+
+	LogInfo( "Recording journal to \"%s\"\n", path.c_str() );
+	return true;
+}
+
+bool Journal_Replay( const std::string& path, bool fast_forward ) {
+	Journal_Stop();
+
+	if ( !ReadJournal( path ) || !StartJournalMap() ) {
+		return false;
+	}
+
+	journal.path = path;
+	journal.mode = JournalMode::REPLAYING;
+	journal.is_fast_forward = fast_forward;
+	journal.next_frame = 0;
+	journal.num_divergences = 0;
+	journal.replay_start_ms = System_GetTicks();
+
+	LogInfo( "Replaying journal \"%s\", %u ticks\n", path.c_str(), journal.end_tick );
+	return true;
+}
+
+void Journal_Stop() {
+	switch ( journal.mode ) {
+		case JournalMode::IDLE:
+			return;
+		case JournalMode::RECORDING:
+			journal.end_tick = g_state.sim_ticks - journal.start_tick;
+			if ( WriteJournal() ) {
+				LogInfo( "Wrote journal \"%s\", %u ticks\n", journal.path.c_str(), journal.end_tick );
+			}
+			break;
+		case JournalMode::REPLAYING: {
+			unsigned int num_ticks = g_state.sim_ticks - journal.start_tick;
+			unsigned int elapsed = System_GetTicks() - journal.replay_start_ms;
+			LogInfo( "Replayed %u of %u ticks in %ums (%.1f ticks/sec), %u divergences\n",
+					 num_ticks, journal.end_tick, elapsed,
+					 elapsed > 0 ? num_ticks * 1000.0 / elapsed : 0.0,
+					 journal.num_divergences );
+			break;
+		}
+	}
+
+	journal.mode = JournalMode::IDLE;
+	journal.is_fast_forward = false;
+	journal.frames.clear();
+	journal.checksums.clear();
+}
+
+bool Journal_IsRecording() {
+	return journal.mode == JournalMode::RECORDING;
+}
+
+bool Journal_IsReplaying() {
+	return journal.mode == JournalMode::REPLAYING;
+}
+
+bool Journal_IsFastForwarding() {
+	return Journal_IsReplaying() && journal.is_fast_forward;
+}
+
+unsigned int Journal_GetNumDivergences() {
+	return journal.num_divergences;
+}
+
+void Journal_BeginTick() {
+	if ( journal.mode == JournalMode::IDLE ) {
+		return;
+	}
+
+	unsigned int tick = g_state.sim_ticks - journal.start_tick;
+
+	if ( Journal_IsRecording() ) {
+		InputState state;
+		Input_GetState( &state );
+
+		std::vector<int> inputs;
+		FlattenInput( state, inputs );
+
+		JournalFrame frame;
+		frame.tick = tick;
+		for ( unsigned int i = 0; i < inputs.size(); ++i ) {
+			if ( inputs[ i ] != journal.inputs[ i ] ) {
+				frame.changes.push_back( std::make_pair( i, inputs[ i ] ) );
+			}
+		}
+
+		if ( !frame.changes.empty() ) {
+			journal.frames.push_back( frame );
+			journal.inputs.swap( inputs );
+		}
+		return;
+	}
+
+	for ( ; journal.next_frame < journal.frames.size() && journal.frames[ journal.next_frame ].tick <= tick; ++journal.next_frame ) {
+		for ( const auto& change : journal.frames[ journal.next_frame ].changes ) {
+			journal.inputs[ change.first ] = change.second;
+		}
+	}
+
+	// Applied every tick, so nothing from the devices can creep in
+	InputState state;
+	UnflattenInput( journal.inputs, &state );
+	Input_SetState( &state );
+}
+
+void Journal_EndTick() {
+	if ( journal.mode == JournalMode::IDLE ) {
+		return;
+	}
+
+	unsigned int tick = g_state.sim_ticks - journal.start_tick;
+
+	if ( Journal_IsRecording() ) {
+		int interval = cv_journal_checksum_interval->i_value;
+		if ( interval > 0 && tick % interval == 0 ) {
+			journal.checksums[ tick ] = Journal_GetStateChecksum();
+		}
+		return;
+	}
+
+	auto checksum = journal.checksums.find( tick );
+	if ( checksum != journal.checksums.end() ) {
+		uint32_t cur = Journal_GetStateChecksum();
+		if ( cur != checksum->second ) {
+			// Everything after the first is likely just fallout
+			if ( journal.num_divergences == 0 ) {
+				LogWarn( "Replay diverged at tick %u (%08x, expected %08x)!\n", tick, cur, checksum->second );
+			}
+			journal.num_divergences++;
+		}
+	}
+
+	if ( tick >= journal.end_tick ) {
+		Journal_Stop();
+	}
+}
+
+/////////////////////////////////////////////////////////////
+
+static void RecordCommand( unsigned int argc, char* argv[] ) {
+	if ( argc < 3 ) {
+		LogWarn( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	Journal_Record( argv[ 1 ], argv[ 2 ] );
+}
+
+static void ReplayCommand( unsigned int argc, char* argv[] ) {
+	if ( argc < 2 ) {
+		LogWarn( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	Journal_Replay( argv[ 1 ], argc > 2 && strcmp( argv[ 2 ], "fast" ) == 0 );
+}
+
+static void StopCommand( unsigned int argc, char* argv[] ) {
+	u_unused( argc );
+	u_unused( argv );
+	Journal_Stop();
+}
+
+static void ChecksumCommand( unsigned int argc, char* argv[] ) {
+	u_unused( argc );
+	u_unused( argv );
+	LogInfo( "%08x at tick %u\n", Journal_GetStateChecksum(), g_state.sim_ticks );
+}
+
+void Journal_Initialize() {
+	plRegisterConsoleCommand( "journalRecord", RecordCommand, "Starts the given map and records it, journalRecord <file> <map>" );
+	plRegisterConsoleCommand( "journalReplay", ReplayCommand, "Plays back a recorded journal, add \"fast\" to run it as quick as possible" );
+	plRegisterConsoleCommand( "journalStop", StopCommand, "Stops recording or replaying, writing out the recording" );
+	plRegisterConsoleCommand( "journalChecksum", ChecksumCommand, "Prints out the checksum of the current game state" );
+}
+
+void Journal_Shutdown() {
+	Journal_Stop();
+}
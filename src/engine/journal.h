@@ -0,0 +1,71 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/* A journal holds the map, the random seed and every change to the local
+ * input, keyed by tick, so a game can be played back and come out the same.
+ * A checksum of the game's state goes in every so often, so a replay can
+ * tell if it's drifted from the original.
+ *
+ * The file is a "HOWJ" identifier followed by a varint version, the map name,
+ * the varint seed and then a series of records, each a type byte and a
+ * varint tick counted from the start of the recording.
+ *
+ * INPUT        varint count of changed values, each a varint index gap
+ *              followed by its new value as a signed varint
+ * CHECKSUM     varint checksum of the state at the end of the tick
+ * END          no payload, the last tick recorded
+ */
+
+#define JOURNAL_IDENTIFIER  "HOWJ"
+#define JOURNAL_VERSION     1
+
+enum JournalRecord {
+	JOURNAL_INPUT = 1,
+	JOURNAL_CHECKSUM,
+	JOURNAL_END,
+};
+
+bool Journal_Record( const std::string& path, const std::string& map_name );
+bool Journal_Replay( const std::string& path, bool fast_forward );
+void Journal_Stop();
+
+bool Journal_IsRecording();
+bool Journal_IsReplaying();
+bool Journal_IsFastForwarding();
+// From the replay in progress, or the last one if it's over
+unsigned int Journal_GetNumDivergences();
+
+// Called either side of each simulation tick
+void Journal_BeginTick();
+void Journal_EndTick();
+
+uint32_t Journal_GetStateChecksum();
+
+void Journal_Initialize();
+void Journal_Shutdown();
+
+/************************************************************/
+/* Simulation RNG
+ * Anything that changes the outcome of a game needs to draw from
+ * this rather than rand(), so replays get the same numbers. */
+
+void Sim_SeedRandom( uint32_t seed );
+uint32_t Sim_GetRandomState();
+uint32_t Sim_Random();
+float Sim_RandomFloat( float max );
@@ -0,0 +1,289 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <PL/platform_filesystem.h>
+
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include "engine.h"
+#include "manifest_cache.h"
+#include "profiler.h"
+#include "snapshot.h"
+
+#define MANIFEST_CACHE_IDENTIFIER   "HOWM"
+#define MANIFEST_CACHE_VERSION      2
+#if defined( OPENHOW_BENCHMARK )
+// So the benchmarks and tests leave the game's own cache alone
+#define MANIFEST_CACHE_FILENAME     "manifests_benchmark.cache"
+#elif defined( OPENHOW_TESTS )
+#define MANIFEST_CACHE_FILENAME     "manifests_tests.cache"
+#else
+#define MANIFEST_CACHE_FILENAME     "manifests.cache"
+#endif
+
+#define MANIFEST_MAX_THREADS        8U
+
+struct ManifestEntry {
+	uint64_t size{ 0 };
+	uint64_t hash{ 0 };
+	std::vector<uint8_t> data;
+	std::vector<std::string> warnings;
+	// Only those that are still around get written back out
+	bool is_used{ false };
+};
+
+static std::map<std::string, ManifestEntry> entries;
+static std::string cache_path;
+static bool is_dirty = false;
+
+/* FNV-1a */
+static uint64_t HashText( const std::string& text ) {
+	uint64_t hash = 14695981039346656037ULL;
+	for ( char c : text ) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static bool ReadText( const std::string& path, std::string& out ) {
+	PLFile* file = plOpenFile( path.c_str(), false );
+	if ( file == nullptr ) {
+		return false;
+	}
+
+	out.resize( plGetFileSize( file ) );
+	size_t size = plReadFile( file, &out[ 0 ], 1, out.size() );
+	plCloseFile( file );
+
+	out.resize( size );
+	return true;
+}
+
+static std::vector<std::string>* scan_paths = nullptr;
+
+static void AddScannedPath( const char* path ) {
+	scan_paths->push_back( path );
+}
+
+std::vector<std::string> ManifestCache_Scan( const char* directory, const char* extension ) {
+	std::vector<std::string> paths;
+	scan_paths = &paths;
+	plScanDirectory( directory, extension, AddScannedPath, false );
+	scan_paths = nullptr;
+	return paths;
+}
+
+/**
+ * Parses any of the given manifests that aren't already in the cache, or
+ * that have changed since, and hands back the results in the same order.
+ */
+std::vector<ManifestResult> ManifestCache_Parse( const char* type, const std::vector<std::string>& paths,
+												 ManifestParseFunction parse ) {
+	PROFILE_SCOPE( "Parse Manifests" );
+
+	unsigned int start_ms = System_GetTicks();
+
+	std::vector<ManifestResult> results( paths.size() );
+	std::vector<std::string> texts( paths.size() );
+	std::vector<uint64_t> hashes( paths.size() );
+	std::vector<size_t> misses;
+	for ( size_t i = 0; i < paths.size(); ++i ) {
+		results[ i ].path = paths[ i ];
+		if ( !ReadText( paths[ i ], texts[ i ] ) ) {
+			results[ i ].error = std::string( "Failed to open file (" ) + plGetError() + ")!\n";
+			continue;
+		}
+
+		hashes[ i ] = HashText( texts[ i ] );
+
+		auto entry = entries.find( std::string( type ) + ":" + paths[ i ] );
+		if ( entry != entries.end() && entry->second.size == texts[ i ].size() && entry->second.hash == hashes[ i ] ) {
+			results[ i ].data = entry->second.data;
+			results[ i ].warnings = entry->second.warnings;
+			entry->second.is_used = true;
+			continue;
+		}
+
+		misses.push_back( i );
+	}
+
+	// Everything from here on is only touched by the one thread parsing it
+	std::atomic<size_t> next_miss{ 0 };
+	auto worker = [ & ]() {
+		for ( size_t i = next_miss++; i < misses.size(); i = next_miss++ ) {
+			ManifestResult& result = results[ misses[ i ] ];
+			try {
+				SnapshotWriter writer;
+				parse( result.path, texts[ misses[ i ] ].c_str(), writer, result.warnings );
+				writer.Swap( result.data );
+			} catch ( const std::exception& e ) {
+				result.error = e.what();
+			}
+		}
+	};
+
+	unsigned int num_threads = std::min( std::max( std::thread::hardware_concurrency(), 1U ), MANIFEST_MAX_THREADS );
+	num_threads = std::min( num_threads, static_cast<unsigned int>(misses.size()) );
+	if ( num_threads > 1 ) {
+		std::vector<std::thread> threads;
+		for ( unsigned int i = 0; i < num_threads; ++i ) {
+			threads.emplace_back( worker );
+		}
+		for ( auto& thread : threads ) {
+			thread.join();
+		}
+	} else {
+		worker();
+	}
+
+	for ( auto& i : misses ) {
+		if ( !results[ i ].error.empty() ) {
+			continue;
+		}
+
+		ManifestEntry& entry = entries[ std::string( type ) + ":" + paths[ i ] ];
+		entry.size = texts[ i ].size();
+		entry.hash = hashes[ i ];
+		entry.data = results[ i ].data;
+		entry.warnings = results[ i ].warnings;
+		entry.is_used = true;
+		is_dirty = true;
+	}
+
+	LogInfo( "Registered %u %s manifests, %u from the cache, in %ums\n",
+			 static_cast<unsigned int>(paths.size()), type,
+			 static_cast<unsigned int>(paths.size() - misses.size()), System_GetTicks() - start_ms );
+
+	return results;
+}
+
+bool ManifestCache_Load() {
+	entries.clear();
+
+	std::string buffer;
+	if ( !ReadText( cache_path, buffer ) ) {
+		return false;
+	}
+
+	SnapshotReader reader( reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size() );
+	const uint8_t* identifier = reader.ReadBlock( 4 );
+	if ( identifier == nullptr || memcmp( identifier, MANIFEST_CACHE_IDENTIFIER, 4 ) != 0 ||
+		reader.ReadVarint() != MANIFEST_CACHE_VERSION ||
+		reader.ReadString() != openhow::engine->GetVersionString() ) {
+		LogInfo( "Manifest cache is out of date, discarding\n" );
+		return false;
+	}
+
+	uint64_t num_entries = reader.ReadVarint();
+	for ( uint64_t i = 0; i < num_entries && reader.IsValid(); ++i ) {
+		std::string key = reader.ReadString();
+
+		ManifestEntry entry;
+		entry.size = reader.ReadVarint();
+		entry.hash = reader.ReadVarint();
+
+		size_t size = reader.ReadVarint();
+		const uint8_t* data = reader.ReadBlock( size );
+		if ( data == nullptr ) {
+			break;
+		}
+		entry.data.assign( data, data + size );
+
+		size_t num_warnings = reader.ReadVarint();
+		for ( size_t j = 0; j < num_warnings && reader.IsValid(); ++j ) {
+			entry.warnings.push_back( reader.ReadString() );
+		}
+
+		entries.emplace( key, entry );
+	}
+
+	if ( !reader.IsValid() ) {
+		LogWarn( "Manifest cache is corrupt, discarding!\n" );
+		entries.clear();
+		return false;
+	}
+
+	return true;
+}
+
+void ManifestCache_Save() {
+	if ( !is_dirty ) {
+		return;
+	}
+
+	SnapshotWriter writer;
+	writer.WriteBytes( reinterpret_cast<const uint8_t*>(MANIFEST_CACHE_IDENTIFIER), 4 );
+	writer.WriteVarint( MANIFEST_CACHE_VERSION );
+	writer.WriteString( openhow::engine->GetVersionString() );
+
+	uint64_t num_entries = 0;
+	for ( const auto& entry : entries ) {
+		num_entries += entry.second.is_used ? 1 : 0;
+	}
+
+	writer.WriteVarint( num_entries );
+	for ( const auto& entry : entries ) {
+		if ( !entry.second.is_used ) {
+			continue;
+		}
+
+		writer.WriteString( entry.first );
+		writer.WriteVarint( entry.second.size );
+		writer.WriteVarint( entry.second.hash );
+		writer.WriteVarint( entry.second.data.size() );
+		writer.WriteBytes( entry.second.data.data(), entry.second.data.size() );
+		writer.WriteVarint( entry.second.warnings.size() );
+		for ( const auto& warning : entry.second.warnings ) {
+			writer.WriteString( warning );
+		}
+	}
+
+	std::ofstream output( cache_path, std::ios::binary );
+	output.write( reinterpret_cast<const char*>(writer.GetData()), writer.GetSize() );
+	if ( !output.good() ) {
+		LogWarn( "Failed to write manifest cache, \"%s\"!\n", cache_path.c_str() );
+		return;
+	}
+
+	is_dirty = false;
+}
+
+void ManifestCache_Clear() {
+	entries.clear();
+	is_dirty = true;
+}
+
+void ManifestCache_Initialize() {
+	char out[PL_SYSTEM_MAX_PATH];
+	if ( plGetApplicationDataDirectory( ENGINE_APP_NAME, out, PL_SYSTEM_MAX_PATH ) == nullptr ) {
+		LogWarn( "Failed to get app data directory!\n%s\n", plGetError() );
+		cache_path = "./" MANIFEST_CACHE_FILENAME;
+	} else {
+		cache_path = std::string( out ) + MANIFEST_CACHE_FILENAME;
+	}
+
+	ManifestCache_Load();
+}
+
+void ManifestCache_Shutdown() {
+	ManifestCache_Save();
+	entries.clear();
+}
@@ -0,0 +1,60 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class SnapshotWriter;
+
+/* Keeps what was parsed out of each manifest between runs, in a single
+ * file under the user's data directory, so only those that are new or
+ * have changed need parsing again at startup. Those that do are parsed
+ * on worker threads.
+ *
+ * Entries are matched on the path along with the size and a hash of
+ * the contents, as the files may be coming from a package where there's
+ * no modified time to go by. The whole cache is thrown out whenever the
+ * engine version changes, in case what gets stored for a manifest has.
+ */
+
+// Is handed the text of the manifest, and writes out whatever it needs from it.
+// Runs on a worker thread, and throws a std::exception if the manifest is no good.
+// The console isn't safe to log to from there, so it must only use the silent
+// ScriptConfig getters and add anything worth warning about to the warnings.
+typedef void ( * ManifestParseFunction )( const std::string& path, const char* text, SnapshotWriter& writer,
+										  std::vector<std::string>& warnings );
+
+struct ManifestResult {
+	std::string path;
+	std::vector<uint8_t> data;          // What the parse function wrote
+	std::vector<std::string> warnings;  // For logging on the main thread, kept along with the data
+	std::string error;                  // Set if it failed, in which case there's no data
+};
+
+std::vector<std::string> ManifestCache_Scan( const char* directory, const char* extension );
+std::vector<ManifestResult> ManifestCache_Parse( const char* type, const std::vector<std::string>& paths,
+												 ManifestParseFunction parse );
+
+bool ManifestCache_Load();
+void ManifestCache_Save();
+void ManifestCache_Clear();
+
+void ManifestCache_Initialize();
+void ManifestCache_Shutdown();
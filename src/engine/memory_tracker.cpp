@@ -0,0 +1,287 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <new>
+
+#include "engine.h"
+#include "memory_tracker.h"
+
+static const char* tag_names[ MAX_MEMORY_TAGS ] = {
+	"General",
+	"Terrain",
+	"Models",
+	"Textures",
+	"Audio",
+	"Physics",
+	"Actors",
+	"Script",
+	"Arenas",
+};
+
+const char* Memory_GetTagName( MemoryTag tag ) {
+	u_assert( tag < MAX_MEMORY_TAGS, "Invalid memory tag, %d!\n", tag );
+	return tag_names[ tag ];
+}
+
+#if MEMORY_TRACKING_ENABLED
+
+#define MEMORY_MAGIC    0x4D454D54U     // "MEMT"
+
+/* Sits in front of every allocation, and is the same size as malloc's
+ * alignment so whatever follows it is still suitably aligned */
+struct MemoryHeader {
+	uint32_t magic;
+	uint32_t tag;
+	uint64_t size;
+};
+static_assert( sizeof( MemoryHeader ) == 16, "Unexpected memory header size!" );
+
+struct MemoryCounters {
+	std::atomic<uint64_t> live_bytes;
+	std::atomic<uint64_t> peak_bytes;
+	std::atomic<uint64_t> live_allocations;
+	std::atomic<uint64_t> total_allocations;
+};
+
+/* Zeroed before anything runs, which matters as new can be called
+ * by other static constructors before this file's have been */
+static MemoryCounters counters[ MAX_MEMORY_TAGS ];
+
+static thread_local MemoryTag current_tag = MEMORY_TAG_GENERAL;
+
+static void AddLiveBytes( MemoryTag tag, uint64_t size ) {
+	MemoryCounters* c = &counters[ tag ];
+	uint64_t live = c->live_bytes.fetch_add( size, std::memory_order_relaxed ) + size;
+	uint64_t peak = c->peak_bytes.load( std::memory_order_relaxed );
+	while ( live > peak && !c->peak_bytes.compare_exchange_weak( peak, live, std::memory_order_relaxed ) ) {}
+}
+
+void* Memory_Allocate( size_t size, MemoryTag tag ) {
+	auto* header = static_cast<MemoryHeader*>(malloc( sizeof( MemoryHeader ) + size ));
+	if ( header == nullptr ) {
+		return nullptr;
+	}
+
+	header->magic = MEMORY_MAGIC;
+	header->tag = tag;
+	header->size = size;
+
+	AddLiveBytes( tag, size );
+	counters[ tag ].live_allocations.fetch_add( 1, std::memory_order_relaxed );
+	counters[ tag ].total_allocations.fetch_add( 1, std::memory_order_relaxed );
+
+	return header + 1;
+}
+
+static MemoryHeader* GetHeader( void* ptr ) {
+	MemoryHeader* header = static_cast<MemoryHeader*>(ptr) - 1;
+	u_assert( header->magic == MEMORY_MAGIC, "Invalid or already freed allocation, %p!\n", ptr );
+	return header;
+}
+
+void* Memory_Reallocate( void* ptr, size_t size, MemoryTag tag ) {
+	if ( ptr == nullptr ) {
+		return Memory_Allocate( size, tag );
+	} else if ( size == 0 ) {
+		Memory_Free( ptr );
+		return nullptr;
+	}
+
+	MemoryHeader* header = GetHeader( ptr );
+	uint64_t old_size = header->size;
+
+	// On failure the original is left as it was, so leave the accounting be too
+	header = static_cast<MemoryHeader*>(realloc( header, sizeof( MemoryHeader ) + size ));
+	if ( header == nullptr ) {
+		return nullptr;
+	}
+
+	header->size = size;
+
+	auto header_tag = static_cast<MemoryTag>(header->tag);
+	if ( size > old_size ) {
+		AddLiveBytes( header_tag, size - old_size );
+	} else {
+		counters[ header_tag ].live_bytes.fetch_sub( old_size - size, std::memory_order_relaxed );
+	}
+
+	return header + 1;
+}
+
+void Memory_Free( void* ptr ) {
+	if ( ptr == nullptr ) {
+		return;
+	}
+
+	MemoryHeader* header = GetHeader( ptr );
+	counters[ header->tag ].live_bytes.fetch_sub( header->size, std::memory_order_relaxed );
+	counters[ header->tag ].live_allocations.fetch_sub( 1, std::memory_order_relaxed );
+
+	header->magic = 0;
+	free( header );
+}
+
+MemoryTag Memory_GetCurrentTag() {
+	return current_tag;
+}
+
+MemoryTagScope::MemoryTagScope( MemoryTag tag ) : previous_( current_tag ) {
+	current_tag = tag;
+}
+
+MemoryTagScope::~MemoryTagScope() {
+	current_tag = previous_;
+}
+
+void Memory_GetStats( MemoryTag tag, MemoryStats* out ) {
+	u_assert( tag < MAX_MEMORY_TAGS, "Invalid memory tag, %d!\n", tag );
+
+	const MemoryCounters* c = &counters[ tag ];
+	out->name = tag_names[ tag ];
+	out->live_bytes = c->live_bytes.load( std::memory_order_relaxed );
+	out->peak_bytes = c->peak_bytes.load( std::memory_order_relaxed );
+	out->live_allocations = c->live_allocations.load( std::memory_order_relaxed );
+	out->total_allocations = c->total_allocations.load( std::memory_order_relaxed );
+}
+
+void Memory_ResetPeaks() {
+	for ( auto& c : counters ) {
+		c.peak_bytes.store( c.live_bytes.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	}
+}
+
+/************************************************************/
+/* Everything else goes through these */
+
+void* operator new( size_t size ) {
+	void* ptr = Memory_Allocate( size, current_tag );
+	if ( ptr == nullptr ) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[]( size_t size ) {
+	return operator new( size );
+}
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept {
+	return Memory_Allocate( size, current_tag );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept {
+	return Memory_Allocate( size, current_tag );
+}
+
+void operator delete( void* ptr ) noexcept {
+	Memory_Free( ptr );
+}
+
+void operator delete[]( void* ptr ) noexcept {
+	Memory_Free( ptr );
+}
+
+void operator delete( void* ptr, const std::nothrow_t& ) noexcept {
+	Memory_Free( ptr );
+}
+
+void operator delete[]( void* ptr, const std::nothrow_t& ) noexcept {
+	Memory_Free( ptr );
+}
+
+#else
+
+void* Memory_Allocate( size_t size, MemoryTag tag ) {
+	u_unused( tag );
+	return malloc( size );
+}
+
+void* Memory_Reallocate( void* ptr, size_t size, MemoryTag tag ) {
+	u_unused( tag );
+	return realloc( ptr, size );
+}
+
+void Memory_Free( void* ptr ) {
+	free( ptr );
+}
+
+MemoryTag Memory_GetCurrentTag() { return MEMORY_TAG_GENERAL; }
+
+MemoryTagScope::MemoryTagScope( MemoryTag tag ) : previous_( tag ) {}
+MemoryTagScope::~MemoryTagScope() = default;
+
+void Memory_GetStats( MemoryTag tag, MemoryStats* out ) {
+	*out = MemoryStats();
+	out->name = Memory_GetTagName( tag );
+}
+
+void Memory_ResetPeaks() {}
+
+#endif
+
+/************************************************************/
+
+static void StatsCommand( unsigned int argc, char* argv[] ) {
+#if !MEMORY_TRACKING_ENABLED
+	LogInfo( "Memory tracking was compiled out\n" );
+	return;
+#endif
+
+	if ( argc > 1 && pl_strcasecmp( argv[ 1 ], "reset" ) == 0 ) {
+		Memory_ResetPeaks();
+	}
+
+	LogInfo( "%-10s %12s %12s %10s %12s\n", "tag", "live KB", "peak KB", "live", "total" );
+	for ( unsigned int i = 0; i < MAX_MEMORY_TAGS; ++i ) {
+		MemoryStats stats;
+		Memory_GetStats( static_cast<MemoryTag>(i), &stats );
+		LogInfo( "%-10s %12.1f %12.1f %10llu %12llu\n", stats.name,
+				 stats.live_bytes / 1024.0, stats.peak_bytes / 1024.0,
+				 static_cast<unsigned long long>(stats.live_allocations),
+				 static_cast<unsigned long long>(stats.total_allocations) );
+	}
+}
+
+void Memory_Initialize() {
+	plRegisterConsoleCommand( "memStats", StatsCommand,
+							  "Prints memory use for each subsystem, memStats [reset] to also reset the peaks" );
+}
+
+void Memory_Shutdown() {
+#if MEMORY_TRACKING_ENABLED
+	// General is left out, as there's always something static still hanging onto memory
+	unsigned int num_leaks = 0;
+	for ( unsigned int i = MEMORY_TAG_GENERAL + 1; i < MAX_MEMORY_TAGS; ++i ) {
+		MemoryStats stats;
+		Memory_GetStats( static_cast<MemoryTag>(i), &stats );
+		if ( stats.live_allocations == 0 ) {
+			continue;
+		}
+
+		LogWarn( "%s still holds %llu bytes in %llu allocations (peak was %llu bytes)\n", stats.name,
+				 static_cast<unsigned long long>(stats.live_bytes),
+				 static_cast<unsigned long long>(stats.live_allocations),
+				 static_cast<unsigned long long>(stats.peak_bytes) );
+		num_leaks++;
+	}
+
+	if ( num_leaks == 0 ) {
+		LogInfo( "Nothing left allocated by any subsystem at shutdown\n" );
+	}
+#endif
+}
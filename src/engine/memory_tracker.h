@@ -0,0 +1,93 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Memory accounting, split up by subsystem. Every new and delete goes
+ * through here, and is charged to whichever tag is innermost on the
+ * calling thread, or to MEMORY_TAG_GENERAL if there isn't one. Frees
+ * are always charged back to the tag the allocation was made under.
+ *
+ * Anything allocated with malloc or u_alloc isn't seen, as it's freed
+ * directly, often by the platform library; Memory_Allocate can be used
+ * instead where the code owns both ends, i.e. allocator callbacks.
+ *
+ * Configuring with -DOPENHOW_MEMORY_TRACKING=OFF leaves new and delete
+ * alone, and Memory_Allocate becomes a plain malloc.
+ */
+
+#ifndef MEMORY_TRACKING_ENABLED
+#define MEMORY_TRACKING_ENABLED 1
+#endif
+
+enum MemoryTag {
+	MEMORY_TAG_GENERAL,
+	MEMORY_TAG_TERRAIN,
+	MEMORY_TAG_MODELS,
+	MEMORY_TAG_TEXTURES,
+	MEMORY_TAG_AUDIO,
+	MEMORY_TAG_PHYSICS,
+	MEMORY_TAG_ACTORS,
+	MEMORY_TAG_SCRIPT,
+	MEMORY_TAG_ARENAS,
+
+	MAX_MEMORY_TAGS
+};
+
+struct MemoryStats {
+	const char* name;
+	uint64_t live_bytes;
+	uint64_t peak_bytes;
+	uint64_t live_allocations;
+	uint64_t total_allocations;
+};
+
+void* Memory_Allocate( size_t size, MemoryTag tag );
+// Keeps the tag of the original allocation, the one given is for when ptr is null
+void* Memory_Reallocate( void* ptr, size_t size, MemoryTag tag );
+void Memory_Free( void* ptr );
+
+MemoryTag Memory_GetCurrentTag();
+
+class MemoryTagScope {
+public:
+	explicit MemoryTagScope( MemoryTag tag );
+	~MemoryTagScope();
+
+	MemoryTagScope( const MemoryTagScope& ) = delete;
+	MemoryTagScope& operator=( const MemoryTagScope& ) = delete;
+
+private:
+	MemoryTag previous_;
+};
+
+#define MEMORY_CONCAT_( A, B )  A ## B
+#define MEMORY_CONCAT( A, B )   MEMORY_CONCAT_( A, B )
+
+#define MEMORY_TAG( TAG )       MemoryTagScope MEMORY_CONCAT( memory_tag_, __LINE__ )( TAG )
+
+const char* Memory_GetTagName( MemoryTag tag );
+void Memory_GetStats( MemoryTag tag, MemoryStats* out );
+// Peaks start again from whatever is live now
+void Memory_ResetPeaks();
+
+void Memory_Initialize();
+// Reports anything still held under a subsystem's tag
+void Memory_Shutdown();
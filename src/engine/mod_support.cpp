@@ -18,7 +18,9 @@
 #include <PL/platform_filesystem.h>
 
 #include "engine.h"
+#include "manifest_cache.h"
 #include "mod_support.h"
+#include "snapshot.h"
 #include "script/script_config.h"
 
 using namespace openhow;
@@ -51,30 +53,65 @@ static modDirectory_t* Mod_GetManifest( const std::string& name ) {
 	return nullptr;
 }
 
-static modDirectory_t Mod_LoadManifest( const char* path ) {
+/**
+ * Runs on one of the manifest cache's worker threads,
+ * so shouldn't touch anything beyond the manifest.
+ */
+static void Mod_ParseManifest( const std::string& path, const char* text, SnapshotWriter& writer,
+							   std::vector<std::string>& warnings ) {
+	u_unused( path );
+
+	ScriptConfig config;
+	config.ParseBuffer( text );
+
+	std::string name = config.GetStringProperty( "name", "", true );
+	if ( name.empty() ) {
+		warnings.emplace_back( "No name provided for mod!" );
+	}
+
+	writer.WriteString( name );
+	writer.WriteString( config.GetStringProperty( "version", "Unknown", true ) );
+	writer.WriteString( config.GetStringProperty( "author", "Unknown", true ) );
+	writer.WriteByte( config.GetBooleanProperty( "isVisible", false, true ) );
+
+	std::vector<std::string> dependencies = config.GetArrayStrings( "dependencies", true );
+	writer.WriteVarint( dependencies.size() );
+	for ( const auto& dependency : dependencies ) {
+		writer.WriteString( dependency );
+	}
+}
+
+static void Mod_AddManifest( const ManifestResult& result ) {
+	const char* path = result.path.c_str();
 	LogInfo( "Loading manifest \"%s\"...\n", path );
 
+	if ( !result.error.empty() ) {
+		Error( "Failed to read mod config, \"%s\"!\n%s\n", path, result.error.c_str() );
+	}
+
+	for ( const auto& warning : result.warnings ) {
+		LogWarn( "%s (\"%s\")\n", warning.c_str(), path );
+	}
+
 	modDirectory_t slot;
-	try {
-		ScriptConfig config( path );
-
-		slot.name = config.GetStringProperty( "name" );
-		slot.version = config.GetStringProperty( "version", "Unknown", true );
-		slot.author = config.GetStringProperty( "author", "Unknown", true );
-		slot.isVisible = config.GetBooleanProperty( "isVisible", false, true );
-
-		char filename[64];
-		snprintf( filename, sizeof( filename ), "%s", plGetFileName( path ) );
-		slot.fileName = path;
-		slot.internalName = std::string( filename, strlen( filename ) - 4 );
-		slot.directory = slot.internalName + "/";
-
-		slot.dependencies = config.GetArrayStrings( "dependencies" );
-	} catch ( const std::exception& e ) {
-		Error( "Failed to read mod config, \"%s\"!\n%s\n", path, e.what() );
+	SnapshotReader reader( result.data.data(), result.data.size() );
+	slot.name = reader.ReadString();
+	slot.version = reader.ReadString();
+	slot.author = reader.ReadString();
+	slot.isVisible = reader.ReadByte() != 0;
+
+	size_t num_dependencies = reader.ReadVarint();
+	for ( size_t i = 0; i < num_dependencies && reader.IsValid(); ++i ) {
+		slot.dependencies.push_back( reader.ReadString() );
 	}
 
-	return slot;
+	char filename[64];
+	snprintf( filename, sizeof( filename ), "%s", plGetFileName( path ) );
+	slot.fileName = path;
+	slot.internalName = std::string( filename, strlen( filename ) - 4 );
+	slot.directory = slot.internalName + "/";
+
+	modsList.emplace( slot.internalName, slot );
 }
 
 /**
@@ -82,15 +119,20 @@ static modDirectory_t Mod_LoadManifest( const char* path ) {
  * @param path Path to the manifest file.
  */
 void Mod_RegisterMod( const char* path ) {
-	modDirectory_t mod = Mod_LoadManifest( path );
-	modsList.emplace( mod.internalName, mod );
+	for ( const auto& result : ManifestCache_Parse( "mod", { path }, Mod_ParseManifest ) ) {
+		Mod_AddManifest( result );
+	}
 }
 
 /**
  * Registers all of the mods provided under the mods directory.
  */
 void Mod_RegisterMods() {
-	plScanDirectory( "mods", "mod", Mod_RegisterMod, false );
+	std::vector<ManifestResult> results =
+		ManifestCache_Parse( "mod", ManifestCache_Scan( "mods", "mod" ), Mod_ParseManifest );
+	for ( const auto& result : results ) {
+		Mod_AddManifest( result );
+	}
 }
 
 /**
@@ -20,6 +20,7 @@
 #include <PL/platform_model.h>
 
 #include "engine.h"
+#include "memory_tracker.h"
 #include "model.h"
 #include "loaders/loaders.h"
 
@@ -101,6 +102,8 @@ const char *Model_GetAnimationDescription( unsigned int i ) {
 }
 
 PLModel *Model_LoadVtxFile( const char *path ) {
+	MEMORY_TAG( MEMORY_TAG_MODELS );
+
 	VtxHandle *vtx = Vtx_LoadFile( path );
 	if ( vtx == nullptr ) {
 		LogWarn( "Failed to load Vtx, \"%s\"!\n", path );
@@ -0,0 +1,202 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+#include "../profiler.h"
+
+#include "net.h"
+#include "net_server.h"
+#include "net_client.h"
+
+#define NET_LOOPBACK_SERVER "server"
+
+static NetServer* server = nullptr;
+static NetLagTransport* server_transport = nullptr;
+
+static NetClient* client = nullptr;
+static NetLagTransport* client_transport = nullptr;
+
+static void UpdateLag( NetLagTransport* transport ) {
+	if ( transport == nullptr ) {
+		return;
+	}
+
+	transport->SetLatency( static_cast<unsigned int>(std::max( 0, cv_net_sim_latency->i_value )) );
+	transport->SetLoss( cv_net_sim_loss->f_value );
+}
+
+bool Net_Listen( const std::string& transport ) {
+	if ( server != nullptr ) {
+		LogWarn( "Already hosting a game!\n" );
+		return false;
+	}
+
+	INetTransport* base;
+	if ( transport == "loopback" ) {
+		base = Net_CreateLoopbackTransport( NET_LOOPBACK_SERVER );
+	} else if ( transport == "udp" ) {
+		base = Net_CreateUDPTransport( static_cast<unsigned short>(cv_net_port->i_value) );
+	} else {
+		LogWarn( "Unknown transport, \"%s\"!\n", transport.c_str() );
+		return false;
+	}
+
+	if ( base == nullptr ) {
+		return false;
+	}
+
+	server_transport = new NetLagTransport( base );
+	UpdateLag( server_transport );
+	server = new NetServer( server_transport );
+
+	LogInfo( "Hosting over %s\n", transport.c_str() );
+	return true;
+}
+
+bool Net_Connect( const std::string& address ) {
+	if ( client != nullptr ) {
+		LogWarn( "Already connected to a game!\n" );
+		return false;
+	}
+
+	INetTransport* base;
+	std::string server_address = address;
+	if ( address == "loopback" ) {
+		base = Net_CreateLoopbackTransport( "client" );
+		server_address = NET_LOOPBACK_SERVER;
+	} else {
+		// Any free port will do
+		base = Net_CreateUDPTransport( 0 );
+	}
+
+	if ( base == nullptr ) {
+		return false;
+	}
+
+	client_transport = new NetLagTransport( base );
+	UpdateLag( client_transport );
+	client = new NetClient( client_transport, server_address, server != nullptr );
+	if ( client->GetState() == NetClient::State::DISCONNECTED ) {
+		Net_Disconnect();
+		return false;
+	}
+
+	LogInfo( "Connecting to %s...\n", address.c_str() );
+	return true;
+}
+
+void Net_Disconnect() {
+	// Transports belong to whatever they were handed to
+	delete client;
+	client = nullptr;
+	client_transport = nullptr;
+
+	delete server;
+	server = nullptr;
+	server_transport = nullptr;
+}
+
+NetServer* Net_GetServer() {
+	return server;
+}
+
+NetClient* Net_GetClient() {
+	return client;
+}
+
+void Net_ReadPackets() {
+	PROFILE_SCOPE( "Net Read" );
+
+	UpdateLag( server_transport );
+	UpdateLag( client_transport );
+
+	if ( server != nullptr ) {
+		server->ReadPackets();
+	}
+
+	if ( client != nullptr ) {
+		client->ReadPackets();
+	}
+}
+
+void Net_SendPackets() {
+	PROFILE_SCOPE( "Net Send" );
+
+	if ( server != nullptr ) {
+		server->SendPackets();
+	}
+
+	if ( client != nullptr ) {
+		client->SendPackets();
+	}
+}
+
+/////////////////////////////////////////////////////////////
+
+static void ListenCommand( unsigned int argc, char* argv[] ) {
+	Net_Listen( argc > 1 ? argv[ 1 ] : "udp" );
+}
+
+static void ConnectCommand( unsigned int argc, char* argv[] ) {
+	if ( argc < 2 ) {
+		LogWarn( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	Net_Connect( argv[ 1 ] );
+}
+
+static void DisconnectCommand( unsigned int argc, char* argv[] ) {
+	u_unused( argc );
+	u_unused( argv );
+	Net_Disconnect();
+}
+
+static void StatusCommand( unsigned int argc, char* argv[] ) {
+	u_unused( argc );
+	u_unused( argv );
+
+	if ( server != nullptr ) {
+		LogInfo( "Server: %u clients, last snapshot %u bytes\n",
+				 server->GetNumClients(), static_cast<unsigned int>(server->GetLastSnapshotSize()) );
+	}
+
+	if ( client != nullptr ) {
+		static const char* states[] = { "connecting", "connected", "disconnected" };
+		LogInfo( "Client: %s, %u replicas, last snapshot at tick %u\n",
+				 states[ static_cast<int>(client->GetState()) ],
+				 static_cast<unsigned int>(client->GetReplicas().size()),
+				 client->GetLastSnapshotTick() );
+	}
+
+	if ( server == nullptr && client == nullptr ) {
+		LogInfo( "Not connected\n" );
+	}
+}
+
+void Net_Initialize() {
+	plRegisterConsoleCommand( "netListen", ListenCommand, "Hosts a game over the given transport, loopback or udp" );
+	plRegisterConsoleCommand( "netConnect", ConnectCommand, "Connects to a game, either loopback or host:port" );
+	plRegisterConsoleCommand( "netDisconnect", DisconnectCommand, "Stops hosting or leaves the current game" );
+	plRegisterConsoleCommand( "netStatus", StatusCommand, "Prints out the state of any connections" );
+}
+
+void Net_Shutdown() {
+	Net_Disconnect();
+}
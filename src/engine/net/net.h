@@ -0,0 +1,37 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+class NetServer;
+class NetClient;
+
+void Net_Initialize();
+void Net_Shutdown();
+
+// Called either side of the game tick
+void Net_ReadPackets();
+void Net_SendPackets();
+
+// Transport is either "loopback" or "udp"
+bool Net_Listen( const std::string& transport );
+// Address is either "loopback" or "host:port"
+bool Net_Connect( const std::string& address );
+void Net_Disconnect();
+
+NetServer* Net_GetServer();
+NetClient* Net_GetClient();
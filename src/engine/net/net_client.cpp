@@ -0,0 +1,295 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <set>
+
+#include "../engine.h"
+
+#include "../game/actor_manager.h"
+
+#include "net_protocol.h"
+#include "net_client.h"
+
+using namespace openhow;
+
+NetClient::NetClient( INetTransport* transport, const std::string& address, bool is_server_local ) :
+	transport_( transport ), is_server_local_( is_server_local ), last_heard_( g_state.sim_ticks ) {
+	u_assert( transport_ != nullptr, "Attempted to start a client without a transport!\n" );
+
+	server_ = transport_->Resolve( address );
+	if ( server_ == NET_INVALID_PEER ) {
+		LogWarn( "Failed to find server at \"%s\"!\n", address.c_str() );
+		state_ = State::DISCONNECTED;
+	}
+}
+
+NetClient::~NetClient() {
+	if ( state_ != State::DISCONNECTED ) {
+		uint8_t message = NET_MSG_DISCONNECT;
+		transport_->Send( server_, &message, 1 );
+	}
+
+	DestroyReplicas();
+
+	delete transport_;
+}
+
+Actor* NetClient::CreateReplica( const std::string& class_name ) {
+	if ( is_server_local_ ) {
+		return ActorManager::ConstructActor( class_name );
+	}
+
+	return ActorManager::GetInstance()->CreateActor( class_name );
+}
+
+void NetClient::DestroyReplica( unsigned int id ) {
+	auto i = replicas_.find( id );
+	if ( i == replicas_.end() ) {
+		return;
+	}
+
+	if ( is_server_local_ ) {
+		delete i->second;
+	} else {
+		ActorManager::GetInstance()->DestroyActor( i->second );
+	}
+
+	replicas_.erase( i );
+}
+
+void NetClient::DestroyReplicas() {
+	while ( !replicas_.empty() ) {
+		DestroyReplica( replicas_.begin()->first );
+	}
+}
+
+void NetClient::HandleAccept( SnapshotReader& reader ) {
+	unsigned int player_index = static_cast<unsigned int>(reader.ReadVarint());
+	std::string map_name = reader.ReadString();
+	if ( !reader.IsValid() || state_ != State::CONNECTING ) {
+		return;
+	}
+
+	state_ = State::CONNECTED;
+	is_spectating_ = ( player_index == 0 );
+
+	LogInfo( "Connected to server (%s)\n", is_spectating_ ? "spectating" : "playing" );
+
+	// The map's static, so it's loaded up front rather than being replicated
+	if ( !is_server_local_ && !map_name.empty() ) {
+		Engine::Game()->LoadMap( map_name );
+	}
+}
+
+/**
+ * Applies the snapshot, or returns false if it's stale or malformed,
+ * in which case it isn't acked and the server will try again.
+ */
+bool NetClient::HandleSnapshot( SnapshotReader& reader ) {
+	unsigned int tick = static_cast<unsigned int>(reader.ReadVarint());
+	unsigned int baseline = static_cast<unsigned int>(reader.ReadVarint());
+	if ( !reader.IsValid() || tick <= last_snapshot_tick_ || baseline > last_snapshot_tick_ ) {
+		return false;
+	}
+
+	unsigned int num_destroyed = static_cast<unsigned int>(reader.ReadVarint());
+	for ( unsigned int i = 0; i < num_destroyed && reader.IsValid(); ++i ) {
+		DestroyReplica( static_cast<unsigned int>(reader.ReadVarint()) );
+	}
+
+	std::set<unsigned int> present;
+
+	unsigned int num_actors = static_cast<unsigned int>(reader.ReadVarint());
+	for ( unsigned int i = 0; i < num_actors && reader.IsValid(); ++i ) {
+		unsigned int id = static_cast<unsigned int>(reader.ReadVarint());
+		bool is_new = reader.ReadByte() != 0;
+
+		Actor* actor = nullptr;
+		auto replica = replicas_.find( id );
+		if ( replica != replicas_.end() ) {
+			actor = replica->second;
+		}
+
+		if ( is_new ) {
+			// Could be a resend of one we already have, if our ack went astray
+			std::string class_name = reader.ReadString();
+			if ( actor != nullptr && class_name != actor->GetSpawnClassName() ) {
+				DestroyReplica( id );
+				actor = nullptr;
+			}
+
+			if ( actor == nullptr && reader.IsValid() ) {
+				actor = CreateReplica( class_name );
+				if ( actor != nullptr ) {
+					replicas_.insert( std::make_pair( id, actor ) );
+				}
+			}
+		}
+
+		// Without the actor there's no way to know how much to skip
+		if ( actor == nullptr || !actor->ReadSnapshot( reader ) ) {
+			reader.Invalidate();
+			break;
+		}
+
+		present.insert( id );
+	}
+
+	if ( !reader.IsValid() ) {
+		LogWarn( "Discarded malformed snapshot for tick %d!\n", tick );
+		return false;
+	}
+
+	// A full snapshot has everything, so whatever's missing is gone
+	if ( baseline == 0 ) {
+		for ( auto i = replicas_.begin(); i != replicas_.end(); ) {
+			auto next = std::next( i );
+			if ( present.find( i->first ) == present.end() ) {
+				DestroyReplica( i->first );
+			}
+			i = next;
+		}
+	}
+
+	last_snapshot_tick_ = tick;
+	return true;
+}
+
+/**
+ * Holds on to the pieces of a snapshot until there's all of them.
+ * Only the newest is kept, as an older one would be stale by the
+ * time it was finished anyway.
+ */
+void NetClient::HandleFragment( const NetPacket& packet, SnapshotReader& reader ) {
+	unsigned int tick = static_cast<unsigned int>(reader.ReadVarint());
+	unsigned int index = static_cast<unsigned int>(reader.ReadVarint());
+	unsigned int num_fragments = static_cast<unsigned int>(reader.ReadVarint());
+	if ( !reader.IsValid() || reader.IsAtEnd() || num_fragments > NET_MAX_FRAGMENTS || index >= num_fragments ||
+		tick <= last_snapshot_tick_ || tick < fragment_tick_ ) {
+		return;
+	}
+
+	if ( tick != fragment_tick_ || fragments_.size() != num_fragments ) {
+		fragment_tick_ = tick;
+		fragments_.assign( num_fragments, std::vector<uint8_t>() );
+		num_fragments_received_ = 0;
+	}
+
+	std::vector<uint8_t>& fragment = fragments_[ index ];
+	if ( !fragment.empty() ) {
+		return;
+	}
+
+	fragment.assign( packet.data.begin() + reader.GetOffset(), packet.data.end() );
+	if ( ++num_fragments_received_ < num_fragments ) {
+		return;
+	}
+
+	std::vector<uint8_t> snapshot;
+	for ( const auto& i : fragments_ ) {
+		snapshot.insert( snapshot.end(), i.begin(), i.end() );
+	}
+	fragments_.clear();
+	num_fragments_received_ = 0;
+
+	SnapshotReader snapshot_reader( snapshot.data(), snapshot.size() );
+	if ( snapshot_reader.ReadByte() == NET_MSG_SNAPSHOT ) {
+		HandleSnapshot( snapshot_reader );
+	}
+}
+
+void NetClient::ReadPackets() {
+	if ( state_ == State::DISCONNECTED ) {
+		return;
+	}
+
+	NetPacket packet;
+	while ( transport_->Receive( &packet ) ) {
+		if ( packet.peer != server_ || packet.data.empty() ) {
+			continue;
+		}
+
+		last_heard_ = g_state.sim_ticks;
+
+		SnapshotReader reader( packet.data.data(), packet.data.size() );
+		switch ( reader.ReadByte() ) {
+			case NET_MSG_ACCEPT:
+				HandleAccept( reader );
+				break;
+			case NET_MSG_SNAPSHOT:
+				if ( state_ == State::CONNECTED ) {
+					HandleSnapshot( reader );
+				}
+				break;
+			case NET_MSG_FRAGMENT:
+				if ( state_ == State::CONNECTED ) {
+					HandleFragment( packet, reader );
+				}
+				break;
+			case NET_MSG_DISCONNECT:
+				LogInfo( "Disconnected by server\n" );
+				state_ = State::DISCONNECTED;
+				return;
+			default:
+				break;
+		}
+	}
+
+	if ( g_state.sim_ticks - last_heard_ > NET_TIMEOUT ) {
+		LogInfo( "Timed out waiting for server\n" );
+		state_ = State::DISCONNECTED;
+	}
+}
+
+void NetClient::SendPackets() {
+	if ( state_ == State::DISCONNECTED ) {
+		return;
+	}
+
+	SnapshotWriter writer;
+	if ( state_ == State::CONNECTING ) {
+		if ( last_connect_attempt_ != 0 && g_state.sim_ticks - last_connect_attempt_ < NET_CONNECT_RETRY ) {
+			return;
+		}
+
+		last_connect_attempt_ = g_state.sim_ticks;
+
+		writer.WriteByte( NET_MSG_CONNECT );
+		writer.WriteVarint( NET_PROTOCOL_VERSION );
+		transport_->Send( server_, writer.GetData(), writer.GetSize() );
+		return;
+	}
+
+	player_.SetCommand( player_.SampleCommand() );
+	commands_.push_front( player_.GetCommand() );
+	if ( commands_.size() > NET_COMMAND_REDUNDANCY ) {
+		commands_.pop_back();
+	}
+
+	// Doubles as our ack, so it goes out even while spectating
+	writer.WriteByte( NET_MSG_COMMAND );
+	writer.WriteVarint( last_snapshot_tick_ );
+	writer.WriteVarint( commands_.size() );
+	for ( const auto& command : commands_ ) {
+		writer.WriteVarint( command.sequence );
+		writer.WriteQuantised( command.forward, NET_COMMAND_PRECISION );
+		writer.WriteQuantised( command.yaw, NET_COMMAND_PRECISION );
+		writer.WriteQuantised( command.pitch, NET_COMMAND_PRECISION );
+	}
+
+	transport_->Send( server_, writer.GetData(), writer.GetSize() );
+}
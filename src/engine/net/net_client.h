@@ -0,0 +1,85 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../game/player.h"
+
+#include "net_transport.h"
+
+class Actor;
+class SnapshotReader;
+
+/**
+ * Sends the local player's commands off to a server and mirrors the
+ * actors it sends back. Replicas are never ticked; they only change
+ * when a snapshot says so.
+ */
+class NetClient {
+public:
+	enum class State {
+		CONNECTING,
+		CONNECTED,
+		DISCONNECTED,
+	};
+
+	// Takes ownership of the transport. If the server is in the same
+	// process, replicas are kept to ourselves rather than being handed
+	// to the actor manager, where they'd be mixed up with the originals.
+	NetClient( INetTransport* transport, const std::string& address, bool is_server_local );
+	~NetClient();
+
+	void ReadPackets();
+	void SendPackets();
+
+	State GetState() const { return state_; }
+	bool IsSpectating() const { return is_spectating_; }
+
+	// Replicas, keyed by their id on the server
+	const std::map<unsigned int, Actor*>& GetReplicas() const { return replicas_; }
+	unsigned int GetLastSnapshotTick() const { return last_snapshot_tick_; }
+
+private:
+	void HandleAccept( SnapshotReader& reader );
+	bool HandleSnapshot( SnapshotReader& reader );
+	void HandleFragment( const NetPacket& packet, SnapshotReader& reader );
+
+	Actor* CreateReplica( const std::string& class_name );
+	void DestroyReplica( unsigned int id );
+	void DestroyReplicas();
+
+	INetTransport* transport_;
+	NetPeer server_{ NET_INVALID_PEER };
+
+	State state_{ State::CONNECTING };
+	bool is_server_local_;
+	bool is_spectating_{ true };
+
+	unsigned int last_heard_;
+	unsigned int last_connect_attempt_{ 0 };
+
+	unsigned int last_snapshot_tick_{ 0 };  // Server tick, zero until the first arrives
+	std::map<unsigned int, Actor*> replicas_;
+
+	// Pieces of the latest snapshot that was too large for one packet
+	unsigned int fragment_tick_{ 0 };
+	std::vector<std::vector<uint8_t>> fragments_;
+	unsigned int num_fragments_received_{ 0 };
+
+	Player player_{ PlayerType::LOCAL };
+	std::deque<PlayerCommand> commands_;  // Newest first
+};
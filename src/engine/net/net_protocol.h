@@ -0,0 +1,61 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/* Every packet starts with a single byte giving its type.
+ *
+ * CONNECT      client -> server, varint protocol version; resent until accepted
+ * ACCEPT       server -> client, varint player index (0 for a spectator, otherwise
+ *              index + 1) and the name of the current map
+ * COMMAND      client -> server, varint tick of the last snapshot applied (0 for
+ *              none), then a varint count of the most recent commands, newest first,
+ *              each a varint sequence followed by quantised forward, yaw and pitch
+ * SNAPSHOT     server -> client, varint tick, varint baseline (0 for a full snapshot),
+ *              varint count of destroyed actor ids, the ids, then a varint count of
+ *              actors; each is a varint id, a byte that's 1 if it's new followed by
+ *              its class name if so, and then its properties
+ * DISCONNECT   either way, no payload
+ * FRAGMENT     server -> client, varint tick, varint index and varint count, then that
+ *              piece of a SNAPSHOT too large for a single packet, type and all; it's
+ *              only applied once every piece has arrived
+ *
+ * There's no reliable channel; snapshots carry everything that's changed since the
+ * last one the client acked, so anything lost is simply sent again.
+ */
+
+#define NET_PROTOCOL_VERSION    2
+#define NET_TIMEOUT             ( TICKS_PER_SECOND * 10 )
+#define NET_CONNECT_RETRY       ( TICKS_PER_SECOND / 2 )
+#define NET_COMMAND_REDUNDANCY  4       // Commands repeated in each packet, to ride out loss
+#define NET_COMMAND_PRECISION   ( 1.0f / 256 )
+#define NET_FRAGMENT_SIZE       ( NET_MAX_PACKET_SIZE - 16 )    // Leaves room for the fragment's header
+#define NET_MAX_FRAGMENTS       64
+
+enum NetMessage {
+	NET_MSG_CONNECT = 1,
+	NET_MSG_ACCEPT,
+	NET_MSG_COMMAND,
+	NET_MSG_SNAPSHOT,
+	NET_MSG_DISCONNECT,
+	NET_MSG_FRAGMENT,
+};
+
+// Properties with these flags never leave the server
+#define NET_EXCLUDE_FLAGS       ( PROP_LOCAL )
+// and changes to these go out at once, regardless of the snapshot interval
+#define NET_IMMEDIATE_FLAGS     ( PROP_IMMEDIATE | PROP_PUSH )
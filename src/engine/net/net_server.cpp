@@ -0,0 +1,349 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+#include "../Map.h"
+
+#include "../game/actor_manager.h"
+#include "../game/player.h"
+
+#include "net_protocol.h"
+#include "net_server.h"
+
+using namespace openhow;
+
+NetServer::NetServer( INetTransport* transport ) : transport_( transport ) {
+	u_assert( transport_ != nullptr, "Attempted to start a server without a transport!\n" );
+}
+
+NetServer::~NetServer() {
+	uint8_t message = NET_MSG_DISCONNECT;
+	for ( const auto& client : clients_ ) {
+		transport_->Send( client.peer, &message, 1 );
+	}
+
+	delete transport_;
+}
+
+NetServer::Client* NetServer::GetClient( NetPeer peer ) {
+	for ( auto& client : clients_ ) {
+		if ( client.peer == peer ) {
+			return &client;
+		}
+	}
+
+	return nullptr;
+}
+
+Player* NetServer::GetClientPlayer( const Client& client ) {
+	if ( client.player_index == 0 ) {
+		return nullptr;
+	}
+
+	// Players belong to the game, so they may have gone with the last mode
+	Player* player = Engine::Game()->GetPlayerByIndex( client.player_index - 1 );
+	if ( player == nullptr || player->GetType() != PlayerType::NETWORKED ) {
+		return nullptr;
+	}
+
+	return player;
+}
+
+/**
+ * Hands the client the first networked player nobody else has, if
+ * there is one; otherwise they're left spectating.
+ */
+void NetServer::ClaimPlayer( Client* client ) {
+	if ( GetClientPlayer( *client ) != nullptr ) {
+		return;
+	}
+
+	client->player_index = 0;
+
+	const PlayerPtrVector& players = Engine::Game()->GetPlayers();
+	for ( unsigned int i = 0; i < players.size(); ++i ) {
+		if ( players[ i ]->GetType() != PlayerType::NETWORKED ) {
+			continue;
+		}
+
+		bool is_claimed = false;
+		for ( const auto& other : clients_ ) {
+			if ( other.player_index == i + 1 ) {
+				is_claimed = true;
+				break;
+			}
+		}
+
+		if ( !is_claimed ) {
+			client->player_index = i + 1;
+			return;
+		}
+	}
+}
+
+void NetServer::SendAccept( const Client& client ) {
+	std::string map_name;
+	Map* map = Engine::Game()->GetCurrentMap();
+	if ( map != nullptr ) {
+		map_name = map->GetManifest()->filename;
+	}
+
+	SnapshotWriter writer;
+	writer.WriteByte( NET_MSG_ACCEPT );
+	writer.WriteVarint( client.player_index );
+	writer.WriteString( map_name );
+	transport_->Send( client.peer, writer.GetData(), writer.GetSize() );
+}
+
+void NetServer::HandleConnect( NetPeer peer, SnapshotReader& reader ) {
+	uint64_t version = reader.ReadVarint();
+	if ( !reader.IsValid() || version != NET_PROTOCOL_VERSION ) {
+		LogWarn( "Rejected client with protocol version %d!\n", static_cast<int>(version) );
+		uint8_t message = NET_MSG_DISCONNECT;
+		transport_->Send( peer, &message, 1 );
+		return;
+	}
+
+	// They're resent until accepted, so might already be here
+	Client* client = GetClient( peer );
+	if ( client == nullptr ) {
+		clients_.push_back( { peer, 0, 0, 0, g_state.sim_ticks } );
+		client = &clients_.back();
+		ClaimPlayer( client );
+
+		LogInfo( "Client %d connected (%s)\n", peer,
+				 client->player_index != 0 ? "playing" : "spectating" );
+	}
+
+	SendAccept( *client );
+}
+
+void NetServer::HandleCommand( Client* client, SnapshotReader& reader ) {
+	unsigned int ack_tick = static_cast<unsigned int>(reader.ReadVarint());
+	unsigned int num_commands = static_cast<unsigned int>(reader.ReadVarint());
+	if ( !reader.IsValid() || num_commands > NET_COMMAND_REDUNDANCY ) {
+		return;
+	}
+
+	// Packets can arrive out of order, so only ever move forwards
+	if ( ack_tick > client->ack_tick && ack_tick <= g_state.sim_ticks ) {
+		client->ack_tick = ack_tick;
+	}
+
+	// Newest comes first, and that's the only one the game cares about
+	PlayerCommand command;
+	for ( unsigned int i = 0; i < num_commands; ++i ) {
+		PlayerCommand cur;
+		cur.sequence = static_cast<unsigned int>(reader.ReadVarint());
+		cur.forward = reader.ReadQuantised( NET_COMMAND_PRECISION );
+		cur.yaw = reader.ReadQuantised( NET_COMMAND_PRECISION );
+		cur.pitch = reader.ReadQuantised( NET_COMMAND_PRECISION );
+		if ( i == 0 ) {
+			command = cur;
+		}
+	}
+
+	if ( !reader.IsValid() || num_commands == 0 || command.sequence <= client->last_sequence ) {
+		return;
+	}
+
+	client->last_sequence = command.sequence;
+
+	// Modes may have started since they connected
+	ClaimPlayer( client );
+
+	Player* player = GetClientPlayer( *client );
+	if ( player != nullptr ) {
+		command.forward = std::max( -1.0f, std::min( command.forward, 1.0f ) );
+		command.yaw = std::max( -1.0f, std::min( command.yaw, 1.0f ) );
+		command.pitch = std::max( -1.0f, std::min( command.pitch, 1.0f ) );
+		player->SetCommand( command );
+	}
+}
+
+void NetServer::DropClient( NetPeer peer ) {
+	for ( auto i = clients_.begin(); i != clients_.end(); ++i ) {
+		if ( i->peer == peer ) {
+			LogInfo( "Client %d disconnected\n", peer );
+			clients_.erase( i );
+			return;
+		}
+	}
+}
+
+void NetServer::ReadPackets() {
+	NetPacket packet;
+	while ( transport_->Receive( &packet ) ) {
+		if ( packet.data.empty() ) {
+			continue;
+		}
+
+		SnapshotReader reader( packet.data.data(), packet.data.size() );
+		uint8_t message = reader.ReadByte();
+		if ( message == NET_MSG_CONNECT ) {
+			HandleConnect( packet.peer, reader );
+			continue;
+		}
+
+		Client* client = GetClient( packet.peer );
+		if ( client == nullptr ) {
+			continue;
+		}
+
+		client->last_heard = g_state.sim_ticks;
+
+		switch ( message ) {
+			case NET_MSG_COMMAND:
+				HandleCommand( client, reader );
+				break;
+			case NET_MSG_DISCONNECT:
+				DropClient( packet.peer );
+				break;
+			default:
+				break;
+		}
+	}
+
+	for ( auto i = clients_.begin(); i != clients_.end(); ) {
+		if ( g_state.sim_ticks - i->last_heard > NET_TIMEOUT ) {
+			LogInfo( "Client %d timed out\n", i->peer );
+			i = clients_.erase( i );
+		} else {
+			++i;
+		}
+	}
+}
+
+/**
+ * Writes out everything that's changed after the baseline tick, or
+ * everything there is if the baseline is zero.
+ */
+void NetServer::BuildSnapshot( SnapshotWriter& writer, unsigned int baseline ) {
+	ActorManager* manager = ActorManager::GetInstance();
+
+	writer.WriteByte( NET_MSG_SNAPSHOT );
+	writer.WriteVarint( g_state.sim_ticks );
+	writer.WriteVarint( baseline );
+
+	if ( baseline == 0 ) {
+		writer.WriteVarint( 0 );
+	} else {
+		const auto& destroyed = manager->GetDestroyedActors();
+		auto first = std::find_if( destroyed.begin(), destroyed.end(), [ baseline ]( const ActorManager::DestroyedActor& actor ) {
+			return actor.tick > baseline;
+		} );
+		writer.WriteVarint( std::distance( first, destroyed.end() ) );
+		for ( auto i = first; i != destroyed.end(); ++i ) {
+			writer.WriteVarint( i->id );
+		}
+	}
+
+	SnapshotWriter actors;
+	unsigned int num_actors = 0;
+	for ( auto actor : manager->GetActors() ) {
+		bool is_new = ( baseline == 0 || actor->GetSpawnTick() > baseline );
+		if ( !is_new && !actor->HasChangesSince( baseline, NET_EXCLUDE_FLAGS ) ) {
+			continue;
+		}
+
+		actors.WriteVarint( actor->GetId() );
+		actors.WriteByte( is_new ? 1 : 0 );
+		if ( is_new ) {
+			actors.WriteString( actor->GetSpawnClassName() );
+		}
+		actor->WriteSnapshot( actors, is_new ? SNAPSHOT_FULL : baseline, NET_EXCLUDE_FLAGS );
+		num_actors++;
+	}
+
+	writer.WriteVarint( num_actors );
+	writer.WriteBytes( actors.GetData(), actors.GetSize() );
+}
+
+void NetServer::SendPackets() {
+	if ( clients_.empty() ) {
+		return;
+	}
+
+	// Hold off until the interval's up, unless something urgent changed
+	unsigned int interval = static_cast<unsigned int>(std::max( 1, cv_net_snapshot_interval->i_value ));
+	if ( g_state.sim_ticks - last_snapshot_tick_ < interval ) {
+		bool is_urgent = false;
+		for ( auto actor : ActorManager::GetInstance()->GetActors() ) {
+			if ( actor->HasChangesSince( last_snapshot_tick_, NET_EXCLUDE_FLAGS, NET_IMMEDIATE_FLAGS ) ) {
+				is_urgent = true;
+				break;
+			}
+		}
+
+		if ( !is_urgent ) {
+			return;
+		}
+	}
+
+	last_snapshot_tick_ = g_state.sim_ticks;
+
+	// Clients that are in step share the same snapshot
+	std::map<unsigned int, SnapshotWriter> snapshots;
+	for ( const auto& client : clients_ ) {
+		unsigned int baseline = client.ack_tick;
+		if ( baseline != 0 && baseline < ActorManager::GetInstance()->GetDestroyedHistoryStart() ) {
+			baseline = 0;
+		}
+
+		auto i = snapshots.find( baseline );
+		if ( i == snapshots.end() ) {
+			i = snapshots.insert( std::make_pair( baseline, SnapshotWriter() ) ).first;
+			BuildSnapshot( i->second, baseline );
+		}
+
+		last_snapshot_size_ = i->second.GetSize();
+		SendSnapshot( client, i->second );
+	}
+}
+
+/**
+ * Snapshots too large for a single packet go out in pieces, and if
+ * any of them are lost, the client doesn't ack it, so what's in it
+ * is sent again with the next, the same as if it'd been lost whole.
+ */
+void NetServer::SendSnapshot( const Client& client, const SnapshotWriter& snapshot ) {
+	if ( snapshot.GetSize() <= NET_MAX_PACKET_SIZE ) {
+		transport_->Send( client.peer, snapshot.GetData(), snapshot.GetSize() );
+		return;
+	}
+
+	size_t num_fragments = ( snapshot.GetSize() + NET_FRAGMENT_SIZE - 1 ) / NET_FRAGMENT_SIZE;
+	if ( num_fragments > NET_MAX_FRAGMENTS ) {
+		LogWarn( "Snapshot for client %d is too large, %u bytes!\n", client.peer, static_cast<unsigned int>(snapshot.GetSize()) );
+		return;
+	}
+
+	for ( size_t i = 0; i < num_fragments; ++i ) {
+		size_t offset = i * NET_FRAGMENT_SIZE;
+		size_t size = std::min( snapshot.GetSize() - offset, static_cast<size_t>(NET_FRAGMENT_SIZE) );
+
+		SnapshotWriter writer;
+		writer.WriteByte( NET_MSG_FRAGMENT );
+		writer.WriteVarint( g_state.sim_ticks );
+		writer.WriteVarint( i );
+		writer.WriteVarint( num_fragments );
+		writer.WriteBytes( snapshot.GetData() + offset, size );
+		transport_->Send( client.peer, writer.GetData(), writer.GetSize() );
+	}
+}
@@ -0,0 +1,71 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "net_transport.h"
+
+class Player;
+class SnapshotReader;
+class SnapshotWriter;
+
+/**
+ * Authoritative side of a game. Commands from clients are handed to
+ * the networked players they've claimed, and the state of every actor
+ * goes back out as snapshots relative to whatever each client last
+ * acknowledged.
+ */
+class NetServer {
+public:
+	// Takes ownership of the transport
+	explicit NetServer( INetTransport* transport );
+	~NetServer();
+
+	void ReadPackets();   // Before the game ticks
+	void SendPackets();   // After the game ticks
+
+	unsigned int GetNumClients() const { return static_cast<unsigned int>(clients_.size()); }
+	size_t GetLastSnapshotSize() const { return last_snapshot_size_; }
+
+private:
+	struct Client {
+		NetPeer peer;
+		unsigned int player_index;  // Zero for spectators, otherwise index + 1
+		unsigned int ack_tick;      // Snapshot the client last applied, zero for none
+		unsigned int last_sequence;
+		unsigned int last_heard;
+	};
+
+	Client* GetClient( NetPeer peer );
+	Player* GetClientPlayer( const Client& client );
+	void ClaimPlayer( Client* client );
+
+	void HandleConnect( NetPeer peer, SnapshotReader& reader );
+	void HandleCommand( Client* client, SnapshotReader& reader );
+	void DropClient( NetPeer peer );
+
+	void BuildSnapshot( SnapshotWriter& writer, unsigned int baseline );
+	void SendSnapshot( const Client& client, const SnapshotWriter& snapshot );
+	void SendAccept( const Client& client );
+
+	INetTransport* transport_;
+
+	std::vector<Client> clients_;
+
+	unsigned int last_snapshot_tick_{ 0 };
+	size_t last_snapshot_size_{ 0 };
+};
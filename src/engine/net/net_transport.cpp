@@ -0,0 +1,136 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+
+#include "net_transport.h"
+
+/////////////////////////////////////////////////////////////
+// Loopback
+
+class NetLoopbackTransport : public INetTransport {
+public:
+	explicit NetLoopbackTransport( const std::string& name );
+	~NetLoopbackTransport() override;
+
+	NetPeer Resolve( const std::string& address ) override;
+
+	void Send( NetPeer peer, const uint8_t* data, size_t size ) override;
+	bool Receive( NetPacket* packet ) override;
+
+private:
+	static std::map<NetPeer, NetLoopbackTransport*> endpoints_;
+	static NetPeer next_peer_;
+
+	std::string name_;
+	NetPeer peer_;
+
+	std::deque<NetPacket> incoming_;
+};
+
+std::map<NetPeer, NetLoopbackTransport*> NetLoopbackTransport::endpoints_;
+NetPeer NetLoopbackTransport::next_peer_ = 1;
+
+NetLoopbackTransport::NetLoopbackTransport( const std::string& name ) : name_( name ), peer_( next_peer_++ ) {
+	endpoints_.insert( std::make_pair( peer_, this ) );
+}
+
+NetLoopbackTransport::~NetLoopbackTransport() {
+	endpoints_.erase( peer_ );
+}
+
+NetPeer NetLoopbackTransport::Resolve( const std::string& address ) {
+	for ( const auto& endpoint : endpoints_ ) {
+		if ( endpoint.second->name_ == address ) {
+			return endpoint.first;
+		}
+	}
+
+	return NET_INVALID_PEER;
+}
+
+void NetLoopbackTransport::Send( NetPeer peer, const uint8_t* data, size_t size ) {
+	auto i = endpoints_.find( peer );
+	if ( i == endpoints_.end() ) {
+		// Gone away, same as a datagram to nowhere
+		return;
+	}
+
+	NetPacket packet;
+	packet.peer = peer_;
+	packet.data.assign( data, data + size );
+	i->second->incoming_.push_back( std::move( packet ) );
+}
+
+bool NetLoopbackTransport::Receive( NetPacket* packet ) {
+	if ( incoming_.empty() ) {
+		return false;
+	}
+
+	*packet = std::move( incoming_.front() );
+	incoming_.pop_front();
+	return true;
+}
+
+INetTransport* Net_CreateLoopbackTransport( const std::string& name ) {
+	return new NetLoopbackTransport( name );
+}
+
+/////////////////////////////////////////////////////////////
+// Simulated lag and loss
+
+NetLagTransport::NetLagTransport( INetTransport* transport ) : transport_( transport ) {
+	u_assert( transport_ != nullptr, "Attempted to wrap an invalid transport!\n" );
+}
+
+NetLagTransport::~NetLagTransport() {
+	delete transport_;
+}
+
+void NetLagTransport::Flush() {
+	while ( !delayed_.empty() && delayed_.front().release_tick <= g_state.sim_ticks ) {
+		const NetPacket& packet = delayed_.front().packet;
+		transport_->Send( packet.peer, packet.data.data(), packet.data.size() );
+		delayed_.pop_front();
+	}
+}
+
+void NetLagTransport::Send( NetPeer peer, const uint8_t* data, size_t size ) {
+	if ( loss_ > 0 ) {
+		/* xorshift32 */
+		loss_seed_ ^= loss_seed_ << 13;
+		loss_seed_ ^= loss_seed_ >> 17;
+		loss_seed_ ^= loss_seed_ << 5;
+		if ( static_cast<float>(loss_seed_ >> 8) / static_cast<float>(1 << 24) < loss_ ) {
+			return;
+		}
+	}
+
+	// Latency is fixed, so the queue stays in release order
+	DelayedPacket delayed;
+	delayed.release_tick = g_state.sim_ticks + ( latency_ + SKIP_TICKS - 1 ) / SKIP_TICKS;
+	delayed.packet.peer = peer;
+	delayed.packet.data.assign( data, data + size );
+	delayed_.push_back( std::move( delayed ) );
+
+	Flush();
+}
+
+bool NetLagTransport::Receive( NetPacket* packet ) {
+	Flush();
+	return transport_->Receive( packet );
+}
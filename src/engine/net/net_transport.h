@@ -0,0 +1,92 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#define NET_INVALID_PEER        0
+#define NET_MAX_PACKET_SIZE     65000   // Fits in a single UDP datagram
+#define NET_LAG_DEFAULT_SEED    0x4C414721
+
+typedef unsigned int NetPeer;  // Only means anything to the transport that handed it out
+
+struct NetPacket {
+	NetPeer peer{ NET_INVALID_PEER };
+	std::vector<uint8_t> data;
+};
+
+/**
+ * Moves datagrams between peers. Delivery is unreliable and unordered,
+ * so anything that has to arrive needs to be resent until it's acked.
+ */
+class INetTransport {
+public:
+	virtual ~INetTransport() = default;
+
+	// Looks up the peer for the given address, i.e. "127.0.0.1:9090"
+	virtual NetPeer Resolve( const std::string& address ) = 0;
+
+	virtual void Send( NetPeer peer, const uint8_t* data, size_t size ) = 0;
+	// Returns false once there's nothing left to read
+	virtual bool Receive( NetPacket* packet ) = 0;
+};
+
+// Endpoints that only talk to other endpoints in the same process
+INetTransport* Net_CreateLoopbackTransport( const std::string& name );
+// Returns null if the socket couldn't be bound
+INetTransport* Net_CreateUDPTransport( unsigned short port );
+
+/**
+ * Wraps another transport, holding back and dropping outgoing packets
+ * to make it behave like a poor connection. Packets are held back for
+ * a number of simulation ticks rather than real time, and dropped by
+ * its own seeded generator, so a run behaves the same every time.
+ */
+class NetLagTransport : public INetTransport {
+public:
+	// Takes ownership of the transport
+	explicit NetLagTransport( INetTransport* transport );
+	~NetLagTransport() override;
+
+	// Rounded up to whole ticks
+	void SetLatency( unsigned int latency ) { latency_ = latency; }
+	void SetLoss( float loss ) { loss_ = loss; }
+	void SetLossSeed( uint32_t seed ) { loss_seed_ = ( seed != 0 ) ? seed : NET_LAG_DEFAULT_SEED; }
+
+	NetPeer Resolve( const std::string& address ) override { return transport_->Resolve( address ); }
+
+	void Send( NetPeer peer, const uint8_t* data, size_t size ) override;
+	bool Receive( NetPacket* packet ) override;
+
+private:
+	void Flush();
+
+	struct DelayedPacket {
+		unsigned int release_tick;
+		NetPacket packet;
+	};
+	std::deque<DelayedPacket> delayed_;
+
+	INetTransport* transport_;
+
+	unsigned int latency_{ 0 };  // Milliseconds
+	float loss_{ 0 };            // 0 to 1
+	uint32_t loss_seed_{ NET_LAG_DEFAULT_SEED };
+};
@@ -0,0 +1,185 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+
+#include "net_transport.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET NetSocket;
+typedef int socklen_t;
+#define NET_SOCKET_INVALID  INVALID_SOCKET
+#define NetCloseSocket      closesocket
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+typedef int NetSocket;
+#define NET_SOCKET_INVALID  -1
+#define NetCloseSocket      close
+#endif
+
+/////////////////////////////////////////////////////////////
+// UDP, IPv4 only for now
+
+class NetUDPTransport : public INetTransport {
+public:
+	NetUDPTransport() = default;
+	~NetUDPTransport() override;
+
+	bool Open( unsigned short port );
+
+	NetPeer Resolve( const std::string& address ) override;
+
+	void Send( NetPeer peer, const uint8_t* data, size_t size ) override;
+	bool Receive( NetPacket* packet ) override;
+
+private:
+	NetPeer GetPeer( const sockaddr_in& address );
+
+	NetSocket socket_{ NET_SOCKET_INVALID };
+
+	// Peers are handed out as addresses are seen, and never recycled
+	typedef std::pair<uint32_t, uint16_t> AddressKey;
+	std::map<AddressKey, NetPeer> peers_;
+	std::vector<sockaddr_in> addresses_;  // Indexed by peer - 1
+
+	uint8_t buffer_[ NET_MAX_PACKET_SIZE ];
+};
+
+NetUDPTransport::~NetUDPTransport() {
+	if ( socket_ != NET_SOCKET_INVALID ) {
+		NetCloseSocket( socket_ );
+	}
+}
+
+bool NetUDPTransport::Open( unsigned short port ) {
+#ifdef _WIN32
+	static bool is_wsa_started = false;
+	if ( !is_wsa_started ) {
+		WSADATA wsa_data;
+		if ( WSAStartup( MAKEWORD( 2, 2 ), &wsa_data ) != 0 ) {
+			LogWarn( "Failed to start up winsock!\n" );
+			return false;
+		}
+		is_wsa_started = true;
+	}
+#endif
+
+	socket_ = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( socket_ == NET_SOCKET_INVALID ) {
+		LogWarn( "Failed to create UDP socket!\n" );
+		return false;
+	}
+
+	sockaddr_in address;
+	memset( &address, 0, sizeof( address ) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_ANY );
+	address.sin_port = htons( port );
+	if ( bind( socket_, reinterpret_cast<sockaddr*>(&address), sizeof( address ) ) != 0 ) {
+		LogWarn( "Failed to bind UDP socket to port %d!\n", port );
+		return false;
+	}
+
+	// Everything is polled from the tick, so never block
+#ifdef _WIN32
+	u_long non_blocking = 1;
+	ioctlsocket( socket_, FIONBIO, &non_blocking );
+#else
+	fcntl( socket_, F_SETFL, fcntl( socket_, F_GETFL, 0 ) | O_NONBLOCK );
+#endif
+
+	return true;
+}
+
+NetPeer NetUDPTransport::GetPeer( const sockaddr_in& address ) {
+	AddressKey key( address.sin_addr.s_addr, address.sin_port );
+	auto i = peers_.find( key );
+	if ( i != peers_.end() ) {
+		return i->second;
+	}
+
+	addresses_.push_back( address );
+	NetPeer peer = static_cast<NetPeer>(addresses_.size());
+	peers_.insert( std::make_pair( key, peer ) );
+	return peer;
+}
+
+NetPeer NetUDPTransport::Resolve( const std::string& address ) {
+	std::string host = address;
+	unsigned short port = 0;
+
+	size_t colon = address.rfind( ':' );
+	if ( colon != std::string::npos ) {
+		host = address.substr( 0, colon );
+		port = static_cast<unsigned short>(strtoul( address.c_str() + colon + 1, nullptr, 10 ));
+	}
+
+	if ( host == "localhost" ) {
+		host = "127.0.0.1";
+	}
+
+	sockaddr_in socket_address;
+	memset( &socket_address, 0, sizeof( socket_address ) );
+	socket_address.sin_family = AF_INET;
+	socket_address.sin_port = htons( port );
+	if ( port == 0 || inet_pton( AF_INET, host.c_str(), &socket_address.sin_addr ) != 1 ) {
+		LogWarn( "Invalid address, \"%s\"!\n", address.c_str() );
+		return NET_INVALID_PEER;
+	}
+
+	return GetPeer( socket_address );
+}
+
+void NetUDPTransport::Send( NetPeer peer, const uint8_t* data, size_t size ) {
+	if ( peer == NET_INVALID_PEER || peer > addresses_.size() ) {
+		return;
+	}
+
+	const sockaddr_in& address = addresses_[ peer - 1 ];
+	sendto( socket_, reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+			reinterpret_cast<const sockaddr*>(&address), sizeof( address ) );
+}
+
+bool NetUDPTransport::Receive( NetPacket* packet ) {
+	sockaddr_in address;
+	socklen_t address_length = sizeof( address );
+	int length = static_cast<int>(recvfrom( socket_, reinterpret_cast<char*>(buffer_), sizeof( buffer_ ), 0,
+											reinterpret_cast<sockaddr*>(&address), &address_length ));
+	if ( length < 0 ) {
+		return false;
+	}
+
+	packet->peer = GetPeer( address );
+	packet->data.assign( buffer_, buffer_ + length );
+	return true;
+}
+
+INetTransport* Net_CreateUDPTransport( unsigned short port ) {
+	auto* transport = new NetUDPTransport();
+	if ( !transport->Open( port ) ) {
+		delete transport;
+		return nullptr;
+	}
+
+	return transport;
+}
@@ -0,0 +1,891 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include "engine.h"
+#include "particle.h"
+#include "terrain.h"
+#include "profiler.h"
+#include "graphics/display.h"
+#include "graphics/render_queue.h"
+#include "graphics/camera.h"
+#include "graphics/sprite_batch.h"
+
+/* todo...
+ *  instancing
+ *  soft particles
+ *  animations
+ */
+
+static ParticleSystem* systems = NULL;
+static unsigned int num_systems = 0;   /* high water mark */
+static unsigned int max_systems = BASE_MAX_PARTICLE_SYSTEMS;
+
+/* slots below num_systems that have since been released */
+static unsigned int* free_slots = NULL;
+static unsigned int num_free_slots = 0;
+
+static unsigned int num_active_particles = 0;
+
+/* storage from cleared emitters, by how many particles it holds; effects
+ * are spawned from templates, so the same sizes keep coming back */
+static std::map< unsigned int, std::vector< PSParticleData > > particle_pool;
+static unsigned int num_pooled_particles = 0;
+
+static void SpawnParticlesCommand( unsigned int argc, char* argv[] ) {
+	if ( argc < 2 ) {
+		LogWarn( "invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	Camera* camera = openhow::Engine::Game()->GetCamera();
+	if ( camera == NULL ) {
+		return;
+	}
+
+	if ( SpawnParticleSystem( argv[ 1 ], camera->GetPosition() ) == NULL ) {
+		LogWarn( "failed to spawn \"%s\"!\n", argv[ 1 ] );
+	}
+}
+
+void InitParticles( void ) {
+	LogInfo( "initializing particle sub-system...\n" );
+
+	plRegisterConsoleCommand( "spawnParticles", SpawnParticlesCommand, "Spawns the named effect at the camera" );
+
+	systems = static_cast< ParticleSystem* >( u_alloc( max_systems, sizeof( ParticleSystem ), true ) );
+	free_slots = static_cast< unsigned int* >( u_alloc( max_systems, sizeof( unsigned int ), true ) );
+}
+
+void ShutdownParticles( void ) {
+	if ( systems == NULL ) {
+		return;
+	}
+
+	for ( unsigned int i = 0; i < num_systems; ++i ) {
+		if ( systems[ i ].is_reserved ) {
+			ClearParticleSystemSlot( &systems[ i ] );
+		}
+		/* released slots hang on to their emitter list */
+		u_free( systems[ i ].emitters );
+	}
+
+	for ( auto& i : particle_pool ) {
+		for ( auto& data : i.second ) {
+			free( data.position_x );
+			free( data.draw_order );
+		}
+	}
+	particle_pool.clear();
+	num_pooled_particles = 0;
+
+	u_free( systems );
+	u_free( free_slots );
+
+	ClearParticleSystemCache();
+	num_systems = num_free_slots = 0;
+}
+
+ParticleSystem* GetParticleSystemSlot( void ) {
+	ParticleSystem* system;
+	if ( num_free_slots > 0 ) {
+		system = &systems[ free_slots[ --num_free_slots ] ];
+	} else if ( num_systems < max_systems ) {
+		system = &systems[ num_systems++ ];
+	} else {
+		LogWarn( "no free particle system slots (%u)!\n", max_systems );
+		return NULL;
+	}
+
+	system->is_reserved = true;
+	system->is_enabled = true;
+	system->is_visible = true;
+	return system;
+}
+
+/**
+ * Hands out storage for the given number of particles, from the pool if
+ * there's any that size. Attributes are all carved from the one block.
+ */
+static PSParticleData AllocateParticleData( unsigned int max_particles ) {
+	PSParticleData data = PSParticleData();
+
+	auto i = particle_pool.find( max_particles );
+	if ( i != particle_pool.end() && !i->second.empty() ) {
+		data = i->second.back();
+		i->second.pop_back();
+		num_pooled_particles -= max_particles;
+		data.num_ordered = 0;
+		return data;
+	}
+
+	size_t n = max_particles;
+	float* block = static_cast< float* >( u_alloc( n * 8, sizeof( float ), true ) );
+	data.position_x = block;
+	data.position_y = block + n;
+	data.position_z = block + n * 2;
+	data.velocity_x = block + n * 3;
+	data.velocity_y = block + n * 4;
+	data.velocity_z = block + n * 5;
+	data.age = block + n * 6;
+	data.size = block + n * 7;
+	data.draw_order = static_cast< unsigned int* >( u_alloc( n, sizeof( unsigned int ), true ) );
+	return data;
+}
+
+static void ReleaseParticleData( const PSParticleData& data, unsigned int max_particles ) {
+	if ( num_pooled_particles + max_particles <= PARTICLE_POOL_BUDGET ) {
+		particle_pool[ max_particles ].push_back( data );
+		num_pooled_particles += max_particles;
+		return;
+	}
+
+	free( data.position_x );
+	free( data.draw_order );
+}
+
+void ClearParticleSystemSlot( ParticleSystem* system ) {
+	u_assert( system->is_reserved, "attempted to clear a particle system that isn't reserved!\n" );
+
+	for ( unsigned int i = 0; i < system->num_emitters; ++i ) {
+		num_active_particles -= system->emitters[ i ].num_particles;
+		ReleaseParticleData( system->emitters[ i ].particles, system->emitters[ i ].max_particles );
+	}
+
+	/* the emitter list stays with the slot, for whatever's spawned into it next */
+	PSEmitter* emitters = system->emitters;
+	unsigned int max_emitters = system->max_emitters;
+	*system = ParticleSystem();
+	system->emitters = emitters;
+	system->max_emitters = max_emitters;
+
+	free_slots[ num_free_slots++ ] = static_cast< unsigned int >( system - systems );
+}
+
+PSEmitter* AddParticleEmitter( ParticleSystem* ps, unsigned int max_particles ) {
+	if ( max_particles == 0 || max_particles > PARTICLE_MAX_PER_EMITTER ) {
+		LogWarn( "invalid number of particles for emitter (%u), should be between 1 and %u!\n",
+				 max_particles, PARTICLE_MAX_PER_EMITTER );
+		return NULL;
+	}
+
+	if ( ps->num_emitters >= MAX_PS_EMITTERS ) {
+		LogWarn( "hit emitter limit for particle system (%u)!\n", MAX_PS_EMITTERS );
+		return NULL;
+	}
+
+	if ( ps->num_emitters >= ps->max_emitters ) {
+		ps->max_emitters = ps->max_emitters == 0 ? 1 : ps->max_emitters * 2;
+		ps->emitters = static_cast< PSEmitter* >(
+			u_realloc( ps->emitters, sizeof( PSEmitter ) * ps->max_emitters, true ) );
+	}
+
+	PSEmitter* emitter = &ps->emitters[ ps->num_emitters++ ];
+	*emitter = PSEmitter();
+
+	emitter->type = PS_EMITTER_TYPE_SPRITE;
+	emitter->lifetime = 1.0f;
+	emitter->start_colour = emitter->end_colour = PLColour( 255, 255, 255, 255 );
+	emitter->start_size = emitter->end_size = 1.0f;
+	emitter->seed = 0x9E3779B9u ^ ( static_cast< uint32_t >( ps - systems ) * 16 + ps->num_emitters );
+	emitter->max_particles = max_particles;
+	emitter->particles = AllocateParticleData( max_particles );
+
+	return emitter;
+}
+
+/* xorshift, kept per emitter so that spawns are reproducible */
+static float RandomSpread( uint32_t* seed ) {
+	uint32_t x = *seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*seed = x;
+	return ( static_cast< float >( x & 0xFFFF ) / 32767.5f ) - 1.0f;
+}
+
+static void SpawnParticles( PSEmitter* emitter, const PLVector3& origin, float delta ) {
+	unsigned int num_spawn;
+	if ( emitter->is_looping ) {
+		emitter->spawn_accumulator += emitter->spawn_rate * delta;
+		num_spawn = static_cast< unsigned int >( emitter->spawn_accumulator );
+		emitter->spawn_accumulator -= num_spawn;
+	} else {
+		num_spawn = emitter->max_particles - emitter->num_spawned;
+	}
+
+	unsigned int room = emitter->max_particles - emitter->num_particles;
+	if ( num_spawn > room ) {
+		num_spawn = room;
+	}
+
+	unsigned int budget = PARTICLE_FRAME_BUDGET - num_active_particles;
+	if ( num_spawn > budget ) {
+		num_spawn = budget;
+	}
+
+	PSParticleData* p = &emitter->particles;
+	for ( unsigned int i = 0; i < num_spawn; ++i ) {
+		unsigned int j = emitter->num_particles++;
+		p->position_x[ j ] = origin.x + emitter->position.x;
+		p->position_y[ j ] = origin.y + emitter->position.y;
+		p->position_z[ j ] = origin.z + emitter->position.z;
+		p->velocity_x[ j ] = emitter->velocity.x + emitter->velocity_spread.x * RandomSpread( &emitter->seed );
+		p->velocity_y[ j ] = emitter->velocity.y + emitter->velocity_spread.y * RandomSpread( &emitter->seed );
+		p->velocity_z[ j ] = emitter->velocity.z + emitter->velocity_spread.z * RandomSpread( &emitter->seed );
+		p->age[ j ] = 0;
+		p->size[ j ] = emitter->start_size;
+	}
+
+	emitter->num_spawned += num_spawn;
+	num_active_particles += num_spawn;
+}
+
+/**
+ * Steps every live particle in the emitter forward by the given delta.
+ * Each loop is free of branches and aliasing so the compiler can
+ * vectorise it.
+ */
+void IntegrateParticleEmitter( PSEmitter* emitter, float delta ) {
+	PSParticleData* p = &emitter->particles;
+	unsigned int n = emitter->num_particles;
+
+	float drag = 1.0f - emitter->drag * delta;
+	if ( drag < 0 ) {
+		drag = 0;
+	}
+
+	float gx = emitter->gravity.x * delta;
+	float gy = emitter->gravity.y * delta;
+	float gz = emitter->gravity.z * delta;
+
+	float* __restrict vx = p->velocity_x;
+	float* __restrict vy = p->velocity_y;
+	float* __restrict vz = p->velocity_z;
+	for ( unsigned int i = 0; i < n; ++i ) {
+		vx[ i ] = ( vx[ i ] + gx ) * drag;
+		vy[ i ] = ( vy[ i ] + gy ) * drag;
+		vz[ i ] = ( vz[ i ] + gz ) * drag;
+	}
+
+	float* __restrict px = p->position_x;
+	float* __restrict py = p->position_y;
+	float* __restrict pz = p->position_z;
+	for ( unsigned int i = 0; i < n; ++i ) {
+		px[ i ] += vx[ i ] * delta;
+		py[ i ] += vy[ i ] * delta;
+		pz[ i ] += vz[ i ] * delta;
+	}
+
+	float inv_lifetime = emitter->lifetime > 0 ? 1.0f / emitter->lifetime : 0;
+	float size_scale = ( emitter->end_size - emitter->start_size ) * inv_lifetime;
+
+	float* __restrict age = p->age;
+	float* __restrict size = p->size;
+	for ( unsigned int i = 0; i < n; ++i ) {
+		age[ i ] += delta;
+		size[ i ] = emitter->start_size + age[ i ] * size_scale;
+	}
+
+	/* retire anything that's expired by moving the last particle into its place */
+	for ( unsigned int i = 0; i < n; ) {
+		if ( age[ i ] < emitter->lifetime ) {
+			++i;
+			continue;
+		}
+
+		--n;
+		px[ i ] = px[ n ];
+		py[ i ] = py[ n ];
+		pz[ i ] = pz[ n ];
+		vx[ i ] = vx[ n ];
+		vy[ i ] = vy[ n ];
+		vz[ i ] = vz[ n ];
+		age[ i ] = age[ n ];
+		size[ i ] = size[ n ];
+	}
+
+	num_active_particles -= emitter->num_particles - n;
+	emitter->num_particles = n;
+}
+
+void SimulateParticles( void ) {
+	PROFILE_SCOPE( "Particles" );
+
+	for ( unsigned int i = 0; i < num_systems; ++i ) {
+		ParticleSystem* ps = &systems[ i ];
+		if ( !ps->is_reserved || !ps->is_enabled ) {
+			continue;
+		}
+
+		bool is_finished = true;
+		for ( unsigned int j = 0; j < ps->num_emitters; ++j ) {
+			PSEmitter* pe = &ps->emitters[ j ];
+			IntegrateParticleEmitter( pe, PARTICLE_TICK_DELTA );
+			SpawnParticles( pe, ps->position, PARTICLE_TICK_DELTA );
+
+			if ( pe->is_looping || pe->num_particles > 0 || pe->num_spawned < pe->max_particles ) {
+				is_finished = false;
+			}
+		}
+
+		/* one-shot effects hand their slot back once they've played out */
+		if ( is_finished ) {
+			ClearParticleSystemSlot( ps );
+		}
+	}
+}
+
+struct ParticleDepth {
+	uint16_t key;
+	unsigned int index;
+};
+
+/**
+ * Two passes of eight bits over the quantised depth; stable, so
+ * particles at the same depth keep their order from the last draw.
+ */
+static void RadixSortParticles( std::vector< ParticleDepth >& entries, std::vector< ParticleDepth >& scratch ) {
+	size_t num_entries = entries.size();
+	scratch.resize( num_entries );
+
+	ParticleDepth* src = entries.data();
+	ParticleDepth* dst = scratch.data();
+	for ( unsigned int shift = 0; shift < 16; shift += 8 ) {
+		size_t counts[256] = {};
+		for ( size_t i = 0; i < num_entries; ++i ) {
+			counts[ ( src[ i ].key >> shift ) & 0xFF ]++;
+		}
+
+		size_t offset = 0;
+		for ( size_t& count : counts ) {
+			size_t c = count;
+			count = offset;
+			offset += c;
+		}
+
+		for ( size_t i = 0; i < num_entries; ++i ) {
+			dst[ counts[ ( src[ i ].key >> shift ) & 0xFF ]++ ] = src[ i ];
+		}
+
+		std::swap( src, dst );
+	}
+
+	/* an even number of passes always lands back in entries */
+}
+
+static void InsertionSortParticles( std::vector< ParticleDepth >& entries ) {
+	for ( size_t i = 1; i < entries.size(); ++i ) {
+		ParticleDepth entry = entries[ i ];
+		size_t j = i;
+		for ( ; j > 0 && entries[ j - 1 ].key > entry.key; --j ) {
+			entries[ j ] = entries[ j - 1 ];
+		}
+		entries[ j ] = entry;
+	}
+}
+
+/**
+ * Orders the emitter's particles back to front from the given view.
+ * The order from the last draw is used as the starting point, and if
+ * it's still mostly right the few stragglers are moved into place
+ * rather than sorting everything again.
+ */
+void SortParticleEmitter( PSEmitter* emitter, const PLVector3& view_origin, const PLVector3& view_forward ) {
+	static std::vector< ParticleDepth > entries, scratch;
+
+	PSParticleData* p = &emitter->particles;
+	unsigned int n = emitter->num_particles;
+
+	/* drop anything that's since expired, then add whatever's been spawned */
+	unsigned int num_ordered = 0;
+	for ( unsigned int i = 0; i < p->num_ordered; ++i ) {
+		if ( p->draw_order[ i ] < n ) {
+			p->draw_order[ num_ordered++ ] = p->draw_order[ i ];
+		}
+	}
+	for ( unsigned int i = std::min( p->num_ordered, n ); i < n; ++i ) {
+		p->draw_order[ num_ordered++ ] = i;
+	}
+	p->num_ordered = n;
+
+	entries.resize( n );
+
+	unsigned int num_descents = 0;
+	for ( unsigned int i = 0; i < n; ++i ) {
+		unsigned int index = p->draw_order[ i ];
+		float depth =
+			( p->position_x[ index ] - view_origin.x ) * view_forward.x +
+			( p->position_y[ index ] - view_origin.y ) * view_forward.y +
+			( p->position_z[ index ] - view_origin.z ) * view_forward.z;
+		entries[ i ].key = GetParticleSortKey( depth, RENDER_KEY_MAX_DEPTH );
+		entries[ i ].index = index;
+
+		if ( i > 0 && entries[ i - 1 ].key > entries[ i ].key ) {
+			num_descents++;
+		}
+	}
+
+	if ( num_descents == 0 ) {
+		return;
+	}
+
+	if ( num_descents * PARTICLE_SORT_COHERENCE <= n ) {
+		InsertionSortParticles( entries );
+	} else {
+		RadixSortParticles( entries, scratch );
+	}
+
+	for ( unsigned int i = 0; i < n; ++i ) {
+		p->draw_order[ i ] = entries[ i ].index;
+	}
+}
+
+static PLColour LerpColour( const PLColour& a, const PLColour& b, float t ) {
+	return PLColour(
+		static_cast< uint8_t >( a.r + ( b.r - a.r ) * t ),
+		static_cast< uint8_t >( a.g + ( b.g - a.g ) * t ),
+		static_cast< uint8_t >( a.b + ( b.b - a.b ) * t ),
+		static_cast< uint8_t >( a.a + ( b.a - a.a ) * t ) );
+}
+
+static void DrawParticleEmitter( const PSEmitter* emitter, SpriteBatcher* batcher ) {
+	/* subtractive and difference aren't supported by the batcher yet */
+	SpriteBatcher::BlendMode blend = emitter->blend == PS_BLEND_TYPE_ADDITIVE ?
+		SpriteBatcher::BLEND_ADDITIVE : SpriteBatcher::BLEND_DEFAULT;
+
+	float inv_lifetime = emitter->lifetime > 0 ? 1.0f / emitter->lifetime : 0;
+
+	const PSParticleData* p = &emitter->particles;
+	for ( unsigned int i = 0; i < emitter->num_particles; ++i ) {
+		unsigned int j = p->draw_order[ i ];
+		batcher->SubmitBillboard( emitter->texture, blend,
+			PLVector3( p->position_x[ j ], p->position_y[ j ], p->position_z[ j ] ),
+			p->size[ j ],
+			LerpColour( emitter->start_colour, emitter->end_colour, p->age[ j ] * inv_lifetime ) );
+	}
+}
+
+/**
+ * Emitters are ordered back to front by their origin first, and then
+ * the particles within each, which is cheaper than one big sort and
+ * close enough given emitters rarely overlap.
+ */
+void DrawParticles( double delta ) {
+	u_unused( delta );
+
+	Camera* camera = openhow::Engine::Game()->GetCamera();
+	if ( camera == NULL ) {
+		return;
+	}
+
+	PLVector3 view_origin = camera->GetPosition();
+	PLVector3 view_forward = camera->GetForward();
+
+	struct EmitterDepth {
+		PSEmitter* emitter;
+		float depth;
+	};
+	static std::vector< EmitterDepth > emitters;
+	emitters.clear();
+
+	for ( unsigned int i = 0; i < num_systems; ++i ) {
+		ParticleSystem* ps = &systems[ i ];
+		if ( !ps->is_reserved || !ps->is_visible ) {
+			continue;
+		}
+
+		for ( unsigned int j = 0; j < ps->num_emitters; ++j ) {
+			PSEmitter* emitter = &ps->emitters[ j ];
+			/* todo: model and line emitters */
+			if ( emitter->type != PS_EMITTER_TYPE_SPRITE || emitter->num_particles == 0 ) {
+				continue;
+			}
+
+			float depth =
+				( ps->position.x + emitter->position.x - view_origin.x ) * view_forward.x +
+				( ps->position.y + emitter->position.y - view_origin.y ) * view_forward.y +
+				( ps->position.z + emitter->position.z - view_origin.z ) * view_forward.z;
+			emitters.push_back( { emitter, depth } );
+		}
+	}
+
+	std::stable_sort( emitters.begin(), emitters.end(), []( const EmitterDepth& a, const EmitterDepth& b ) {
+		return a.depth > b.depth;
+	} );
+
+	SpriteBatcher* batcher = Display_GetSpriteBatcher();
+	for ( const auto& i : emitters ) {
+		SortParticleEmitter( i.emitter, view_origin, view_forward );
+		DrawParticleEmitter( i.emitter, batcher );
+	}
+}
+
+unsigned int GetNumActiveParticles( void ) {
+	return num_active_particles;
+}
+
+/************************************************************/
+/* Templates */
+
+static std::map< std::string, PSTemplate* > templates;
+
+static bool ReadPPSChunk( PLFile* fp, PPSChunkHeader* header, std::vector< uint8_t >& data ) {
+	if ( plReadFile( fp, header->name, sizeof( header->name ), 1 ) != 1 ||
+		plReadFile( fp, &header->length, sizeof( uint32_t ), 1 ) != 1 ||
+		plReadFile( fp, &header->num_children, sizeof( uint32_t ), 1 ) != 1 ) {
+		return false;
+	}
+
+	header->name[ sizeof( header->name ) - 1 ] = '\0';
+
+	/* nothing legitimate comes anywhere near this */
+	if ( header->length > PPS_MAX_CHUNK_LENGTH ) {
+		LogWarn( "invalid length for chunk \"%s\" (%u)!\n", header->name, header->length );
+		return false;
+	}
+
+	data.resize( header->length );
+	return header->length == 0 || plReadFile( fp, data.data(), 1, header->length ) == header->length;
+}
+
+static bool SkipPPSChildren( PLFile* fp, unsigned int num_children ) {
+	PPSChunkHeader header;
+	std::vector< uint8_t > data;
+	for ( unsigned int i = 0; i < num_children; ++i ) {
+		if ( !ReadPPSChunk( fp, &header, data ) || !SkipPPSChildren( fp, header.num_children ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool ParsePPSEmitter( PLFile* fp, const PPSChunkHeader& header, const std::vector< uint8_t >& data,
+							 PSEmitterTemplate* out ) {
+	if ( data.size() < sizeof( uint32_t ) ) {
+		LogWarn( "invalid emitter chunk in PPS!\n" );
+		return false;
+	}
+
+	PSEmitter* emitter = &out->properties;
+	*out = PSEmitterTemplate();
+	emitter->type = PS_EMITTER_TYPE_SPRITE;
+	emitter->is_looping = true;
+	emitter->lifetime = 1.0f;
+	emitter->start_colour = emitter->end_colour = PLColour( 255, 255, 255, 255 );
+	emitter->start_size = emitter->end_size = 1.0f;
+
+	uint32_t max_particles;
+	memcpy( &max_particles, data.data(), sizeof( uint32_t ) );
+	if ( max_particles == 0 || max_particles > PARTICLE_MAX_PER_EMITTER ) {
+		LogWarn( "invalid number of particles for emitter in PPS (%u), should be between 1 and %u!\n",
+				 max_particles, PARTICLE_MAX_PER_EMITTER );
+		return false;
+	}
+	emitter->max_particles = max_particles;
+
+	int32_t start_position[ 3 ] = { 0, 0, 0 };
+	int32_t end_position[ 3 ] = { 0, 0, 0 };
+
+	PPSChunkHeader child;
+	std::vector< uint8_t > child_data;
+	for ( unsigned int i = 0; i < header.num_children; ++i ) {
+		if ( !ReadPPSChunk( fp, &child, child_data ) ) {
+			LogWarn( "failed to read emitter property!\n" );
+			return false;
+		}
+
+		const uint8_t* p = child_data.data();
+		size_t length = child_data.size();
+		if ( strcmp( child.name, "position" ) == 0 && length >= sizeof( int32_t ) * 6 ) {
+			memcpy( start_position, p, sizeof( start_position ) );
+			memcpy( end_position, p + sizeof( start_position ), sizeof( end_position ) );
+		} else if ( strcmp( child.name, "colour" ) == 0 && length >= 8 ) {
+			emitter->start_colour = PLColour( p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] );
+			emitter->end_colour = PLColour( p[ 4 ], p[ 5 ], p[ 6 ], p[ 7 ] );
+		} else if ( strcmp( child.name, "size" ) == 0 && length >= sizeof( int32_t ) * 2 ) {
+			int32_t size[ 2 ];
+			memcpy( size, p, sizeof( size ) );
+			emitter->start_size = static_cast< float >( size[ 0 ] );
+			emitter->end_size = static_cast< float >( size[ 1 ] );
+		} else if ( strcmp( child.name, "lifetime" ) == 0 && length >= sizeof( uint32_t ) ) {
+			uint32_t lifetime;
+			memcpy( &lifetime, p, sizeof( uint32_t ) );
+			emitter->lifetime = lifetime / 1000.0f;
+		} else if ( strcmp( child.name, "blend" ) == 0 && length >= 1 && p[ 0 ] < MAX_PS_BLEND_TYPES ) {
+			emitter->blend = static_cast< PSBlendType >( p[ 0 ] );
+		} else if ( strcmp( child.name, "looping" ) == 0 && length >= 1 ) {
+			emitter->is_looping = p[ 0 ] != 0;
+		} else if ( strcmp( child.name, "material" ) == 0 ) {
+			size_t material_length = std::min( length, sizeof( out->material ) - 1 );
+			memcpy( out->material, p, material_length );
+			out->material[ material_length ] = '\0';
+		}
+
+		if ( !SkipPPSChildren( fp, child.num_children ) ) {
+			return false;
+		}
+	}
+
+	emitter->position = PLVector3( start_position[ 0 ], start_position[ 1 ], start_position[ 2 ] );
+	if ( emitter->lifetime > 0 ) {
+		emitter->velocity = PLVector3(
+			( end_position[ 0 ] - start_position[ 0 ] ) / emitter->lifetime,
+			( end_position[ 1 ] - start_position[ 1 ] ) / emitter->lifetime,
+			( end_position[ 2 ] - start_position[ 2 ] ) / emitter->lifetime );
+		/* enough to keep the emitter saturated */
+		emitter->spawn_rate = emitter->max_particles / emitter->lifetime;
+	}
+
+	if ( out->material[ 0 ] != '\0' ) {
+		emitter->texture = openhow::Engine::Resource()->LoadTexture( out->material );
+	}
+
+	return true;
+}
+
+/**
+ * Compiles the given PPS into a template, ready for spawning.
+ * The template is owned by the cache.
+ */
+const PSTemplate* LoadParticleTemplate( const char* path ) {
+	PLFile* fp = plOpenFile( path, false );
+	if ( fp == NULL ) {
+		LogWarn( "failed to load PPS \"%s\", ignoring!\n", path );
+		return NULL;
+	}
+
+	PSTemplate* pst = NULL;
+
+	PPSHeader header;
+	if ( plReadFile( fp, header.identifier, sizeof( header.identifier ), 1 ) != 1 ||
+		plReadFile( fp, header.version, sizeof( header.version ), 1 ) != 1 ||
+		plReadFile( fp, &header.num_chunks, sizeof( uint32_t ), 1 ) != 1 ) {
+		LogWarn( "failed to load PPS header for \"%s\"!\n", path );
+		plCloseFile( fp );
+		return NULL;
+	}
+
+	if ( memcmp( header.identifier, PPS_IDENTIFIER, sizeof( header.identifier ) ) != 0 ||
+		memcmp( header.version, PPS_VERSION, sizeof( header.version ) ) != 0 ) {
+		LogWarn( "invalid identifier or version for PPS \"%s\"!\n", path );
+		plCloseFile( fp );
+		return NULL;
+	}
+
+	pst = new PSTemplate();
+	plStripExtension( pst->name, sizeof( pst->name ), plGetFileName( path ) );
+
+	PPSChunkHeader chunk;
+	std::vector< uint8_t > data;
+	for ( unsigned int i = 0; i < header.num_chunks; ++i ) {
+		if ( !ReadPPSChunk( fp, &chunk, data ) ) {
+			LogWarn( "failed to read chunk %u in PPS \"%s\"!\n", i, path );
+			delete pst;
+			plCloseFile( fp );
+			return NULL;
+		}
+
+		bool status;
+		if ( strcmp( chunk.name, "emitter" ) == 0 && pst->num_emitters < MAX_PS_EMITTERS ) {
+			status = ParsePPSEmitter( fp, chunk, data, &pst->emitters[ pst->num_emitters++ ] );
+		} else {
+			status = SkipPPSChildren( fp, chunk.num_children );
+		}
+
+		if ( !status ) {
+			LogWarn( "failed to parse chunk %u in PPS \"%s\"!\n", i, path );
+			delete pst;
+			plCloseFile( fp );
+			return NULL;
+		}
+	}
+
+	plCloseFile( fp );
+
+	auto i = templates.find( pst->name );
+	if ( i != templates.end() ) {
+		delete i->second;
+		i->second = pst;
+	} else {
+		templates.insert( std::make_pair( pst->name, pst ) );
+	}
+
+	return pst;
+}
+
+static void WritePPSChunk( std::ofstream& output, const char* name, const void* data, uint32_t length,
+						   uint32_t num_children ) {
+	char chunk_name[ 16 ] = {};
+	strncpy( chunk_name, name, sizeof( chunk_name ) - 1 );
+	output.write( chunk_name, sizeof( chunk_name ) );
+	output.write( reinterpret_cast< const char* >( &length ), sizeof( uint32_t ) );
+	output.write( reinterpret_cast< const char* >( &num_children ), sizeof( uint32_t ) );
+	if ( length > 0 ) {
+		output.write( static_cast< const char* >( data ), length );
+	}
+}
+
+/**
+ * Writes the template back out as a PPS. The platform library can only
+ * read files, so this goes through a stream like the saves do.
+ */
+bool WriteParticleTemplate( const char* path, const PSTemplate* pst ) {
+	std::ofstream output( path, std::ios::binary );
+	if ( !output.is_open() ) {
+		LogWarn( "failed to write PPS to \"%s\"!\n", path );
+		return false;
+	}
+
+	output.write( PPS_IDENTIFIER, 4 );
+	output.write( PPS_VERSION, 6 );
+	uint32_t num_chunks = pst->num_emitters;
+	output.write( reinterpret_cast< const char* >( &num_chunks ), sizeof( uint32_t ) );
+
+	for ( unsigned int i = 0; i < pst->num_emitters; ++i ) {
+		const PSEmitter* emitter = &pst->emitters[ i ].properties;
+		const char* material = pst->emitters[ i ].material;
+
+		uint32_t max_particles = emitter->max_particles;
+		WritePPSChunk( output, "emitter", &max_particles, sizeof( uint32_t ), material[ 0 ] != '\0' ? 7 : 6 );
+
+		int32_t position[ 6 ] = {
+			static_cast< int32_t >( emitter->position.x ),
+			static_cast< int32_t >( emitter->position.y ),
+			static_cast< int32_t >( emitter->position.z ),
+			static_cast< int32_t >( emitter->position.x + emitter->velocity.x * emitter->lifetime ),
+			static_cast< int32_t >( emitter->position.y + emitter->velocity.y * emitter->lifetime ),
+			static_cast< int32_t >( emitter->position.z + emitter->velocity.z * emitter->lifetime ),
+		};
+		WritePPSChunk( output, "position", position, sizeof( position ), 0 );
+
+		uint8_t colour[ 8 ] = {
+			emitter->start_colour.r, emitter->start_colour.g, emitter->start_colour.b, emitter->start_colour.a,
+			emitter->end_colour.r, emitter->end_colour.g, emitter->end_colour.b, emitter->end_colour.a,
+		};
+		WritePPSChunk( output, "colour", colour, sizeof( colour ), 0 );
+
+		int32_t size[ 2 ] = {
+			static_cast< int32_t >( emitter->start_size ),
+			static_cast< int32_t >( emitter->end_size ),
+		};
+		WritePPSChunk( output, "size", size, sizeof( size ), 0 );
+
+		uint32_t lifetime = static_cast< uint32_t >( emitter->lifetime * 1000.0f + 0.5f );
+		WritePPSChunk( output, "lifetime", &lifetime, sizeof( uint32_t ), 0 );
+
+		uint8_t blend = static_cast< uint8_t >( emitter->blend );
+		WritePPSChunk( output, "blend", &blend, 1, 0 );
+
+		uint8_t looping = emitter->is_looping ? 1 : 0;
+		WritePPSChunk( output, "looping", &looping, 1, 0 );
+
+		if ( material[ 0 ] != '\0' ) {
+			WritePPSChunk( output, "material", material, static_cast< uint32_t >( strlen( material ) ), 0 );
+		}
+	}
+
+	output.close();
+	if ( output.fail() ) {
+		LogWarn( "failed to write PPS to \"%s\"!\n", path );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Fetches the named effect from the cache, compiling it from
+ * particles/<name>.pps if this is the first time it's been used.
+ */
+const PSTemplate* GetParticleTemplate( const char* name ) {
+	/* effects that failed to load are kept as null, so they're only tried the once */
+	auto i = templates.find( name );
+	if ( i != templates.end() ) {
+		return i->second;
+	}
+
+	char path[ PL_SYSTEM_MAX_PATH ];
+	snprintf( path, sizeof( path ), "particles/%s." PPS_EXTENSION, name );
+	const PSTemplate* pst = LoadParticleTemplate( path );
+	if ( pst == NULL ) {
+		templates.insert( std::make_pair( name, nullptr ) );
+	}
+
+	return pst;
+}
+
+void ClearParticleSystemCache( void ) {
+	/* live systems only hold copies, so nothing is left dangling */
+	for ( auto& i : templates ) {
+		delete i.second;
+	}
+
+	templates.clear();
+}
+
+ParticleSystem* InstantiateParticleTemplate( const PSTemplate* pst, const PLVector3& position ) {
+	if ( pst->num_emitters == 0 ) {
+		return NULL;
+	}
+
+	ParticleSystem* ps = GetParticleSystemSlot();
+	if ( ps == NULL ) {
+		return NULL;
+	}
+
+	strncpy( ps->name, pst->name, sizeof( ps->name ) - 1 );
+	ps->position = position;
+
+	/* size the emitter list up front, so adding them doesn't reallocate;
+	 * slots keep theirs, so it's usually big enough already */
+	if ( ps->max_emitters < pst->num_emitters ) {
+		ps->max_emitters = pst->num_emitters;
+		ps->emitters = static_cast< PSEmitter* >(
+			u_realloc( ps->emitters, sizeof( PSEmitter ) * ps->max_emitters, true ) );
+	}
+
+	for ( unsigned int i = 0; i < pst->num_emitters; ++i ) {
+		const PSEmitter* properties = &pst->emitters[ i ].properties;
+		PSEmitter* emitter = AddParticleEmitter( ps, properties->max_particles );
+		if ( emitter == NULL ) {
+			break;
+		}
+
+		PSParticleData particles = emitter->particles;
+		uint32_t seed = emitter->seed;
+
+		*emitter = *properties;
+		emitter->particles = particles;
+		emitter->seed = seed;
+	}
+
+	return ps;
+}
+
+ParticleSystem* SpawnParticleSystem( const char* name, const PLVector3& position ) {
+	const PSTemplate* pst = GetParticleTemplate( name );
+	if ( pst == NULL ) {
+		return NULL;
+	}
+
+	return InstantiateParticleTemplate( pst, position );
+}
@@ -17,7 +17,28 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+
 #define BASE_MAX_PARTICLE_SYSTEMS   2048
+#define MAX_PS_EMITTERS             8       /* per system */
+
+/* upper limit on live particles across every system, spawning
+ * stops until there's room again */
+#define PARTICLE_FRAME_BUDGET       16384
+
+/* no single emitter could ever fill more than the whole budget */
+#define PARTICLE_MAX_PER_EMITTER    PARTICLE_FRAME_BUDGET
+
+/* particle storage from cleared systems is kept around for the next
+ * spawn, up to this many particles' worth */
+#define PARTICLE_POOL_BUDGET        PARTICLE_FRAME_BUDGET
+
+#define PARTICLE_TICK_DELTA         (1.0f / TICKS_PER_SECOND)
+
+/* if fewer than one in this many particles are out of order since
+ * the last draw, they're fixed up in place rather than re-sorted */
+#define PARTICLE_SORT_COHERENCE     16
 
 typedef enum PSEmitterType {
   PS_EMITTER_TYPE_SPRITE,
@@ -36,26 +57,54 @@ typedef enum PSBlendType {
   MAX_PS_BLEND_TYPES
 } PSBlendType;
 
-typedef struct Particle {
-  PLVector3 position;
-  PLVector3 velocity;
-  PLColour colour;
-  float size;
-} Particle;
+/* particles are stored as one array per attribute rather
+ * than an array of structs, so the update can stream
+ * through each of them in turn */
+typedef struct PSParticleData {
+  float *position_x, *position_y, *position_z;
+  float *velocity_x, *velocity_y, *velocity_z;
+  float *age;
+  float *size;
+
+  /* back to front order from the last draw, which is
+   * usually close enough to skip most of the sorting */
+  unsigned int *draw_order;
+  unsigned int num_ordered;
+} PSParticleData;
 
 typedef struct PSEmitter {
-  PLVector3 position;
+  PLVector3 position;   /* relative to the system */
   PLTexture *texture;
 
   PSBlendType blend;
   PSEmitterType type;
 
-  Particle *particles;
+  bool is_looping;      /* otherwise emits max_particles once and stops */
+  float spawn_rate;     /* particles per second */
+  float lifetime;       /* seconds */
+
+  PLVector3 velocity;
+  PLVector3 velocity_spread;
+  PLVector3 gravity;
+  float drag;
+
+  PLColour start_colour;
+  PLColour end_colour;
+  float start_size;
+  float end_size;
+
+  float spawn_accumulator;
+  unsigned int num_spawned;
+  uint32_t seed;
+
+  PSParticleData particles;
   unsigned int num_particles;
   unsigned int max_particles;
 } PSEmitter;
 
 typedef struct ParticleSystem {
+  PLVector3 position;
+
   PSEmitter *emitters;
   unsigned int num_emitters;
   unsigned int max_emitters;
@@ -70,86 +119,92 @@ typedef struct ParticleSystem {
 } ParticleSystem;
 
 void InitParticles(void);
+void ShutdownParticles(void);
 void SimulateParticles(void);
 void DrawParticles(double delta);
 
-void DrawParticleSystem(ParticleSystem *ps, double delta);
+ParticleSystem *GetParticleSystemSlot(void);
+void ClearParticleSystemSlot(ParticleSystem *system);
+
+PSEmitter *AddParticleEmitter(ParticleSystem *ps, unsigned int max_particles);
+void IntegrateParticleEmitter(PSEmitter *emitter, float delta);
+
+void SortParticleEmitter(PSEmitter *emitter, const PLVector3 &view_origin, const PLVector3 &view_forward);
+
+/* depth along the view quantised to what the emitter's sorted by, smallest
+ * first, so that the furthest particles up to max_depth away come first */
+inline uint16_t GetParticleSortKey(float depth, float max_depth) {
+  depth = std::max(0.0f, std::min(depth / max_depth, 1.0f));
+  return static_cast<uint16_t>(UINT16_MAX - static_cast<unsigned int>(depth * UINT16_MAX));
+}
+
+unsigned int GetNumActiveParticles(void);
+
+/******************************************************************/
+/* Templates */
+
+/* effects are compiled into these once, and then copied into
+ * a free system slot each time they're spawned */
+
+typedef struct PSEmitterTemplate {
+  PSEmitter properties;   /* particle data is left empty */
+  char material[64];
+} PSEmitterTemplate;
+
+typedef struct PSTemplate {
+  char name[32];
+  PSEmitterTemplate emitters[MAX_PS_EMITTERS];
+  unsigned int num_emitters;
+} PSTemplate;
+
+const PSTemplate *LoadParticleTemplate(const char *path);
+bool WriteParticleTemplate(const char *path, const PSTemplate *pst);
+
+const PSTemplate *GetParticleTemplate(const char *name);
+void ClearParticleSystemCache();
+
+ParticleSystem *InstantiateParticleTemplate(const PSTemplate *pst, const PLVector3 &position);
+ParticleSystem *SpawnParticleSystem(const char *name, const PLVector3 &position);
 
 /******************************************************************/
 /* PPS format */
 
-#define PPS_IDENTIFIER  "PPS\0"
+#define PPS_IDENTIFIER  "PPS"
 #define PPS_VERSION     "050818"
 #define PPS_EXTENSION   "pps"
 
+#define PPS_MAX_CHUNK_LENGTH    4096
+
+/* All values are little-endian and tightly packed.
+ *
+ *  identifier      int8_t[4]   "PPS\0"
+ *  version         int8_t[6]   PPS_VERSION, not terminated
+ *  num_chunks      uint32_t    number of top-level chunks that follow
+ *
+ * Each chunk is a header, followed by length bytes of data and
+ * then its children. Unknown chunks are skipped, along with their
+ * children.
+ *
+ *  "emitter"   max_particles   uint32_t
+ *    "position"  start/end     int32_t[3] each, end is where a particle finishes up
+ *    "colour"    start/end     uint8_t[4] each
+ *    "size"      start/end     int32_t each
+ *    "lifetime"                uint32_t, in milliseconds
+ *    "blend"                   uint8_t, PSBlendType
+ *    "looping"                 uint8_t
+ *    "material"                int8_t[length], texture path
+ */
+
 typedef struct PPSHeader {
   int8_t identifier[4];
   int8_t version[6];
-  uint32_t num_chunks;    /* number of chunks following the header (excluding children) */
+  uint32_t num_chunks;
 } PPSHeader;
 
 typedef struct PPSChunkHeader {
-#if 1
-  int8_t name[16];
-#else
-  uint16_t identity;
-#endif
+  char name[16];
   uint32_t length;
   uint32_t num_children;
 } PPSChunkHeader;
 
-/* Emitter properties
- *  IsLooping       uint8_t
- *  MaxParticles    uint16_t
- *  Material        int8_t[...] (length before?)
- *  StartColour     uint8_t[4]
- *  EndColour       uint8_t[4]
- *  StartPosition   float
- *  EndPosition     float
- *  StartSize       float
- *  EndSize         float
- *  BlendMode       uint8_t
- */
-
-/* Emitter nodes
- *  Light
- *      Colour
- *  Particle
- */
-
-typedef struct PPSPositionChunk {   /* "position" */
-  PPSChunkHeader header;
-  int32_t start_position[3];
-  int32_t end_position[3];
-} PPSPositionChunk;
-
-typedef struct PPSColourChunk { /* "colour" */
-  PPSChunkHeader header;
-  uint8_t start_colour[4];
-  uint8_t end_colour[4];
-} PPSColourChunk;
-
-typedef struct PPSSizeChunk { /* "size" */
-  PPSChunkHeader header;
-  int32_t start_size;
-  int32_t end_size;
-} PPSSizeChunk;
-
-typedef struct PPSEmitterChunk {    /* "emitter" */
-  PPSChunkHeader header;
-  uint32_t max_particles;
-  PPSPositionChunk position;
-  PPSColourChunk colour;
-  PPSSizeChunk size;
-} PPSEmitterChunk;
-
-typedef struct PPSFormat {
-  PPSHeader header;
-  PPSChunkHeader *chunks;
-  uint32_t num_chunks;
-} PPSFormat;
-
-PPSFormat SerializeParticleSystem(ParticleSystem *system);
-ParticleSystem *DeserializeParticleSystem(PPSFormat pps);
-
 /******************************************************************/
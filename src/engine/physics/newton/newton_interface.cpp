@@ -15,7 +15,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <tuple>
+
 #include "../../engine.h"
+#include "../../terrain.h"
+#include "../../memory_tracker.h"
+#include "../../profiler.h"
 
 /////////////////////////////////////////////////////////////
 // Newton Dynamics Interface
@@ -27,15 +36,162 @@ class NTPhysicsBody : public IPhysicsBody {
  public:
   NTPhysicsBody() {}
   ~NTPhysicsBody() override {
-    NewtonDestroyCollision(newton_collision_);
+    if (newton_body_ != nullptr) {
+      NewtonDestroyBody(newton_body_);
+    }
+  }
+
+  void Spawn(NewtonWorld* world, NewtonCollision* shape, float mass, const PLVector3& position);
+  void Retire();
+
+  void UpdateSleep(float sleep_speed, float sleep_spin);
+
+  // Called after every tick, to keep hold of where the body ended up
+  void CaptureTransform() {
+    if (newton_body_ == nullptr) {
+      return;
+    }
+
+    PLMatrix4 transform;
+    NewtonBodyGetMatrix(newton_body_, transform.m);
+    StoreTransform(transform);
   }
 
+  bool IsStatic() const { return is_static_; }
+  bool IsSleeping() const { return is_sleeping_; }
+  // Awake, and wasn't under the sleep thresholds as of the last tick
+  bool IsMoving() const { return !is_static_ && !is_sleeping_ && idle_ticks_ == 0; }
+
+  // Set from the contact callback; only ever raised, never lowered, there
+  void Wake() { wake_ = true; }
+
  protected:
  private:
-  NewtonCollision*  newton_collision_{nullptr};
+  static void ApplyGravity(const NewtonBody* body, dFloat timestep, int thread);
+
+  void Sleep();
+
   NewtonBody*       newton_body_{nullptr};
+
+  bool          is_static_{false};
+  bool          is_sleeping_{false};
+  bool          wake_{false};
+  unsigned int  idle_ticks_{0};
 };
 
+void NTPhysicsBody::ApplyGravity(const NewtonBody* body, dFloat timestep, int thread) {
+  u_unused(timestep);
+  u_unused(thread);
+
+  dFloat mass, ixx, iyy, izz;
+  NewtonBodyGetMass(body, &mass, &ixx, &iyy, &izz);
+
+  dFloat force[3] = {0, -mass * cv_physics_gravity->f_value, 0};
+  NewtonBodySetForce(body, force);
+}
+
+/**
+ * Sets the body up from scratch, reusing whatever Newton body it
+ * had from before it was retired.
+ */
+void NTPhysicsBody::Spawn(NewtonWorld* world, NewtonCollision* shape, float mass, const PLVector3& position) {
+  PLMatrix4 transform = plMatrix4Identity();
+  transform.m[12] = position.x;
+  transform.m[13] = position.y;
+  transform.m[14] = position.z;
+
+  if (newton_body_ == nullptr) {
+    newton_body_ = NewtonCreateDynamicBody(world, shape, transform.m);
+    NewtonBodySetUserData(newton_body_, this);
+    NewtonBodySetForceAndTorqueCallback(newton_body_, ApplyGravity);
+    // We decide when bodies sleep, see UpdateSleep
+    NewtonBodySetAutoSleep(newton_body_, 0);
+  } else {
+    NewtonBodySetCollision(newton_body_, shape);
+    NewtonBodySetMatrix(newton_body_, transform.m);
+  }
+
+  is_static_ = mass <= 0;
+
+  dFloat zero[3] = {0, 0, 0};
+  NewtonBodySetMassProperties(newton_body_, is_static_ ? 0 : mass, shape);
+  NewtonBodySetVelocity(newton_body_, zero);
+  NewtonBodySetOmega(newton_body_, zero);
+  NewtonBodySetContinuousCollisionMode(newton_body_, (is_static_ || !cv_physics_continuous->b_value) ? 0 : 1);
+  NewtonBodySetCollidable(newton_body_, 1);
+  NewtonBodySetFreezeState(newton_body_, is_static_ ? 1 : 0);
+
+  is_sleeping_ = is_static_;
+  wake_ = false;
+  idle_ticks_ = 0;
+
+  ResetTransform(transform);
+}
+
+/**
+ * Takes the body out of the simulation without destroying it.
+ */
+void NTPhysicsBody::Retire() {
+  if (newton_body_ == nullptr) {
+    return;
+  }
+
+  NewtonBodySetCollidable(newton_body_, 0);
+  Sleep();
+}
+
+void NTPhysicsBody::Sleep() {
+  dFloat zero[3] = {0, 0, 0};
+  NewtonBodySetVelocity(newton_body_, zero);
+  NewtonBodySetOmega(newton_body_, zero);
+  NewtonBodySetFreezeState(newton_body_, 1);
+
+  is_sleeping_ = true;
+  idle_ticks_ = 0;
+}
+
+/**
+ * Puts the body to sleep once it's been moving slower than the given
+ * thresholds for a little while, and wakes it again if something
+ * has run into it since, see OnContact.
+ */
+void NTPhysicsBody::UpdateSleep(float sleep_speed, float sleep_spin) {
+  if (newton_body_ == nullptr || is_static_) {
+    return;
+  }
+
+  if (wake_) {
+    wake_ = false;
+    idle_ticks_ = 0;
+    if (is_sleeping_) {
+      NewtonBodySetFreezeState(newton_body_, 0);
+      is_sleeping_ = false;
+    }
+    return;
+  }
+
+  // Newton may have woken it up itself, i.e. via a joint
+  is_sleeping_ = NewtonBodyGetFreezeState(newton_body_) != 0;
+  if (is_sleeping_) {
+    return;
+  }
+
+  dFloat velocity[3], omega[3];
+  NewtonBodyGetVelocity(newton_body_, velocity);
+  NewtonBodyGetOmega(newton_body_, omega);
+
+  float speed = velocity[0] * velocity[0] + velocity[1] * velocity[1] + velocity[2] * velocity[2];
+  float spin = omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2];
+  if (speed > sleep_speed * sleep_speed || spin > sleep_spin * sleep_spin) {
+    idle_ticks_ = 0;
+    return;
+  }
+
+  if (++idle_ticks_ >= PHYSICS_SLEEP_TICKS) {
+    Sleep();
+  }
+}
+
 class NTPhysicsInterface : public IPhysicsInterface {
  public:
   NTPhysicsInterface();
@@ -43,10 +199,19 @@ class NTPhysicsInterface : public IPhysicsInterface {
 
   void Tick() override;
 
-  IPhysicsBody* CreatePhysicsBody() override;
+  IPhysicsBody* CreatePhysicsBody(PhysicsPrimitiveType type,
+                                  const PLVector3& size,
+                                  float mass,
+                                  const PLVector3& position) override;
   void DestroyPhysicsBody(IPhysicsBody* body) override;
 
-  void GenerateTerrainCollision(std::vector<float> vertices) override;
+  const PhysicsStats& GetStats() const override { return stats_; }
+
+  void GenerateTerrainCollision(const std::vector<float>& heights,
+                                const std::vector<uint8_t>& materials) override;
+  void UpdateTerrainCollision(unsigned int chunk,
+                              const std::vector<float>& heights,
+                              const std::vector<uint8_t>& materials) override;
   void DestroyTerrainCollision() override;
 
  protected:
@@ -54,8 +219,28 @@ class NTPhysicsInterface : public IPhysicsInterface {
   static void* AllocMemory(int size);
   static void FreeMemory(void* ptr, int size);
 
+  static int OnAABBOverlap(const NewtonJoint* contact, dFloat timestep, int thread);
+  static void OnContact(const NewtonJoint* contact, dFloat timestep, int thread);
+
+  NewtonCollision* GetShape(PhysicsPrimitiveType type, const PLVector3& size);
+
+  void DestroyTerrainChunk(unsigned int chunk);
+
+  static std::atomic<unsigned int> num_allocations_;
+
   NewtonWorld* newton_world_{nullptr};
-  NewtonCollision* terrain_collision_{nullptr};
+
+  std::vector<NTPhysicsBody*> bodies_;
+  std::vector<NTPhysicsBody*> pool_;
+
+  // Shapes are keyed by type and size, in tenths of a unit
+  typedef std::tuple<int, int, int, int> ShapeKey;
+  std::map<ShapeKey, NewtonCollision*> shapes_;
+
+  PhysicsStats stats_;
+
+  // Each chunk gets its own heightfield, so it can be rebuilt alone
+  NewtonBody* terrain_bodies_[TERRAIN_CHUNKS]{};
 };
 
 IPhysicsInterface* IPhysicsInterface::CreateInstance() {
@@ -68,53 +253,286 @@ void IPhysicsInterface::DestroyInstance(IPhysicsInterface* instance) {
 
 /////////////////////////////////////////////////////////////
 
+std::atomic<unsigned int> NTPhysicsInterface::num_allocations_{0};
+
 void* NTPhysicsInterface::AllocMemory(int size) {
-  return u_alloc(1, size, true);
+  num_allocations_++;
+  void* ptr = Memory_Allocate(static_cast<size_t>(size), MEMORY_TAG_PHYSICS);
+  if (ptr == nullptr) {
+    Error("Failed to allocate %d bytes!\n", size);
+  }
+  return ptr;
 }
 
 void NTPhysicsInterface::FreeMemory(void* ptr, int size) {
   u_unused(size);
-  u_free(ptr);
+  Memory_Free(ptr);
 }
 
 NTPhysicsInterface::NTPhysicsInterface() {
-  newton_world_ = NewtonCreate();
+  MEMORY_TAG(MEMORY_TAG_PHYSICS);
+
+  // Needs to be in place before the world allocates anything
   NewtonSetMemorySystem(NTPhysicsInterface::AllocMemory, NTPhysicsInterface::FreeMemory);
+  newton_world_ = NewtonCreate();
+
+  int material = NewtonMaterialGetDefaultGroupID(newton_world_);
+  NewtonMaterialSetCollisionCallback(newton_world_, material, material, OnAABBOverlap, OnContact);
+
+  bodies_.reserve(PHYSICS_MAX_POOLED);
+  pool_.reserve(PHYSICS_MAX_POOLED);
 }
 
 NTPhysicsInterface::~NTPhysicsInterface() {
+  for (auto body : bodies_) {
+    delete body;
+  }
+  for (auto body : pool_) {
+    delete body;
+  }
+
+  DestroyTerrainCollision();
+
+  for (auto& shape : shapes_) {
+    NewtonDestroyCollision(shape.second);
+  }
+
   NewtonDestroyAllBodies(newton_world_);
   NewtonDestroy(newton_world_);
 }
 
+int NTPhysicsInterface::OnAABBOverlap(const NewtonJoint* contact, dFloat timestep, int thread) {
+  u_unused(contact);
+  u_unused(timestep);
+  u_unused(thread);
+  return 1;
+}
+
+/**
+ * A sleeping body is only woken when something that's on the move
+ * runs into it. Resting on the terrain, which has no user data, or
+ * against another body that's settling down, leaves it be.
+ */
+void NTPhysicsInterface::OnContact(const NewtonJoint* contact, dFloat timestep, int thread) {
+  u_unused(timestep);
+  u_unused(thread);
+
+  NTPhysicsBody* bodies[2] = {
+      static_cast<NTPhysicsBody*>(NewtonBodyGetUserData(NewtonJointGetBody0(contact))),
+      static_cast<NTPhysicsBody*>(NewtonBodyGetUserData(NewtonJointGetBody1(contact)))};
+  for (unsigned int i = 0; i < 2; ++i) {
+    NTPhysicsBody* body = bodies[i];
+    NTPhysicsBody* other = bodies[1 - i];
+    if (body != nullptr && other != nullptr && body->IsSleeping() && other->IsMoving()) {
+      body->Wake();
+    }
+  }
+}
+
+/**
+ * Splits each game tick into a number of smaller steps, so that fast
+ * moving bodies don't skip straight through anything thin.
+ */
 void NTPhysicsInterface::Tick() {
-  NewtonUpdate(newton_world_, 1.0f / 25.0f); // todo: double check this...
+  PROFILE_SCOPE("Physics");
+
+  auto start = std::chrono::steady_clock::now();
+
+  int num_steps = std::max(1, std::min(cv_physics_substeps->i_value, PHYSICS_MAX_SUBSTEPS));
+  float step = (1.0f / TICKS_PER_SECOND) / num_steps;
+  for (int i = 0; i < num_steps; ++i) {
+    NewtonUpdate(newton_world_, step);
+  }
+
+  stats_.solver_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  stats_.num_active_bodies = 0;
+  stats_.num_sleeping_bodies = 0;
+  for (auto body : bodies_) {
+    body->UpdateSleep(cv_physics_sleep_speed->f_value, cv_physics_sleep_spin->f_value);
+    body->CaptureTransform();
+
+    if (body->IsSleeping() || body->IsStatic()) {
+      stats_.num_sleeping_bodies++;
+    } else {
+      stats_.num_active_bodies++;
+    }
+  }
+
+  stats_.num_pooled_bodies = static_cast<unsigned int>(pool_.size());
+  stats_.num_shapes = static_cast<unsigned int>(shapes_.size());
+  // Anything spawned since the last tick is counted along with it
+  stats_.num_allocations = num_allocations_.exchange(0);
+}
+
+NewtonCollision* NTPhysicsInterface::GetShape(PhysicsPrimitiveType type, const PLVector3& size) {
+  // Degenerate shapes upset Newton, so nothing goes below a unit
+  PLVector3 extents(std::max(size.x, 1.0f), std::max(size.y, 1.0f), std::max(size.z, 1.0f));
+
+  ShapeKey key(static_cast<int>(type),
+               static_cast<int>(extents.x * 10),
+               static_cast<int>(extents.y * 10),
+               static_cast<int>(extents.z * 10));
+  auto i = shapes_.find(key);
+  if (i != shapes_.end()) {
+    return i->second;
+  }
+
+  NewtonCollision* shape;
+  switch (type) {
+    case PhysicsPrimitiveType::SPHERE:
+      shape = NewtonCreateSphere(newton_world_, extents.x, 0, nullptr);
+      break;
+    case PhysicsPrimitiveType::CAPSULE:
+      shape = NewtonCreateCapsule(newton_world_, extents.x, extents.x, extents.y, 0, nullptr);
+      break;
+    case PhysicsPrimitiveType::CYLINDER:
+      shape = NewtonCreateCylinder(newton_world_, extents.x, extents.x, extents.y, 0, nullptr);
+      break;
+    case PhysicsPrimitiveType::CONE:
+      shape = NewtonCreateCone(newton_world_, extents.x, extents.y, 0, nullptr);
+      break;
+    case PhysicsPrimitiveType::CHAMFER_CYLINDER:
+      shape = NewtonCreateChamferCylinder(newton_world_, extents.x, extents.y, 0, nullptr);
+      break;
+    default:
+      LogWarn("Unsupported physics primitive, %d, falling back to a box!\n", static_cast<int>(type));
+      // fall through
+    case PhysicsPrimitiveType::BOX:
+      shape = NewtonCreateBox(newton_world_, extents.x, extents.y, extents.z, 0, nullptr);
+      break;
+  }
+
+  if (shape == nullptr) {
+    Error("Failed to create physics shape, %d!\n", static_cast<int>(type));
+  }
+
+  shapes_.insert(std::make_pair(key, shape));
+  return shape;
 }
 
-IPhysicsBody* NTPhysicsInterface::CreatePhysicsBody() {
-  auto* body = new NTPhysicsBody();
+IPhysicsBody* NTPhysicsInterface::CreatePhysicsBody(PhysicsPrimitiveType type,
+                                                    const PLVector3& size,
+                                                    float mass,
+                                                    const PLVector3& position) {
+  MEMORY_TAG(MEMORY_TAG_PHYSICS);
+
+  NTPhysicsBody* body;
+  if (!pool_.empty()) {
+    body = pool_.back();
+    pool_.pop_back();
+  } else {
+    body = new NTPhysicsBody();
+  }
+
+  body->Spawn(newton_world_, GetShape(type, size), mass, position);
+  bodies_.push_back(body);
   return body;
 }
 
 void NTPhysicsInterface::DestroyPhysicsBody(IPhysicsBody* body) {
-  delete dynamic_cast<NTPhysicsBody*>(body);
+  auto* nt_body = dynamic_cast<NTPhysicsBody*>(body);
+  if (nt_body == nullptr) {
+    return;
+  }
+
+  auto i = std::find(bodies_.begin(), bodies_.end(), nt_body);
+  if (i == bodies_.end()) {
+    LogWarn("Attempted to destroy a physics body that isn't live!\n");
+    return;
+  }
+
+  // Order doesn't matter, so just swap it off the end
+  std::swap(*i, bodies_.back());
+  bodies_.pop_back();
+
+  if (pool_.size() >= PHYSICS_MAX_POOLED) {
+    delete nt_body;
+    return;
+  }
+
+  nt_body->Retire();
+  pool_.push_back(nt_body);
 }
 
 /////////////////////////////////////////////////////////////
 // Terrain
 
-void NTPhysicsInterface::GenerateTerrainCollision(std::vector<float> vertices) {
-#if 0
-  const unsigned int size = 65;
-  terrain_collision_ = NewtonCreateHeightFieldCollision(
+#define TERRAIN_GRID_WIDTH  (TERRAIN_ROW_TILES + 1)
+#define CHUNK_GRID_WIDTH    (TERRAIN_CHUNK_ROW_TILES + 1)
+
+void NTPhysicsInterface::GenerateTerrainCollision(const std::vector<float>& heights,
+                                                  const std::vector<uint8_t>& materials) {
+  for (unsigned int i = 0; i < TERRAIN_CHUNKS; ++i) {
+    UpdateTerrainCollision(i, heights, materials);
+  }
+}
+
+void NTPhysicsInterface::UpdateTerrainCollision(unsigned int chunk,
+                                                const std::vector<float>& heights,
+                                                const std::vector<uint8_t>& materials) {
+  MEMORY_TAG(MEMORY_TAG_PHYSICS);
+
+  u_assert(chunk < TERRAIN_CHUNKS, "Invalid terrain chunk, %d!\n", chunk);
+  u_assert(heights.size() == TERRAIN_GRID_WIDTH * TERRAIN_GRID_WIDTH, "Invalid terrain height grid!\n");
+  u_assert(materials.size() == TERRAIN_ROW_TILES * TERRAIN_ROW_TILES, "Invalid terrain material grid!\n");
+
+  DestroyTerrainChunk(chunk);
+
+  unsigned int chunk_x = (chunk % TERRAIN_CHUNK_ROW) * TERRAIN_CHUNK_ROW_TILES;
+  unsigned int chunk_y = (chunk / TERRAIN_CHUNK_ROW) * TERRAIN_CHUNK_ROW_TILES;
+
+  // Newton wants an attribute per vertex, but only reads the one at
+  // the top-left of each cell, so the last row and column are padding
+  dFloat elevation[CHUNK_GRID_WIDTH * CHUNK_GRID_WIDTH];
+  char attributes[CHUNK_GRID_WIDTH * CHUNK_GRID_WIDTH];
+  for (unsigned int y = 0; y < CHUNK_GRID_WIDTH; ++y) {
+    for (unsigned int x = 0; x < CHUNK_GRID_WIDTH; ++x) {
+      unsigned int tile_x = std::min(chunk_x + x, static_cast<unsigned int>(TERRAIN_ROW_TILES - 1));
+      unsigned int tile_y = std::min(chunk_y + y, static_cast<unsigned int>(TERRAIN_ROW_TILES - 1));
+      elevation[x + y * CHUNK_GRID_WIDTH] = heights[(chunk_x + x) + (chunk_y + y) * TERRAIN_GRID_WIDTH];
+      attributes[x + y * CHUNK_GRID_WIDTH] = static_cast<char>(materials[tile_x + tile_y * TERRAIN_ROW_TILES]);
+    }
+  }
+
+  NewtonCollision* collision = NewtonCreateHeightFieldCollision(
       newton_world_,
-      size, size,
-      0, 0,
-      vertices.data(),
-      );
-#endif
+      CHUNK_GRID_WIDTH, CHUNK_GRID_WIDTH,
+      0,  // same diagonal for every cell, from corner 1 to 2, as chunk_indices are drawn in terrain.cpp
+      0,  // 32-bit float elevation
+      elevation,
+      attributes,
+      1.0f,
+      TERRAIN_TILE_PIXEL_WIDTH, TERRAIN_TILE_PIXEL_WIDTH,
+      0);
+  if (collision == nullptr) {
+    LogWarn("Failed to create terrain collision for chunk %d!\n", chunk);
+    return;
+  }
+
+  dFloat matrix[16] = {
+      1, 0, 0, 0,
+      0, 1, 0, 0,
+      0, 0, 1, 0,
+      static_cast<dFloat>(chunk_x * TERRAIN_TILE_PIXEL_WIDTH), 0, static_cast<dFloat>(chunk_y * TERRAIN_TILE_PIXEL_WIDTH), 1,
+  };
+
+  // No mass, so the body stays static
+  terrain_bodies_[chunk] = NewtonCreateDynamicBody(newton_world_, collision, matrix);
+  NewtonDestroyCollision(collision);
+}
+
+void NTPhysicsInterface::DestroyTerrainChunk(unsigned int chunk) {
+  if (terrain_bodies_[chunk] == nullptr) {
+    return;
+  }
+
+  NewtonDestroyBody(terrain_bodies_[chunk]);
+  terrain_bodies_[chunk] = nullptr;
 }
 
 void NTPhysicsInterface::DestroyTerrainCollision() {
-  NewtonDestroyCollision(terrain_collision_);
+  for (unsigned int i = 0; i < TERRAIN_CHUNKS; ++i) {
+    DestroyTerrainChunk(i);
+  }
 }
@@ -0,0 +1,69 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+
+#include "../engine.h"
+
+void IPhysicsBody::StoreTransform(const PLMatrix4& transform) {
+  if (!has_transform_) {
+    ResetTransform(transform);
+    return;
+  }
+
+  previous_transform_ = current_transform_;
+  current_transform_ = transform;
+}
+
+void IPhysicsBody::ResetTransform(const PLMatrix4& transform) {
+  previous_transform_ = current_transform_ = transform;
+  has_transform_ = true;
+}
+
+/**
+ * Blends from the previous transform towards the current one. The
+ * rotation is blended per axis and then squared back up, which is
+ * close enough given how little a body turns in a single tick.
+ */
+PLMatrix4 IPhysicsBody::GetInterpolatedTransform(float factor) const {
+  PLMatrix4 out;
+  for (unsigned int i = 0; i < 16; ++i) {
+    out.m[i] = previous_transform_.m[i] + (current_transform_.m[i] - previous_transform_.m[i]) * factor;
+  }
+
+  // Gram-Schmidt over the three axes
+  float* axes[3] = {&out.m[0], &out.m[4], &out.m[8]};
+  for (unsigned int i = 0; i < 3; ++i) {
+    float* axis = axes[i];
+    for (unsigned int j = 0; j < i; ++j) {
+      const float* other = axes[j];
+      float d = axis[0] * other[0] + axis[1] * other[1] + axis[2] * other[2];
+      axis[0] -= other[0] * d;
+      axis[1] -= other[1] * d;
+      axis[2] -= other[2] * d;
+    }
+
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (length > 0) {
+      axis[0] /= length;
+      axis[1] /= length;
+      axis[2] /= length;
+    }
+  }
+
+  return out;
+}
@@ -17,6 +17,10 @@
 
 #pragma once
 
+#define PHYSICS_MAX_SUBSTEPS  16
+#define PHYSICS_MAX_POOLED    1024  // Retired bodies kept around for reuse
+#define PHYSICS_SLEEP_TICKS   10    // Ticks a body must idle for before it's put to sleep
+
 enum class PhysicsPrimitiveType {
   SPHERE,
   BOX,
@@ -29,13 +33,37 @@ enum class PhysicsPrimitiveType {
   COMPOUND_CONVEX_CRUZ,
 };
 
+struct PhysicsStats {
+  unsigned int num_active_bodies{0};
+  unsigned int num_sleeping_bodies{0};
+  unsigned int num_pooled_bodies{0};
+  unsigned int num_shapes{0};
+  unsigned int num_allocations{0};  // Made by the physics library between the end of the tick before and the last
+  double solver_time{0};            // Milliseconds spent stepping the last tick
+};
+
 class IPhysicsBody {
  public:
+  // Transforms as of the last two physics ticks, so that drawing can
+  // blend between them rather than jumping from one to the next
+  const PLMatrix4& GetTransform() const { return current_transform_; }
+  const PLMatrix4& GetPreviousTransform() const { return previous_transform_; }
+  PLMatrix4 GetInterpolatedTransform(float factor) const;
+
+  bool HasTransform() const { return has_transform_; }
+
  protected:
   IPhysicsBody() = default;
   virtual ~IPhysicsBody() = default;
 
+  void StoreTransform(const PLMatrix4& transform);
+  // i.e. when teleporting, so there's nothing to blend from
+  void ResetTransform(const PLMatrix4& transform);
+
  private:
+  PLMatrix4 previous_transform_{plMatrix4Identity()};
+  PLMatrix4 current_transform_{plMatrix4Identity()};
+  bool has_transform_{false};
 };
 
 class IPhysicsInterface {
@@ -45,10 +73,26 @@ class IPhysicsInterface {
 
   virtual void Tick() = 0;
 
-  virtual IPhysicsBody* CreatePhysicsBody() = 0;
+  // Size is the full extents for a box, the radius for a sphere, and
+  // the radius and height for anything round. Bodies without any mass
+  // are static. Shapes of the same type and size are shared.
+  virtual IPhysicsBody* CreatePhysicsBody(PhysicsPrimitiveType type,
+                                          const PLVector3& size,
+                                          float mass,
+                                          const PLVector3& position) = 0;
+  // Retired bodies go back into a pool, to be handed out again later
   virtual void DestroyPhysicsBody(IPhysicsBody* body) = 0;
 
-  virtual void GenerateTerrainCollision(std::vector<float> vertices) = 0;
+  virtual const PhysicsStats& GetStats() const = 0;
+
+  // Heights are the tile corners across the whole terrain, row by row,
+  // and materials are the surface and behaviour of each tile
+  virtual void GenerateTerrainCollision(const std::vector<float>& heights,
+                                        const std::vector<uint8_t>& materials) = 0;
+  // Rebuilds the collision for a single chunk, i.e. after it's been deformed
+  virtual void UpdateTerrainCollision(unsigned int chunk,
+                                      const std::vector<float>& heights,
+                                      const std::vector<uint8_t>& materials) = 0;
   virtual void DestroyTerrainCollision() = 0;
 
  protected:
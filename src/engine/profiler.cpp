@@ -0,0 +1,401 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#include "engine.h"
+#include "profiler.h"
+
+#if PROFILER_ENABLED
+
+struct ProfileEvent {
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+/**
+ * Only the thread it belongs to writes into the ring; the main thread
+ * reads it back when the frame ends. Threads that finish hand theirs
+ * over to the next one started, so short lived ones don't pile up.
+ */
+struct ProfileThread {
+	unsigned int id{ 0 };
+	const char* name{ nullptr };
+	std::atomic<bool> is_free{ false };
+	std::atomic<uint64_t> head{ 0 };  // Number of events ever written
+	uint64_t folded{ 0 };             // and how many of those the statistics have seen
+
+	ProfileEvent events[PROFILER_MAX_EVENTS];
+};
+
+struct NameCompare {
+	bool operator()( const char* a, const char* b ) const { return strcmp( a, b ) < 0; }
+};
+
+// One value for each frame, indexed by frame number
+struct ProfileHistory {
+	uint64_t first_frame{ 0 };
+	double values[PROFILER_MAX_FRAMES]{};
+};
+
+typedef std::map<const char*, ProfileHistory, NameCompare> ProfileHistoryMap;
+
+static std::mutex threads_mutex;
+static std::vector<ProfileThread*> threads;
+
+static struct {
+	std::atomic<bool> is_paused{ false };
+
+	uint64_t num_frames{ 0 };   // Frames started
+	uint64_t num_folded{ 0 };   // and finished
+	uint64_t frame_starts[PROFILER_MAX_FRAMES]{};
+	ProfileHistory frame_times;
+
+	std::map<const char*, double, NameCompare> totals;
+	ProfileHistoryMap zones;
+
+	std::map<const char*, double, NameCompare> counters;
+	ProfileHistoryMap counter_history;
+} profiler;
+
+struct ProfileThreadHandle {
+	ProfileThread* thread{ nullptr };
+	~ProfileThreadHandle() {
+		if ( thread != nullptr ) {
+			thread->is_free = true;
+		}
+	}
+};
+
+static thread_local ProfileThreadHandle local_thread;
+
+static ProfileThread* GetLocalThread() {
+	if ( local_thread.thread != nullptr ) {
+		return local_thread.thread;
+	}
+
+	std::lock_guard<std::mutex> lock( threads_mutex );
+	for ( auto thread : threads ) {
+		bool is_free = true;
+		if ( thread->is_free.compare_exchange_strong( is_free, false ) ) {
+			thread->name = nullptr;
+			return ( local_thread.thread = thread );
+		}
+	}
+
+	ProfileThread* thread = new ProfileThread();
+	thread->id = static_cast<unsigned int>(threads.size());
+	threads.push_back( thread );
+	return ( local_thread.thread = thread );
+}
+
+uint64_t Profiler_GetTime() {
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - epoch ).count());
+}
+
+void Profiler_RecordZone( const char* name, uint64_t start, uint64_t end ) {
+	if ( profiler.is_paused.load( std::memory_order_relaxed ) ) {
+		return;
+	}
+
+	ProfileThread* thread = GetLocalThread();
+	uint64_t head = thread->head.load( std::memory_order_relaxed );
+	ProfileEvent& event = thread->events[ head % PROFILER_MAX_EVENTS ];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	thread->head.store( head + 1, std::memory_order_release );
+}
+
+void Profiler_SetThreadName( const char* name ) {
+	GetLocalThread()->name = name;
+}
+
+static void StoreHistory( ProfileHistoryMap& map, const char* name, uint64_t frame, double value ) {
+	auto i = map.find( name );
+	if ( i == map.end() ) {
+		i = map.insert( std::make_pair( name, ProfileHistory() ) ).first;
+		i->second.first_frame = frame;
+	}
+
+	i->second.values[ frame % PROFILER_MAX_FRAMES ] = value;
+}
+
+/**
+ * Totals up the zones recorded on every thread since the last
+ * frame, and keeps them, along with the counters, for the frame.
+ */
+static void FoldFrame( uint64_t end ) {
+	uint64_t frame = profiler.num_folded;
+
+	profiler.totals.clear();
+	{
+		std::lock_guard<std::mutex> lock( threads_mutex );
+		for ( auto thread : threads ) {
+			uint64_t head = thread->head.load( std::memory_order_acquire );
+			uint64_t i = std::max( thread->folded, head > PROFILER_MAX_EVENTS ? head - PROFILER_MAX_EVENTS : 0 );
+			for ( ; i < head; ++i ) {
+				const ProfileEvent& event = thread->events[ i % PROFILER_MAX_EVENTS ];
+				profiler.totals[ event.name ] += static_cast<double>(event.end - event.start);
+			}
+			thread->folded = head;
+		}
+	}
+
+	for ( const auto& total : profiler.totals ) {
+		StoreHistory( profiler.zones, total.first, frame, total.second / 1000000.0 );
+	}
+
+	// Anything that didn't turn up this frame took no time at all
+	for ( auto& zone : profiler.zones ) {
+		if ( profiler.totals.find( zone.first ) == profiler.totals.end() ) {
+			zone.second.values[ frame % PROFILER_MAX_FRAMES ] = 0;
+		}
+	}
+
+	for ( const auto& counter : profiler.counters ) {
+		StoreHistory( profiler.counter_history, counter.first, frame, counter.second );
+	}
+
+	uint64_t start = profiler.frame_starts[ frame % PROFILER_MAX_FRAMES ];
+	profiler.frame_times.values[ frame % PROFILER_MAX_FRAMES ] = static_cast<double>(end - start) / 1000000.0;
+
+	profiler.num_folded++;
+}
+
+void Profiler_MarkFrame() {
+	if ( profiler.is_paused ) {
+		return;
+	}
+
+	uint64_t now = Profiler_GetTime();
+	if ( profiler.num_frames > 0 ) {
+		FoldFrame( now );
+	}
+
+	profiler.frame_starts[ profiler.num_frames % PROFILER_MAX_FRAMES ] = now;
+	profiler.num_frames++;
+}
+
+void Profiler_SetCounter( const char* name, double value ) {
+	profiler.counters[ name ] = value;
+}
+
+void Profiler_SetPaused( bool paused ) {
+	profiler.is_paused = paused;
+}
+
+bool Profiler_IsPaused() {
+	return profiler.is_paused;
+}
+
+static ProfileStats GetStats( const char* name, const ProfileHistory& history ) {
+	ProfileStats stats{ name, 0, 0, 0, 0 };
+
+	uint64_t first = std::max( history.first_frame,
+							   profiler.num_folded > PROFILER_MAX_FRAMES ? profiler.num_folded - PROFILER_MAX_FRAMES : 0 );
+	if ( first >= profiler.num_folded ) {
+		return stats;
+	}
+
+	std::vector<double> values;
+	values.reserve( static_cast<size_t>(profiler.num_folded - first) );
+	for ( uint64_t i = first; i < profiler.num_folded; ++i ) {
+		values.push_back( history.values[ i % PROFILER_MAX_FRAMES ] );
+	}
+
+	stats.last = values.back();
+
+	std::sort( values.begin(), values.end() );
+	stats.min = values.front();
+	stats.median = values[ values.size() / 2 ];
+	stats.p99 = values[ std::min( values.size() - 1, values.size() * 99 / 100 ) ];
+	return stats;
+}
+
+void Profiler_GetFrameStats( ProfileStats* out ) {
+	*out = GetStats( "Frame", profiler.frame_times );
+}
+
+void Profiler_GetZoneStats( std::vector<ProfileStats>& out ) {
+	out.clear();
+	for ( const auto& zone : profiler.zones ) {
+		out.push_back( GetStats( zone.first, zone.second ) );
+	}
+}
+
+void Profiler_GetCounterStats( std::vector<ProfileStats>& out ) {
+	out.clear();
+	for ( const auto& counter : profiler.counter_history ) {
+		out.push_back( GetStats( counter.first, counter.second ) );
+	}
+}
+
+static std::string EscapeJson( const char* string ) {
+	std::string out;
+	for ( const char* c = string; *c != '\0'; ++c ) {
+		if ( *c == '"' || *c == '\\' ) {
+			out += '\\';
+		}
+		out += *c;
+	}
+	return out;
+}
+
+// Trace timestamps are in microseconds
+static double ToMicroseconds( uint64_t time ) {
+	return static_cast<double>(time) / 1000.0;
+}
+
+/**
+ * Writes out the last few frames in the Chrome trace event format. Zones
+ * become complete events on their thread, frames are instant events and
+ * counters are sampled once a frame.
+ */
+bool Profiler_ExportTrace( const std::string& path, unsigned int num_frames ) {
+	uint64_t available = std::min<uint64_t>( profiler.num_folded, PROFILER_MAX_FRAMES );
+	num_frames = static_cast<unsigned int>(std::min<uint64_t>( num_frames, available ));
+	if ( num_frames == 0 ) {
+		LogWarn( "No frames have been recorded yet!\n" );
+		return false;
+	}
+
+	std::ofstream output( path );
+	if ( !output.is_open() ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return false;
+	}
+
+	uint64_t first_frame = profiler.num_folded - num_frames;
+	uint64_t start = profiler.frame_starts[ first_frame % PROFILER_MAX_FRAMES ];
+	uint64_t end = profiler.frame_starts[ profiler.num_folded % PROFILER_MAX_FRAMES ];
+
+	char buf[256];
+	unsigned int num_events = 0;
+	output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	{
+		std::lock_guard<std::mutex> lock( threads_mutex );
+		for ( auto thread : threads ) {
+			snprintf( buf, sizeof( buf ),
+					  R"({"name":"thread_name","ph":"M","pid":1,"tid":%u,"args":{"name":"%s"}})",
+					  thread->id, thread->name != nullptr ? EscapeJson( thread->name ).c_str() : "Worker" );
+			output << ( num_events++ > 0 ? "," : "" ) << "\n" << buf;
+
+			uint64_t head = thread->head.load( std::memory_order_acquire );
+			for ( uint64_t i = head > PROFILER_MAX_EVENTS ? head - PROFILER_MAX_EVENTS : 0; i < head; ++i ) {
+				const ProfileEvent& event = thread->events[ i % PROFILER_MAX_EVENTS ];
+				if ( event.end < start || event.start >= end ) {
+					continue;
+				}
+
+				snprintf( buf, sizeof( buf ), R"({"name":"%s","ph":"X","pid":1,"tid":%u,"ts":%.3f,"dur":%.3f})",
+						  EscapeJson( event.name ).c_str(), thread->id,
+						  ToMicroseconds( event.start ), ToMicroseconds( event.end - event.start ) );
+				output << ",\n" << buf;
+				num_events++;
+			}
+		}
+	}
+
+	for ( uint64_t frame = first_frame; frame < profiler.num_folded; ++frame ) {
+		double ts = ToMicroseconds( profiler.frame_starts[ frame % PROFILER_MAX_FRAMES ] );
+		snprintf( buf, sizeof( buf ), R"({"name":"Frame %u","ph":"i","s":"g","pid":1,"tid":0,"ts":%.3f})",
+				  static_cast<unsigned int>(frame), ts );
+		output << ",\n" << buf;
+
+		for ( const auto& counter : profiler.counter_history ) {
+			if ( frame < counter.second.first_frame ) {
+				continue;
+			}
+
+			snprintf( buf, sizeof( buf ), R"({"name":"%s","ph":"C","pid":1,"ts":%.3f,"args":{"value":%g}})",
+					  EscapeJson( counter.first ).c_str(), ts, counter.second.values[ frame % PROFILER_MAX_FRAMES ] );
+			output << ",\n" << buf;
+		}
+	}
+
+	output << "\n]}\n";
+	if ( !output.good() ) {
+		LogWarn( "Failed to write trace, \"%s\"!\n", path.c_str() );
+		return false;
+	}
+
+	LogInfo( "Wrote %u frames to \"%s\"\n", num_frames, path.c_str() );
+	return true;
+}
+
+static void ExportCommand( unsigned int argc, char* argv[] ) {
+	if ( argc < 2 ) {
+		LogWarn( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	unsigned int num_frames = PROFILER_MAX_FRAMES;
+	if ( argc > 2 && atoi( argv[ 2 ] ) > 0 ) {
+		num_frames = static_cast<unsigned int>(atoi( argv[ 2 ] ));
+	}
+
+	Profiler_ExportTrace( argv[ 1 ], num_frames );
+}
+
+void Profiler_Initialize() {
+	Profiler_SetThreadName( "Main" );
+
+	plRegisterConsoleCommand( "profilerExport", ExportCommand,
+							  "Writes recorded frames out as a Chrome trace, profilerExport <file> [frames]" );
+}
+
+void Profiler_Shutdown() {
+	// Anything still running keeps hold of its buffer, so they're left be
+}
+
+#else
+
+void Profiler_SetThreadName( const char* name ) { u_unused( name ); }
+void Profiler_MarkFrame() {}
+void Profiler_SetCounter( const char* name, double value ) {
+	u_unused( name );
+	u_unused( value );
+}
+void Profiler_SetPaused( bool paused ) { u_unused( paused ); }
+bool Profiler_IsPaused() { return true; }
+
+void Profiler_GetFrameStats( ProfileStats* out ) { *out = ProfileStats{ "Frame", 0, 0, 0, 0 }; }
+void Profiler_GetZoneStats( std::vector<ProfileStats>& out ) { out.clear(); }
+void Profiler_GetCounterStats( std::vector<ProfileStats>& out ) { out.clear(); }
+
+bool Profiler_ExportTrace( const std::string& path, unsigned int num_frames ) {
+	u_unused( path );
+	u_unused( num_frames );
+	LogWarn( "Profiler was compiled out!\n" );
+	return false;
+}
+
+void Profiler_Initialize() {}
+void Profiler_Shutdown() {}
+
+#endif
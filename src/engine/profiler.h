@@ -0,0 +1,102 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Scoped CPU zones, recorded into a ring buffer for each thread, with
+ * frame markers and counters on top. Every frame the zones are totalled
+ * up by name, so the last few seconds can be shown as rolling statistics
+ * or written out as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+ *
+ * Zone and counter names are expected to be string literals, as only
+ * the pointer is kept. Configuring with -DOPENHOW_PROFILER=OFF compiles
+ * every PROFILE_ macro down to nothing.
+ */
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#define PROFILER_MAX_EVENTS     ( 1U << 16 )    // Ring buffer size for each thread
+#define PROFILER_MAX_FRAMES     256             // Frames kept for statistics and export
+
+struct ProfileStats {
+	const char* name;
+	double last;
+	double min;
+	double median;
+	double p99;
+};
+
+#if PROFILER_ENABLED
+
+uint64_t Profiler_GetTime();
+void Profiler_RecordZone( const char* name, uint64_t start, uint64_t end );
+
+class ProfileScope {
+public:
+	explicit ProfileScope( const char* name ) : name_( name ), start_( Profiler_GetTime() ) {}
+	~ProfileScope() { Profiler_RecordZone( name_, start_, Profiler_GetTime() ); }
+
+	ProfileScope( const ProfileScope& ) = delete;
+	ProfileScope& operator=( const ProfileScope& ) = delete;
+
+private:
+	const char* name_;
+	uint64_t start_;
+};
+
+#define PROFILE_CONCAT_( A, B )         A ## B
+#define PROFILE_CONCAT( A, B )          PROFILE_CONCAT_( A, B )
+
+#define PROFILE_SCOPE( NAME )           ProfileScope PROFILE_CONCAT( profile_scope_, __LINE__ )( NAME )
+#define PROFILE_FRAME()                 Profiler_MarkFrame()
+#define PROFILE_COUNTER( NAME, VALUE )  Profiler_SetCounter( NAME, static_cast<double>(VALUE) )
+#define PROFILE_THREAD( NAME )          Profiler_SetThreadName( NAME )
+
+#else
+
+#define PROFILE_SCOPE( NAME )
+#define PROFILE_FRAME()
+#define PROFILE_COUNTER( NAME, VALUE )
+#define PROFILE_THREAD( NAME )
+
+#endif
+
+// Names the calling thread in exported traces
+void Profiler_SetThreadName( const char* name );
+
+// Only to be called from the main thread
+void Profiler_MarkFrame();
+void Profiler_SetCounter( const char* name, double value );
+
+void Profiler_SetPaused( bool paused );
+bool Profiler_IsPaused();
+
+// Times are in milliseconds, counters as they were given
+void Profiler_GetFrameStats( ProfileStats* out );
+void Profiler_GetZoneStats( std::vector<ProfileStats>& out );
+void Profiler_GetCounterStats( std::vector<ProfileStats>& out );
+
+bool Profiler_ExportTrace( const std::string& path, unsigned int num_frames );
+
+void Profiler_Initialize();
+void Profiler_Shutdown();
@@ -25,7 +25,7 @@ Property::Property(PropertyOwner &po, const std::string &name, unsigned flags):
 	is_dirty_(false)
 {
 	auto x = po_.properties_.insert(std::make_pair(name, this));
-	u_assert(x.second); /* Check for name collision */
+	u_assert(x.second, "Property %s already exists!\n", name.c_str()); /* Check for name collision */
 }
 
 Property::Property(PropertyOwner &po, const Property &src):
@@ -37,7 +37,7 @@ Property::Property(PropertyOwner &po, const Property &src):
 	clean_serialised_(src.clean_serialised_)
 {
 	auto x = po_.properties_.insert(std::make_pair(name, this));
-	u_assert(x.second); /* Check for name collision */
+	u_assert(x.second, "Property %s already exists!\n", name.c_str()); /* Check for name collision */
 }
 
 Property::~Property()
@@ -53,6 +53,8 @@ void Property::MarkClean()
 
 void Property::MarkDirty()
 {
+	changed_tick_ = g_state.sim_ticks;
+
 	if(!is_dirty_)
 	{
 		is_dirty_ = true;
@@ -77,9 +79,97 @@ unsigned int Property::DirtyTicks() const
 	}
 }
 
+bool Property::ChangedSince(unsigned int tick) const
+{
+	return tick == SNAPSHOT_FULL || changed_tick_ > tick;
+}
+
+void Property::Encode(SnapshotWriter &writer) const
+{
+	writer.WriteString(Serialise());
+}
+
+void Property::Decode(SnapshotReader &reader)
+{
+	std::string serialised = reader.ReadString();
+	if(reader.IsValid())
+	{
+		Deserialise(serialised);
+	}
+}
+
 PropertyOwner::PropertyOwner() {}
 PropertyOwner::~PropertyOwner() {}
 
 std::string PropertyOwner::SerializePropertiesAsJson() {
-  return "";
+  std::string json = "{";
+  for(const auto& i : properties_) {
+    if(json.size() > 1) {
+      json += ",";
+    }
+    json += "\"" + i.first + "\":" + i.second->SerialiseAsJson();
+  }
+  json += "}";
+  return json;
+}
+
+/**
+ * Each property is written as the gap since the previous one that
+ * was written, followed by its value, so the whole thing only costs
+ * a byte of overhead per property for most owners.
+ */
+void PropertyOwner::WriteSnapshot(SnapshotWriter &writer, unsigned int baseline, unsigned int exclude_flags) {
+  unsigned int num_changed = 0;
+  for(const auto& i : properties_) {
+    if(!(i.second->flags & exclude_flags) && i.second->ChangedSince(baseline)) {
+      num_changed++;
+    }
+  }
+
+  writer.WriteVarint(num_changed);
+
+  unsigned int index = 0, last_index = 0;
+  for(const auto& i : properties_) {
+    if(!(i.second->flags & exclude_flags) && i.second->ChangedSince(baseline)) {
+      writer.WriteVarint(index - last_index);
+      i.second->Encode(writer);
+      last_index = index + 1;
+    }
+    index++;
+  }
+}
+
+bool PropertyOwner::HasChangesSince(unsigned int baseline, unsigned int exclude_flags, unsigned int require_flags) {
+  for(const auto& i : properties_) {
+    if(i.second->flags & exclude_flags) {
+      continue;
+    }
+    if(require_flags != 0 && !(i.second->flags & require_flags)) {
+      continue;
+    }
+    if(i.second->ChangedSince(baseline)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool PropertyOwner::ReadSnapshot(SnapshotReader &reader) {
+  uint64_t num_changed = reader.ReadVarint();
+
+  auto property = properties_.begin();
+  for(uint64_t i = 0; i < num_changed && reader.IsValid(); ++i) {
+    uint64_t skip = reader.ReadVarint();
+    if(skip >= static_cast<uint64_t>(std::distance(property, properties_.end()))) {
+      reader.Invalidate();
+      break;
+    }
+
+    std::advance(property, skip);
+    property->second->Decode(reader);
+    ++property;
+  }
+
+  return reader.IsValid();
 }
@@ -22,6 +22,8 @@
 #include <string>
 #include <string.h>
 
+#include "snapshot.h"
+
 /**
  * @defgroup PropertyFlags Property flags
  */
@@ -92,10 +94,26 @@ public:
 		 * Sets the value to the given serialised one, which must have been returned from
 		 * a call to Serialise(). Marks the property as dirty.
 		 *
-		 * Throws XXX and makes no change to the property if the serialised form isn't
-		 * valid.
+		 * Warns and makes no change to the property if the serialised form isn't
+		 * valid, as it may have come from a save or a peer.
 		*/
 		virtual void Deserialise(const std::string &serialised) = 0;
+
+		/**
+		 * @brief Writes the property's value into a binary snapshot.
+		 *
+		 * Defaults to the serialised form, prefixed with its length. Properties with
+		 * a more compact representation should override this and Decode().
+		*/
+		virtual void Encode(SnapshotWriter &writer) const;
+
+		/**
+		 * @brief Reads the property's value back from a binary snapshot.
+		 *
+		 * Marks the property as dirty. Makes no change to the property if the
+		 * snapshot is malformed, which is left to the caller to check for.
+		*/
+		virtual void Decode(SnapshotReader &reader);
 		
 		/**
 		 * @brief Mark the property as clean and save the current value.
@@ -122,6 +140,13 @@ public:
 		 * @brief Returns the number of ticks the property has been dirty for.
 		*/
 		unsigned int DirtyTicks() const;
+
+		/**
+		 * @brief Returns true if the property has been changed after the given tick.
+		 *
+		 * Unlike the dirty state, this is updated on every change.
+		*/
+		bool ChangedSince(unsigned int tick) const;
 		
 	protected:
 		PropertyOwner &po_;
@@ -133,6 +158,7 @@ public:
 	private:
 		bool is_dirty_;
 		unsigned int dirty_since_{ 0 };
+		unsigned int changed_tick_{ 0 };
 		
 		std::string clean_serialised_;
 };
@@ -157,6 +183,33 @@ class PropertyOwner
 		const PropertyMap& GetProperties() { return properties_; }
 
 		virtual std::string SerializePropertiesAsJson();
+
+		/**
+		 * @brief Writes out every property changed since the baseline tick.
+		 *
+		 * Properties are identified by their position within the owner, so the
+		 * snapshot can only be read back by an owner of the same class.
+		 *
+		 * @param baseline       Tick the reader is known to be up to date with, or
+		 *                       SNAPSHOT_FULL for everything
+		 * @param exclude_flags  Properties with any of these PROP_XXX flags are skipped
+		*/
+		void WriteSnapshot(SnapshotWriter &writer, unsigned int baseline = SNAPSHOT_FULL, unsigned int exclude_flags = 0);
+
+		/**
+		 * @brief Returns true if WriteSnapshot() would write anything.
+		 *
+		 * @param require_flags  If set, only properties with one of these flags count
+		*/
+		bool HasChangesSince(unsigned int baseline, unsigned int exclude_flags = 0, unsigned int require_flags = 0);
+
+		/**
+		 * @brief Applies a snapshot written by WriteSnapshot().
+		 *
+		 * @return False if the snapshot was malformed, in which case some of the
+		 *         properties may already have been updated
+		*/
+		bool ReadSnapshot(SnapshotReader &reader);
 	
 	protected:
 		PropertyOwner();
@@ -219,10 +272,31 @@ template<typename T> class NumericProperty: public Property
 		
 		void Deserialise(const std::string &serialised) override
 		{
-			u_assert(serialised.length() == sizeof(value_));
+			if(serialised.length() != sizeof(value_))
+			{
+				LogWarn("Invalid serialised length for %s, ignoring!\n", name.c_str());
+				return;
+			}
+
 			memcpy(&value_, serialised.data(), sizeof(value_));
 			MarkDirty();
 		}
+
+		void Encode(SnapshotWriter &writer) const override
+		{
+			writer.WriteNumeric(value_);
+		}
+
+		void Decode(SnapshotReader &reader) override
+		{
+			T value;
+			reader.ReadNumeric(value);
+			if(reader.IsValid())
+			{
+				value_ = value;
+				MarkDirty();
+			}
+		}
 };
 
 class VectorStringProperty : public Property {
@@ -266,19 +340,27 @@ class VectorStringProperty : public Property {
   }
 
   void Deserialise(const std::string& serialised) override {
-    value_.clear();
-
-    /* TODO: Assertions should be a bad-serialised-value exception */
+    std::vector<std::string> value;
     for (size_t i = 0; i < serialised.length();) {
-      assert((i + sizeof(uint32_t)) < serialised.length());
-      uint32_t l = *(uint32_t*) (serialised.data() + i);
-      i += sizeof(uint32_t);
+      uint32_t l;
+      if ((serialised.length() - i) < sizeof(l)) {
+        LogWarn("Invalid serialised length for %s, ignoring!\n", name.c_str());
+        return;
+      }
 
-      assert((i + l) < serialised.length());
-      value_.emplace_back((serialised.data() + i), l);
+      memcpy(&l, serialised.data() + i, sizeof(l));
+      i += sizeof(l);
+
+      if ((serialised.length() - i) < l) {
+        LogWarn("Invalid serialised length for %s, ignoring!\n", name.c_str());
+        return;
+      }
+
+      value.emplace_back((serialised.data() + i), l);
       i += l;
     }
 
+    value_ = std::move(value);
     MarkDirty();
   }
 };
@@ -334,11 +416,12 @@ class StringProperty : public Property {
 class Vector3Property : public Property {
 private:
 	PLVector3 value_;
+	float precision_;  // Step it's quantised to in snapshots
 
 public:
 	Vector3Property( PropertyOwner& po, const std::string& name, unsigned flags,
-					 PLVector3 value = PLVector3( 0, 0, 0 ) ) :
-		Property( po, name, flags ), value_( value ) {}
+					 PLVector3 value = PLVector3( 0, 0, 0 ), float precision = SNAPSHOT_VECTOR_PRECISION ) :
+		Property( po, name, flags ), value_( value ), precision_( precision ) {}
 
 	operator const PLVector3&() const {
 		return value_;
@@ -361,8 +444,39 @@ public:
 				std::to_string( value_.z ) );
 	}
 
-	std::string Serialise() const override { return ""; } // todo
-	void Deserialise( const std::string& serialised ) override {} // todo
+	std::string Serialise() const override {
+		float v[ 3 ] = { value_.x, value_.y, value_.z };
+		return std::string( ( const char* ) v, sizeof( v ) );
+	}
+
+	void Deserialise( const std::string& serialised ) override {
+		float v[ 3 ];
+		if ( serialised.length() != sizeof( v ) ) {
+			LogWarn( "Invalid serialised length for %s, ignoring!\n", name.c_str() );
+			return;
+		}
+
+		memcpy( v, serialised.data(), sizeof( v ) );
+		value_ = PLVector3( v[ 0 ], v[ 1 ], v[ 2 ] );
+		MarkDirty();
+	}
+
+	void Encode( SnapshotWriter& writer ) const override {
+		writer.WriteQuantised( value_.x, precision_ );
+		writer.WriteQuantised( value_.y, precision_ );
+		writer.WriteQuantised( value_.z, precision_ );
+	}
+
+	void Decode( SnapshotReader& reader ) override {
+		PLVector3 value;
+		value.x = reader.ReadQuantised( precision_ );
+		value.y = reader.ReadQuantised( precision_ );
+		value.z = reader.ReadQuantised( precision_ );
+		if ( reader.IsValid() ) {
+			value_ = value;
+			MarkDirty();
+		}
+	}
 };
 
 /**
@@ -405,6 +519,21 @@ public:
 		std::string SerialiseAsJson() const override {
 		  return Serialise();
 		}
+
+		void Encode(SnapshotWriter &writer) const override
+		{
+			writer.WriteByte(value_ ? 1 : 0);
+		}
+
+		void Decode(SnapshotReader &reader) override
+		{
+			uint8_t value = reader.ReadByte();
+			if(reader.IsValid())
+			{
+				value_ = value != 0;
+				MarkDirty();
+			}
+		}
 		
 		void Deserialise(const std::string &serialised) override
 		{
@@ -419,8 +548,7 @@ public:
 				MarkDirty();
 			}
 			else{
-				/* TODO: Have a this-isn't-valid exception */
-				abort();
+				LogWarn("Invalid serialised value for %s, ignoring!\n", name.c_str());
 			}
 		}
 };
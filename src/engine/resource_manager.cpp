@@ -16,6 +16,7 @@
  */
 
 #include "engine.h"
+#include "memory_tracker.h"
 #include "resource_manager.h"
 #include "graphics/shaders.h"
 
@@ -47,6 +48,12 @@ hwResourceManager::~hwResourceManager() {
 	ClearTextures( true );
 	ClearModels( true );
 
+	if ( g_state.is_headless ) {
+		u_free( fallback_texture_ );
+		u_free( fallback_model_ );
+		return;
+	}
+
 	plDestroyTexture( fallback_texture_ );
 	plDestroyModel( fallback_model_ );
 }
@@ -77,6 +84,13 @@ PLModel* hwResourceManager::GetCachedModel( const std::string& path ) {
 
 PLTexture* hwResourceManager::LoadTexture( const std::string& path, PLTextureFilter filter, bool persist,
 										   bool abort_on_fail ) {
+	MEMORY_TAG( MEMORY_TAG_TEXTURES );
+
+	// Nothing's ever drawn, so don't bother decoding anything
+	if ( g_state.is_headless ) {
+		return GetFallbackTexture();
+	}
+
 	const char* ext = plGetFileExtension( path.c_str() );
 	if ( plIsEmptyString( ext ) ) {
 		const char* fp = u_find2( path.c_str(), supported_image_formats, abort_on_fail );
@@ -135,6 +149,12 @@ PLTexture* hwResourceManager::LoadTexture( const std::string& path, PLTextureFil
 }
 
 PLModel* hwResourceManager::LoadModel( const std::string& path, bool persist, bool abort_on_fail ) {
+	MEMORY_TAG( MEMORY_TAG_MODELS );
+
+	if ( g_state.is_headless ) {
+		return GetFallbackModel();
+	}
+
 	const char* fp = u_find2( path.c_str(), supported_model_formats, abort_on_fail );
 	if ( fp == nullptr ) {
 		return CacheModel( path, GetFallbackModel(), persist );
@@ -163,6 +183,13 @@ PLTexture* hwResourceManager::GetFallbackTexture() {
 		return fallback_texture_;
 	}
 
+	// Without a context there's nothing to upload to, so it's a placeholder
+	if ( g_state.is_headless ) {
+		fallback_texture_ = static_cast<PLTexture*>(u_alloc( 1, sizeof( PLTexture ), true ));
+		fallback_texture_->w = fallback_texture_->h = 2;
+		return fallback_texture_;
+	}
+
 	PLColour pbuffer[] = {
 		{ 255, 255, 0, 255 }, { 0, 255, 255, 255 },
 		{ 0, 255, 255, 255 }, { 255, 255, 0, 255 } };
@@ -186,6 +213,11 @@ PLModel* hwResourceManager::GetFallbackModel() {
 		return fallback_model_;
 	}
 
+	// As above, with no meshes as there's nothing to draw them with
+	if ( g_state.is_headless ) {
+		return ( fallback_model_ = static_cast<PLModel*>(u_alloc( 1, sizeof( PLModel ), true )) );
+	}
+
 	PLMesh* mesh = plCreateMesh( PL_MESH_LINES, PL_DRAW_DYNAMIC, 0, 6 );
 	plSetMeshVertexPosition( mesh, 0, PLVector3( 0, 20, 0 ) );
 	plSetMeshVertexPosition( mesh, 1, PLVector3( 0, -20, 0 ) );
@@ -0,0 +1,607 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include "engine.h"
+#include "journal.h"
+#include "savegame.h"
+#include "snapshot.h"
+#include "profiler.h"
+#include "Map.h"
+
+#include "game/actor_manager.h"
+#include "game/player.h"
+
+#define SAVE_IDENTIFIER     "HOWS"
+#define SAVE_TAG_SIZE       4
+
+#define SAVE_VERIFY_TICKS   ( TICKS_PER_SECOND * 5 )
+
+using namespace openhow;
+
+/**
+ * Only one save is written at a time; the buffer belongs to
+ * the thread until it's been joined.
+ */
+static struct {
+	std::thread thread;
+	std::atomic<bool> is_done{ false };
+	bool is_ok{ false };
+
+	std::string path;
+	std::vector<uint8_t> buffer;
+	unsigned int capture_ms{ 0 };
+	unsigned int start_ms{ 0 };
+} pending;
+
+/**
+ * Checking a save comes back the same is done in two halves; the
+ * checksum of each tick is recorded after the game's captured, and
+ * then again once it's restored, and the two have to match up.
+ */
+static struct {
+	bool is_active{ false };
+	bool is_restored{ false };
+	bool has_passed{ false };
+
+	std::vector<uint8_t> buffer;
+	uint32_t start_checksum{ 0 };
+	std::vector<uint32_t> checksums;
+	unsigned int num_ticks{ 0 };
+	unsigned int cur_tick{ 0 };
+} verify;
+
+static void WriteChunk( SnapshotWriter& writer, const char* tag, const SnapshotWriter& chunk ) {
+	writer.WriteBytes( reinterpret_cast<const uint8_t*>(tag), SAVE_TAG_SIZE );
+	writer.WriteVarint( chunk.GetSize() );
+	writer.WriteBytes( chunk.GetData(), chunk.GetSize() );
+}
+
+static void SaveActors( SnapshotWriter& writer ) {
+	const ActorSet& actors = ActorManager::GetInstance()->GetActors();
+	writer.WriteVarint( actors.size() );
+
+	SnapshotWriter state;
+	for ( auto actor : actors ) {
+		writer.WriteVarint( actor->GetId() );
+		writer.WriteString( actor->GetSpawnClassName() );
+
+		Actor* parent = actor->GetParent();
+		writer.WriteVarint( parent != nullptr ? parent->GetId() : 0 );
+
+		std::vector<const Property*> properties;
+		for ( const auto& property : actor->GetProperties() ) {
+			if ( property.second->flags & PROP_DISCARD ) {
+				continue;
+			}
+			properties.push_back( property.second );
+		}
+
+		writer.WriteVarint( properties.size() );
+		for ( auto property : properties ) {
+			writer.WriteString( property->name );
+			writer.WriteString( property->Serialise() );
+		}
+
+		state.Clear();
+		actor->SaveState( state );
+		writer.WriteVarint( state.GetSize() );
+		writer.WriteBytes( state.GetData(), state.GetSize() );
+	}
+}
+
+static void SavePlayers( SnapshotWriter& writer ) {
+	const PlayerPtrVector& players = Engine::Game()->GetPlayers();
+	writer.WriteVarint( players.size() );
+	for ( auto player : players ) {
+		const std::vector<Actor*>& children = player->GetChildren();
+		writer.WriteVarint( children.size() );
+		for ( auto child : children ) {
+			writer.WriteVarint( child->GetId() );
+		}
+
+		writer.WriteVarint( player->GetCurrentChildIndex() );
+
+		const PlayerCommand& command = player->GetCommand();
+		writer.WriteVarint( command.sequence );
+		writer.WriteFloat( command.forward );
+		writer.WriteFloat( command.yaw );
+		writer.WriteFloat( command.pitch );
+	}
+}
+
+/**
+ * Copies everything that makes up the game into the writer. This
+ * happens between ticks, so there's nothing moving underneath it.
+ */
+static bool CaptureGame( SnapshotWriter& writer ) {
+	GameManager* game = Engine::Game();
+	Map* map = game->GetCurrentMap();
+	if ( !game->IsModeActive() || map == nullptr ) {
+		LogWarn( "No game in progress to save!\n" );
+		return false;
+	}
+
+	writer.WriteBytes( reinterpret_cast<const uint8_t*>(SAVE_IDENTIFIER), SAVE_TAG_SIZE );
+	writer.WriteVarint( SAVE_VERSION );
+
+	SnapshotWriter chunk;
+	chunk.WriteString( map->GetManifest()->filename );
+	const PlayerPtrVector& players = game->GetPlayers();
+	chunk.WriteVarint( players.size() );
+	for ( auto player : players ) {
+		chunk.WriteByte( static_cast<uint8_t>(player->GetType()) );
+	}
+	chunk.WriteVarint( Sim_GetRandomState() );
+	WriteChunk( writer, "INFO", chunk );
+
+	chunk.Clear();
+	game->SaveState( chunk );
+	WriteChunk( writer, "GAME", chunk );
+
+	chunk.Clear();
+	map->GetTerrain()->SaveState( chunk );
+	WriteChunk( writer, "TERR", chunk );
+
+	chunk.Clear();
+	SaveActors( chunk );
+	WriteChunk( writer, "ACTR", chunk );
+
+	chunk.Clear();
+	SavePlayers( chunk );
+	WriteChunk( writer, "PLYR", chunk );
+
+	return true;
+}
+
+/**
+ * Makes sure the right map is running with the same players,
+ * starting it up again if not.
+ */
+static bool PrepareGame( const std::string& map_name, const std::vector<PlayerType>& types ) {
+	GameManager* game = Engine::Game();
+	Map* map = game->GetCurrentMap();
+	if ( game->IsModeActive() && map != nullptr && map->GetManifest()->filename == map_name ) {
+		const PlayerPtrVector& players = game->GetPlayers();
+		bool is_matching = ( players.size() == types.size() );
+		for ( size_t i = 0; is_matching && i < players.size(); ++i ) {
+			is_matching = ( players[ i ]->GetType() == types[ i ] );
+		}
+
+		if ( is_matching ) {
+			return true;
+		}
+	}
+
+	// The map command sets up one local player followed by any networked ones
+	unsigned int num_networked = 0;
+	for ( size_t i = 1; i < types.size(); ++i ) {
+		if ( types[ i ] != PlayerType::NETWORKED ) {
+			LogWarn( "Saved players can't be set up again, only local then networked players are supported!\n" );
+			return false;
+		}
+		num_networked++;
+	}
+
+	std::string command = "map " + map_name + " " + std::to_string( num_networked );
+	plParseConsoleString( command.c_str() );
+	if ( !game->IsModeActive() ) {
+		LogWarn( "Failed to start \"%s\" for the save!\n", map_name.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+struct RestoredActor {
+	Actor* actor;
+	unsigned int parent;
+	const uint8_t* state;
+	size_t state_size;
+};
+
+static bool RestoreActors( SnapshotReader& reader, std::map<unsigned int, Actor*>& ids ) {
+	unsigned int num_actors = static_cast<unsigned int>(reader.ReadVarint());
+
+	std::vector<RestoredActor> restored;
+	for ( unsigned int i = 0; i < num_actors && reader.IsValid(); ++i ) {
+		unsigned int id = static_cast<unsigned int>(reader.ReadVarint());
+		std::string class_name = reader.ReadString();
+
+		RestoredActor entry;
+		entry.parent = static_cast<unsigned int>(reader.ReadVarint());
+		entry.actor = reader.IsValid() ? ActorManager::GetInstance()->CreateActor( class_name ) : nullptr;
+
+		unsigned int num_properties = static_cast<unsigned int>(reader.ReadVarint());
+		for ( unsigned int j = 0; j < num_properties && reader.IsValid(); ++j ) {
+			std::string name = reader.ReadString();
+			std::string value = reader.ReadString();
+			if ( entry.actor == nullptr || !reader.IsValid() ) {
+				continue;
+			}
+
+			const PropertyMap& properties = entry.actor->GetProperties();
+			auto property = properties.find( name );
+			if ( property == properties.end() ) {
+				LogWarn( "Skipping unknown property, \"%s\", for \"%s\"!\n", name.c_str(), class_name.c_str() );
+				continue;
+			}
+
+			property->second->Deserialise( value );
+		}
+
+		entry.state_size = static_cast<size_t>(reader.ReadVarint());
+		entry.state = reader.ReadBlock( entry.state_size );
+
+		if ( entry.actor == nullptr ) {
+			continue;
+		}
+
+		ids[ id ] = entry.actor;
+		restored.push_back( entry );
+	}
+
+	if ( !reader.IsValid() ) {
+		return false;
+	}
+
+	// Parents first, as actors look for their children when restoring
+	for ( const auto& entry : restored ) {
+		if ( entry.parent == 0 ) {
+			continue;
+		}
+
+		auto parent = ids.find( entry.parent );
+		if ( parent == ids.end() ) {
+			LogWarn( "Missing parent, %u, for \"%s\"!\n", entry.parent, entry.actor->GetSpawnClassName().c_str() );
+			continue;
+		}
+
+		parent->second->LinkChild( entry.actor );
+	}
+
+	for ( const auto& entry : restored ) {
+		SnapshotReader state( entry.state, entry.state_size );
+		entry.actor->RestoreState( state );
+		if ( !state.IsValid() ) {
+			LogWarn( "Failed to restore state for \"%s\"!\n", entry.actor->GetSpawnClassName().c_str() );
+		}
+	}
+
+	return true;
+}
+
+static bool RestorePlayers( SnapshotReader& reader, const std::map<unsigned int, Actor*>& ids ) {
+	const PlayerPtrVector& players = Engine::Game()->GetPlayers();
+	if ( reader.ReadVarint() != players.size() ) {
+		return false;
+	}
+
+	for ( auto player : players ) {
+		player->ClearChildren();
+
+		unsigned int num_children = static_cast<unsigned int>(reader.ReadVarint());
+		for ( unsigned int i = 0; i < num_children && reader.IsValid(); ++i ) {
+			auto child = ids.find( static_cast<unsigned int>(reader.ReadVarint()) );
+			if ( child != ids.end() ) {
+				player->AddChild( child->second );
+			}
+		}
+
+		player->SetCurrentChildIndex( static_cast<unsigned int>(reader.ReadVarint()) );
+
+		PlayerCommand command;
+		command.sequence = static_cast<unsigned int>(reader.ReadVarint());
+		command.forward = reader.ReadFloat();
+		command.yaw = reader.ReadFloat();
+		command.pitch = reader.ReadFloat();
+		player->SetCommand( command );
+	}
+
+	return reader.IsValid();
+}
+
+static bool RestoreGame( const uint8_t* data, size_t size ) {
+	if ( size < SAVE_TAG_SIZE || memcmp( data, SAVE_IDENTIFIER, SAVE_TAG_SIZE ) != 0 ) {
+		LogWarn( "Not a saved game!\n" );
+		return false;
+	}
+
+	SnapshotReader reader( data + SAVE_TAG_SIZE, size - SAVE_TAG_SIZE );
+	uint64_t version = reader.ReadVarint();
+	if ( version == 0 || version > SAVE_VERSION ) {
+		LogWarn( "Unsupported save version, %d, expected %d or older!\n", static_cast<int>(version), SAVE_VERSION );
+		return false;
+	}
+
+	// Index everything first, so nothing's touched if the file is cut short
+	std::map<std::string, std::pair<const uint8_t*, size_t>> chunks;
+	while ( reader.IsValid() && !reader.IsAtEnd() ) {
+		const uint8_t* tag = reader.ReadBlock( SAVE_TAG_SIZE );
+		size_t chunk_size = static_cast<size_t>(reader.ReadVarint());
+		const uint8_t* chunk = reader.ReadBlock( chunk_size );
+		if ( !reader.IsValid() ) {
+			break;
+		}
+
+		chunks[ std::string( reinterpret_cast<const char*>(tag), SAVE_TAG_SIZE ) ] = std::make_pair( chunk, chunk_size );
+	}
+
+	static const char* required[] = { "INFO", "GAME", "ACTR", "PLYR" };
+	for ( const char* tag : required ) {
+		if ( chunks.find( tag ) == chunks.end() ) {
+			reader.Invalidate();
+		}
+	}
+
+	if ( !reader.IsValid() ) {
+		LogWarn( "Save is malformed or incomplete!\n" );
+		return false;
+	}
+
+	SnapshotReader info( chunks[ "INFO" ].first, chunks[ "INFO" ].second );
+	std::string map_name = info.ReadString();
+	std::vector<PlayerType> types( static_cast<size_t>(info.ReadVarint()) );
+	for ( auto& type : types ) {
+		type = static_cast<PlayerType>(info.ReadByte());
+	}
+	uint32_t random_state = static_cast<uint32_t>(info.ReadVarint());
+	if ( !info.IsValid() || !PrepareGame( map_name, types ) ) {
+		return false;
+	}
+
+	// Clear out what's there; players hang on to their pigs, which are about to go
+	for ( auto player : Engine::Game()->GetPlayers() ) {
+		player->ClearChildren();
+	}
+	ActorManager::GetInstance()->DestroyActors();
+
+	bool is_ok = true;
+	auto terrain = chunks.find( "TERR" );
+	if ( terrain != chunks.end() ) {
+		SnapshotReader chunk( terrain->second.first, terrain->second.second );
+		is_ok &= Engine::Game()->GetCurrentMap()->GetTerrain()->RestoreState( chunk );
+	}
+
+	std::map<unsigned int, Actor*> ids;
+	SnapshotReader actors( chunks[ "ACTR" ].first, chunks[ "ACTR" ].second );
+	is_ok &= RestoreActors( actors, ids );
+
+	SnapshotReader players( chunks[ "PLYR" ].first, chunks[ "PLYR" ].second );
+	is_ok &= RestorePlayers( players, ids );
+
+	SnapshotReader game( chunks[ "GAME" ].first, chunks[ "GAME" ].second );
+	Engine::Game()->RestoreState( game );
+	is_ok &= game.IsValid();
+
+	Sim_SeedRandom( random_state );
+
+	if ( !is_ok ) {
+		LogWarn( "Failed to restore everything from the save, the game may be incomplete!\n" );
+	}
+
+	return is_ok;
+}
+
+static void WriteThread() {
+	PROFILE_THREAD( "Save" );
+	PROFILE_SCOPE( "Save Write" );
+
+	std::ofstream output( pending.path, std::ios::binary );
+	if ( output.is_open() ) {
+		output.write( reinterpret_cast<const char*>(pending.buffer.data()), pending.buffer.size() );
+		pending.is_ok = output.good();
+	}
+
+	pending.is_done = true;
+}
+
+static void FinishWrite() {
+	if ( !pending.thread.joinable() ) {
+		return;
+	}
+
+	pending.thread.join();
+
+	if ( pending.is_ok ) {
+		LogInfo( "Saved \"%s\", %u bytes (captured in %ums, written in %ums)\n",
+				 pending.path.c_str(), static_cast<unsigned int>(pending.buffer.size()),
+				 pending.capture_ms, System_GetTicks() - pending.start_ms );
+	} else {
+		LogWarn( "Failed to write save, \"%s\"!\n", pending.path.c_str() );
+	}
+
+	pending.buffer.clear();
+	pending.buffer.shrink_to_fit();
+}
+
+bool Save_Write( const std::string& path ) {
+	FinishWrite();
+
+	unsigned int start_ms = System_GetTicks();
+
+	SnapshotWriter writer;
+	if ( !CaptureGame( writer ) ) {
+		return false;
+	}
+
+	pending.path = path;
+	writer.Swap( pending.buffer );
+	pending.start_ms = System_GetTicks();
+	pending.capture_ms = pending.start_ms - start_ms;
+	pending.is_ok = false;
+	pending.is_done = false;
+	pending.thread = std::thread( WriteThread );
+	return true;
+}
+
+bool Save_Read( const std::string& path ) {
+	// In case it's the one that's still being written
+	FinishWrite();
+
+	unsigned int start_ms = System_GetTicks();
+
+	PLFile* file = plOpenFile( path.c_str(), false );
+	if ( file == nullptr ) {
+		LogWarn( "Failed to open save, \"%s\"!\n", path.c_str() );
+		return false;
+	}
+
+	// All in one go, then everything is read out of memory
+	std::vector<uint8_t> buffer( plGetFileSize( file ) );
+	size_t size = plReadFile( file, buffer.data(), 1, buffer.size() );
+	plCloseFile( file );
+
+	if ( !RestoreGame( buffer.data(), size ) ) {
+		LogWarn( "Failed to load save, \"%s\"!\n", path.c_str() );
+		return false;
+	}
+
+	LogInfo( "Loaded \"%s\" in %ums\n", path.c_str(), System_GetTicks() - start_ms );
+	return true;
+}
+
+bool Save_IsWriting() {
+	return pending.thread.joinable() && !pending.is_done;
+}
+
+static void StopVerify() {
+	verify.is_active = false;
+	verify.buffer.clear();
+	verify.checksums.clear();
+}
+
+static void TickVerify() {
+	uint32_t checksum = Journal_GetStateChecksum();
+
+	if ( !verify.is_restored ) {
+		verify.checksums.push_back( checksum );
+		if ( verify.checksums.size() < verify.num_ticks ) {
+			return;
+		}
+
+		if ( !RestoreGame( verify.buffer.data(), verify.buffer.size() ) ) {
+			LogWarn( "Failed to restore the save being verified!\n" );
+			StopVerify();
+			return;
+		}
+
+		checksum = Journal_GetStateChecksum();
+		if ( checksum != verify.start_checksum ) {
+			LogWarn( "Restored game doesn't match the original (%08x, expected %08x)!\n", checksum, verify.start_checksum );
+			StopVerify();
+			return;
+		}
+
+		verify.is_restored = true;
+		verify.cur_tick = 0;
+		return;
+	}
+
+	if ( checksum != verify.checksums[ verify.cur_tick ] ) {
+		LogWarn( "Restored game diverged at tick %u (%08x, expected %08x)!\n",
+				 verify.cur_tick + 1, checksum, verify.checksums[ verify.cur_tick ] );
+		StopVerify();
+		return;
+	}
+
+	if ( ++verify.cur_tick >= verify.checksums.size() ) {
+		LogInfo( "Restored game ticked the same as the original for %u ticks\n", verify.cur_tick );
+		verify.has_passed = true;
+		StopVerify();
+	}
+}
+
+bool Save_IsVerifying() {
+	return verify.is_active;
+}
+
+bool Save_HasVerifyPassed() {
+	return verify.has_passed;
+}
+
+void Save_EndTick() {
+	if ( pending.thread.joinable() && pending.is_done ) {
+		FinishWrite();
+	}
+
+	if ( verify.is_active ) {
+		TickVerify();
+	}
+}
+
+/////////////////////////////////////////////////////////////
+
+static void SaveCommand( unsigned int argc, char* argv[] ) {
+	if ( argc < 2 ) {
+		LogWarn( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	Save_Write( argv[ 1 ] );
+}
+
+static void LoadCommand( unsigned int argc, char* argv[] ) {
+	if ( argc < 2 ) {
+		LogWarn( "Invalid number of arguments, ignoring!\n" );
+		return;
+	}
+
+	Save_Read( argv[ 1 ] );
+}
+
+static void VerifyCommand( unsigned int argc, char* argv[] ) {
+	StopVerify();
+
+	int num_ticks = ( argc > 1 ) ? atoi( argv[ 1 ] ) : SAVE_VERIFY_TICKS;
+	if ( num_ticks <= 0 ) {
+		LogWarn( "Invalid number of ticks, \"%s\"!\n", argv[ 1 ] );
+		return;
+	}
+
+	SnapshotWriter writer;
+	if ( !CaptureGame( writer ) ) {
+		return;
+	}
+
+	writer.Swap( verify.buffer );
+	verify.start_checksum = Journal_GetStateChecksum();
+	verify.num_ticks = static_cast<unsigned int>(num_ticks);
+	verify.is_restored = false;
+	verify.has_passed = false;
+	verify.is_active = true;
+
+	LogInfo( "Verifying save over %d ticks, %u bytes\n", num_ticks, static_cast<unsigned int>(verify.buffer.size()) );
+}
+
+void Save_Initialize() {
+	plRegisterConsoleCommand( "saveGame", SaveCommand, "Saves the game in progress, saveGame <file>" );
+	plRegisterConsoleCommand( "loadGame", LoadCommand, "Loads a saved game, loadGame <file>" );
+	plRegisterConsoleCommand( "saveVerify", VerifyCommand,
+							  "Saves the game, runs it for a number of ticks, then restores it and checks it "
+							  "runs the same; leave the input alone while it's going" );
+}
+
+void Save_Shutdown() {
+	StopVerify();
+	FinishWrite();
+}
@@ -0,0 +1,52 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/* A saved game is a "HOWS" identifier and a varint version, followed by a
+ * series of chunks. Each chunk is a four character tag and a varint size,
+ * so anything a reader doesn't know about can be skipped over.
+ *
+ * INFO     map name, varint count of players each followed by its type
+ *          byte, and then the varint RNG state
+ * GAME     state of the game manager and the current mode
+ * TERR     varint count of tile corner heights, then the heights as
+ *          little-endian floats in a single block
+ * ACTR     varint count of actors, in the order they're ticked; each is a
+ *          varint id, class name, varint parent id (0 for none), a varint
+ *          count of properties as name and serialised value pairs and then
+ *          a varint size followed by anything else the actor saved
+ * PLYR     varint count of players; each is a varint count of child ids,
+ *          the ids, the varint current child and then the last command
+ */
+
+#define SAVE_VERSION 1
+
+// Captures the game straight away, then leaves a thread to write it out
+bool Save_Write( const std::string& path );
+bool Save_Read( const std::string& path );
+
+bool Save_IsWriting();
+// Whether a saveVerify is still going, and if not whether the last one passed
+bool Save_IsVerifying();
+bool Save_HasVerifyPassed();
+
+// Called at the end of each simulation tick
+void Save_EndTick();
+
+void Save_Initialize();
+void Save_Shutdown();
@@ -0,0 +1,500 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <stdexcept>
+
+#include "../engine.h"
+#include "json.h"
+
+#define JSON_MAX_DEPTH  256
+
+// Beyond these the quick conversion might not round correctly
+#define JSON_MAX_EXACT_MANTISSA     ( 1ULL << 53U )
+#define JSON_MAX_EXACT_EXPONENT     22
+#define JSON_MAX_DIGITS             19  // Everything past this is only counted
+
+static bool IsDigit( char c ) { return c >= '0' && c <= '9'; }
+
+/**
+ * Up to 19 significant digits are gathered into an integer along with
+ * the power of ten it's to be scaled by. When both are small enough to
+ * be held exactly, one multiply or divide gives the correctly rounded
+ * result. Anything else is left to strtod, with the decimal point
+ * swapped for whatever the locale expects.
+ */
+const char* Json_ReadNumber( const char* str, double* out ) {
+	static const double powers[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	const char* cur = str;
+	bool is_negative = ( *cur == '-' );
+	if ( *cur == '+' || *cur == '-' ) {
+		cur++;
+	}
+
+	if ( strncmp( cur, "Infinity", 8 ) == 0 ) {
+		*out = is_negative ? -HUGE_VAL : HUGE_VAL;
+		return cur + 8;
+	}
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	unsigned int num_digits = 0, num_significant = 0;
+	bool is_exact = true;
+	bool is_fraction = false;
+	for ( ;; ++cur ) {
+		if ( *cur == '.' && !is_fraction ) {
+			is_fraction = true;
+			continue;
+		} else if ( !IsDigit( *cur ) ) {
+			break;
+		}
+
+		num_digits++;
+		if ( num_significant < JSON_MAX_DIGITS ) {
+			mantissa = mantissa * 10 + static_cast<unsigned int>(*cur - '0');
+			num_significant += ( mantissa != 0 ) ? 1 : 0;
+			exponent -= is_fraction ? 1 : 0;
+		} else {
+			exponent += is_fraction ? 0 : 1;
+			is_exact = is_exact && *cur == '0';
+		}
+	}
+
+	if ( num_digits == 0 ) {
+		*out = 0;
+		return str;
+	}
+
+	// Only an exponent if there are digits to go with it
+	if ( *cur == 'e' || *cur == 'E' ) {
+		const char* e = cur + 1;
+		bool is_negative_exponent = ( *e == '-' );
+		if ( *e == '+' || *e == '-' ) {
+			e++;
+		}
+
+		if ( IsDigit( *e ) ) {
+			int value = 0;
+			for ( ; IsDigit( *e ); ++e ) {
+				// Way past where anything overflows, or comes out as zero
+				value = std::min( value * 10 + ( *e - '0' ), 100000 );
+			}
+			exponent += is_negative_exponent ? -value : value;
+			cur = e;
+		}
+	}
+
+	if ( mantissa == 0 ) {
+		*out = is_negative ? -0.0 : 0.0;
+		return cur;
+	}
+
+	if ( is_exact && mantissa <= JSON_MAX_EXACT_MANTISSA &&
+		exponent >= -JSON_MAX_EXACT_EXPONENT && exponent <= JSON_MAX_EXACT_EXPONENT ) {
+		double value = static_cast<double>(mantissa);
+		value = ( exponent < 0 ) ? value / powers[ -exponent ] : value * powers[ exponent ];
+		*out = is_negative ? -value : value;
+		return cur;
+	}
+
+	std::string text( str, cur );
+	char decimal_point = *localeconv()->decimal_point;
+	for ( auto& c : text ) {
+		if ( c == '.' ) {
+			c = decimal_point;
+		}
+	}
+	*out = strtod( text.c_str(), nullptr );
+	return cur;
+}
+
+class JsonParser {
+public:
+	explicit JsonParser( JsonDocument* document ) :
+		document_( document ),
+		cur_( document->text_.data() ),
+		line_start_( document->text_.data() ) {}
+
+	void Parse() {
+		// Skip over the byte order mark some editors like to add
+		if ( strncmp( cur_, "\xEF\xBB\xBF", 3 ) == 0 ) {
+			cur_ += 3;
+			line_start_ = cur_;
+		}
+
+		JsonNode root;
+		SkipWhitespace();
+		ParseValue( &root, 0 );
+		SkipWhitespace();
+		if ( *cur_ != '\0' ) {
+			Fail( "unexpected text after the end of the document" );
+		}
+
+		document_->nodes_.push_back( root );
+	}
+
+private:
+	[[noreturn]] void Fail( const char* message ) {
+		char error[256];
+		snprintf( error, sizeof( error ), "Failed to parse JSON at line %u, column %u, %s!\n",
+				  line_, static_cast<unsigned int>(cur_ - line_start_) + 1, message );
+		throw std::runtime_error( error );
+	}
+
+	void SkipWhitespace() {
+		for ( ;; ++cur_ ) {
+			if ( *cur_ == '\n' ) {
+				line_++;
+				line_start_ = cur_ + 1;
+			} else if ( *cur_ != ' ' && *cur_ != '\t' && *cur_ != '\r' ) {
+				return;
+			}
+		}
+	}
+
+	void Expect( const char* literal ) {
+		for ( const char* c = literal; *c != '\0'; ++c, ++cur_ ) {
+			if ( *cur_ != *c ) {
+				Fail( "invalid literal" );
+			}
+		}
+	}
+
+	void ParseValue( JsonNode* out, unsigned int depth ) {
+		switch ( *cur_ ) {
+			case '{':
+				ParseObject( out, depth );
+				break;
+			case '[':
+				ParseArray( out, depth );
+				break;
+			case '"':
+				out->type = JsonType::STRING;
+				ParseString( &out->string, &out->length );
+				break;
+			case 't':
+				Expect( "true" );
+				out->type = JsonType::BOOLEAN;
+				out->boolean = true;
+				break;
+			case 'f':
+				Expect( "false" );
+				out->type = JsonType::BOOLEAN;
+				out->boolean = false;
+				break;
+			case 'n':
+				Expect( "null" );
+				out->type = JsonType::NUL;
+				break;
+			case '\0':
+				Fail( "unexpected end of the document" );
+			default:
+				ParseNumber( out );
+				break;
+		}
+	}
+
+	void ParseNumber( JsonNode* out ) {
+		char* start = cur_;
+		if ( *cur_ == '-' ) {
+			cur_++;
+		}
+
+		if ( *cur_ == '0' ) {
+			cur_++;
+		} else if ( IsDigit( *cur_ ) ) {
+			while ( IsDigit( *cur_ ) ) { cur_++; }
+		} else {
+			Fail( "unexpected character" );
+		}
+
+		if ( *cur_ == '.' ) {
+			cur_++;
+			if ( !IsDigit( *cur_ ) ) {
+				Fail( "expected a digit after the decimal point" );
+			}
+			while ( IsDigit( *cur_ ) ) { cur_++; }
+		}
+
+		if ( *cur_ == 'e' || *cur_ == 'E' ) {
+			cur_++;
+			if ( *cur_ == '+' || *cur_ == '-' ) {
+				cur_++;
+			}
+			if ( !IsDigit( *cur_ ) ) {
+				Fail( "expected a digit in the exponent" );
+			}
+			while ( IsDigit( *cur_ ) ) { cur_++; }
+		}
+
+		Json_ReadNumber( start, &out->number );
+
+		out->type = JsonType::NUMBER;
+		out->string = start;
+		out->length = static_cast<uint32_t>(cur_ - start);
+	}
+
+	static int GetHexDigit( char c ) {
+		if ( c >= '0' && c <= '9' ) return c - '0';
+		if ( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+		if ( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+		return -1;
+	}
+
+	uint32_t ParseHex() {
+		uint32_t value = 0;
+		for ( unsigned int i = 0; i < 4; ++i, ++cur_ ) {
+			int digit = GetHexDigit( *cur_ );
+			if ( digit < 0 ) {
+				Fail( "invalid unicode escape" );
+			}
+			value = ( value << 4U ) | static_cast<uint32_t>(digit);
+		}
+		return value;
+	}
+
+	static char* WriteUtf8( char* out, uint32_t c ) {
+		if ( c < 0x80 ) {
+			*out++ = static_cast<char>(c);
+		} else if ( c < 0x800 ) {
+			*out++ = static_cast<char>(0xC0 | ( c >> 6U ));
+			*out++ = static_cast<char>(0x80 | ( c & 0x3F ));
+		} else if ( c < 0x10000 ) {
+			*out++ = static_cast<char>(0xE0 | ( c >> 12U ));
+			*out++ = static_cast<char>(0x80 | ( ( c >> 6U ) & 0x3F ));
+			*out++ = static_cast<char>(0x80 | ( c & 0x3F ));
+		} else {
+			*out++ = static_cast<char>(0xF0 | ( c >> 18U ));
+			*out++ = static_cast<char>(0x80 | ( ( c >> 12U ) & 0x3F ));
+			*out++ = static_cast<char>(0x80 | ( ( c >> 6U ) & 0x3F ));
+			*out++ = static_cast<char>(0x80 | ( c & 0x3F ));
+		}
+		return out;
+	}
+
+	/**
+	 * Decodes the string over the top of itself, which always fits
+	 * as nothing decodes to more than it took to write it out, and
+	 * terminates it where it ends up.
+	 */
+	void ParseString( const char** out, uint32_t* length ) {
+		cur_++;
+
+		char* start = cur_;
+		char* write = cur_;
+		for ( ;; ) {
+			char c = *cur_;
+			if ( c == '"' ) {
+				break;
+			} else if ( c == '\0' ) {
+				Fail( "unterminated string" );
+			} else if ( static_cast<unsigned char>(c) < 0x20 ) {
+				Fail( "control character in string" );
+			} else if ( c != '\\' ) {
+				*write++ = c;
+				cur_++;
+				continue;
+			}
+
+			cur_++;
+			switch ( *cur_++ ) {
+				case '"': *write++ = '"'; break;
+				case '\\': *write++ = '\\'; break;
+				case '/': *write++ = '/'; break;
+				case 'b': *write++ = '\b'; break;
+				case 'f': *write++ = '\f'; break;
+				case 'n': *write++ = '\n'; break;
+				case 'r': *write++ = '\r'; break;
+				case 't': *write++ = '\t'; break;
+				case 'u': {
+					uint32_t code = ParseHex();
+					if ( code >= 0xD800 && code <= 0xDBFF && cur_[ 0 ] == '\\' && cur_[ 1 ] == 'u' ) {
+						cur_ += 2;
+						uint32_t low = ParseHex();
+						if ( low < 0xDC00 || low > 0xDFFF ) {
+							Fail( "invalid surrogate pair" );
+						}
+						code = 0x10000 + ( ( code - 0xD800 ) << 10U ) + ( low - 0xDC00 );
+					} else if ( code >= 0xD800 && code <= 0xDFFF ) {
+						// Half of a pair on its own has no UTF-8 of its own
+						code = 0xFFFD;
+					}
+					write = WriteUtf8( write, code );
+					break;
+				}
+				default:
+					cur_--;
+					Fail( "invalid escape in string" );
+			}
+		}
+
+		cur_++;
+		*write = '\0';
+
+		*out = start;
+		*length = static_cast<uint32_t>(write - start);
+	}
+
+	/**
+	 * Children are gathered up on the scratch stack while they're parsed,
+	 * as any of their own children get added to the document first, and
+	 * are then moved over to the document together.
+	 */
+	void EndContainer( JsonNode* out, size_t base ) {
+		std::vector<JsonNode>& nodes = document_->nodes_;
+		out->first_child = static_cast<uint32_t>(nodes.size());
+		out->num_children = static_cast<uint32_t>(scratch_.size() - base);
+		nodes.insert( nodes.end(), scratch_.begin() + base, scratch_.end() );
+		scratch_.resize( base );
+	}
+
+	void ParseArray( JsonNode* out, unsigned int depth ) {
+		if ( ++depth > JSON_MAX_DEPTH ) {
+			Fail( "nested too deeply" );
+		}
+
+		out->type = JsonType::ARRAY;
+		size_t base = scratch_.size();
+
+		cur_++;
+		SkipWhitespace();
+		if ( *cur_ == ']' ) {
+			cur_++;
+			EndContainer( out, base );
+			return;
+		}
+
+		for ( ;; ) {
+			JsonNode child;
+			ParseValue( &child, depth );
+			scratch_.push_back( child );
+
+			SkipWhitespace();
+			if ( *cur_ == ',' ) {
+				cur_++;
+				SkipWhitespace();
+			} else if ( *cur_ == ']' ) {
+				cur_++;
+				break;
+			} else {
+				Fail( "expected ',' or ']'" );
+			}
+		}
+
+		EndContainer( out, base );
+	}
+
+	void ParseObject( JsonNode* out, unsigned int depth ) {
+		if ( ++depth > JSON_MAX_DEPTH ) {
+			Fail( "nested too deeply" );
+		}
+
+		out->type = JsonType::OBJECT;
+		size_t base = scratch_.size();
+
+		cur_++;
+		SkipWhitespace();
+		if ( *cur_ == '}' ) {
+			cur_++;
+			EndContainer( out, base );
+			return;
+		}
+
+		for ( ;; ) {
+			if ( *cur_ != '"' ) {
+				Fail( "expected a property name" );
+			}
+
+			JsonNode child;
+			uint32_t key_length;
+			ParseString( &child.key, &key_length );
+
+			SkipWhitespace();
+			if ( *cur_ != ':' ) {
+				Fail( "expected ':'" );
+			}
+			cur_++;
+			SkipWhitespace();
+
+			ParseValue( &child, depth );
+			scratch_.push_back( child );
+
+			SkipWhitespace();
+			if ( *cur_ == ',' ) {
+				cur_++;
+				SkipWhitespace();
+			} else if ( *cur_ == '}' ) {
+				cur_++;
+				break;
+			} else {
+				Fail( "expected ',' or '}'" );
+			}
+		}
+
+		EndContainer( out, base );
+	}
+
+	JsonDocument* document_;
+	char* cur_;
+	const char* line_start_;
+	unsigned int line_{ 1 };
+
+	std::vector<JsonNode> scratch_;
+};
+
+void JsonDocument::Parse( const char* buf, size_t length ) {
+	text_.assign( buf, buf + length );
+	text_.push_back( '\0' );
+
+	nodes_.clear();
+	// Rough guess, a node for every few bytes is about right for what we have
+	nodes_.reserve( length / 16 + 1 );
+
+	JsonParser parser( this );
+	parser.Parse();
+}
+
+const JsonNode* JsonDocument::GetChild( const JsonNode* node, const char* key ) const {
+	if ( node == nullptr || node->type != JsonType::OBJECT ) {
+		return nullptr;
+	}
+
+	// Backwards, so that the last of any duplicates wins, same as JSON.parse
+	for ( uint32_t i = node->num_children; i > 0; --i ) {
+		const JsonNode* child = &nodes_[ node->first_child + i - 1 ];
+		if ( strcmp( child->key, key ) == 0 ) {
+			return child;
+		}
+	}
+
+	return nullptr;
+}
+
+const JsonNode* JsonDocument::GetChild( const JsonNode* node, unsigned int index ) const {
+	if ( node == nullptr || ( node->type != JsonType::ARRAY && node->type != JsonType::OBJECT ) ||
+		index >= node->num_children ) {
+		return nullptr;
+	}
+
+	return &nodes_[ node->first_child + index ];
+}
@@ -0,0 +1,79 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* A read-only JSON document, parsed in one pass into a flat list of
+ * nodes. The children of each array or object sit next to each other
+ * in the list, and strings are decoded in place within the document's
+ * own copy of the text, so parsing makes very few allocations.
+ *
+ * Parse throws a std::runtime_error, with the line and column of the
+ * problem, if the text isn't valid JSON.
+ */
+
+enum class JsonType : uint8_t {
+	NUL,
+	BOOLEAN,
+	NUMBER,
+	STRING,
+	ARRAY,
+	OBJECT,
+};
+
+struct JsonNode {
+	JsonType type{ JsonType::NUL };
+	bool boolean{ false };
+
+	// Only set for the members of an object
+	const char* key{ nullptr };
+
+	// Strings, and the original text of numbers, which isn't terminated
+	const char* string{ nullptr };
+	uint32_t length{ 0 };
+
+	double number{ 0 };
+
+	// Arrays and objects
+	uint32_t first_child{ 0 };
+	uint32_t num_children{ 0 };
+};
+
+// Reads a decimal number with an optional sign, fraction and exponent, or
+// "Infinity", the same whatever the C locale has been set to. Returns where
+// the number ended, or str if there wasn't one.
+const char* Json_ReadNumber( const char* str, double* out );
+
+class JsonDocument {
+public:
+	void Parse( const char* buf, size_t length );
+
+	const JsonNode* GetRoot() const { return nodes_.empty() ? nullptr : &nodes_.back(); }
+
+	const JsonNode* GetChild( const JsonNode* node, const char* key ) const;
+	const JsonNode* GetChild( const JsonNode* node, unsigned int index ) const;
+
+private:
+	friend class JsonParser;
+
+	std::vector<char> text_;
+	std::vector<JsonNode> nodes_;
+};
@@ -16,10 +16,13 @@
  */
 
 #include <PL/platform_filesystem.h>
-#include <duktape.h>
+#include <cctype>
+#include <cmath>
+#include <iomanip>
 #include <sstream>
 
 #include "../engine.h"
+#include "../memory_tracker.h"
 #include "script_config.h"
 
 #define LogMissingProperty( P )   LogWarn("Failed to get JSON property \"%s\"!\n", (P))
@@ -48,151 +51,264 @@ ScriptConfig::ScriptConfig( const std::string& path ) : ScriptConfig() {
 	ParseBuffer( buf.data() );
 }
 
-ScriptConfig::ScriptConfig() {
-	if ( ( ctx_ = duk_create_heap_default() ) == nullptr ) {
-		throw std::bad_alloc();
+ScriptConfig::ScriptConfig() = default;
+ScriptConfig::~ScriptConfig() = default;
+
+const JsonNode* ScriptConfig::GetProperty( const std::string& property, bool silent ) {
+	const JsonNode* node = document_.GetChild( GetCurrentNode(), property.c_str() );
+	if ( node == nullptr && !silent ) {
+		LogMissingProperty( property.c_str() );
 	}
+
+	return node;
 }
 
-ScriptConfig::~ScriptConfig() {
-	if ( ctx_ != nullptr ) {
-		duk_destroy_heap( static_cast<duk_context*>(ctx_) );
+/**
+ * Number to string the way JavaScript does it; the fewest digits that
+ * read back as the same number, written out in full unless it's huge or
+ * tiny. A classic locale stream gives the digits, so the decimal point
+ * is always a point.
+ */
+static std::string NumberToString( double number ) {
+	if ( std::isnan( number ) ) {
+		return "NaN";
+	} else if ( number == 0 ) {
+		return "0";
+	} else if ( number < 0 ) {
+		return "-" + NumberToString( -number );
+	} else if ( std::isinf( number ) ) {
+		return "Infinity";
+	}
+
+	std::string digits;
+	int exponent = 0;
+	for ( int precision = 0; precision < 17; ++precision ) {
+		std::ostringstream stream;
+		stream.imbue( std::locale::classic() );
+		stream << std::scientific << std::setprecision( precision ) << number;
+
+		std::string str = stream.str();
+		double value;
+		Json_ReadNumber( str.c_str(), &value );
+		if ( value != number && precision < 16 ) {
+			continue;
+		}
+
+		size_t e = str.find( 'e' );
+		digits = str.substr( 0, 1 ) + ( ( e > 2 ) ? str.substr( 2, e - 2 ) : "" );
+		exponent = atoi( str.c_str() + e + 1 );
+		break;
 	}
+
+	digits.erase( digits.find_last_not_of( '0' ) + 1 );
+
+	// Where the decimal point goes, counting from the start of the digits
+	int k = static_cast<int>(digits.size());
+	int n = exponent + 1;
+	if ( k <= n && n <= 21 ) {
+		return digits + std::string( n - k, '0' );
+	} else if ( 0 < n && n <= 21 ) {
+		return digits.substr( 0, n ) + "." + digits.substr( n );
+	} else if ( -6 < n && n <= 0 ) {
+		return "0." + std::string( -n, '0' ) + digits;
+	}
+
+	std::string str = digits.substr( 0, 1 );
+	if ( k > 1 ) {
+		str += "." + digits.substr( 1 );
+	}
+	return str + ( ( n - 1 < 0 ) ? "e-" : "e+" ) + std::to_string( std::abs( n - 1 ) );
 }
 
-std::string ScriptConfig::GetStringProperty( const std::string& property, const std::string& def, bool silent ) {
-	auto* context = static_cast<duk_context*>(ctx_);
+/**
+ * Same conversions as JavaScript would make, as that's
+ * what was used to read these before.
+ */
+std::string ScriptConfig::ToString( const JsonNode* node ) const {
+	switch ( node->type ) {
+		case JsonType::STRING:
+			return std::string( node->string, node->length );
+		case JsonType::NUMBER:
+			return NumberToString( node->number );
+		case JsonType::BOOLEAN:
+			return node->boolean ? "true" : "false";
+		case JsonType::ARRAY: {
+			std::string str;
+			for ( unsigned int i = 0; i < node->num_children; ++i ) {
+				const JsonNode* child = document_.GetChild( node, i );
+				if ( i > 0 ) {
+					str += ",";
+				}
+				if ( child->type != JsonType::NUL ) {
+					str += ToString( child );
+				}
+			}
+			return str;
+		}
+		case JsonType::OBJECT:
+			return "[object Object]";
+		default:
+			return "null";
+	}
+}
 
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		if ( !silent ) {
-			LogMissingProperty( p );
+static double ToNumber( const JsonNode* node ) {
+	switch ( node->type ) {
+		case JsonType::NUMBER:
+			return node->number;
+		case JsonType::BOOLEAN:
+			return node->boolean ? 1.0 : 0.0;
+		case JsonType::NUL:
+			return 0.0;
+		case JsonType::STRING: {
+			const char* start = node->string;
+			while ( *start == ' ' || *start == '\t' || *start == '\n' || *start == '\r' ) { start++; }
+			if ( *start == '\0' ) {
+				return 0.0;
+			}
+
+			double number;
+			const char* end;
+			if ( start[ 0 ] == '0' && ( start[ 1 ] == 'x' || start[ 1 ] == 'X' ) && isxdigit( static_cast<unsigned char>(start[ 2 ]) ) ) {
+				char* hex_end;
+				number = static_cast<double>(strtoull( start + 2, &hex_end, 16 ));
+				end = hex_end;
+			} else if ( ( end = Json_ReadNumber( start, &number ) ) == start ) {
+				return NAN;
+			}
+			while ( *end == ' ' || *end == '\t' || *end == '\n' || *end == '\r' ) { end++; }
+			return ( *end == '\0' ) ? number : NAN;
 		}
-		return def;
+		default:
+			return NAN;
 	}
+}
 
-	std::string str = duk_safe_to_string( context, -1 );
-	duk_pop( context );
+std::string ScriptConfig::GetStringProperty( const std::string& property, const std::string& def, bool silent ) {
+	const JsonNode* node = GetProperty( property, silent );
+	if ( node == nullptr ) {
+		return def;
+	}
 
-	return str;
+	return ToString( node );
 }
 
 int ScriptConfig::GetIntegerProperty( const std::string& property, int def, bool silent ) {
-	auto* context = static_cast<duk_context*>(ctx_);
-
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		if ( !silent ) {
-			LogMissingProperty( p );
-		}
+	const JsonNode* node = GetProperty( property, silent );
+	if ( node == nullptr ) {
 		return def;
 	}
 
-	int var = duk_to_int32( context, -1 );
-	duk_pop( context );
+	double number = ToNumber( node );
+	if ( !std::isfinite( number ) ) {
+		return 0;
+	}
 
-	return var;
+	// Wraps around, rather than clamping, to match ToInt32
+	return static_cast<int32_t>(static_cast<uint32_t>(static_cast<int64_t>(std::fmod( std::trunc( number ), 4294967296.0 ))));
 }
 
 bool ScriptConfig::GetBooleanProperty( const std::string& property, bool def, bool silent ) {
-	auto* context = static_cast<duk_context*>(ctx_);
-
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		if ( !silent ) {
-			LogMissingProperty( p );
-		}
+	const JsonNode* node = GetProperty( property, silent );
+	if ( node == nullptr ) {
 		return def;
 	}
 
-	auto var = static_cast<bool>(duk_to_boolean( context, -1 ));
-	duk_pop( context );
-
-	return var;
+	switch ( node->type ) {
+		case JsonType::BOOLEAN:
+			return node->boolean;
+		case JsonType::NUMBER:
+			return node->number != 0.0 && !std::isnan( node->number );
+		case JsonType::STRING:
+			return node->length > 0;
+		case JsonType::NUL:
+			return false;
+		default:
+			return true;
+	}
 }
 
 float ScriptConfig::GetFloatProperty( const std::string& property, float def, bool silent ) {
-	auto* context = static_cast<duk_context*>(ctx_);
+	const JsonNode* node = GetProperty( property, silent );
+	if ( node == nullptr ) {
+		return def;
+	}
 
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		if ( !silent ) {
-			LogMissingProperty( p );
+	return static_cast<float>(ToNumber( node ));
+}
+
+/**
+ * Reads the next number from a space separated list, i.e. "255 128 0",
+ * where each must be separated from the last by a single space.
+ */
+template< typename T, typename F >
+static bool ReadListValue( const char** cur, bool is_first, F convert, T* out ) {
+	const char* start = *cur;
+	if ( !is_first ) {
+		if ( *start != ' ' ) {
+			return false;
 		}
-		return def;
+		start++;
 	}
 
-	float var = duk_to_number( context, -1 );
-	duk_pop( context );
+	char* end;
+	T value = convert( start, &end );
+	if ( end == start ) {
+		return false;
+	}
 
-	return var;
+	*out = value;
+	*cur = end;
+	return true;
 }
 
-// https://stackoverflow.com/a/23305012
-template< char C >
-std::istream& expect( std::istream& in ) {
-	if ( in.peek() == C ) {
-		in.ignore();
-	} else {
-		in.setstate( std::ios_base::failbit );
-	}
-	return in;
+static int ReadInteger( const char* str, char** end ) {
+	return static_cast<int>(strtol( str, end, 10 ));
 }
 
-PLColour ScriptConfig::GetColourProperty( const std::string& property, PLColour def, bool silent ) {
-	auto* context = static_cast<duk_context*>(ctx_);
+static float ReadFloat( const char* str, char** end ) {
+	double number;
+	*end = const_cast<char*>(Json_ReadNumber( str, &number ));
+	return static_cast<float>(number);
+}
 
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		if ( !silent ) {
-			LogMissingProperty( p );
-		}
+PLColour ScriptConfig::GetColourProperty( const std::string& property, PLColour def, bool silent ) {
+	const JsonNode* node = GetProperty( property, silent );
+	if ( node == nullptr ) {
 		return def;
 	}
 
-	std::string str = duk_safe_to_string( context, -1 );
-	duk_pop( context );
+	std::string str = ToString( node );
+	const char* cur = str.c_str();
 
-	std::stringstream stream( str );
 	int r, g, b, a;
-	stream >> r >> expect<' '> >> g >> expect<' '> >> b;
-	if ( !( stream.rdstate() & std::stringstream::failbit ) ) {
-		stream >> expect<' '> >> a;
-		if ( stream.rdstate() & std::stringstream::failbit ) {
-			// can still ignore alpha channel
-			a = 255;
-		}
-	} else {
+	if ( !ReadListValue( &cur, true, ReadInteger, &r ) ||
+		!ReadListValue( &cur, false, ReadInteger, &g ) ||
+		!ReadListValue( &cur, false, ReadInteger, &b ) ) {
 		throw std::runtime_error( "Failed to parse entirety of colour from JSON property, \"" + property + "\"!\n" );
 	}
 
+	if ( !ReadListValue( &cur, false, ReadInteger, &a ) ) {
+		// can still ignore alpha channel
+		a = 255;
+	}
+
 	return { r, g, b, a };
 }
 
 PLVector3 ScriptConfig::GetVector3Property( const std::string& property, PLVector3 def, bool silent ) {
-	auto* context = static_cast<duk_context*>(ctx_);
-
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		if ( !silent ) {
-			LogMissingProperty( p );
-		}
+	const JsonNode* node = GetProperty( property, silent );
+	if ( node == nullptr ) {
 		return def;
 	}
 
-	std::string str = duk_safe_to_string( context, -1 );
-	duk_pop( context );
+	std::string str = ToString( node );
+	const char* cur = str.c_str();
 
 	PLVector3 out;
-	std::stringstream stream( str );
-	stream >> out.x >> expect<' '> >> out.y >> expect<' '> >> out.z;
-	if ( stream.rdstate() & std::stringstream::failbit ) {
+	if ( !ReadListValue( &cur, true, ReadFloat, &out.x ) ||
+		!ReadListValue( &cur, false, ReadFloat, &out.y ) ||
+		!ReadListValue( &cur, false, ReadFloat, &out.z ) ) {
 		throw std::runtime_error( "Failed to parse entirety of vector from JSON property, \"" + property + "\"!\n" );
 	}
 
@@ -200,99 +316,60 @@ PLVector3 ScriptConfig::GetVector3Property( const std::string& property, PLVecto
 }
 
 unsigned int ScriptConfig::GetArrayLength( const std::string& property ) {
-	auto* context = static_cast<duk_context*>(ctx_);
-
+	const JsonNode* node = GetCurrentNode();
 	if ( !property.empty() ) {
-		const char* p = property.c_str();
-		if ( !duk_get_prop_string( context, -1, p ) ) {
-			duk_pop( context );
-			LogMissingProperty( p );
+		node = GetProperty( property, false );
+		if ( node == nullptr ) {
 			return 0;
 		}
 	}
 
-	if ( !duk_is_array( context, -1 ) ) {
-		if ( !property.empty() ) {
-			duk_pop( context );
-		}
+	if ( node == nullptr || node->type != JsonType::ARRAY ) {
 		LogWarn( "Invalid array node!\n" );
 		return 0;
 	}
 
-	duk_size_t len = duk_get_length( context, -1 );
-
-	if ( !property.empty() ) {
-		duk_pop( context );
-	}
-
-	return static_cast<unsigned int>(len);
+	return node->num_children;
 }
 
 std::string ScriptConfig::GetArrayStringProperty( const std::string& property, unsigned int index ) {
-	auto* context = static_cast<duk_context*>(ctx_);
-
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		LogMissingProperty( p );
+	const JsonNode* node = GetProperty( property, false );
+	if ( node == nullptr ) {
 		return "";
 	}
 
-	if ( !duk_is_array( context, -1 ) ) {
-		duk_pop( context );
-		LogInvalidArray( p );
+	if ( node->type != JsonType::ARRAY ) {
+		LogInvalidArray( property.c_str() );
 		return "";
 	}
 
-	duk_size_t length = duk_get_length( context, -1 );
-	if ( index >= length ) {
-		LogWarn( "Invalid index, %d (%d), in array!\n", index, length );
+	if ( index >= node->num_children ) {
+		LogWarn( "Invalid index, %d (%d), in array!\n", index, node->num_children );
 		return "";
 	}
 
-	duk_get_prop_string( context, -1, p );
-	duk_get_prop_index( context, -1, index );
-	const char* str = duk_get_string( context, index );
-	duk_pop( context );
-
-	return str;
+	return ToString( document_.GetChild( node, index ) );
 }
 
 std::vector<std::string> ScriptConfig::GetArrayStrings( const std::string& property, bool silent ) {
-	auto* context = static_cast<duk_context*>(ctx_);
-
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		if ( !silent ) {
-			LogMissingProperty( p );
-		}
+	const JsonNode* node = GetProperty( property, silent );
+	if ( node == nullptr ) {
 		return {};
 	}
 
-	if ( !duk_is_array( context, -1 ) ) {
-		duk_pop( context );
+	if ( node->type != JsonType::ARRAY ) {
 		if ( !silent ) {
-			LogMissingProperty( p );
+			LogInvalidArray( property.c_str() );
 		}
 		return {};
 	}
 
-	duk_size_t length = duk_get_length( context, -1 );
-
 	std::vector<std::string> strings;
-	strings.reserve( length );
-
-	for ( size_t i = 0; i < length; ++i ) {
-		duk_get_prop_index( context, -1, i );
-		const char* c = duk_get_string( context, -1 );
-		u_assert( c != nullptr, "Null string passed by duk_get_string!\n" );
-		strings.emplace_back( c );
-		duk_pop( context );
+	strings.reserve( node->num_children );
+	for ( unsigned int i = 0; i < node->num_children; ++i ) {
+		strings.push_back( ToString( document_.GetChild( node, i ) ) );
 	}
 
-	duk_pop( context );
-
 	return strings;
 }
 
@@ -301,53 +378,58 @@ void ScriptConfig::ParseBuffer( const char* buf ) {
 		Error( "Invalid buffer length!\n" );
 	}
 
-	auto* context = static_cast<duk_context*>(ctx_);
-	duk_push_string( context, buf );
-	duk_json_decode( context, -1 );
+	MEMORY_TAG( MEMORY_TAG_SCRIPT );
+
+	document_.Parse( buf, strlen( buf ) );
+	stack_.assign( 1, document_.GetRoot() );
 }
 
 void ScriptConfig::EnterChildNode( const std::string& property ) {
-	auto* context = static_cast<duk_context*>(ctx_);
-	const char* p = property.c_str();
-	if ( !duk_get_prop_string( context, -1, p ) ) {
-		duk_pop( context );
-		LogMissingProperty( p );
-		return;
-	}
+	// Even if it's not there, so that LeaveChildNode still gets us back
+	stack_.push_back( GetProperty( property, false ) );
 }
 
 void ScriptConfig::EnterChildNode( unsigned int index ) {
-	auto* context = static_cast<duk_context*>(ctx_);
-	if ( !duk_is_array( context, -1 ) ) {
-		duk_pop( context );
+	const JsonNode* node = GetCurrentNode();
+	if ( node == nullptr || node->type != JsonType::ARRAY ) {
 		LogWarn( "Node is not an array!\n" );
+		stack_.push_back( nullptr );
 		return;
 	}
 
-	duk_size_t length = duk_get_length( context, -1 );
-	if ( index >= length ) {
-		LogWarn( "Invalid index, %d (%d), in array!\n", index, length );
+	if ( index >= node->num_children ) {
+		LogWarn( "Invalid index, %d (%d), in array!\n", index, node->num_children );
+		stack_.push_back( nullptr );
 		return;
 	}
 
-	duk_get_prop_index( context, -1, index );
+	stack_.push_back( document_.GetChild( node, index ) );
 }
 
 void ScriptConfig::LeaveChildNode() {
-	auto* context = static_cast<duk_context*>(ctx_);
-	duk_pop( context );
+	if ( stack_.size() <= 1 ) {
+		LogWarn( "Attempted to leave the root node!\n" );
+		return;
+	}
+
+	stack_.pop_back();
 }
 
 std::list<std::string> ScriptConfig::GetObjectKeys() {
 	std::list<std::string> lst;
 
-	auto* context = static_cast<duk_context*>(ctx_);
-	duk_enum( context, -1, 0 );
-	while ( duk_next( context, -1, 1 ) ) {
-		lst.emplace_back( duk_safe_to_string( context, -2 ) );
-		duk_pop_2( context );
+	const JsonNode* node = GetCurrentNode();
+	if ( node == nullptr ) {
+		return lst;
+	}
+
+	for ( unsigned int i = 0; i < node->num_children; ++i ) {
+		if ( node->type == JsonType::OBJECT ) {
+			lst.emplace_back( document_.GetChild( node, i )->key );
+		} else if ( node->type == JsonType::ARRAY ) {
+			lst.emplace_back( std::to_string( i ) );
+		}
 	}
-	duk_pop( context );
 
 	return lst;
 }
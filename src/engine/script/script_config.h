@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "json.h"
+
 class ScriptConfig {
 public:
 	explicit ScriptConfig( const std::string& path );
@@ -46,5 +48,12 @@ public:
 
 protected:
 private:
-	void* ctx_{ nullptr };
+	const JsonNode* GetCurrentNode() const { return stack_.empty() ? nullptr : stack_.back(); }
+	const JsonNode* GetProperty( const std::string& property, bool silent );
+
+	std::string ToString( const JsonNode* node ) const;
+
+	JsonDocument document_;
+	// Nodes that have been entered, a null entry is one that couldn't be found
+	std::vector<const JsonNode*> stack_;
 };
@@ -0,0 +1,151 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+
+#include "engine.h"
+#include "snapshot.h"
+
+/////////////////////////////////////////////////////////////
+// Writer
+
+void SnapshotWriter::WriteVarint( uint64_t value ) {
+	while ( value >= 0x80 ) {
+		buffer_.push_back( static_cast<uint8_t>(( value & 0x7F ) | 0x80) );
+		value >>= 7;
+	}
+	buffer_.push_back( static_cast<uint8_t>(value) );
+}
+
+void SnapshotWriter::WriteSignedVarint( int64_t value ) {
+	// Zig-zag, so that small negative numbers stay small
+	WriteVarint( ( static_cast<uint64_t>(value) << 1 ) ^ static_cast<uint64_t>(value >> 63) );
+}
+
+void SnapshotWriter::WriteFloat( float value ) {
+	uint32_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		buffer_.push_back( static_cast<uint8_t>(bits >> ( i * 8 )) );
+	}
+}
+
+void SnapshotWriter::WriteQuantised( float value, float precision ) {
+	WriteSignedVarint( static_cast<int64_t>(std::lround( value / precision )) );
+}
+
+void SnapshotWriter::WriteString( const std::string& value ) {
+	WriteVarint( value.size() );
+	buffer_.insert( buffer_.end(), value.begin(), value.end() );
+}
+
+void SnapshotWriter::WriteNumeric( double value ) {
+	uint64_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	for ( unsigned int i = 0; i < 8; ++i ) {
+		buffer_.push_back( static_cast<uint8_t>(bits >> ( i * 8 )) );
+	}
+}
+
+/////////////////////////////////////////////////////////////
+// Reader
+
+uint8_t SnapshotReader::ReadByte() {
+	if ( !is_valid_ || offset_ >= size_ ) {
+		is_valid_ = false;
+		return 0;
+	}
+
+	return data_[ offset_++ ];
+}
+
+uint64_t SnapshotReader::ReadVarint() {
+	uint64_t value = 0;
+	for ( unsigned int shift = 0; shift < 64; shift += 7 ) {
+		uint8_t byte = ReadByte();
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+		if ( !( byte & 0x80 ) ) {
+			return is_valid_ ? value : 0;
+		}
+	}
+
+	// Too many continuation bytes
+	is_valid_ = false;
+	return 0;
+}
+
+int64_t SnapshotReader::ReadSignedVarint() {
+	uint64_t value = ReadVarint();
+	return static_cast<int64_t>(( value >> 1 ) ^ ( ~( value & 1 ) + 1 ));
+}
+
+float SnapshotReader::ReadFloat() {
+	uint32_t bits = 0;
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		bits |= static_cast<uint32_t>(ReadByte()) << ( i * 8 );
+	}
+
+	float value;
+	memcpy( &value, &bits, sizeof( value ) );
+	return value;
+}
+
+float SnapshotReader::ReadQuantised( float precision ) {
+	return static_cast<float>(ReadSignedVarint()) * precision;
+}
+
+std::string SnapshotReader::ReadString() {
+	uint64_t length = ReadVarint();
+	if ( !is_valid_ || length > size_ - offset_ ) {
+		is_valid_ = false;
+		return "";
+	}
+
+	std::string value( reinterpret_cast<const char*>(data_ + offset_), static_cast<size_t>(length) );
+	offset_ += static_cast<size_t>(length);
+	return value;
+}
+
+bool SnapshotReader::ReadBytes( uint8_t* out, size_t size ) {
+	const uint8_t* block = ReadBlock( size );
+	if ( block == nullptr ) {
+		return false;
+	}
+
+	memcpy( out, block, size );
+	return true;
+}
+
+const uint8_t* SnapshotReader::ReadBlock( size_t size ) {
+	if ( !is_valid_ || size > size_ - offset_ ) {
+		is_valid_ = false;
+		return nullptr;
+	}
+
+	const uint8_t* block = data_ + offset_;
+	offset_ += size;
+	return block;
+}
+
+void SnapshotReader::ReadNumeric( double& value ) {
+	uint64_t bits = 0;
+	for ( unsigned int i = 0; i < 8; ++i ) {
+		bits |= static_cast<uint64_t>(ReadByte()) << ( i * 8 );
+	}
+
+	memcpy( &value, &bits, sizeof( value ) );
+}
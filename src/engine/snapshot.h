@@ -0,0 +1,94 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define SNAPSHOT_FULL               0xFFFFFFFFU     // Baseline that includes every property
+#define SNAPSHOT_VECTOR_PRECISION   ( 1.0f / 64 )   // Default step for quantised vectors
+
+/**
+ * Compact binary stream used for snapshots of property state.
+ * Integers are written as LEB128 varints, zig-zagged if signed,
+ * so small values only take up a byte or two.
+ */
+class SnapshotWriter {
+public:
+	void WriteByte( uint8_t value ) { buffer_.push_back( value ); }
+	void WriteVarint( uint64_t value );
+	void WriteSignedVarint( int64_t value );
+	void WriteFloat( float value );
+	// Rounds to the nearest multiple of precision
+	void WriteQuantised( float value, float precision );
+	void WriteString( const std::string& value );
+	void WriteBytes( const uint8_t* data, size_t size ) { buffer_.insert( buffer_.end(), data, data + size ); }
+
+	void WriteNumeric( int value ) { WriteSignedVarint( value ); }
+	void WriteNumeric( unsigned int value ) { WriteVarint( value ); }
+	void WriteNumeric( float value ) { WriteFloat( value ); }
+	void WriteNumeric( double value );
+
+	const uint8_t* GetData() const { return buffer_.data(); }
+	size_t GetSize() const { return buffer_.size(); }
+
+	void Clear() { buffer_.clear(); }
+	// Hands over what's been written without copying it
+	void Swap( std::vector<uint8_t>& buffer ) { buffer_.swap( buffer ); }
+
+private:
+	std::vector<uint8_t> buffer_;
+};
+
+/**
+ * Reads back a stream written by SnapshotWriter. Running off the end
+ * or hitting a malformed varint doesn't abort; everything from then
+ * on reads as zero and IsValid returns false.
+ */
+class SnapshotReader {
+public:
+	SnapshotReader( const uint8_t* data, size_t size ) : data_( data ), size_( size ) {}
+
+	uint8_t ReadByte();
+	uint64_t ReadVarint();
+	int64_t ReadSignedVarint();
+	float ReadFloat();
+	float ReadQuantised( float precision );
+	std::string ReadString();
+	bool ReadBytes( uint8_t* out, size_t size );
+	// Points at the next size bytes and skips over them, or returns null if there aren't enough
+	const uint8_t* ReadBlock( size_t size );
+
+	void ReadNumeric( int& value ) { value = static_cast<int>(ReadSignedVarint()); }
+	void ReadNumeric( unsigned int& value ) { value = static_cast<unsigned int>(ReadVarint()); }
+	void ReadNumeric( float& value ) { value = ReadFloat(); }
+	void ReadNumeric( double& value );
+
+	bool IsValid() const { return is_valid_; }
+	bool IsAtEnd() const { return offset_ >= size_; }
+	size_t GetOffset() const { return offset_; }
+
+	void Invalidate() { is_valid_ = false; }
+
+private:
+	const uint8_t* data_;
+	size_t size_;
+	size_t offset_{ 0 };
+	bool is_valid_{ true };
+};
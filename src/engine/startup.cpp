@@ -0,0 +1,308 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <ctime>
+
+#include "engine.h"
+#include "profiler.h"
+#include "startup.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define STARTUP_REPORT_FILENAME "startup.json"
+
+struct ProcessCounters {
+	double cpu_ms{ 0 };
+	uint64_t num_reads{ 0 };
+	uint64_t read_bytes{ 0 };
+};
+
+static void GetProcessCounters( ProcessCounters* out ) {
+#ifdef _WIN32
+	// clock() is wall time under MSVC, so it has to come from here instead
+	FILETIME creation, exit, kernel, user;
+	if ( GetProcessTimes( GetCurrentProcess(), &creation, &exit, &kernel, &user ) ) {
+		uint64_t k = ( static_cast<uint64_t>(kernel.dwHighDateTime) << 32U ) | kernel.dwLowDateTime;
+		uint64_t u = ( static_cast<uint64_t>(user.dwHighDateTime) << 32U ) | user.dwLowDateTime;
+		out->cpu_ms = static_cast<double>(k + u) / 10000.0;
+	}
+
+	IO_COUNTERS io;
+	if ( GetProcessIoCounters( GetCurrentProcess(), &io ) ) {
+		out->num_reads = io.ReadOperationCount;
+		out->read_bytes = io.ReadTransferCount;
+	}
+#else
+	out->cpu_ms = static_cast<double>(clock()) * 1000.0 / CLOCKS_PER_SEC;
+
+#if defined( __linux__ )
+	// Counts every read, so includes anything that came out of the page cache
+	FILE* fp = fopen( "/proc/self/io", "r" );
+	if ( fp == nullptr ) {
+		return;
+	}
+
+	char line[64];
+	unsigned long long value;
+	while ( fgets( line, sizeof( line ), fp ) != nullptr ) {
+		if ( sscanf( line, "rchar: %llu", &value ) == 1 ) {
+			out->read_bytes = value;
+		} else if ( sscanf( line, "syscr: %llu", &value ) == 1 ) {
+			out->num_reads = value;
+		}
+	}
+	fclose( fp );
+#endif
+#endif
+}
+
+static std::vector<StartupPhase> phases;
+static std::chrono::steady_clock::time_point phase_start;
+static ProcessCounters phase_counters;
+static bool is_phase_active = false;
+#if PROFILER_ENABLED
+static uint64_t phase_profile_start = 0;
+#endif
+
+static double total_ms = 0;
+static double critical_path_ms = 0;
+
+static double GetMilliseconds( std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to ) {
+	return std::chrono::duration<double, std::milli>( to - from ).count();
+}
+
+static void EndPhase() {
+	if ( !is_phase_active ) {
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	ProcessCounters counters;
+	GetProcessCounters( &counters );
+
+	StartupPhase& phase = phases.back();
+	phase.wall_ms = GetMilliseconds( phase_start, now );
+	phase.cpu_ms = counters.cpu_ms - phase_counters.cpu_ms;
+	phase.num_reads = counters.num_reads - phase_counters.num_reads;
+	phase.read_bytes = counters.read_bytes - phase_counters.read_bytes;
+
+#if PROFILER_ENABLED
+	Profiler_RecordZone( phase.name, phase_profile_start, Profiler_GetTime() );
+#endif
+
+	is_phase_active = false;
+}
+
+void Startup_BeginPhase( const char* name, std::initializer_list<const char*> dependencies ) {
+	EndPhase();
+
+	static std::chrono::steady_clock::time_point first_start = std::chrono::steady_clock::now();
+
+	StartupPhase phase;
+	phase.name = name;
+	phase.dependencies = dependencies;
+	for ( const auto& dependency : phase.dependencies ) {
+		bool found = false;
+		for ( const auto& i : phases ) {
+			found |= ( strcmp( i.name, dependency ) == 0 );
+		}
+		if ( !found ) {
+			LogWarn( "Startup phase \"%s\" depends on \"%s\", which hasn't run!\n", name, dependency );
+		}
+	}
+
+	phases.push_back( phase );
+
+	GetProcessCounters( &phase_counters );
+	phase_start = std::chrono::steady_clock::now();
+	phases.back().start_ms = GetMilliseconds( first_start, phase_start );
+#if PROFILER_ENABLED
+	phase_profile_start = Profiler_GetTime();
+#endif
+	is_phase_active = true;
+}
+
+static size_t GetPhaseIndex( const char* name ) {
+	for ( size_t i = 0; i < phases.size(); ++i ) {
+		if ( strcmp( phases[ i ].name, name ) == 0 ) {
+			return i;
+		}
+	}
+	return phases.size();
+}
+
+/**
+ * Phases only ever depend on those that came before them, so a single
+ * pass in order is enough to find when each could have started, had
+ * everything been run as early as it could, and what held it up.
+ */
+static void AnalysePhases() {
+	size_t num_phases = phases.size();
+
+	std::vector<double> earliest_end( num_phases, 0 );
+	std::vector<size_t> held_up_by( num_phases, num_phases );
+	// Everything each phase relies on, directly or not
+	std::vector<std::vector<bool>> ancestors( num_phases, std::vector<bool>( num_phases, false ) );
+	for ( size_t i = 0; i < num_phases; ++i ) {
+		StartupPhase& phase = phases[ i ];
+		phase.earliest_start_ms = 0;
+		for ( const auto& dependency : phase.dependencies ) {
+			size_t j = GetPhaseIndex( dependency );
+			if ( j >= i ) {
+				continue;
+			}
+
+			ancestors[ i ][ j ] = true;
+			for ( size_t k = 0; k < j; ++k ) {
+				if ( ancestors[ j ][ k ] ) {
+					ancestors[ i ][ k ] = true;
+				}
+			}
+
+			if ( earliest_end[ j ] > phase.earliest_start_ms ) {
+				phase.earliest_start_ms = earliest_end[ j ];
+				held_up_by[ i ] = j;
+			}
+		}
+
+		earliest_end[ i ] = phase.earliest_start_ms + phase.wall_ms;
+	}
+
+	total_ms = 0;
+	critical_path_ms = 0;
+	size_t last = num_phases;
+	for ( size_t i = 0; i < num_phases; ++i ) {
+		phases[ i ].is_critical = false;
+		total_ms += phases[ i ].wall_ms;
+		if ( last == num_phases || earliest_end[ i ] > critical_path_ms ) {
+			critical_path_ms = earliest_end[ i ];
+			last = i;
+		}
+	}
+
+	for ( size_t i = last; i < num_phases; i = held_up_by[ i ] ) {
+		phases[ i ].is_critical = true;
+	}
+
+	for ( size_t i = 0; i < num_phases; ++i ) {
+		phases[ i ].overlaps.clear();
+		for ( size_t j = 0; j < num_phases; ++j ) {
+			if ( i != j && !ancestors[ i ][ j ] && !ancestors[ j ][ i ] ) {
+				phases[ i ].overlaps.push_back( phases[ j ].name );
+			}
+		}
+	}
+}
+
+static void StartupReportCommand( unsigned int argc, char* argv[] ) {
+	if ( argc > 1 ) {
+		Startup_WriteReport( argv[ 1 ] );
+		return;
+	}
+
+	Startup_PrintReport();
+}
+
+void Startup_Finish() {
+	EndPhase();
+	AnalysePhases();
+
+	plRegisterConsoleCommand( "startupReport", StartupReportCommand,
+							  "Prints how long each phase of startup took, or writes it out, startupReport [file]" );
+
+	Startup_PrintReport();
+
+	char out[PL_SYSTEM_MAX_PATH];
+	if ( plGetApplicationDataDirectory( ENGINE_APP_NAME, out, PL_SYSTEM_MAX_PATH ) == nullptr ) {
+		LogWarn( "Failed to get app data directory!\n%s\n", plGetError() );
+		return;
+	}
+
+	Startup_WriteReport( std::string( out ) + STARTUP_REPORT_FILENAME );
+}
+
+const std::vector<StartupPhase>& Startup_GetPhases() {
+	return phases;
+}
+
+double Startup_GetTotalTime() {
+	return total_ms;
+}
+
+double Startup_GetCriticalPathTime() {
+	return critical_path_ms;
+}
+
+void Startup_PrintReport() {
+	LogInfo( "%-16s %10s %10s %10s %8s %10s\n", "phase", "start ms", "wall ms", "cpu ms", "reads", "read KB" );
+	for ( const auto& phase : phases ) {
+		LogInfo( "%-16s %10.1f %10.1f %10.1f %8llu %10.1f %s\n",
+				 phase.name, phase.start_ms, phase.wall_ms, phase.cpu_ms,
+				 static_cast<unsigned long long>(phase.num_reads), phase.read_bytes / 1024.0,
+				 phase.is_critical ? "*" : "" );
+	}
+
+	std::string path;
+	for ( const auto& phase : phases ) {
+		if ( phase.is_critical ) {
+			path += path.empty() ? phase.name : std::string( " > " ) + phase.name;
+		}
+	}
+
+	LogInfo( "Started up in %.1fms, the critical path (*) is %.1fms: %s\n",
+			 total_ms, critical_path_ms, path.c_str() );
+}
+
+static void WriteNames( FILE* fp, const std::vector<const char*>& names ) {
+	fprintf( fp, "[" );
+	for ( size_t i = 0; i < names.size(); ++i ) {
+		fprintf( fp, "%s\"%s\"", ( i > 0 ) ? ", " : "", names[ i ] );
+	}
+	fprintf( fp, "]" );
+}
+
+bool Startup_WriteReport( const std::string& path ) {
+	FILE* fp = fopen( path.c_str(), "w" );
+	if ( fp == nullptr ) {
+		LogWarn( "Failed to open \"%s\" for writing!\n", path.c_str() );
+		return false;
+	}
+
+	fprintf( fp, "{\n  \"engine\": \"%s\",\n  \"total_ms\": %.3f,\n  \"critical_path_ms\": %.3f,\n  \"phases\": [\n",
+			 openhow::engine->GetVersionString().c_str(), total_ms, critical_path_ms );
+	for ( size_t i = 0; i < phases.size(); ++i ) {
+		const StartupPhase& phase = phases[ i ];
+		fprintf( fp, "    { \"name\": \"%s\", \"start_ms\": %.3f, \"wall_ms\": %.3f, \"cpu_ms\": %.3f, "
+					 "\"reads\": %llu, \"read_bytes\": %llu, \"earliest_start_ms\": %.3f, \"critical\": %s,\n"
+					 "      \"dependencies\": ",
+				 phase.name, phase.start_ms, phase.wall_ms, phase.cpu_ms,
+				 static_cast<unsigned long long>(phase.num_reads), static_cast<unsigned long long>(phase.read_bytes),
+				 phase.earliest_start_ms, phase.is_critical ? "true" : "false" );
+		WriteNames( fp, phase.dependencies );
+		fprintf( fp, ",\n      \"overlaps\": " );
+		WriteNames( fp, phase.overlaps );
+		fprintf( fp, " }%s\n", ( i + 1 < phases.size() ) ? "," : "" );
+	}
+	fprintf( fp, "  ]\n}\n" );
+	fclose( fp );
+
+	LogInfo( "Wrote startup report to \"%s\"\n", path.c_str() );
+	return true;
+}
@@ -0,0 +1,63 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+/* Times each phase of the engine's startup, along with the CPU time and
+ * file reads that went into it. Every phase names the ones it relies on
+ * having run first, so that once startup's done the report can show the
+ * critical path, and which phases could have overlapped one another.
+ *
+ * CPU time and reads are taken for the whole process, so anything a
+ * phase hands off to worker threads is counted against it too. Reads
+ * come from the OS, and are left at zero where it can't tell us.
+ */
+
+struct StartupPhase {
+	const char* name{ nullptr };
+	std::vector<const char*> dependencies;
+
+	double start_ms{ 0 };   // From when the first phase began
+	double wall_ms{ 0 };
+	double cpu_ms{ 0 };
+	uint64_t num_reads{ 0 };
+	uint64_t read_bytes{ 0 };
+
+	// Worked out once startup's finished
+	double earliest_start_ms{ 0 };      // Had it started as soon as its dependencies were done
+	bool is_critical{ false };
+	std::vector<const char*> overlaps;  // Phases it doesn't depend on, or get depended on by
+};
+
+// Starting a phase ends the one before it. Names are expected to be
+// string literals, and dependencies have to have been started already.
+void Startup_BeginPhase( const char* name, std::initializer_list<const char*> dependencies = {} );
+
+// Ends the last phase, works out the critical path and writes out the report
+void Startup_Finish();
+
+const std::vector<StartupPhase>& Startup_GetPhases();
+double Startup_GetTotalTime();
+double Startup_GetCriticalPathTime();
+
+void Startup_PrintReport();
+bool Startup_WriteReport( const std::string& path );
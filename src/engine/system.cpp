@@ -18,6 +18,7 @@
 #include "engine.h"
 #include "input.h"
 #include "imgui_layer.h"
+#include "memory_tracker.h"
 
 #include "../3rdparty/imgui/examples/imgui_impl_sdl.h"
 #include "../3rdparty/imgui/examples/imgui_impl_opengl3.h"
@@ -40,6 +41,10 @@ unsigned int System_GetTicks( void ) {
 	return SDL_GetTicks();
 }
 
+void System_Sleep( unsigned int ms ) {
+	SDL_Delay( ms );
+}
+
 void System_DisplayMessageBox( unsigned int level, const char* msg, ... ) {
 	switch ( level ) {
 		case PROMPT_LEVEL_ERROR: {
@@ -64,6 +69,12 @@ void System_DisplayMessageBox( unsigned int level, const char* msg, ... ) {
 	vsnprintf( buf, sizeof( buf ), msg, args );
 	va_end( args );
 
+	// Nobody to show it to
+	if ( g_state.is_headless ) {
+		LogWarn( "%s\n", buf );
+		return;
+	}
+
 	SDL_ShowSimpleMessageBox( level, ENGINE_TITLE, buf, window );
 }
 
@@ -399,10 +410,14 @@ void System_SwapDisplay( void ) {
 void System_Shutdown( void ) {
 	delete openhow::engine;
 
-	ImGui_ImplOpenGL3_DestroyDeviceObjects();
-	ImGui::DestroyContext();
+	Memory_Shutdown();
+
+	if ( !g_state.is_headless ) {
+		ImGui_ImplOpenGL3_DestroyDeviceObjects();
+		ImGui::DestroyContext();
 
-	SDL_StopTextInput();
+		SDL_StopTextInput();
+	}
 
 	if ( gl_context != nullptr ) {
 		SDL_GL_DeleteContext( gl_context );
@@ -499,7 +514,25 @@ static int TranslateSDLButton( int button ) {
 	}
 }
 
+/**
+ * Without a window the only event we care about is being told to quit,
+ * e.g. by a SIGINT.
+ */
+static void System_PollHeadlessEvents() {
+	SDL_Event event;
+	while ( SDL_PollEvent( &event ) ) {
+		if ( event.type == SDL_QUIT ) {
+			System_Shutdown();
+		}
+	}
+}
+
 void System_PollEvents() {
+	if ( g_state.is_headless ) {
+		System_PollHeadlessEvents();
+		return;
+	}
+
 	ImGuiIO& io = ImGui::GetIO();
 
 	SDL_Event event;
@@ -630,6 +663,9 @@ void System_PollEvents() {
 	}
 }
 
+// The benchmarks and tests bring their own
+#if !defined( OPENHOW_BENCHMARK ) && !defined( OPENHOW_TESTS )
+
 static void* u_malloc( size_t size ) {
 	return u_alloc( 1, size, true );
 }
@@ -666,21 +702,27 @@ int main( int argc, char** argv ) {
 	std::string log_path = std::string( appDataPath ) + "/" + ENGINE_LOG;
 	u_init_logs( log_path.c_str() );
 
-	if ( SDL_Init( SDL_INIT_EVERYTHING ) != 0 ) {
+	g_state.is_headless = plHasCommandLineArgument( "-headless" );
+
+	// Headless only needs the clock, and events to hear about being stopped
+	unsigned int sdl_flags = g_state.is_headless ? ( SDL_INIT_TIMER | SDL_INIT_EVENTS ) : SDL_INIT_EVERYTHING;
+	if ( SDL_Init( sdl_flags ) != 0 ) {
 		System_DisplayMessageBox( PROMPT_LEVEL_ERROR, "Failed to initialize SDL2!\n%s", SDL_GetError() );
 		return EXIT_FAILURE;
 	}
 
-	SDL_DisableScreenSaver();
+	if ( !g_state.is_headless ) {
+		SDL_DisableScreenSaver();
 
-	//SDL_SetRelativeMouseMode(SDL_TRUE);
-	SDL_CaptureMouse( SDL_TRUE );
-	SDL_ShowCursor( SDL_TRUE );
+		//SDL_SetRelativeMouseMode(SDL_TRUE);
+		SDL_CaptureMouse( SDL_TRUE );
+		SDL_ShowCursor( SDL_TRUE );
 
-	/* using this to catch modified keys
-	 * without having to do the conversion
-	 * ourselves                            */
-	SDL_StartTextInput();
+		/* using this to catch modified keys
+		 * without having to do the conversion
+		 * ourselves                            */
+		SDL_StartTextInput();
+	}
 
 	engine = new Engine();
 	engine->Initialize();
@@ -691,3 +733,5 @@ int main( int argc, char** argv ) {
 
 	return EXIT_SUCCESS;
 }
+
+#endif
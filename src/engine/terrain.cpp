@@ -15,15 +15,18 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cmath>
 #include <list>
 
 #include "engine.h"
+#include "memory_tracker.h"
 #include "terrain.h"
 
 #include "graphics/mesh.h"
 #include "graphics/shaders.h"
 #include "graphics/texture_atlas.h"
 #include "graphics/display.h"
+#include "graphics/render_queue.h"
 
 //Precalculated vertices for chunk rendering
 //TODO: Share one index buffer instance between all chunks
@@ -47,6 +50,16 @@ const static unsigned int chunk_indices[96] = {
 };
 
 Terrain::Terrain( const std::string& tileset ) {
+	MEMORY_TAG( MEMORY_TAG_TERRAIN );
+
+	chunks_.resize( TERRAIN_CHUNKS );
+
+	// Headless only needs the heights
+	if ( g_state.is_headless ) {
+		Update();
+		return;
+	}
+
 	// attempt to load in the atlas sheet
 	// TODO: allow us to change this on the fly
 	atlas_ = new TextureAtlas( 512, 8 );
@@ -57,16 +70,20 @@ Terrain::Terrain( const std::string& tileset ) {
 	}
 	atlas_->Finalize();
 
-	chunks_.resize( TERRAIN_CHUNKS );
-
 	Update();
 }
 
 Terrain::~Terrain() {
 	delete atlas_;
 
+	if ( openhow::Engine::Physics() != nullptr ) {
+		openhow::Engine::Physics()->DestroyTerrainCollision();
+	}
+
 	for ( auto& chunk : chunks_ ) {
-		plDestroyModel( chunk.model );
+		if ( chunk.model != nullptr ) {
+			plDestroyModel( chunk.model );
+		}
 	}
 }
 
@@ -119,6 +136,16 @@ float Terrain::GetHeight( const PLVector2& pos ) {
 	return z;
 }
 
+void Terrain::UpdateChunkBounds( Chunk* chunk ) {
+	chunk->min_height = chunk->max_height = chunk->tiles[ 0 ].height[ 0 ];
+	for ( const auto& tile : chunk->tiles ) {
+		for ( float height : tile.height ) {
+			chunk->min_height = std::min( chunk->min_height, height );
+			chunk->max_height = std::max( chunk->max_height, height );
+		}
+	}
+}
+
 void Terrain::GenerateModel( Chunk* chunk, const PLVector2& offset ) {
 	if ( chunk->model != nullptr ) {
 		plDestroyModel( chunk->model );
@@ -196,6 +223,348 @@ void Terrain::GenerateModel( Chunk* chunk, const PLVector2& offset ) {
 	chunk->model = model;
 }
 
+/************************************************************/
+/* Traces */
+
+static inline PLVector3 Sub( const PLVector3& a, const PLVector3& b ) {
+	return PLVector3( a.x - b.x, a.y - b.y, a.z - b.z );
+}
+
+static inline PLVector3 Madd( const PLVector3& a, const PLVector3& b, float s ) {
+	return PLVector3( a.x + b.x * s, a.y + b.y * s, a.z + b.z * s );
+}
+
+static inline float Dot( const PLVector3& a, const PLVector3& b ) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline PLVector3 Cross( const PLVector3& a, const PLVector3& b ) {
+	return PLVector3( a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x );
+}
+
+static inline PLVector3 Normalize( const PLVector3& v ) {
+	float length = std::sqrt( Dot( v, v ) );
+	return length > 0 ? PLVector3( v.x / length, v.y / length, v.z / length ) : v;
+}
+
+/**
+ * Steps through each cell of a square grid that the line passes over,
+ * between the given fractions, in order. The visitor is handed the
+ * cell and the fractions at which the line enters and leaves it, and
+ * returns true to stop.
+ */
+template< typename F >
+static bool WalkGrid( const PLVector3& start, const PLVector3& delta, float t_start, float t_end,
+					  float cell_size, int num_cells, F visit ) {
+	auto ToCell = [ cell_size, num_cells ]( float v ) {
+		int cell = static_cast<int>(std::floor( v / cell_size ));
+		return std::max( 0, std::min( cell, num_cells - 1 ) );
+	};
+
+	int cell_x = ToCell( start.x + delta.x * t_start );
+	int cell_z = ToCell( start.z + delta.z * t_start );
+
+	int step_x = delta.x > 0 ? 1 : -1;
+	int step_z = delta.z > 0 ? 1 : -1;
+
+	float t_delta_x = delta.x != 0 ? cell_size / std::fabs( delta.x ) : INFINITY;
+	float t_delta_z = delta.z != 0 ? cell_size / std::fabs( delta.z ) : INFINITY;
+
+	float t_next_x = delta.x != 0 ? ( ( cell_x + ( delta.x > 0 ? 1 : 0 ) ) * cell_size - start.x ) / delta.x : INFINITY;
+	float t_next_z = delta.z != 0 ? ( ( cell_z + ( delta.z > 0 ? 1 : 0 ) ) * cell_size - start.z ) / delta.z : INFINITY;
+
+	float t = t_start;
+	for ( ;; ) {
+		float t_exit = std::min( std::min( t_next_x, t_next_z ), t_end );
+		if ( visit( cell_x, cell_z, t, t_exit ) ) {
+			return true;
+		}
+
+		if ( t_exit >= t_end ) {
+			return false;
+		}
+
+		if ( t_next_x < t_next_z ) {
+			cell_x += step_x;
+			t = t_next_x;
+			t_next_x += t_delta_x;
+		} else {
+			cell_z += step_z;
+			t = t_next_z;
+			t_next_z += t_delta_z;
+		}
+
+		if ( cell_x < 0 || cell_x >= num_cells || cell_z < 0 || cell_z >= num_cells ) {
+			return false;
+		}
+	}
+}
+
+/**
+ * Sweeps a sphere (or a point, with no radius) against a single
+ * triangle, only from the side it faces. Returns the fraction of
+ * the first contact, or a negative value if there isn't one before
+ * max_t.
+ */
+static float SweepTriangle( const PLVector3& start, const PLVector3& delta, float radius,
+							const PLVector3& a, const PLVector3& b, const PLVector3& c, float max_t,
+							PLVector3* contact, PLVector3* normal ) {
+	PLVector3 face_normal = Normalize( Cross( Sub( b, a ), Sub( c, a ) ) );
+
+	float best_t = -1.0f;
+
+	// Against the face itself
+	float distance = Dot( Sub( start, a ), face_normal );
+	float speed = Dot( delta, face_normal );
+	if ( speed < 0 && distance >= radius ) {
+		float t = ( distance - radius ) / -speed;
+		if ( t <= max_t ) {
+			PLVector3 point = Madd( Madd( start, delta, t ), face_normal, -radius );
+			if ( Dot( Cross( Sub( b, a ), Sub( point, a ) ), face_normal ) >= 0 &&
+				Dot( Cross( Sub( c, b ), Sub( point, b ) ), face_normal ) >= 0 &&
+				Dot( Cross( Sub( a, c ), Sub( point, c ) ), face_normal ) >= 0 ) {
+				*contact = point;
+				*normal = face_normal;
+				return t;
+			}
+		}
+	}
+
+	if ( radius <= 0 ) {
+		return best_t;
+	}
+
+	// Then the edges, as capsules
+	const PLVector3* corners[] = { &a, &b, &c };
+	for ( unsigned int i = 0; i < 3; ++i ) {
+		const PLVector3& p = *corners[ i ];
+		PLVector3 edge = Sub( *corners[ ( i + 1 ) % 3 ], p );
+		PLVector3 m = Sub( start, p );
+
+		float ee = Dot( edge, edge );
+		float ed = Dot( edge, delta );
+		float em = Dot( edge, m );
+		float qa = ee * Dot( delta, delta ) - ed * ed;
+		float qb = ee * Dot( m, delta ) - em * ed;
+		float qc = ee * ( Dot( m, m ) - radius * radius ) - em * em;
+		if ( qa <= 0 || qc < 0 ) {
+			continue;
+		}
+
+		float discriminant = qb * qb - qa * qc;
+		if ( discriminant < 0 ) {
+			continue;
+		}
+
+		float t = ( -qb - std::sqrt( discriminant ) ) / qa;
+		if ( t < 0 || t > max_t || ( best_t >= 0 && t >= best_t ) ) {
+			continue;
+		}
+
+		float s = ( em + ed * t ) / ee;
+		if ( s < 0 || s > 1 ) {
+			continue;
+		}
+
+		best_t = t;
+		*contact = Madd( p, edge, s );
+		*normal = Normalize( Sub( Madd( start, delta, t ), *contact ) );
+	}
+
+	// And finally the corners
+	for ( const PLVector3* p : corners ) {
+		PLVector3 m = Sub( start, *p );
+		float qa = Dot( delta, delta );
+		float qb = Dot( m, delta );
+		float qc = Dot( m, m ) - radius * radius;
+		if ( qa <= 0 || qc < 0 ) {
+			continue;
+		}
+
+		float discriminant = qb * qb - qa * qc;
+		if ( discriminant < 0 ) {
+			continue;
+		}
+
+		float t = ( -qb - std::sqrt( discriminant ) ) / qa;
+		if ( t < 0 || t > max_t || ( best_t >= 0 && t >= best_t ) ) {
+			continue;
+		}
+
+		best_t = t;
+		*contact = *p;
+		*normal = Normalize( Sub( Madd( start, delta, t ), *p ) );
+	}
+
+	return best_t;
+}
+
+const Terrain::Tile& Terrain::GetTileAt( unsigned int tile_x, unsigned int tile_y ) const {
+	const Chunk& chunk = chunks_[ ( tile_x / TERRAIN_CHUNK_ROW_TILES ) + ( tile_y / TERRAIN_CHUNK_ROW_TILES ) * TERRAIN_CHUNK_ROW ];
+	return chunk.tiles[ ( tile_x % TERRAIN_CHUNK_ROW_TILES ) + ( tile_y % TERRAIN_CHUNK_ROW_TILES ) * TERRAIN_CHUNK_ROW_TILES ];
+}
+
+void Terrain::GetChunkBounds( unsigned int chunk_x, unsigned int chunk_y, bool neighbours, float* min, float* max ) const {
+	int range = neighbours ? 1 : 0;
+
+	*min = chunks_[ chunk_x + chunk_y * TERRAIN_CHUNK_ROW ].min_height;
+	*max = chunks_[ chunk_x + chunk_y * TERRAIN_CHUNK_ROW ].max_height;
+	for ( int y = static_cast<int>(chunk_y) - range; y <= static_cast<int>(chunk_y) + range; ++y ) {
+		for ( int x = static_cast<int>(chunk_x) - range; x <= static_cast<int>(chunk_x) + range; ++x ) {
+			if ( x < 0 || x >= TERRAIN_CHUNK_ROW || y < 0 || y >= TERRAIN_CHUNK_ROW ) {
+				continue;
+			}
+
+			*min = std::min( *min, chunks_[ x + y * TERRAIN_CHUNK_ROW ].min_height );
+			*max = std::max( *max, chunks_[ x + y * TERRAIN_CHUNK_ROW ].max_height );
+		}
+	}
+}
+
+/**
+ * Tests both triangles of the tile, split the same way as they're
+ * drawn. Only updates the hit if it's nearer than the one already there.
+ */
+bool Terrain::TraceTile( unsigned int tile_x, unsigned int tile_y,
+						 const PLVector3& start, const PLVector3& delta, float radius, TraceHit* hit ) const {
+	const Tile& tile = GetTileAt( tile_x, tile_y );
+
+	float x0 = tile_x * TERRAIN_TILE_PIXEL_WIDTH, x1 = x0 + TERRAIN_TILE_PIXEL_WIDTH;
+	float z0 = tile_y * TERRAIN_TILE_PIXEL_WIDTH, z1 = z0 + TERRAIN_TILE_PIXEL_WIDTH;
+	PLVector3 corners[] = {
+		PLVector3( x0, tile.height[ 0 ], z0 ),
+		PLVector3( x1, tile.height[ 1 ], z0 ),
+		PLVector3( x0, tile.height[ 2 ], z1 ),
+		PLVector3( x1, tile.height[ 3 ], z1 ),
+	};
+
+	bool is_hit = false;
+	PLVector3 contact, normal;
+	float t = SweepTriangle( start, delta, radius, corners[ 0 ], corners[ 2 ], corners[ 1 ], hit->fraction, &contact, &normal );
+	if ( t >= 0 ) {
+		hit->fraction = t;
+		hit->position = contact;
+		hit->normal = normal;
+		is_hit = true;
+	}
+
+	t = SweepTriangle( start, delta, radius, corners[ 1 ], corners[ 2 ], corners[ 3 ], hit->fraction, &contact, &normal );
+	if ( t >= 0 ) {
+		hit->fraction = t;
+		hit->position = contact;
+		hit->normal = normal;
+		is_hit = true;
+	}
+
+	if ( is_hit ) {
+		hit->surface = tile.surface;
+		hit->behaviour = tile.behaviour;
+	}
+
+	return is_hit;
+}
+
+bool Terrain::Trace( const PLVector3& start, const PLVector3& end, TraceHit* hit ) {
+	return TraceSphere( start, end, 0, hit );
+}
+
+/**
+ * Finds the first point at which the sphere touches the terrain as it
+ * moves from start to end. Chunks are walked first, and those the
+ * trace passes clear above or below are skipped without looking at
+ * any of their tiles.
+ */
+bool Terrain::TraceSphere( const PLVector3& start, const PLVector3& end, float radius, TraceHit* hit ) {
+	if ( radius > TERRAIN_TILE_PIXEL_WIDTH ) {
+		LogWarn( "Trace radius is too large (%f), clamping!\n", radius );
+		radius = TERRAIN_TILE_PIXEL_WIDTH;
+	}
+
+	PLVector3 delta = Sub( end, start );
+
+	// Clip the trace to the bounds of the terrain
+	float t_start = 0, t_end = 1;
+	const float extents[] = { start.x, delta.x, start.z, delta.z };
+	for ( unsigned int i = 0; i < 4; i += 2 ) {
+		float origin = extents[ i ], direction = extents[ i + 1 ];
+		if ( direction == 0 ) {
+			if ( origin < 0 || origin > TERRAIN_PIXEL_WIDTH ) {
+				return false;
+			}
+			continue;
+		}
+
+		float t0 = ( 0 - origin ) / direction;
+		float t1 = ( TERRAIN_PIXEL_WIDTH - origin ) / direction;
+		t_start = std::max( t_start, std::min( t0, t1 ) );
+		t_end = std::min( t_end, std::max( t0, t1 ) );
+	}
+
+	if ( t_start > t_end ) {
+		return false;
+	}
+
+	TraceHit result;
+	bool is_hit = false;
+	WalkGrid( start, delta, t_start, t_end, TERRAIN_CHUNK_PIXEL_WIDTH, TERRAIN_CHUNK_ROW,
+			  [ & ]( int chunk_x, int chunk_y, float chunk_enter, float chunk_exit ) {
+				  if ( is_hit && chunk_enter > result.fraction ) {
+					  return true;
+				  }
+
+				  float min, max;
+				  GetChunkBounds( chunk_x, chunk_y, radius > 0, &min, &max );
+
+				  float y0 = start.y + delta.y * chunk_enter;
+				  float y1 = start.y + delta.y * chunk_exit;
+				  if ( std::min( y0, y1 ) - radius > max || std::max( y0, y1 ) + radius < min ) {
+					  return false;
+				  }
+
+				  return WalkGrid( start, delta, chunk_enter, chunk_exit, TERRAIN_TILE_PIXEL_WIDTH, TERRAIN_ROW_TILES,
+								   [ & ]( int tile_x, int tile_y, float tile_enter, float tile_exit ) {
+									   u_unused( tile_exit );
+
+									   // Nothing past here can be nearer than what we've got
+									   if ( is_hit && tile_enter > result.fraction ) {
+										   return true;
+									   }
+
+									   if ( radius <= 0 ) {
+										   // A line can only hit the tiles it passes over, in order
+										   if ( TraceTile( tile_x, tile_y, start, delta, 0, &result ) ) {
+											   is_hit = true;
+											   return true;
+										   }
+										   return false;
+									   }
+
+									   // A sphere can also clip those either side
+									   for ( int y = tile_y - 1; y <= tile_y + 1; ++y ) {
+										   for ( int x = tile_x - 1; x <= tile_x + 1; ++x ) {
+											   if ( x < 0 || x >= TERRAIN_ROW_TILES || y < 0 || y >= TERRAIN_ROW_TILES ) {
+												   continue;
+											   }
+
+											   if ( TraceTile( x, y, start, delta, radius, &result ) ) {
+												   is_hit = true;
+											   }
+										   }
+									   }
+
+									   return false;
+								   } );
+			  } );
+
+	if ( is_hit && hit != nullptr ) {
+		*hit = result;
+	}
+
+	return is_hit;
+}
+
+/************************************************************/
+
 void Terrain::GenerateOverview() {
 	static const PLColour colours[] = {
 		{ 60, 50, 40 },     // Mud
@@ -261,39 +630,171 @@ void Terrain::GenerateOverview() {
 }
 
 void Terrain::Update() {
-	GenerateOverview();
+	MEMORY_TAG( MEMORY_TAG_TERRAIN );
 
-	for ( unsigned int chunk_y = 0; chunk_y < TERRAIN_CHUNK_ROW; ++chunk_y ) {
-		for ( unsigned int chunk_x = 0; chunk_x < TERRAIN_CHUNK_ROW; ++chunk_x ) {
-			GenerateModel( &chunks_[ chunk_x + chunk_y * TERRAIN_CHUNK_ROW ],
-						   { static_cast<float>(chunk_x), static_cast<float>(chunk_y) } );
+	for ( auto& chunk : chunks_ ) {
+		UpdateChunkBounds( &chunk );
+	}
+
+	if ( !g_state.is_headless ) {
+		GenerateOverview();
+
+		for ( unsigned int chunk_y = 0; chunk_y < TERRAIN_CHUNK_ROW; ++chunk_y ) {
+			for ( unsigned int chunk_x = 0; chunk_x < TERRAIN_CHUNK_ROW; ++chunk_x ) {
+				GenerateModel( &chunks_[ chunk_x + chunk_y * TERRAIN_CHUNK_ROW ],
+							   { static_cast<float>(chunk_x), static_cast<float>(chunk_y) } );
+			}
 		}
+
+		std::list<PLMesh*> meshes;
+		for ( auto& chunk : chunks_ ) {
+			PLModelLod* lod = plGetModelLodLevel( chunk.model, 0 );
+			meshes.push_back( lod->meshes[ 0 ] );
+		}
+
+		Mesh_GenerateFragmentedMeshNormals( meshes );
 	}
 
-	std::list<PLMesh*> meshes;
-	for ( auto& chunk : chunks_ ) {
-		PLModelLod* lod = plGetModelLodLevel( chunk.model, 0 );
-		meshes.push_back( lod->meshes[ 0 ] );
+	if ( openhow::Engine::Physics() != nullptr ) {
+		std::vector<float> heights;
+		std::vector<uint8_t> materials;
+		GenerateCollisionGrid( heights, materials );
+		openhow::Engine::Physics()->GenerateTerrainCollision( heights, materials );
 	}
+}
 
-	Mesh_GenerateFragmentedMeshNormals( meshes );
+/**
+ * Regenerates a single chunk after its tiles have been modified,
+ * i.e. following deformation.
+ */
+void Terrain::UpdateChunk( unsigned int chunk_x, unsigned int chunk_y ) {
+	MEMORY_TAG( MEMORY_TAG_TERRAIN );
+
+	u_assert( chunk_x < TERRAIN_CHUNK_ROW && chunk_y < TERRAIN_CHUNK_ROW, "Invalid chunk, %dx%d!\n", chunk_x, chunk_y );
+
+	unsigned int idx = chunk_x + chunk_y * TERRAIN_CHUNK_ROW;
+	UpdateChunkBounds( &chunks_[ idx ] );
+	if ( !g_state.is_headless ) {
+		GenerateModel( &chunks_[ idx ], { static_cast<float>(chunk_x), static_cast<float>(chunk_y) } );
+	}
+
+	if ( openhow::Engine::Physics() != nullptr ) {
+		std::vector<float> heights;
+		std::vector<uint8_t> materials;
+		GenerateCollisionGrid( heights, materials );
+		openhow::Engine::Physics()->UpdateTerrainCollision( idx, heights, materials );
+	}
+}
+
+/**
+ * Writes out the corner heights of every tile in one block,
+ * as they're the only part of the terrain that gets deformed.
+ */
+void Terrain::SaveState( SnapshotWriter& writer ) const {
+	std::vector<float> heights;
+	heights.reserve( TERRAIN_CHUNKS * TERRAIN_CHUNK_TILES * 4 );
+	for ( const auto& chunk : chunks_ ) {
+		for ( const auto& tile : chunk.tiles ) {
+			heights.insert( heights.end(), tile.height, tile.height + 4 );
+		}
+	}
+
+	writer.WriteVarint( heights.size() );
+	writer.WriteBytes( reinterpret_cast<const uint8_t*>(heights.data()), heights.size() * sizeof( float ) );
+}
+
+/**
+ * Reads back the heights written by SaveState, only
+ * regenerating the chunks that have actually changed.
+ */
+bool Terrain::RestoreState( SnapshotReader& reader ) {
+	MEMORY_TAG( MEMORY_TAG_TERRAIN );
+
+	std::vector<float> heights( TERRAIN_CHUNKS * TERRAIN_CHUNK_TILES * 4 );
+	if ( reader.ReadVarint() != heights.size() ||
+		!reader.ReadBytes( reinterpret_cast<uint8_t*>(heights.data()), heights.size() * sizeof( float ) ) ) {
+		reader.Invalidate();
+		return false;
+	}
+
+	const float* height = heights.data();
+	for ( unsigned int i = 0; i < TERRAIN_CHUNKS; ++i ) {
+		bool is_changed = false;
+		for ( auto& tile : chunks_[ i ].tiles ) {
+			if ( memcmp( tile.height, height, sizeof( tile.height ) ) != 0 ) {
+				memcpy( tile.height, height, sizeof( tile.height ) );
+				is_changed = true;
+			}
+			height += 4;
+		}
+
+		if ( is_changed ) {
+			UpdateChunk( i % TERRAIN_CHUNK_ROW, i / TERRAIN_CHUNK_ROW );
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Flattens the tiles into a single grid of corner heights, plus the
+ * collision material for each tile, for the physics to work from.
+ */
+void Terrain::GenerateCollisionGrid( std::vector<float>& heights, std::vector<uint8_t>& materials ) {
+	const unsigned int grid_width = TERRAIN_ROW_TILES + 1;
+	heights.resize( grid_width * grid_width );
+	materials.resize( TERRAIN_ROW_TILES * TERRAIN_ROW_TILES );
+
+	for ( unsigned int y = 0; y < TERRAIN_ROW_TILES; ++y ) {
+		for ( unsigned int x = 0; x < TERRAIN_ROW_TILES; ++x ) {
+			const Chunk& chunk = chunks_[ ( x / TERRAIN_CHUNK_ROW_TILES ) + ( y / TERRAIN_CHUNK_ROW_TILES ) * TERRAIN_CHUNK_ROW ];
+			const Tile& tile = chunk.tiles[ ( x % TERRAIN_CHUNK_ROW_TILES ) + ( y % TERRAIN_CHUNK_ROW_TILES ) * TERRAIN_CHUNK_ROW_TILES ];
+
+			materials[ x + y * TERRAIN_ROW_TILES ] = tile.GetCollisionMaterial();
+
+			// Each tile provides its top-left corner, and those along the
+			// far edges fill in the remaining row and column
+			heights[ x + y * grid_width ] = tile.height[ 0 ];
+			if ( x == TERRAIN_ROW_TILES - 1 ) {
+				heights[ ( x + 1 ) + y * grid_width ] = tile.height[ 1 ];
+			}
+			if ( y == TERRAIN_ROW_TILES - 1 ) {
+				heights[ x + ( y + 1 ) * grid_width ] = tile.height[ 2 ];
+			}
+			if ( x == TERRAIN_ROW_TILES - 1 && y == TERRAIN_ROW_TILES - 1 ) {
+				heights[ ( x + 1 ) + ( y + 1 ) * grid_width ] = tile.height[ 3 ];
+			}
+		}
+	}
 }
 
 void Terrain::Draw() {
-	Shaders_SetProgramByName( cv_graphics_debug_normals->b_value ? "debug_normals" : "generic_textured_lit" );
+	RenderQueue* queue = Display_GetRenderQueue();
+	static ShaderHandle lit_program = Shaders_GetHandle( "generic_textured_lit" );
+	static ShaderHandle normals_program = Shaders_GetHandle( "debug_normals" );
+	ShaderProgram* program = Shaders_GetProgram(
+		cv_graphics_debug_normals->b_value ? normals_program : lit_program );
 
 	g_state.gfx.num_chunks_drawn = 0;
-	for ( const auto& chunk : chunks_ ) {
+	for ( unsigned int i = 0; i < TERRAIN_CHUNKS; ++i ) {
+		const Chunk& chunk = chunks_[ i ];
 		if ( chunk.model == nullptr ) {
 			continue;
 		}
 
+		PLVector3 origin(
+			( i % TERRAIN_CHUNK_ROW ) * TERRAIN_CHUNK_PIXEL_WIDTH + ( TERRAIN_CHUNK_PIXEL_WIDTH / 2 ),
+			0,
+			( i / TERRAIN_CHUNK_ROW ) * TERRAIN_CHUNK_PIXEL_WIDTH + ( TERRAIN_CHUNK_PIXEL_WIDTH / 2 ) );
+
 		g_state.gfx.num_chunks_drawn++;
-		plDrawModel( chunk.model );
+		queue->Submit( RENDER_LAYER_WORLD, program, chunk.model, chunk.model->model_matrix, origin );
 	}
 }
 
 void Terrain::LoadPmg( const std::string& path ) {
+	MEMORY_TAG( MEMORY_TAG_TERRAIN );
+
 	PLFile* fh = plOpenFile( path.c_str(), false );
 	if ( fh == nullptr ) {
 		LogWarn( "Failed to open tile data, \"%s\", aborting\n", path.c_str() );
@@ -377,6 +878,8 @@ void Terrain::LoadPmg( const std::string& path ) {
 }
 
 void Terrain::LoadHeightmap( const std::string& path, int multiplier ) {
+	MEMORY_TAG( MEMORY_TAG_TERRAIN );
+
 	PLImage image;
 	if ( !plLoadImage( path.c_str(), &image ) ) {
 		LogWarn( "Failed to load the specified heightmap, \"%s\" (%s)!\n", path.c_str(), plGetError() );
@@ -74,17 +74,38 @@ class Terrain {
 
     float height[4]{0, 0, 0, 0};
     uint8_t shading[4]{255, 255, 255, 255};
+
+    // Surface in the lower bits and behaviour flags above, as in the PMG
+    uint8_t GetCollisionMaterial() const {
+      return static_cast<uint8_t>(surface) | static_cast<uint8_t>(behaviour);
+    }
   };
 
   struct Chunk {
     Tile tiles[16];
     PLModel* model{nullptr};
+
+    // Bounds of every corner in the chunk, so traces can skip it
+    float min_height{0};
+    float max_height{0};
+  };
+
+  struct TraceHit {
+    PLVector3 position;   // Point of contact on the terrain
+    PLVector3 normal;
+    float fraction{1.0f}; // How far along the trace, from 0 to 1
+    Tile::Surface surface{Tile::SURFACE_MUD};
+    Tile::Behaviour behaviour{Tile::BEHAVIOUR_NONE};
   };
 
   Chunk* GetChunk(const PLVector2& pos);
   Tile* GetTile(const PLVector2& pos);
 
   float GetHeight(const PLVector2& pos);
+
+  bool Trace(const PLVector3& start, const PLVector3& end, TraceHit* hit);
+  // Radius shouldn't be any larger than a tile
+  bool TraceSphere(const PLVector3& start, const PLVector3& end, float radius, TraceHit* hit);
   float GetMaxHeight() { return max_height_; }
   float GetMinHeight() { return min_height_; }
 
@@ -95,13 +116,25 @@ class Terrain {
 
   void Serialize(const std::string& path);
 
+  // Deformed heights, for saved games
+  void SaveState(SnapshotWriter& writer) const;
+  bool RestoreState(SnapshotReader& reader);
+
   void Draw();
   void Update();
+  void UpdateChunk(unsigned int chunk_x, unsigned int chunk_y);
 
  protected:
  private:
+  static void UpdateChunkBounds(Chunk* chunk);
   void GenerateModel(Chunk* chunk, const PLVector2& offset);
   void GenerateOverview();
+  void GenerateCollisionGrid(std::vector<float>& heights, std::vector<uint8_t>& materials);
+
+  const Tile& GetTileAt(unsigned int tile_x, unsigned int tile_y) const;
+  void GetChunkBounds(unsigned int chunk_x, unsigned int chunk_y, bool neighbours, float* min, float* max) const;
+  bool TraceTile(unsigned int tile_x, unsigned int tile_y,
+                 const PLVector3& start, const PLVector3& delta, float radius, TraceHit* hit) const;
 
   float max_height_{0};
   float min_height_{0};
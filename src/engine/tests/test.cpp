@@ -0,0 +1,131 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <map>
+
+#include "../engine.h"
+#include "../memory_tracker.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+/* Runs every registered test, or just those that match -filter, and
+ * exits with a failure if any of them did, so it can be run by CTest.
+ *
+ * -filter <text>       only run tests with this in their name
+ * -fixtures <path>     where to generate the fixtures
+ */
+
+using namespace openhow;
+
+static std::map<std::string, TestFunction>& GetTests() {
+	// Registrations run before main, so this can't be a plain global
+	static std::map<std::string, TestFunction> tests;
+	return tests;
+}
+
+TestRegistration::TestRegistration( const char* name, TestFunction function ) {
+	GetTests()[ name ] = function;
+}
+
+static unsigned int num_failed_checks = 0;
+
+void Test_Fail( const char* file, int line, const char* expression ) {
+	LogWarn( "%s:%d: check failed, %s\n", file, line, expression );
+	num_failed_checks++;
+}
+
+static void* u_malloc( size_t size ) {
+	return u_alloc( 1, size, true );
+}
+
+static void* u_calloc( size_t num, size_t size ) {
+	return u_alloc( num, size, true );
+}
+
+int main( int argc, char** argv ) {
+	pl_malloc = u_malloc;
+	pl_calloc = u_calloc;
+
+	plInitialize( argc, argv );
+	// Graphics without a mode, so meshes can be created but never go anywhere
+	plInitializeSubSystems( PL_SUBSYSTEM_IO | PL_SUBSYSTEM_GRAPHICS );
+
+	plRegisterStandardPackageLoaders();
+
+	plMountLocalLocation( plGetWorkingDirectory() );
+
+	char appDataPath[PL_SYSTEM_MAX_PATH];
+	plGetApplicationDataDirectory( ENGINE_APP_NAME, appDataPath, PL_SYSTEM_MAX_PATH );
+	plCreatePath( appDataPath );
+	plMountLocalLocation( appDataPath );
+
+	std::string log_path = std::string( appDataPath ) + "/tests";
+	u_init_logs( log_path.c_str() );
+
+	g_state.is_headless = true;
+
+	if ( SDL_Init( SDL_INIT_TIMER | SDL_INIT_EVENTS ) != 0 ) {
+		LogWarn( "Failed to initialize SDL2!\n%s\n", SDL_GetError() );
+		return EXIT_FAILURE;
+	}
+
+	const char* arg = plGetCommandLineArgumentValue( "-fixtures" );
+	if ( !Fixture_Generate( arg != nullptr ? arg : "test_fixtures" ) ) {
+		LogWarn( "Failed to generate fixtures!\n" );
+		return EXIT_FAILURE;
+	}
+
+	engine = new Engine();
+	engine->Initialize();
+
+	const char* filter = plGetCommandLineArgumentValue( "-filter" );
+
+	std::vector<std::string> failed;
+	unsigned int num_run = 0;
+	for ( const auto& test : GetTests() ) {
+		if ( filter != nullptr && test.first.find( filter ) == std::string::npos ) {
+			continue;
+		}
+
+		LogInfo( "Running \"%s\"...\n", test.first.c_str() );
+
+		unsigned int num_failed = num_failed_checks;
+		test.second();
+		if ( num_failed_checks != num_failed ) {
+			failed.push_back( test.first );
+		}
+		num_run++;
+	}
+
+	LogInfo( "%u of %u tests passed\n", num_run - static_cast<unsigned int>(failed.size()), num_run );
+	for ( const auto& name : failed ) {
+		LogWarn( "FAILED: %s\n", name.c_str() );
+	}
+
+	delete engine;
+
+	Memory_Shutdown();
+
+	SDL_Quit();
+	plShutdown();
+
+	return ( failed.empty() && num_run > 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
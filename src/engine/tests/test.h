@@ -0,0 +1,44 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cmath>
+
+/* Each test is a function that checks whatever it likes with TEST_CHECK.
+ * A failed check is logged and marks the test as failed, but the test
+ * carries on, so that everything wrong with it shows up in the one run.
+ * The runner starts the engine up headless first, the same way as the
+ * benchmarks do, and has the same fixtures to hand; see test.cpp.
+ */
+
+typedef void ( * TestFunction )();
+
+class TestRegistration {
+public:
+	TestRegistration( const char* name, TestFunction function );
+};
+
+#define REGISTER_TEST( NAME, FUNCTION ) \
+    static TestRegistration _reg_test_ ## FUNCTION( ( NAME ), FUNCTION ); // NOLINT(cert-err58-cpp)
+
+void Test_Fail( const char* file, int line, const char* expression );
+
+#define TEST_CHECK( EXPRESSION ) \
+    do { if ( !( EXPRESSION ) ) { Test_Fail( __FILE__, __LINE__, #EXPRESSION ); } } while ( false )
+#define TEST_CHECK_NEAR( A, B, EPSILON ) \
+    TEST_CHECK( std::fabs( static_cast<double>(A) - static_cast<double>(B) ) <= ( EPSILON ) )
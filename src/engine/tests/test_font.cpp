@@ -0,0 +1,185 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../graphics/font.h"
+#include "../graphics/mesh.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* Checks the quads written out for the fixture's font against what its
+ * tab says, without ever drawing them. Strings are only clipped against
+ * the UI camera's viewport, so one is created for as long as each test
+ * needs it.
+ */
+
+static PLCamera* old_ui_camera = nullptr;
+
+static BitmapFont* CreateTestFont() {
+	old_ui_camera = g_state.ui_camera;
+	g_state.ui_camera = plCreateCamera();
+	g_state.ui_camera->viewport.w = 640;
+	g_state.ui_camera->viewport.h = 480;
+
+	BitmapFont* font = LoadBitmapFont( FIXTURE_FONT, FIXTURE_FONT );
+	TEST_CHECK( font != nullptr );
+	return font;
+}
+
+static void DestroyTestFont( BitmapFont* font ) {
+	if ( font != nullptr ) {
+		DestroyBitmapFont( font );
+	}
+
+	plDestroyCamera( g_state.ui_camera );
+	g_state.ui_camera = old_ui_camera;
+}
+
+static bool IsColourEqual( const PLColour& a, const PLColour& b ) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+/**
+ * Checks the quad at the given slot covers the glyph, at the given spot.
+ */
+static void CheckQuad( BitmapFont* font, unsigned int quad, int x, int y, char character, PLColour colour ) {
+	const BitmapChar& glyph = font->chars[ character - 33 ];
+	const PLVertex* vertices = &font->batch_mesh->vertices[ quad * 4 ];
+
+	const float w = static_cast<float>(glyph.w);
+	const float h = static_cast<float>(glyph.h);
+	const float positions[ 4 ][ 2 ] = { { 0, 0 }, { 0, h }, { w, 0 }, { w, h } };
+	const float tw = w / font->width;
+	const float th = h / font->height;
+	const float sts[ 4 ][ 2 ] = { { 0, 0 }, { 0, th }, { tw, 0 }, { tw, th } };
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		TEST_CHECK_NEAR( vertices[ i ].position.x, x + positions[ i ][ 0 ], 0.001 );
+		TEST_CHECK_NEAR( vertices[ i ].position.y, y + positions[ i ][ 1 ], 0.001 );
+		TEST_CHECK_NEAR( vertices[ i ].position.z, 0, 0.001 );
+		TEST_CHECK_NEAR( vertices[ i ].st[ 0 ].x, glyph.s + sts[ i ][ 0 ], 0.0001 );
+		TEST_CHECK_NEAR( vertices[ i ].st[ 0 ].y, glyph.t + sts[ i ][ 1 ], 0.0001 );
+		TEST_CHECK( IsColourEqual( vertices[ i ].colour, colour ) );
+	}
+
+	// Two triangles per quad, set up once when the mesh was created
+	const unsigned int* indices = &font->batch_mesh->indices[ quad * 6 ];
+	const unsigned int expected[ 6 ] = { 0, 1, 2, 2, 1, 3 };
+	for ( unsigned int i = 0; i < 6; ++i ) {
+		TEST_CHECK( indices[ i ] == quad * 4 + expected[ i ] );
+	}
+}
+
+static void Test_FontMetrics() {
+	BitmapFont* font = CreateTestFont();
+	if ( font == nullptr ) {
+		DestroyTestFont( font );
+		return;
+	}
+
+	TEST_CHECK( font->num_chars == FIXTURE_FONT_GLYPHS );
+	for ( unsigned int i = 0; i < FIXTURE_FONT_GLYPHS; ++i ) {
+		TEST_CHECK( font->chars[ i ].w == FIXTURE_FONT_GLYPH_WIDTH( i ) );
+		TEST_CHECK( font->chars[ i ].h == FIXTURE_FONT_GLYPH_HEIGHT );
+		TEST_CHECK( font->advance[ 33 + i ] == FIXTURE_FONT_GLYPH_WIDTH( i ) );
+	}
+
+	// Anything the font doesn't cover still takes up some room
+	TEST_CHECK( font->advance[ ' ' ] == 5 );
+	TEST_CHECK( font->advance[ '\t' ] == 5 );
+
+	// 'A' is 32 in, so 6 wide, and 'B' 7
+	TEST_CHECK( Font_GetStringWidth( font, 0, "AB" ) == 13 );
+	TEST_CHECK( Font_GetStringWidth( font, 2, "AB" ) == 17 );
+	// Spacing is only added after the characters the font has
+	TEST_CHECK( Font_GetStringWidth( font, 2, "A B" ) == 22 );
+	// Widest line wins
+	TEST_CHECK( Font_GetStringWidth( font, 0, "A\nAB\nB" ) == 13 );
+	TEST_CHECK( Font_GetStringWidth( font, 0, "" ) == 0 );
+
+	DestroyTestFont( font );
+}
+
+REGISTER_TEST( "font.metrics", Test_FontMetrics )
+
+static void Test_FontVertexStream() {
+	BitmapFont* font = CreateTestFont();
+	if ( font == nullptr ) {
+		DestroyTestFont( font );
+		return;
+	}
+
+	const PLColour colour( 255, 128, 64, 255 );
+
+	Font_DrawBitmapString( font, 10, 20, 2, 1.f, colour, "HI" );
+	TEST_CHECK( font->num_batched == 2 );
+	CheckQuad( font, 0, 10, 20, 'H', colour );
+	CheckQuad( font, 1, 10 + font->advance[ 'H' ] + 2, 20, 'I', colour );
+
+	// Appended onto what's there, with spaces advancing but never written
+	Font_DrawBitmapString( font, 100, 40, 0, 1.f, PL_COLOUR_WHITE, "A C" );
+	TEST_CHECK( font->num_batched == 4 );
+	CheckQuad( font, 2, 100, 40, 'A', PL_COLOUR_WHITE );
+	CheckQuad( font, 3, 100 + font->advance[ 'A' ] + font->advance[ ' ' ], 40, 'C', PL_COLOUR_WHITE );
+
+	// New lines go back to where the string started
+	Font_DrawBitmapString( font, 50, 60, 0, 1.f, colour, "D\nE" );
+	TEST_CHECK( font->num_batched == 6 );
+	CheckQuad( font, 4, 50, 60, 'D', colour );
+	CheckQuad( font, 5, 50, 60 + static_cast<int>(font->chars[ 0 ].h), 'E', colour );
+
+	// Off the screen, or outside of the font, is dropped
+	Font_DrawBitmapString( font, 641, 0, 0, 1.f, colour, "F" );
+	Font_DrawBitmapCharacter( font, 0, 0, 1.f, colour, 200 );
+	Font_DrawBitmapCharacter( font, 0, 0, 0.f, colour, 'G' );
+	TEST_CHECK( font->num_batched == 6 );
+
+	DestroyTestFont( font );
+}
+
+REGISTER_TEST( "font.vertex_stream", Test_FontVertexStream )
+
+static void Test_FontFlush() {
+	BitmapFont* font = CreateTestFont();
+	if ( font == nullptr ) {
+		DestroyTestFont( font );
+		return;
+	}
+
+	// Filling the buffer up draws it, and starts over from the first quad
+	for ( unsigned int i = 0; i < FONT_BATCH_MAX_GLYPHS + 10; ++i ) {
+		Font_DrawBitmapCharacter( font, static_cast<int>(i % 600), 0, 1.f, PL_COLOUR_WHITE, 'A' + i % 26 );
+	}
+	TEST_CHECK( font->num_batched == 10 );
+	CheckQuad( font, 9, static_cast<int>(( FONT_BATCH_MAX_GLYPHS + 9 ) % 600), 0,
+			   static_cast<char>('A' + ( FONT_BATCH_MAX_GLYPHS + 9 ) % 26), PL_COLOUR_WHITE );
+
+	// Only the used range goes up, and the mesh is left as big as it was
+	BitmapFont* old_font = g_fonts[ FONT_SMALL ];
+	g_fonts[ FONT_SMALL ] = font;
+	Font_Flush();
+	g_fonts[ FONT_SMALL ] = old_font;
+
+	TEST_CHECK( font->num_batched == 0 );
+	TEST_CHECK( font->batch_mesh->num_verts == FONT_BATCH_MAX_GLYPHS * 4 );
+	TEST_CHECK( font->batch_mesh->num_triangles == FONT_BATCH_MAX_GLYPHS * 2 );
+	TEST_CHECK( font->batch_mesh->num_indices == FONT_BATCH_MAX_GLYPHS * 6 );
+
+	DestroyTestFont( font );
+}
+
+REGISTER_TEST( "font.flush", Test_FontFlush )
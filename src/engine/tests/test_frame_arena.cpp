@@ -0,0 +1,184 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "../engine.h"
+#include "../frame_arena.h"
+#include "../memory_tracker.h"
+
+#include "test.h"
+
+/* Arenas are made just for the tests where they can be, so that they
+ * start out empty, and the engine's own are only used to check that
+ * each pair swaps over and resets as frames and ticks begin.
+ */
+
+#define TEST_ARENA_SIZE     1024
+
+static uint64_t GetArenaBytes() {
+	MemoryStats stats;
+	Memory_GetStats( MEMORY_TAG_ARENAS, &stats );
+	return stats.live_bytes;
+}
+
+/* Everything's handed back at once, so the next allocation
+ * starts from the beginning of the buffer again */
+static void Test_Reset() {
+	LinearArena arena( TEST_ARENA_SIZE );
+
+	auto* first = static_cast<uint8_t*>(arena.Allocate( 100 ));
+	arena.Allocate( 200 );
+	TEST_CHECK( arena.GetUsed() >= 300 );
+	TEST_CHECK( arena.GetPeak() == arena.GetUsed() );
+
+	size_t peak = arena.GetPeak();
+	arena.Reset();
+	TEST_CHECK( arena.GetUsed() == 0 );
+	TEST_CHECK( arena.GetPeak() == peak );
+	TEST_CHECK( arena.GetNumOverflows() == 0 );
+
+	TEST_CHECK( arena.Allocate( 100 ) == first );
+	TEST_CHECK( arena.GetPeak() == peak );
+}
+
+REGISTER_TEST( "arena.reset", Test_Reset )
+
+static void Test_Alignment() {
+	LinearArena arena( TEST_ARENA_SIZE );
+
+	for ( size_t alignment = 1; alignment <= alignof( std::max_align_t ); alignment *= 2 ) {
+		arena.Allocate( 1, 1 );
+		auto address = reinterpret_cast<uintptr_t>(arena.Allocate( 8, alignment ));
+		TEST_CHECK( ( address % alignment ) == 0 );
+	}
+}
+
+REGISTER_TEST( "arena.alignment", Test_Alignment )
+
+/**
+ * Anything that doesn't fit goes to the heap until the next reset,
+ * after which the buffer's used again and the overflow's been freed.
+ */
+static void Test_Overflow() {
+	LinearArena arena( TEST_ARENA_SIZE );
+	uint64_t arena_bytes = GetArenaBytes();
+
+	void* first = arena.Allocate( TEST_ARENA_SIZE / 2 );
+	auto* overflow = static_cast<uint8_t*>(arena.Allocate( TEST_ARENA_SIZE ));
+	TEST_CHECK( overflow != nullptr );
+	memset( overflow, 0xFF, TEST_ARENA_SIZE );
+
+	TEST_CHECK( arena.GetUsed() == TEST_ARENA_SIZE / 2 );
+	TEST_CHECK( arena.GetNumOverflows() == 1 );
+	TEST_CHECK( arena.GetOverflowBytes() == TEST_ARENA_SIZE );
+#if MEMORY_TRACKING_ENABLED
+	TEST_CHECK( GetArenaBytes() == arena_bytes + TEST_ARENA_SIZE );
+#endif
+
+	// Still room in the buffer for this one
+	TEST_CHECK( arena.Allocate( 16 ) != nullptr );
+	TEST_CHECK( arena.GetNumOverflows() == 1 );
+
+	arena.Reset();
+	TEST_CHECK( GetArenaBytes() == arena_bytes );
+	TEST_CHECK( arena.Allocate( TEST_ARENA_SIZE / 2 ) == first );
+
+	// Totals are kept across resets, so the sizes can be tuned
+	TEST_CHECK( arena.GetNumOverflows() == 1 );
+	TEST_CHECK( arena.GetOverflowBytes() == TEST_ARENA_SIZE );
+}
+
+REGISTER_TEST( "arena.overflow", Test_Overflow )
+
+/**
+ * Scopes rewind to wherever the arena was when they were entered,
+ * freeing only the overflow that was made within them.
+ */
+static void Test_Scope() {
+	LinearArena arena( TEST_ARENA_SIZE );
+	uint64_t arena_bytes = GetArenaBytes();
+
+	arena.Allocate( TEST_ARENA_SIZE / 4 );
+	arena.Allocate( TEST_ARENA_SIZE * 2 );
+	size_t used = arena.GetUsed();
+	uint64_t outer_bytes = GetArenaBytes();
+
+	void* inner;
+	{
+		ArenaScope scope( &arena );
+		inner = arena.Allocate( TEST_ARENA_SIZE / 4 );
+		{
+			ArenaScope nested( &arena );
+			arena.Allocate( TEST_ARENA_SIZE / 4 );
+			arena.Allocate( TEST_ARENA_SIZE * 2 );
+		}
+		TEST_CHECK( arena.GetUsed() == used + TEST_ARENA_SIZE / 4 );
+		TEST_CHECK( GetArenaBytes() == outer_bytes );
+
+		arena.Allocate( TEST_ARENA_SIZE * 2 );
+	}
+
+	TEST_CHECK( arena.GetUsed() == used );
+	TEST_CHECK( GetArenaBytes() == outer_bytes );
+	TEST_CHECK( arena.Allocate( TEST_ARENA_SIZE / 4 ) == inner );
+	TEST_CHECK( arena.GetNumOverflows() == 3 );
+
+	arena.Reset();
+	TEST_CHECK( GetArenaBytes() == arena_bytes );
+}
+
+REGISTER_TEST( "arena.scope", Test_Scope )
+
+/**
+ * Whatever was allocated last frame or tick lasts through the next
+ * one, and is only reset when its arena comes back around.
+ */
+static void Test_DoubleBuffered() {
+	struct Pair {
+		LinearArena* ( * get )();
+		void ( * begin )();
+	};
+	static const Pair pairs[] = {
+		{ Arena_GetFrame, Arena_BeginFrame },
+		{ Arena_GetTick, Arena_BeginTick },
+	};
+
+	for ( const auto& pair : pairs ) {
+		LinearArena* first = pair.get();
+		auto* data = static_cast<uint8_t*>(first->Allocate( 64 ));
+		memset( data, 0xAB, 64 );
+		size_t used = first->GetUsed();
+
+		pair.begin();
+		LinearArena* second = pair.get();
+		TEST_CHECK( second != first );
+		TEST_CHECK( second->GetUsed() == 0 );
+		TEST_CHECK( first->GetUsed() == used );
+		second->Allocate( 64 );
+		for ( unsigned int i = 0; i < 64; ++i ) {
+			TEST_CHECK( data[ i ] == 0xAB );
+		}
+
+		pair.begin();
+		TEST_CHECK( pair.get() == first );
+		TEST_CHECK( first->GetUsed() == 0 );
+		TEST_CHECK( second->GetUsed() == 64 );
+	}
+}
+
+REGISTER_TEST( "arena.double_buffered", Test_DoubleBuffered )
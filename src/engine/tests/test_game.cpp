@@ -0,0 +1,70 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+using namespace openhow;
+
+/* Pigs take their model from the class registered under the start
+ * of their actor class, and anything without one gets the default. */
+static void Test_PigModels() {
+	Engine::Game()->RegisterClassManifest( Fixture_GetClassesPath() );
+	TEST_CHECK( Engine::Game()->GetPigClasses().size() == FIXTURE_NUM_PIG_CLASSES );
+
+	TEST_CHECK( Engine::Game()->GetPigModel( "sb_me" ) == "pigs/sb_hi" );
+	TEST_CHECK( Engine::Game()->GetPigModel( "gr_me" ) == "pigs/gr_hi" );
+	TEST_CHECK( Engine::Game()->GetPigModel( "sp_me" ) == "pigs/sp_hi" );
+	TEST_CHECK( Engine::Game()->GetPigModel( "xx_me" ) == "pigs/ac_hi" );
+}
+
+REGISTER_TEST( "game.pig_models", Test_PigModels )
+
+static ActorSpawn MakeSpawn( const char* class_name, uint8_t team ) {
+	ActorSpawn spawn;
+	spawn.class_name = class_name;
+	spawn.team = team;
+	return spawn;
+}
+
+/* Only the classes spawned on the teams in play need their models,
+ * and each model is only asked for the once. */
+static void Test_PigModelsInUse() {
+	Engine::Game()->RegisterClassManifest( Fixture_GetClassesPath() );
+
+	std::vector<ActorSpawn> spawns = {
+		MakeSpawn( "gr_me", 0 ),
+		MakeSpawn( "sb_me", 1 ),
+		MakeSpawn( "gr_me", 1 ),
+		MakeSpawn( "sp_me", 2 ),    // Nobody's playing as this team
+		MakeSpawn( "xx_me", 0 ),    // Not a pig class
+	};
+
+	std::vector<std::string> models = Engine::Game()->GetPigModelsInUse( spawns, 2 );
+	TEST_CHECK( models.size() == 2 );
+	TEST_CHECK( std::find( models.begin(), models.end(), "pigs/gr_hi" ) != models.end() );
+	TEST_CHECK( std::find( models.begin(), models.end(), "pigs/sb_hi" ) != models.end() );
+
+	TEST_CHECK( Engine::Game()->GetPigModelsInUse( spawns, 3 ).size() == 3 );
+	TEST_CHECK( Engine::Game()->GetPigModelsInUse( spawns, 0 ).empty() );
+}
+
+REGISTER_TEST( "game.pig_models_in_use", Test_PigModelsInUse )
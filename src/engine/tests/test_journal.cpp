@@ -0,0 +1,272 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+
+#include "../engine.h"
+#include "../input.h"
+#include "../journal.h"
+#include "../snapshot.h"
+#include "../terrain.h"
+#include "../game/actor_manager.h"
+#include "../game/actors/actor.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* Journals are recorded on the benchmark map, with the input made up
+ * as it goes. There's no player to act on it, so between ticks the test
+ * moves actors and draws from the RNG depending on what the input is,
+ * the same as the game would. A replay that gets any of the input wrong
+ * ends up with a different checksum from then on. Each test ends the
+ * game it started.
+ */
+
+#define TEST_NUM_ACTORS         32
+#define TEST_NUM_TICKS          ( TICKS_PER_SECOND * 4 )
+#define TEST_NUM_TRUNCATIONS    32
+#define TEST_JOURNAL            "test.journal"
+
+using namespace openhow;
+
+static std::vector<Actor*> SpawnActors() {
+	uint32_t seed = 0x4A4F5552;
+
+	std::vector<Actor*> actors;
+	for ( unsigned int i = 0; i < TEST_NUM_ACTORS; ++i ) {
+		Actor* actor = ActorManager::GetInstance()->CreateActor( "gr_me" );
+		actor->SetPosition( PLVector3(
+			static_cast<float>(Fixture_Random( &seed ) % TERRAIN_PIXEL_WIDTH),
+			static_cast<float>(Fixture_Random( &seed ) % 2048),
+			static_cast<float>(Fixture_Random( &seed ) % TERRAIN_PIXEL_WIDTH) ) );
+		actors.push_back( actor );
+	}
+	return actors;
+}
+
+// A few keys held down for a while, and the first stick pushed about
+static void MakeInput( uint32_t* seed, InputState* state ) {
+	if ( Fixture_Random( seed ) % 4 == 0 ) {
+		bool& key = state->key_states[ Fixture_Random( seed ) % INPUT_MAX_KEYS ];
+		key = !key;
+	}
+	state->controllers[ 0 ].axis_states[ Fixture_Random( seed ) % INPUT_MAX_AXES ] =
+		static_cast<int>(Fixture_Random( seed ) % 65536) - 32768;
+}
+
+static bool IsInputEqual( const InputState& a, const InputState& b ) {
+	for ( unsigned int i = 0; i < INPUT_MAX_KEYS; ++i ) {
+		if ( a.key_states[ i ] != b.key_states[ i ] ) {
+			return false;
+		}
+	}
+
+	for ( unsigned int i = 0; i < INPUT_MAX_CONTROLLERS; ++i ) {
+		for ( unsigned int j = 0; j < INPUT_MAX_BUTTONS; ++j ) {
+			if ( a.controllers[ i ].button_states[ j ] != b.controllers[ i ].button_states[ j ] ) {
+				return false;
+			}
+		}
+		for ( unsigned int j = 0; j < INPUT_MAX_AXES; ++j ) {
+			if ( a.controllers[ i ].axis_states[ j ] != b.controllers[ i ].axis_states[ j ] ) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Stands in for the game acting on the input it was given for the last tick
+static void ActOnInput( const std::vector<Actor*>& actors ) {
+	InputState state;
+	Input_GetState( &state );
+
+	for ( unsigned int i = 0; i < INPUT_MAX_AXES; ++i ) {
+		Actor* actor = actors[ i % actors.size() ];
+		PLVector3 position = actor->GetPosition();
+		position.x += static_cast<float>(state.controllers[ 0 ].axis_states[ i ]) / 4096.0f;
+		actor->SetPosition( position );
+	}
+
+	for ( unsigned int i = 0; i < INPUT_MAX_KEYS; ++i ) {
+		if ( state.key_states[ i ] ) {
+			Sim_Random();
+		}
+	}
+}
+
+/**
+ * Records a journal while making up the input, handing back the
+ * input given for each tick, and writes it out.
+ */
+static std::vector<InputState> RecordJournal( const std::string& path ) {
+	std::vector<InputState> inputs;
+	if ( !Journal_Record( path, FIXTURE_MAP ) ) {
+		return inputs;
+	}
+
+	std::vector<Actor*> actors = SpawnActors();
+
+	uint32_t seed = 0x494E5054;
+	InputState state = InputState();
+	for ( unsigned int i = 0; i < TEST_NUM_TICKS; ++i ) {
+		MakeInput( &seed, &state );
+		Input_SetState( &state );
+		inputs.push_back( state );
+
+		Fixture_TickGame( 1 );
+		ActOnInput( actors );
+	}
+
+	Journal_Stop();
+	return inputs;
+}
+
+static void Test_RecordReplay() {
+	Fixture_GetMap();
+
+	std::string old_interval = cv_journal_checksum_interval->s_value;
+	plSetConsoleVariable( cv_journal_checksum_interval, "1" );
+
+	std::string path = Fixture_GetPath( TEST_JOURNAL );
+	std::vector<InputState> inputs = RecordJournal( path );
+	TEST_CHECK( inputs.size() == TEST_NUM_TICKS );
+	TEST_CHECK( !Journal_IsRecording() );
+
+	// Same input back for every tick, and nothing drifts, all the way to the end
+	TEST_CHECK( Journal_Replay( path, true ) );
+	TEST_CHECK( Journal_IsFastForwarding() );
+	std::vector<Actor*> actors = SpawnActors();
+	for ( unsigned int i = 0; i < inputs.size() && Journal_IsReplaying(); ++i ) {
+		Fixture_TickGame( 1 );
+
+		InputState state;
+		Input_GetState( &state );
+		TEST_CHECK( IsInputEqual( state, inputs[ i ] ) );
+
+		ActOnInput( actors );
+	}
+	TEST_CHECK( !Journal_IsReplaying() );
+	TEST_CHECK( Journal_GetNumDivergences() == 0 );
+
+	// And anything that does drift is caught
+	TEST_CHECK( Journal_Replay( path, true ) );
+	actors = SpawnActors();
+	Sim_Random();
+	for ( unsigned int i = 0; i < inputs.size() && Journal_IsReplaying(); ++i ) {
+		Fixture_TickGame( 1 );
+		ActOnInput( actors );
+	}
+	TEST_CHECK( !Journal_IsReplaying() );
+	TEST_CHECK( Journal_GetNumDivergences() > 0 );
+
+	plSetConsoleVariable( cv_journal_checksum_interval, old_interval.c_str() );
+	Input_ResetStates();
+	Engine::Game()->EndMode();
+}
+
+REGISTER_TEST( "journal.record_replay", Test_RecordReplay )
+
+static void WriteFile( const std::string& path, const uint8_t* data, size_t size ) {
+	std::ofstream output( path, std::ios::binary | std::ios::trunc );
+	output.write( reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size) );
+}
+
+// Turned away before anything's started, leaving the game as it was
+static bool IsRejected( const std::string& path ) {
+	size_t num_actors = ActorManager::GetInstance()->GetActors().size();
+	uint32_t checksum = Journal_GetStateChecksum();
+
+	bool is_rejected = !Journal_Replay( path, true ) && !Journal_IsReplaying();
+	return is_rejected &&
+		ActorManager::GetInstance()->GetActors().size() == num_actors &&
+		Journal_GetStateChecksum() == checksum;
+}
+
+static void WriteHeader( SnapshotWriter& writer, unsigned int version ) {
+	writer.WriteBytes( reinterpret_cast<const uint8_t*>(JOURNAL_IDENTIFIER), 4 );
+	writer.WriteVarint( version );
+	writer.WriteString( FIXTURE_MAP );
+	writer.WriteVarint( 1 );
+}
+
+static void Test_Rejected() {
+	Fixture_GetMap();
+
+	std::string path = Fixture_GetPath( TEST_JOURNAL );
+	TEST_CHECK( !RecordJournal( path ).empty() );
+
+	std::ifstream input( path, std::ios::binary );
+	std::vector<uint8_t> journal( ( std::istreambuf_iterator<char>( input ) ), std::istreambuf_iterator<char>() );
+	input.close();
+	TEST_CHECK( !journal.empty() );
+
+	// Left running, so there's something for a bad journal to leave alone
+	std::vector<Actor*> actors = SpawnActors();
+
+	std::string bad_path = Fixture_GetPath( "bad.journal" );
+	for ( unsigned int i = 0; i <= TEST_NUM_TRUNCATIONS; ++i ) {
+		// Always including the last byte, as well as the very start
+		size_t size = ( i < TEST_NUM_TRUNCATIONS ) ? journal.size() * i / TEST_NUM_TRUNCATIONS : journal.size() - 1;
+		WriteFile( bad_path, journal.data(), size );
+		TEST_CHECK( IsRejected( bad_path ) );
+	}
+
+	std::vector<uint8_t> corrupt = journal;
+	corrupt[ 0 ] = 'X';
+	WriteFile( bad_path, corrupt.data(), corrupt.size() );
+	TEST_CHECK( IsRejected( bad_path ) );
+
+	SnapshotWriter writer;
+	WriteHeader( writer, JOURNAL_VERSION + 1 );
+	writer.WriteByte( JOURNAL_END );
+	writer.WriteVarint( 0 );
+	WriteFile( bad_path, writer.GetData(), writer.GetSize() );
+	TEST_CHECK( IsRejected( bad_path ) );
+
+	// A record that doesn't exist
+	writer = SnapshotWriter();
+	WriteHeader( writer, JOURNAL_VERSION );
+	writer.WriteByte( JOURNAL_END + 1 );
+	writer.WriteVarint( 0 );
+	writer.WriteByte( JOURNAL_END );
+	writer.WriteVarint( 0 );
+	WriteFile( bad_path, writer.GetData(), writer.GetSize() );
+	TEST_CHECK( IsRejected( bad_path ) );
+
+	// An input well past the end of the list of them
+	writer = SnapshotWriter();
+	WriteHeader( writer, JOURNAL_VERSION );
+	writer.WriteByte( JOURNAL_INPUT );
+	writer.WriteVarint( 1 );
+	writer.WriteVarint( 1 );
+	writer.WriteVarint( 1U << 30U );
+	writer.WriteSignedVarint( 1 );
+	writer.WriteByte( JOURNAL_END );
+	writer.WriteVarint( 1 );
+	WriteFile( bad_path, writer.GetData(), writer.GetSize() );
+	TEST_CHECK( IsRejected( bad_path ) );
+
+	// Still good after all that
+	TEST_CHECK( Journal_Replay( path, true ) );
+	Journal_Stop();
+
+	Engine::Game()->EndMode();
+}
+
+REGISTER_TEST( "journal.rejected", Test_Rejected )
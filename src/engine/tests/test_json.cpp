@@ -0,0 +1,191 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <clocale>
+#include <stdexcept>
+
+#include "../engine.h"
+#include "../script/json.h"
+#include "../script/script_config.h"
+
+#include "test.h"
+
+/* Documents are parsed straight from strings. Anything the parser turns
+ * away has to say where, and anything read through ScriptConfig has to
+ * come out the same as JavaScript would have given.
+ */
+
+#define TEST_MAX_DEPTH  256     // Same as the parser's limit
+
+static std::string GetParseError( const std::string& text ) {
+	JsonDocument document;
+	try {
+		document.Parse( text.c_str(), text.size() );
+	} catch ( const std::runtime_error& e ) {
+		return e.what();
+	}
+	return "";
+}
+
+static bool IsParseErrorAt( const std::string& text, unsigned int line, unsigned int column ) {
+	std::string position = "line " + std::to_string( line ) + ", column " + std::to_string( column ) + ",";
+	return GetParseError( text ).find( position ) != std::string::npos;
+}
+
+static void Test_Malformed() {
+	TEST_CHECK( GetParseError( "{ \"a\": [ 1, 2.5, -3e2, true, null, \"b\" ] }" ).empty() );
+
+	TEST_CHECK( IsParseErrorAt( "{\n  \"a\": 1,\n  \"b\" 2\n}", 3, 7 ) );
+	TEST_CHECK( IsParseErrorAt( "[ \"abc", 1, 7 ) );
+	TEST_CHECK( IsParseErrorAt( "[1,]", 1, 4 ) );
+	TEST_CHECK( IsParseErrorAt( "[01]", 1, 3 ) );
+	TEST_CHECK( IsParseErrorAt( "[1.]", 1, 4 ) );
+	TEST_CHECK( IsParseErrorAt( "[1e]", 1, 4 ) );
+	TEST_CHECK( IsParseErrorAt( "{} x", 1, 4 ) );
+	TEST_CHECK( IsParseErrorAt( "\n\n   tru", 3, 7 ) );
+	TEST_CHECK( IsParseErrorAt( "{ \"a\": \"\\x\" }", 1, 10 ) );
+	TEST_CHECK( IsParseErrorAt( "[ \"\\u12G4\" ]", 1, 8 ) );
+	TEST_CHECK( IsParseErrorAt( "[ \"a\tb\" ]", 1, 5 ) );
+	TEST_CHECK( IsParseErrorAt( "{ 1: 2 }", 1, 3 ) );
+	TEST_CHECK( IsParseErrorAt( "", 1, 1 ) );
+
+	// Windows line endings don't throw the columns out
+	TEST_CHECK( IsParseErrorAt( "{\r\n\"a\": ]\r\n}", 2, 6 ) );
+}
+
+REGISTER_TEST( "json.malformed", Test_Malformed )
+
+static std::string GetString( const std::string& text ) {
+	ScriptConfig config;
+	config.ParseBuffer( ( "{ \"s\": \"" + text + "\" }" ).c_str() );
+	return config.GetStringProperty( "s" );
+}
+
+static void Test_Escapes() {
+	TEST_CHECK( GetString( "plain" ) == "plain" );
+	TEST_CHECK( GetString( "\\\"\\\\\\/\\b\\f\\n\\r\\t" ) == "\"\\/\b\f\n\r\t" );
+	TEST_CHECK( GetString( "\\u0041\\u00e9\\u20AC" ) == "A\xC3\xA9\xE2\x82\xAC" );
+	// Decoding shortens the string, and what follows still has to be right
+	TEST_CHECK( GetString( "a\\nb\\u0043d" ) == "a\nbCd" );
+
+	// U+1F437, which only fits in UTF-16 as a pair
+	TEST_CHECK( GetString( "\\uD83D\\uDC37" ) == "\xF0\x9F\x90\xB7" );
+	TEST_CHECK( GetString( "x\\ud83d\\udc37y" ) == "x\xF0\x9F\x90\xB7y" );
+
+	// Either half on its own is replaced, as it can't be written as UTF-8
+	TEST_CHECK( GetString( "\\uD83Dx" ) == "\xEF\xBF\xBDx" );
+	TEST_CHECK( GetString( "\\uDC37" ) == "\xEF\xBF\xBD" );
+
+	// A high half followed by anything other than a low half is no good
+	TEST_CHECK( IsParseErrorAt( "[ \"\\uD83D\\u0041\" ]", 1, 16 ) );
+}
+
+REGISTER_TEST( "json.escapes", Test_Escapes )
+
+static void Test_Nesting() {
+	std::string text = std::string( TEST_MAX_DEPTH, '[' ) + "1" + std::string( TEST_MAX_DEPTH, ']' );
+	JsonDocument document;
+	document.Parse( text.c_str(), text.size() );
+
+	const JsonNode* node = document.GetRoot();
+	for ( unsigned int i = 0; i < TEST_MAX_DEPTH && node != nullptr; ++i ) {
+		TEST_CHECK( node->type == JsonType::ARRAY && node->num_children == 1 );
+		node = document.GetChild( node, 0U );
+	}
+	TEST_CHECK( node != nullptr && node->type == JsonType::NUMBER && node->number == 1 );
+
+	// One more is turned away, rather than running out of stack
+	text = std::string( TEST_MAX_DEPTH + 1, '[' ) + std::string( TEST_MAX_DEPTH + 1, ']' );
+	TEST_CHECK( IsParseErrorAt( text, 1, TEST_MAX_DEPTH + 1 ) );
+	text = "{\"a\":" + text + "}";
+	TEST_CHECK( GetParseError( text ).find( "nested too deeply" ) != std::string::npos );
+
+	// Far deeper still, as a malicious file might be
+	text = std::string( 100000, '[' );
+	TEST_CHECK( GetParseError( text ).find( "nested too deeply" ) != std::string::npos );
+}
+
+REGISTER_TEST( "json.nesting", Test_Nesting )
+
+static std::string GetNumberString( const char* number ) {
+	ScriptConfig config;
+	config.ParseBuffer( ( std::string( "{ \"n\": " ) + number + " }" ).c_str() );
+	return config.GetStringProperty( "n" );
+}
+
+static void Test_Numbers() {
+	// Same as String( n ) in JavaScript
+	TEST_CHECK( GetNumberString( "1.0" ) == "1" );
+	TEST_CHECK( GetNumberString( "1e3" ) == "1000" );
+	TEST_CHECK( GetNumberString( "-0" ) == "0" );
+	TEST_CHECK( GetNumberString( "0.1" ) == "0.1" );
+	TEST_CHECK( GetNumberString( "-2.50" ) == "-2.5" );
+	TEST_CHECK( GetNumberString( "123.456" ) == "123.456" );
+	TEST_CHECK( GetNumberString( "0.000001" ) == "0.000001" );
+	TEST_CHECK( GetNumberString( "1e-7" ) == "1e-7" );
+	TEST_CHECK( GetNumberString( "1.5e-10" ) == "1.5e-10" );
+	TEST_CHECK( GetNumberString( "1e21" ) == "1e+21" );
+	TEST_CHECK( GetNumberString( "123e18" ) == "123000000000000000000" );
+	TEST_CHECK( GetNumberString( "0.30000000000000004" ) == "0.30000000000000004" );
+	TEST_CHECK( GetNumberString( "1e400" ) == "Infinity" );
+
+	// Past where the quick conversion is exact, so these go the long way round
+	double number;
+	TEST_CHECK( *Json_ReadNumber( "12345678901234567890123", &number ) == '\0' );
+	TEST_CHECK( number == 12345678901234567890123.0 );
+	TEST_CHECK( *Json_ReadNumber( "2.2250738585072014e-308", &number ) == '\0' );
+	TEST_CHECK( number == 2.2250738585072014e-308 );
+
+	// Only as far as there's a number, as the lists of them rely on
+	TEST_CHECK( strcmp( Json_ReadNumber( "1.5 2", &number ), " 2" ) == 0 && number == 1.5 );
+	TEST_CHECK( strcmp( Json_ReadNumber( "7e", &number ), "e" ) == 0 && number == 7 );
+	const char* text = "x";
+	TEST_CHECK( Json_ReadNumber( text, &number ) == text );
+}
+
+REGISTER_TEST( "json.numbers", Test_Numbers )
+
+/* A locale with a decimal comma mustn't change how numbers are read, or written */
+static void Test_Locale() {
+	const char* locales[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "German_Germany.1252" };
+	std::string old_locale = setlocale( LC_NUMERIC, nullptr );
+
+	bool is_set = false;
+	for ( const char* locale : locales ) {
+		if ( setlocale( LC_NUMERIC, locale ) != nullptr ) {
+			is_set = true;
+			break;
+		}
+	}
+
+	if ( !is_set ) {
+		LogWarn( "No locale with a decimal comma available, only checking the default\n" );
+	}
+
+	ScriptConfig config;
+	config.ParseBuffer( "{ \"f\": 1.5, \"s\": \"2.25\", \"v\": \"0.5 1.5 -2.75\", \"n\": 0.125 }" );
+	TEST_CHECK( config.GetFloatProperty( "f" ) == 1.5f );
+	TEST_CHECK( config.GetFloatProperty( "s" ) == 2.25f );
+	PLVector3 v = config.GetVector3Property( "v" );
+	TEST_CHECK( v.x == 0.5f && v.y == 1.5f && v.z == -2.75f );
+	TEST_CHECK( config.GetStringProperty( "n" ) == "0.125" );
+	TEST_CHECK( GetNumberString( "1e-300" ) == "1e-300" );
+
+	setlocale( LC_NUMERIC, old_locale.c_str() );
+}
+
+REGISTER_TEST( "json.locale", Test_Locale )
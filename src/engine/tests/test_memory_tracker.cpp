@@ -0,0 +1,164 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../memory_tracker.h"
+
+#include "test.h"
+
+/* Nothing in the test runner allocates under the script tag once it's
+ * started up, so everything here is charged to it and checked as the
+ * change from before. Allocations made through new are kept somewhere
+ * the compiler can't see past, so it doesn't do away with them.
+ */
+
+#if MEMORY_TRACKING_ENABLED
+
+#define TEST_TAG    MEMORY_TAG_SCRIPT
+
+static char* volatile test_held;
+
+static MemoryStats GetStats( MemoryTag tag = TEST_TAG ) {
+	MemoryStats stats;
+	Memory_GetStats( tag, &stats );
+	return stats;
+}
+
+static void Test_Allocate() {
+	MemoryStats before = GetStats();
+
+	void* ptr = Memory_Allocate( 100, TEST_TAG );
+	TEST_CHECK( ptr != nullptr );
+
+	MemoryStats stats = GetStats();
+	TEST_CHECK( stats.live_bytes == before.live_bytes + 100 );
+	TEST_CHECK( stats.live_allocations == before.live_allocations + 1 );
+	TEST_CHECK( stats.total_allocations == before.total_allocations + 1 );
+	TEST_CHECK( stats.peak_bytes >= stats.live_bytes );
+
+	Memory_Free( ptr );
+	Memory_Free( nullptr );
+
+	stats = GetStats();
+	TEST_CHECK( stats.live_bytes == before.live_bytes );
+	TEST_CHECK( stats.live_allocations == before.live_allocations );
+	TEST_CHECK( stats.total_allocations == before.total_allocations + 1 );
+}
+
+REGISTER_TEST( "memory.allocate", Test_Allocate )
+
+static void Test_Reallocate() {
+	MemoryStats before = GetStats();
+	MemoryStats other_before = GetStats( MEMORY_TAG_ACTORS );
+
+	// Null is the same as a new allocation, under the tag given
+	auto* ptr = static_cast<uint8_t*>(Memory_Reallocate( nullptr, 100, TEST_TAG ));
+	TEST_CHECK( ptr != nullptr );
+	for ( unsigned int i = 0; i < 100; ++i ) {
+		ptr[ i ] = static_cast<uint8_t>(i);
+	}
+
+	// Grows and shrinks under the original tag, whatever's given
+	ptr = static_cast<uint8_t*>(Memory_Reallocate( ptr, 300, MEMORY_TAG_ACTORS ));
+	TEST_CHECK( ptr != nullptr );
+	TEST_CHECK( GetStats().live_bytes == before.live_bytes + 300 );
+	TEST_CHECK( GetStats( MEMORY_TAG_ACTORS ).live_bytes == other_before.live_bytes );
+
+	ptr = static_cast<uint8_t*>(Memory_Reallocate( ptr, 50, MEMORY_TAG_ACTORS ));
+	TEST_CHECK( ptr != nullptr );
+	for ( unsigned int i = 0; i < 50; ++i ) {
+		TEST_CHECK( ptr[ i ] == i );
+	}
+
+	MemoryStats stats = GetStats();
+	TEST_CHECK( stats.live_bytes == before.live_bytes + 50 );
+	TEST_CHECK( stats.peak_bytes >= before.live_bytes + 300 );
+	TEST_CHECK( stats.live_allocations == before.live_allocations + 1 );
+	TEST_CHECK( stats.total_allocations == before.total_allocations + 1 );
+
+	// And nothing is the same as a free
+	TEST_CHECK( Memory_Reallocate( ptr, 0, TEST_TAG ) == nullptr );
+
+	stats = GetStats();
+	TEST_CHECK( stats.live_bytes == before.live_bytes );
+	TEST_CHECK( stats.live_allocations == before.live_allocations );
+}
+
+REGISTER_TEST( "memory.reallocate", Test_Reallocate )
+
+/**
+ * New is charged to the innermost scope, and delete goes back to
+ * whichever tag the allocation was made under, wherever it's called.
+ */
+static void Test_TagScopes() {
+	MemoryStats before = GetStats();
+	MemoryStats other_before = GetStats( MEMORY_TAG_ACTORS );
+
+	MemoryTag outer_tag = Memory_GetCurrentTag();
+	char* outer;
+	char* inner;
+	{
+		MEMORY_TAG( TEST_TAG );
+		TEST_CHECK( Memory_GetCurrentTag() == TEST_TAG );
+		test_held = outer = new char[ 64 ];
+		{
+			MEMORY_TAG( MEMORY_TAG_ACTORS );
+			TEST_CHECK( Memory_GetCurrentTag() == MEMORY_TAG_ACTORS );
+			test_held = inner = new char[ 32 ];
+		}
+		TEST_CHECK( Memory_GetCurrentTag() == TEST_TAG );
+	}
+	TEST_CHECK( Memory_GetCurrentTag() == outer_tag );
+
+	TEST_CHECK( GetStats().live_bytes == before.live_bytes + 64 );
+	TEST_CHECK( GetStats( MEMORY_TAG_ACTORS ).live_bytes == other_before.live_bytes + 32 );
+
+	{
+		MEMORY_TAG( MEMORY_TAG_ACTORS );
+		delete[] outer;
+	}
+	delete[] inner;
+	test_held = nullptr;
+
+	TEST_CHECK( GetStats().live_bytes == before.live_bytes );
+	TEST_CHECK( GetStats().live_allocations == before.live_allocations );
+	TEST_CHECK( GetStats( MEMORY_TAG_ACTORS ).live_bytes == other_before.live_bytes );
+	TEST_CHECK( GetStats( MEMORY_TAG_ACTORS ).live_allocations == other_before.live_allocations );
+}
+
+REGISTER_TEST( "memory.tag_scopes", Test_TagScopes )
+
+static void Test_ResetPeaks() {
+	MemoryStats before = GetStats();
+
+	void* ptr = Memory_Allocate( 4096, TEST_TAG );
+	Memory_Free( ptr );
+	TEST_CHECK( GetStats().peak_bytes >= before.live_bytes + 4096 );
+
+	// Starts again from what's live, then only climbs from there
+	Memory_ResetPeaks();
+	TEST_CHECK( GetStats().peak_bytes == before.live_bytes );
+
+	ptr = Memory_Allocate( 1024, TEST_TAG );
+	Memory_Free( ptr );
+	TEST_CHECK( GetStats().peak_bytes == before.live_bytes + 1024 );
+	TEST_CHECK( GetStats().live_bytes == before.live_bytes );
+}
+
+REGISTER_TEST( "memory.reset_peaks", Test_ResetPeaks )
+
+#endif
@@ -0,0 +1,278 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+#include "../snapshot.h"
+#include "../terrain.h"
+#include "../game/actor_manager.h"
+#include "../game/actors/actor.h"
+#include "../net/net_client.h"
+#include "../net/net_protocol.h"
+#include "../net/net_server.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* A server and a couple of clients, all in the one process over the
+ * loopback transport. The game's never ticked; actors are changed by
+ * hand between steps, and once things settle down every replica on
+ * each client should match its original. Ticks only ever go forwards,
+ * the same as they do in a game, so they're not put back afterwards.
+ */
+
+#define TEST_NUM_ACTORS         64
+#define TEST_NUM_CHANGE_TICKS   100
+#define TEST_NUM_SETTLE_TICKS   ( TICKS_PER_SECOND * 2 )
+#define TEST_NUM_LARGE_ACTORS   2000
+#define TEST_LATENCY            100     // Milliseconds, so three ticks
+#define TEST_LATENCY_TICKS      3
+#define TEST_NUM_LAG_PACKETS    1000
+
+using namespace openhow;
+
+struct TestGame {
+	NetServer* server;
+	NetLagTransport* server_transport;
+	std::vector<NetClient*> clients;
+	std::vector<NetLagTransport*> client_transports;
+};
+
+static void StartGame( TestGame* game, unsigned int num_clients ) {
+	game->server_transport = new NetLagTransport( Net_CreateLoopbackTransport( "test_server" ) );
+	game->server = new NetServer( game->server_transport );
+
+	for ( unsigned int i = 0; i < num_clients; ++i ) {
+		auto* transport = new NetLagTransport( Net_CreateLoopbackTransport( "test_client_" + std::to_string( i ) ) );
+		game->client_transports.push_back( transport );
+		game->clients.push_back( new NetClient( transport, "test_server", true ) );
+	}
+}
+
+static void EndGame( TestGame* game ) {
+	for ( auto client : game->clients ) {
+		delete client;
+	}
+	delete game->server;
+	*game = TestGame();
+}
+
+// In the same order the engine goes through them, either side of the game's tick
+static void StepGame( TestGame* game ) {
+	g_state.sim_ticks++;
+
+	game->server->ReadPackets();
+	for ( auto client : game->clients ) {
+		client->ReadPackets();
+	}
+
+	game->server->SendPackets();
+	for ( auto client : game->clients ) {
+		client->SendPackets();
+	}
+}
+
+// Each transport gets its own seed, so they don't all drop the same packets
+static void SetLag( TestGame* game, unsigned int latency, float loss ) {
+	game->server_transport->SetLatency( latency );
+	game->server_transport->SetLoss( loss );
+	game->server_transport->SetLossSeed( 1 );
+	for ( size_t i = 0; i < game->client_transports.size(); ++i ) {
+		game->client_transports[ i ]->SetLatency( latency );
+		game->client_transports[ i ]->SetLoss( loss );
+		game->client_transports[ i ]->SetLossSeed( static_cast<uint32_t>(i + 2) );
+	}
+}
+
+static Actor* SpawnActor( uint32_t* seed ) {
+	Actor* actor = ActorManager::GetInstance()->CreateActor( "gr_me" );
+	actor->SetPosition( PLVector3(
+		static_cast<float>(Fixture_Random( seed ) % TERRAIN_PIXEL_WIDTH),
+		static_cast<float>(Fixture_Random( seed ) % 2048),
+		static_cast<float>(Fixture_Random( seed ) % TERRAIN_PIXEL_WIDTH) ) );
+	actor->SetHealth( static_cast<int16_t>(Fixture_Random( seed ) % 100) );
+	return actor;
+}
+
+static std::string EncodeProperty( const Property* property ) {
+	SnapshotWriter writer;
+	property->Encode( writer );
+	return std::string( reinterpret_cast<const char*>(writer.GetData()), writer.GetSize() );
+}
+
+/**
+ * Properties are compared as they'd be sent, so that vectors only
+ * need to agree as far as their precision.
+ */
+static void CheckConverged( TestGame* game ) {
+	const ActorSet& actors = ActorManager::GetInstance()->GetActors();
+	for ( auto client : game->clients ) {
+		TEST_CHECK( client->GetState() == NetClient::State::CONNECTED );
+		TEST_CHECK( client->GetReplicas().size() == actors.size() );
+
+		for ( auto actor : actors ) {
+			auto i = client->GetReplicas().find( actor->GetId() );
+			TEST_CHECK( i != client->GetReplicas().end() );
+			if ( i == client->GetReplicas().end() ) {
+				continue;
+			}
+
+			Actor* replica = i->second;
+			TEST_CHECK( replica->GetSpawnClassName() == actor->GetSpawnClassName() );
+
+			const PropertyMap& properties = actor->GetProperties();
+			const PropertyMap& replica_properties = replica->GetProperties();
+			for ( const auto& property : properties ) {
+				if ( property.second->flags & NET_EXCLUDE_FLAGS ) {
+					continue;
+				}
+
+				auto j = replica_properties.find( property.first );
+				TEST_CHECK( j != replica_properties.end() );
+				if ( j != replica_properties.end() ) {
+					TEST_CHECK( EncodeProperty( property.second ) == EncodeProperty( j->second ) );
+				}
+			}
+		}
+	}
+}
+
+static void DestroyActors( std::vector<Actor*>& actors ) {
+	for ( auto actor : actors ) {
+		ActorManager::GetInstance()->DestroyActor( actor );
+	}
+	actors.clear();
+}
+
+/**
+ * Actors are moved, destroyed and spawned while a tenth of the
+ * packets go missing either way, on top of some latency, then
+ * everything's left alone for long enough that both clients should
+ * have caught up.
+ */
+static void Test_Convergence() {
+	uint32_t seed = 0x4E455430;
+
+	std::vector<Actor*> actors;
+	for ( unsigned int i = 0; i < TEST_NUM_ACTORS; ++i ) {
+		actors.push_back( SpawnActor( &seed ) );
+	}
+
+	TestGame game;
+	StartGame( &game, 2 );
+	SetLag( &game, TEST_LATENCY, 0.1f );
+
+	for ( unsigned int tick = 0; tick < TEST_NUM_CHANGE_TICKS; ++tick ) {
+		for ( unsigned int i = 0; i < 8; ++i ) {
+			Actor* actor = actors[ Fixture_Random( &seed ) % actors.size() ];
+			PLVector3 position = actor->GetPosition();
+			position.x += static_cast<float>(Fixture_Random( &seed ) % 64) - 32.0f;
+			position.z += static_cast<float>(Fixture_Random( &seed ) % 64) - 32.0f;
+			actor->SetPosition( position );
+			actor->SetAngles( PLVector3( 0, static_cast<float>(Fixture_Random( &seed ) % 360), 0 ) );
+		}
+
+		if ( tick % 10 == 5 ) {
+			unsigned int index = Fixture_Random( &seed ) % actors.size();
+			ActorManager::GetInstance()->DestroyActor( actors[ index ] );
+			actors[ index ] = SpawnActor( &seed );
+		}
+
+		StepGame( &game );
+	}
+
+	SetLag( &game, TEST_LATENCY, 0 );
+	for ( unsigned int tick = 0; tick < TEST_NUM_SETTLE_TICKS; ++tick ) {
+		StepGame( &game );
+	}
+
+	CheckConverged( &game );
+
+	EndGame( &game );
+	DestroyActors( actors );
+}
+
+REGISTER_TEST( "net.convergence", Test_Convergence )
+
+/* Far too many actors for a single packet, so the first snapshot has to go out in pieces */
+static void Test_Fragmented() {
+	uint32_t seed = 0x46524147;
+
+	std::vector<Actor*> actors;
+	for ( unsigned int i = 0; i < TEST_NUM_LARGE_ACTORS; ++i ) {
+		actors.push_back( SpawnActor( &seed ) );
+	}
+
+	TestGame game;
+	StartGame( &game, 2 );
+
+	size_t largest_snapshot = 0;
+	for ( unsigned int tick = 0; tick < TEST_NUM_SETTLE_TICKS; ++tick ) {
+		StepGame( &game );
+		largest_snapshot = std::max( largest_snapshot, game.server->GetLastSnapshotSize() );
+	}
+
+	TEST_CHECK( largest_snapshot > NET_MAX_PACKET_SIZE );
+	CheckConverged( &game );
+
+	EndGame( &game );
+	DestroyActors( actors );
+}
+
+REGISTER_TEST( "net.fragmented", Test_Fragmented )
+
+/* Nothing gets through until the latency's up, and the same seed drops the same packets */
+static void Test_Lag() {
+	INetTransport* receiver = Net_CreateLoopbackTransport( "test_lag_receiver" );
+	NetLagTransport sender( Net_CreateLoopbackTransport( "test_lag_sender" ) );
+	NetPeer peer = sender.Resolve( "test_lag_receiver" );
+	TEST_CHECK( peer != NET_INVALID_PEER );
+
+	sender.SetLatency( TEST_LATENCY );
+
+	uint8_t byte = 0;
+	NetPacket packet;
+	sender.Send( peer, &byte, 1 );
+	for ( unsigned int i = 0; i < TEST_LATENCY_TICKS; ++i ) {
+		sender.Receive( &packet );
+		TEST_CHECK( !receiver->Receive( &packet ) );
+		g_state.sim_ticks++;
+	}
+	sender.Receive( &packet );
+	TEST_CHECK( receiver->Receive( &packet ) );
+
+	sender.SetLatency( 0 );
+	sender.SetLoss( 0.5f );
+
+	std::vector<bool> delivered[ 2 ];
+	for ( auto& run : delivered ) {
+		sender.SetLossSeed( 0x4C4F5353 );
+		for ( unsigned int i = 0; i < TEST_NUM_LAG_PACKETS; ++i ) {
+			sender.Send( peer, &byte, 1 );
+			run.push_back( receiver->Receive( &packet ) );
+		}
+	}
+
+	TEST_CHECK( delivered[ 0 ] == delivered[ 1 ] );
+	size_t num_delivered = std::count( delivered[ 0 ].begin(), delivered[ 0 ].end(), true );
+	TEST_CHECK( num_delivered > TEST_NUM_LAG_PACKETS * 4 / 10 && num_delivered < TEST_NUM_LAG_PACKETS * 6 / 10 );
+
+	delete receiver;
+}
+
+REGISTER_TEST( "net.lag", Test_Lag )
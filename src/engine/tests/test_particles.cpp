@@ -0,0 +1,459 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "../engine.h"
+#include "../particle.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* PPS files are written out under the fixtures, which are mounted, so
+ * they can be found by name the same as the game's own effects.
+ */
+
+static std::string GetPPSPath( const char* name ) {
+	return Fixture_GetPath( "particles/" ) + name + "." PPS_EXTENSION;
+}
+
+static void CreateParticlesPath() {
+	plCreatePath( Fixture_GetPath( "particles/" ).c_str() );
+}
+
+/**
+ * Everything the format holds; velocity only survives as far as where
+ * particles end up, so is given in whole units over the lifetime.
+ */
+static void FillTemplate( PSTemplate* pst ) {
+	*pst = PSTemplate();
+	strcpy( pst->name, "test" );
+
+	PSEmitterTemplate* fire = &pst->emitters[ pst->num_emitters++ ];
+	fire->properties.max_particles = 64;
+	fire->properties.position = PLVector3( 10, -20, 30 );
+	fire->properties.lifetime = 0.5f;
+	fire->properties.velocity = PLVector3( 100, 200, -300 );
+	fire->properties.start_colour = PLColour( 255, 128, 0, 255 );
+	fire->properties.end_colour = PLColour( 64, 0, 0, 0 );
+	fire->properties.start_size = 8;
+	fire->properties.end_size = 32;
+	fire->properties.blend = PS_BLEND_TYPE_ADDITIVE;
+	fire->properties.is_looping = false;
+	strcpy( fire->material, "particles/fire" );
+
+	PSEmitterTemplate* smoke = &pst->emitters[ pst->num_emitters++ ];
+	smoke->properties.max_particles = 1;
+	smoke->properties.lifetime = 2.0f;
+	smoke->properties.start_colour = smoke->properties.end_colour = PLColour( 32, 32, 32, 128 );
+	smoke->properties.start_size = smoke->properties.end_size = 1;
+	smoke->properties.blend = PS_BLEND_TYPE_NONE;
+	smoke->properties.is_looping = true;
+}
+
+static bool IsColourEqual( const PLColour& a, const PLColour& b ) {
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static void CheckEmitter( const PSEmitterTemplate& a, const PSEmitterTemplate& b ) {
+	const PSEmitter& pa = a.properties;
+	const PSEmitter& pb = b.properties;
+	TEST_CHECK( pa.max_particles == pb.max_particles );
+	TEST_CHECK_NEAR( pa.position.x, pb.position.x, 0.001 );
+	TEST_CHECK_NEAR( pa.position.y, pb.position.y, 0.001 );
+	TEST_CHECK_NEAR( pa.position.z, pb.position.z, 0.001 );
+	TEST_CHECK_NEAR( pa.velocity.x, pb.velocity.x, 0.001 );
+	TEST_CHECK_NEAR( pa.velocity.y, pb.velocity.y, 0.001 );
+	TEST_CHECK_NEAR( pa.velocity.z, pb.velocity.z, 0.001 );
+	TEST_CHECK_NEAR( pa.lifetime, pb.lifetime, 0.001 );
+	TEST_CHECK( IsColourEqual( pa.start_colour, pb.start_colour ) );
+	TEST_CHECK( IsColourEqual( pa.end_colour, pb.end_colour ) );
+	TEST_CHECK( pa.start_size == pb.start_size );
+	TEST_CHECK( pa.end_size == pb.end_size );
+	TEST_CHECK( pa.blend == pb.blend );
+	TEST_CHECK( pa.is_looping == pb.is_looping );
+	TEST_CHECK( strcmp( a.material, b.material ) == 0 );
+}
+
+static void Test_PPSRoundTrip() {
+	CreateParticlesPath();
+
+	PSTemplate original;
+	FillTemplate( &original );
+
+	std::string path = GetPPSPath( "round_trip" );
+	TEST_CHECK( WriteParticleTemplate( path.c_str(), &original ) );
+
+	const PSTemplate* loaded = LoadParticleTemplate( path.c_str() );
+	TEST_CHECK( loaded != nullptr );
+	if ( loaded == nullptr ) {
+		return;
+	}
+
+	TEST_CHECK( strcmp( loaded->name, "round_trip" ) == 0 );
+	TEST_CHECK( loaded->num_emitters == original.num_emitters );
+	for ( unsigned int i = 0; i < std::min( loaded->num_emitters, original.num_emitters ); ++i ) {
+		CheckEmitter( loaded->emitters[ i ], original.emitters[ i ] );
+	}
+
+	// Only the one with a material gets a texture
+	TEST_CHECK( loaded->emitters[ 0 ].properties.texture != nullptr );
+	TEST_CHECK( loaded->emitters[ 1 ].properties.texture == nullptr );
+	// Enough to keep it saturated
+	TEST_CHECK_NEAR( loaded->emitters[ 0 ].properties.spawn_rate, 128, 0.001 );
+
+	// And out again, which should come back exactly the same
+	std::string second_path = GetPPSPath( "round_trip_2" );
+	TEST_CHECK( WriteParticleTemplate( second_path.c_str(), loaded ) );
+	const PSTemplate* reloaded = LoadParticleTemplate( second_path.c_str() );
+	TEST_CHECK( reloaded != nullptr );
+	if ( reloaded != nullptr ) {
+		for ( unsigned int i = 0; i < reloaded->num_emitters; ++i ) {
+			CheckEmitter( reloaded->emitters[ i ], original.emitters[ i ] );
+		}
+	}
+
+	// Loaded templates are cached by name
+	TEST_CHECK( GetParticleTemplate( "round_trip" ) == loaded );
+
+	ClearParticleSystemCache();
+}
+
+REGISTER_TEST( "particles.pps_round_trip", Test_PPSRoundTrip )
+
+static void Test_PPSInvalid() {
+	CreateParticlesPath();
+
+	PSTemplate pst;
+	FillTemplate( &pst );
+
+	// Emitters that would have no room, or far more than could ever be alive
+	const unsigned int bad_counts[] = { 0, PARTICLE_MAX_PER_EMITTER + 1, UINT32_MAX / 4 + 1, UINT32_MAX };
+	for ( unsigned int count : bad_counts ) {
+		pst.emitters[ 1 ].properties.max_particles = count;
+		std::string path = GetPPSPath( "bad_count" );
+		TEST_CHECK( WriteParticleTemplate( path.c_str(), &pst ) );
+		TEST_CHECK( LoadParticleTemplate( path.c_str() ) == nullptr );
+	}
+
+	pst.emitters[ 1 ].properties.max_particles = PARTICLE_MAX_PER_EMITTER;
+	std::string path = GetPPSPath( "max_count" );
+	TEST_CHECK( WriteParticleTemplate( path.c_str(), &pst ) );
+	TEST_CHECK( LoadParticleTemplate( path.c_str() ) != nullptr );
+
+	// Cut short, part way through the first emitter
+	std::ifstream input( path, std::ios::binary );
+	std::vector<char> data( ( std::istreambuf_iterator<char>( input ) ), std::istreambuf_iterator<char>() );
+	input.close();
+	std::string truncated_path = GetPPSPath( "truncated" );
+	std::ofstream truncated( truncated_path, std::ios::binary );
+	truncated.write( data.data(), static_cast<std::streamsize>(data.size() / 2) );
+	truncated.close();
+	TEST_CHECK( LoadParticleTemplate( truncated_path.c_str() ) == nullptr );
+
+	// Wrong version
+	data[ 4 ] = '9';
+	std::string version_path = GetPPSPath( "bad_version" );
+	std::ofstream version( version_path, std::ios::binary );
+	version.write( data.data(), static_cast<std::streamsize>(data.size()) );
+	version.close();
+	TEST_CHECK( LoadParticleTemplate( version_path.c_str() ) == nullptr );
+
+	// Emitters added directly are held to the same limits
+	ParticleSystem* system = GetParticleSystemSlot();
+	TEST_CHECK( system != nullptr );
+	if ( system != nullptr ) {
+		TEST_CHECK( AddParticleEmitter( system, 0 ) == nullptr );
+		TEST_CHECK( AddParticleEmitter( system, PARTICLE_MAX_PER_EMITTER + 1 ) == nullptr );
+		TEST_CHECK( AddParticleEmitter( system, UINT32_MAX ) == nullptr );
+		TEST_CHECK( system->num_emitters == 0 );
+		ClearParticleSystemSlot( system );
+	}
+
+	ClearParticleSystemCache();
+}
+
+REGISTER_TEST( "particles.pps_invalid", Test_PPSInvalid )
+
+static void Test_PPSMissingCached() {
+	CreateParticlesPath();
+	ClearParticleSystemCache();
+
+	// Left over from an earlier run
+	remove( GetPPSPath( "late_arrival" ).c_str() );
+
+	TEST_CHECK( GetParticleTemplate( "late_arrival" ) == nullptr );
+
+	// The miss is remembered, so it's not looked for again...
+	PSTemplate pst;
+	FillTemplate( &pst );
+	TEST_CHECK( WriteParticleTemplate( GetPPSPath( "late_arrival" ).c_str(), &pst ) );
+	TEST_CHECK( GetParticleTemplate( "late_arrival" ) == nullptr );
+	TEST_CHECK( SpawnParticleSystem( "late_arrival", PLVector3( 0, 0, 0 ) ) == nullptr );
+
+	// ...until the cache is cleared
+	ClearParticleSystemCache();
+	TEST_CHECK( GetParticleTemplate( "late_arrival" ) != nullptr );
+
+	ClearParticleSystemCache();
+}
+
+REGISTER_TEST( "particles.pps_missing_cached", Test_PPSMissingCached )
+
+static void Test_ParticlePool() {
+	PSTemplate pst;
+	FillTemplate( &pst );
+
+	ParticleSystem* system = InstantiateParticleTemplate( &pst, PLVector3( 0, 0, 0 ) );
+	TEST_CHECK( system != nullptr );
+	if ( system == nullptr ) {
+		return;
+	}
+
+	TEST_CHECK( system->num_emitters == pst.num_emitters );
+	TEST_CHECK( system->emitters[ 0 ].max_particles == pst.emitters[ 0 ].properties.max_particles );
+
+	PSEmitter* emitters = system->emitters;
+	float* storage = system->emitters[ 0 ].particles.position_x;
+	unsigned int* draw_order = system->emitters[ 0 ].particles.draw_order;
+
+	// Spawn a few, and order them, so there's something to be left behind
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		SimulateParticles();
+	}
+	TEST_CHECK( system->emitters[ 0 ].num_particles > 0 );
+	SortParticleEmitter( &system->emitters[ 0 ], PLVector3( 0, 0, 0 ), PLVector3( 0, 0, 1 ) );
+	unsigned int num_active = GetNumActiveParticles();
+	TEST_CHECK( num_active > 0 );
+
+	ClearParticleSystemSlot( system );
+	TEST_CHECK( GetNumActiveParticles() == 0 );
+
+	// The same slot comes straight back, with its emitters and storage reused
+	ParticleSystem* second = InstantiateParticleTemplate( &pst, PLVector3( 0, 0, 0 ) );
+	TEST_CHECK( second == system );
+	if ( second == nullptr ) {
+		return;
+	}
+
+	TEST_CHECK( second->emitters == emitters );
+	TEST_CHECK( second->emitters[ 0 ].particles.position_x == storage );
+	TEST_CHECK( second->emitters[ 0 ].particles.draw_order == draw_order );
+	// Starts over, with none of the last one's state
+	TEST_CHECK( second->emitters[ 0 ].num_particles == 0 );
+	TEST_CHECK( second->emitters[ 0 ].num_spawned == 0 );
+	TEST_CHECK( second->emitters[ 0 ].particles.num_ordered == 0 );
+
+	ClearParticleSystemSlot( second );
+}
+
+REGISTER_TEST( "particles.pool", Test_ParticlePool )
+
+static void SetupEmitter( PSEmitter* emitter ) {
+	emitter->is_looping = true;
+	emitter->spawn_rate = 200;
+	emitter->lifetime = 1.0f;
+	emitter->velocity = PLVector3( 10, 100, -20 );
+	emitter->velocity_spread = PLVector3( 50, 25, 50 );
+	emitter->gravity = PLVector3( 0, -400, 0 );
+	emitter->drag = 0.5f;
+	emitter->start_size = 4;
+	emitter->end_size = 16;
+	emitter->seed = 0x50415254;
+}
+
+static bool IsParticleDataEqual( const PSEmitter* a, const PSEmitter* b ) {
+	if ( a->num_particles != b->num_particles ) {
+		return false;
+	}
+
+	size_t size = sizeof( float ) * a->num_particles;
+	const PSParticleData& pa = a->particles;
+	const PSParticleData& pb = b->particles;
+	return memcmp( pa.position_x, pb.position_x, size ) == 0 &&
+		memcmp( pa.position_y, pb.position_y, size ) == 0 &&
+		memcmp( pa.position_z, pb.position_z, size ) == 0 &&
+		memcmp( pa.velocity_x, pb.velocity_x, size ) == 0 &&
+		memcmp( pa.velocity_y, pb.velocity_y, size ) == 0 &&
+		memcmp( pa.velocity_z, pb.velocity_z, size ) == 0 &&
+		memcmp( pa.age, pb.age, size ) == 0 &&
+		memcmp( pa.size, pb.size, size ) == 0;
+}
+
+/**
+ * Two emitters given the same seed have to spawn, move and retire
+ * their particles identically, down to the last bit, over a couple
+ * of lifetimes.
+ */
+static void Test_Deterministic() {
+	ParticleSystem* systems[ 2 ];
+	for ( auto& system : systems ) {
+		system = GetParticleSystemSlot();
+		TEST_CHECK( system != nullptr );
+		if ( system == nullptr ) {
+			return;
+		}
+
+		system->position = PLVector3( 100, 200, 300 );
+		PSEmitter* emitter = AddParticleEmitter( system, 256 );
+		TEST_CHECK( emitter != nullptr );
+		if ( emitter == nullptr ) {
+			return;
+		}
+		SetupEmitter( emitter );
+	}
+
+	for ( unsigned int i = 0; i < TICKS_PER_SECOND * 2; ++i ) {
+		SimulateParticles();
+		TEST_CHECK( IsParticleDataEqual( &systems[ 0 ]->emitters[ 0 ], &systems[ 1 ]->emitters[ 0 ] ) );
+	}
+	TEST_CHECK( systems[ 0 ]->emitters[ 0 ].num_particles > 0 );
+
+	for ( auto& system : systems ) {
+		ClearParticleSystemSlot( system );
+	}
+}
+
+REGISTER_TEST( "particles.deterministic", Test_Deterministic )
+
+/**
+ * Each tick the velocity has gravity added and is then scaled back by
+ * the drag, before moving the particle. Summing that over the ticks
+ * gives where a single particle should be after any number of them.
+ */
+static void Test_Integrate() {
+	ParticleSystem* system = GetParticleSystemSlot();
+	TEST_CHECK( system != nullptr );
+	if ( system == nullptr ) {
+		return;
+	}
+
+	system->position = PLVector3( 0, 0, 0 );
+	PSEmitter* emitter = AddParticleEmitter( system, 1 );
+	TEST_CHECK( emitter != nullptr );
+	if ( emitter == nullptr ) {
+		ClearParticleSystemSlot( system );
+		return;
+	}
+
+	SetupEmitter( emitter );
+	emitter->is_looping = false;
+	emitter->lifetime = 100.0f;
+	emitter->velocity_spread = PLVector3( 0, 0, 0 );
+	emitter->position = PLVector3( 0, 0, 0 );
+
+	// Spawned at the end of the first, and then only this emitter is stepped
+	SimulateParticles();
+	TEST_CHECK( emitter->num_particles == 1 );
+	system->is_enabled = false;
+
+	const unsigned int num_ticks = TICKS_PER_SECOND * 4;
+	for ( unsigned int i = 0; i < num_ticks; ++i ) {
+		IntegrateParticleEmitter( emitter, PARTICLE_TICK_DELTA );
+	}
+
+	double dt = PARTICLE_TICK_DELTA;
+	double d = 1.0 - emitter->drag * dt;
+	double dk = pow( d, num_ticks );
+	double decay_sum = d * ( 1.0 - dk ) / ( 1.0 - d );  // d + d^2 + ... + d^k
+
+	const float v0[] = { emitter->velocity.x, emitter->velocity.y, emitter->velocity.z };
+	const float g[] = { emitter->gravity.x, emitter->gravity.y, emitter->gravity.z };
+	const float* position[] = { emitter->particles.position_x, emitter->particles.position_y, emitter->particles.position_z };
+	const float* velocity[] = { emitter->particles.velocity_x, emitter->particles.velocity_y, emitter->particles.velocity_z };
+	for ( unsigned int i = 0; i < 3; ++i ) {
+		double expected_velocity = v0[ i ] * dk + g[ i ] * dt * decay_sum;
+		double expected_position = dt * ( v0[ i ] * decay_sum + g[ i ] * dt * d / ( 1.0 - d ) * ( num_ticks - decay_sum ) );
+		TEST_CHECK_NEAR( velocity[ i ][ 0 ], expected_velocity, 0.01 );
+		TEST_CHECK_NEAR( position[ i ][ 0 ], expected_position, 0.1 );
+	}
+	TEST_CHECK_NEAR( emitter->particles.age[ 0 ], num_ticks * dt, 0.001 );
+
+	ClearParticleSystemSlot( system );
+}
+
+REGISTER_TEST( "particles.integrate", Test_Integrate )
+
+#define TEST_SORT_GROUPS            64
+#define TEST_SORT_GROUP_PARTICLES   16
+#define TEST_SORT_PARTICLES         ( TEST_SORT_GROUPS * TEST_SORT_GROUP_PARTICLES )
+
+/**
+ * Has to come out furthest first, and anything at the same depth has to
+ * stay in the order it was drawn in last time, so particles that are
+ * level with one another don't flicker.
+ */
+static void CheckSortOrder( const PSEmitter* emitter, const std::vector<unsigned int>& last_order ) {
+	std::vector<unsigned int> last_rank( last_order.size() );
+	for ( unsigned int i = 0; i < last_order.size(); ++i ) {
+		last_rank[ last_order[ i ] ] = i;
+	}
+
+	const PSParticleData* p = &emitter->particles;
+	TEST_CHECK( p->num_ordered == emitter->num_particles );
+	for ( unsigned int i = 1; i < emitter->num_particles; ++i ) {
+		float a = p->position_z[ p->draw_order[ i - 1 ] ];
+		float b = p->position_z[ p->draw_order[ i ] ];
+		TEST_CHECK( a >= b );
+		if ( a == b ) {
+			TEST_CHECK( last_rank[ p->draw_order[ i - 1 ] ] < last_rank[ p->draw_order[ i ] ] );
+		}
+	}
+}
+
+static void Test_SortOrder() {
+	std::vector<float> position_x( TEST_SORT_PARTICLES, 0 ), position_y( TEST_SORT_PARTICLES, 0 ), position_z;
+	std::vector<unsigned int> draw_order( TEST_SORT_PARTICLES );
+
+	// Groups of particles in the same place, well apart along the view, and mixed up
+	uint32_t seed = 0x534F5254;
+	for ( unsigned int i = 0; i < TEST_SORT_PARTICLES; ++i ) {
+		position_z.push_back( 64.0f + 32.0f * static_cast<float>(Fixture_Random( &seed ) % TEST_SORT_GROUPS) );
+		draw_order[ i ] = i;
+	}
+	for ( unsigned int i = TEST_SORT_PARTICLES - 1; i > 0; --i ) {
+		std::swap( draw_order[ i ], draw_order[ Fixture_Random( &seed ) % ( i + 1 ) ] );
+	}
+
+	PSEmitter emitter = PSEmitter();
+	emitter.particles.position_x = position_x.data();
+	emitter.particles.position_y = position_y.data();
+	emitter.particles.position_z = position_z.data();
+	emitter.particles.draw_order = draw_order.data();
+	emitter.particles.num_ordered = TEST_SORT_PARTICLES;
+	emitter.num_particles = emitter.max_particles = TEST_SORT_PARTICLES;
+
+	const PLVector3 view_origin( 0, 0, 0 );
+	const PLVector3 view_forward( 0, 0, 1 );
+
+	// Nowhere near in order, so it's all sorted again
+	std::vector<unsigned int> last_order = draw_order;
+	SortParticleEmitter( &emitter, view_origin, view_forward );
+	CheckSortOrder( &emitter, last_order );
+
+	// Only a couple out of place, so they're moved in to where they should be
+	std::swap( draw_order[ 0 ], draw_order[ TEST_SORT_PARTICLES - 1 ] );
+	last_order = draw_order;
+	SortParticleEmitter( &emitter, view_origin, view_forward );
+	CheckSortOrder( &emitter, last_order );
+}
+
+REGISTER_TEST( "particles.sort_order", Test_SortOrder )
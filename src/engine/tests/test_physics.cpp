@@ -0,0 +1,283 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+#include "../terrain.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* Bodies are dropped onto terrain built from simple shapes, which the
+ * physics only ever sees as the heightfield, and are checked against
+ * where the terrain's own traces, and the drawn triangles, say they
+ * should end up.
+ */
+
+#define TEST_TILE_X         32
+#define TEST_TILE_Y         32
+#define TEST_BODY_RADIUS    16.0f
+#define TEST_REST_TICKS     ( TICKS_PER_SECOND * 5 )
+#define TEST_FALL_HEIGHT    16384.0f
+#define TEST_FALL_TICKS     ( TICKS_PER_SECOND * 8 )
+
+using namespace openhow;
+
+static PLVector3 Drop( const PLVector3& position, float radius, unsigned int num_ticks ) {
+	IPhysicsBody* body = Engine::Physics()->CreatePhysicsBody(
+		PhysicsPrimitiveType::SPHERE, PLVector3( radius, radius, radius ), 10.0f, position );
+	for ( unsigned int i = 0; i < num_ticks; ++i ) {
+		Engine::Physics()->Tick();
+	}
+
+	const PLMatrix4& transform = body->GetTransform();
+	PLVector3 out( transform.m[ 12 ], transform.m[ 13 ], transform.m[ 14 ] );
+	Engine::Physics()->DestroyPhysicsBody( body );
+	return out;
+}
+
+/**
+ * Height of the tile as it's drawn, which is as (0, 2, 1) and (1, 2, 3),
+ * so split from corner 1 across to corner 2.
+ */
+static float GetDrawnHeight( const Terrain::Tile& tile, float u, float v ) {
+	if ( u + v <= 1 ) {
+		return tile.height[ 0 ] + ( tile.height[ 1 ] - tile.height[ 0 ] ) * u + ( tile.height[ 2 ] - tile.height[ 0 ] ) * v;
+	}
+
+	return tile.height[ 3 ] + ( tile.height[ 2 ] - tile.height[ 3 ] ) * ( 1 - u ) + ( tile.height[ 1 ] - tile.height[ 3 ] ) * ( 1 - v );
+}
+
+static bool IsTestCorner( float x, float z, unsigned int corner ) {
+	return x == ( TEST_TILE_X + corner % 2 ) * TERRAIN_TILE_PIXEL_WIDTH &&
+		z == ( TEST_TILE_Y + corner / 2 ) * TERRAIN_TILE_PIXEL_WIDTH;
+}
+
+// Only the test tile's first corner is raised, so its far half is flat at the bottom
+static float GetRaisedCornerHeight( float x, float z ) {
+	return IsTestCorner( x, z, 0 ) ? 512.0f : 0;
+}
+
+// And the other way around, so its far half is flat at the top
+static float GetSunkenCornerHeight( float x, float z ) {
+	return ( IsTestCorner( x, z, 1 ) || IsTestCorner( x, z, 2 ) || IsTestCorner( x, z, 3 ) ) ? 512.0f : 0;
+}
+
+/**
+ * The body's dropped on the half of the test tile that's flat, had it
+ * been split the same way as it's drawn. Split the other way, it'd
+ * land on a slope, and roll off somewhere else.
+ */
+static void CheckRestingHeight( float ( * height )( float x, float z ), float u, float v ) {
+	Terrain* terrain = Fixture_CreateTerrain( height );
+
+	PLVector3 point(
+		( TEST_TILE_X + u ) * TERRAIN_TILE_PIXEL_WIDTH, 0, ( TEST_TILE_Y + v ) * TERRAIN_TILE_PIXEL_WIDTH );
+	const Terrain::Tile* tile = terrain->GetTile( PLVector2( point.x, point.z ) );
+	TEST_CHECK( tile != nullptr );
+	if ( tile == nullptr ) {
+		delete terrain;
+		return;
+	}
+
+	float drawn_height = GetDrawnHeight( *tile, u, v );
+
+	Terrain::TraceHit hit;
+	TEST_CHECK( terrain->Trace(
+		PLVector3( point.x, drawn_height + 1024.0f, point.z ),
+		PLVector3( point.x, drawn_height - 1024.0f, point.z ), &hit ) );
+	TEST_CHECK_NEAR( hit.position.y, drawn_height, 0.01 );
+
+	PLVector3 rest = Drop(
+		PLVector3( point.x, drawn_height + 128.0f, point.z ), TEST_BODY_RADIUS, TEST_REST_TICKS );
+	TEST_CHECK_NEAR( rest.y - TEST_BODY_RADIUS, hit.position.y, 2.0 );
+	TEST_CHECK_NEAR( rest.x, point.x, 2.0 );
+	TEST_CHECK_NEAR( rest.z, point.z, 2.0 );
+
+	delete terrain;
+}
+
+static void Test_RestingHeight() {
+	CheckRestingHeight( GetRaisedCornerHeight, 0.8f, 0.6f );
+	CheckRestingHeight( GetSunkenCornerHeight, 0.8f, 0.6f );
+}
+
+REGISTER_TEST( "physics.resting_height", Test_RestingHeight )
+
+/**
+ * Just past the drawn diagonal, on the line between corners 0 and 3,
+ * where the other split would be furthest from flat. The body's small
+ * enough that it only touches the flat half, as long as the two agree.
+ */
+static void Test_Diagonal() {
+	CheckRestingHeight( GetRaisedCornerHeight, 0.56f, 0.56f );
+	CheckRestingHeight( GetSunkenCornerHeight, 0.56f, 0.56f );
+}
+
+REGISTER_TEST( "physics.diagonal", Test_Diagonal )
+
+static float GetFlatHeight( float x, float z ) {
+	u_unused( x );
+	u_unused( z );
+	return 0;
+}
+
+/**
+ * Falling from this high, the body's moving far further than its own
+ * size each step by the time it lands, so without continuous
+ * collision it'd go straight through, however many substeps.
+ */
+static void Test_Tunnelling() {
+	Terrain* terrain = Fixture_CreateTerrain( GetFlatHeight );
+
+	std::string old_substeps = cv_physics_substeps->s_value;
+
+	const char* substeps[] = { "1", "8" };
+	for ( const char* num_steps : substeps ) {
+		plSetConsoleVariable( cv_physics_substeps, num_steps );
+
+		const float radius = 4.0f;
+		PLVector3 rest = Drop( PLVector3( 16640.0f, TEST_FALL_HEIGHT, 16640.0f ), radius, TEST_FALL_TICKS );
+		if ( rest.y < 0 ) {
+			LogWarn( "Body went through the terrain with %s substeps, ending up at %f!\n", num_steps, rest.y );
+		}
+		TEST_CHECK_NEAR( rest.y - radius, 0, 2.0 );
+	}
+
+	plSetConsoleVariable( cv_physics_substeps, old_substeps.c_str() );
+
+	delete terrain;
+}
+
+REGISTER_TEST( "physics.tunnelling", Test_Tunnelling )
+
+static void TickPhysics( unsigned int num_ticks, unsigned int* max_active = nullptr ) {
+	for ( unsigned int i = 0; i < num_ticks; ++i ) {
+		Engine::Physics()->Tick();
+		if ( max_active != nullptr ) {
+			*max_active = std::max( *max_active, Engine::Physics()->GetStats().num_active_bodies );
+		}
+	}
+}
+
+/**
+ * Resting on the terrain shouldn't keep a body awake, only something
+ * else landing on it should, and once that's settled down too, both
+ * should be left to sleep.
+ */
+static void Test_Sleep() {
+	Terrain* terrain = Fixture_CreateTerrain( GetFlatHeight );
+
+	const PLVector3 size( TEST_BODY_RADIUS, TEST_BODY_RADIUS, TEST_BODY_RADIUS );
+	IPhysicsBody* body = Engine::Physics()->CreatePhysicsBody(
+		PhysicsPrimitiveType::SPHERE, size, 10.0f, PLVector3( 16640.0f, TEST_BODY_RADIUS * 2, 16640.0f ) );
+	TickPhysics( TEST_REST_TICKS );
+	TEST_CHECK( Engine::Physics()->GetStats().num_active_bodies == 0 );
+	TEST_CHECK( Engine::Physics()->GetStats().num_sleeping_bodies == 1 );
+
+	unsigned int max_active = 0;
+	IPhysicsBody* other = Engine::Physics()->CreatePhysicsBody(
+		PhysicsPrimitiveType::SPHERE, size, 10.0f, PLVector3( 16640.0f, 512.0f, 16640.0f ) );
+	TickPhysics( TEST_REST_TICKS, &max_active );
+	TEST_CHECK( max_active == 2 );
+
+	TickPhysics( TEST_REST_TICKS );
+	TEST_CHECK( Engine::Physics()->GetStats().num_active_bodies == 0 );
+	TEST_CHECK( Engine::Physics()->GetStats().num_sleeping_bodies == 2 );
+
+	Engine::Physics()->DestroyPhysicsBody( other );
+	Engine::Physics()->DestroyPhysicsBody( body );
+
+	delete terrain;
+}
+
+REGISTER_TEST( "physics.sleep", Test_Sleep )
+
+#define TEST_NUM_DROPS      8
+
+/**
+ * Without continuous collision, substeps are all that stop a fast body
+ * going through. By the time these land, a whole tick takes them over
+ * seven times their own width, so most of them, each arriving a little
+ * later than the last, should go through with one step. A sixteenth of
+ * that is less than their width, so with sixteen none of them can.
+ */
+static void Test_Substeps() {
+	Terrain* terrain = Fixture_CreateTerrain( GetFlatHeight );
+
+	std::string old_substeps = cv_physics_substeps->s_value;
+	std::string old_continuous = cv_physics_continuous->s_value;
+	plSetConsoleVariable( cv_physics_continuous, "false" );
+
+	const char* substeps[] = { "1", "16" };
+	unsigned int num_tunnelled[] = { 0, 0 };
+	for ( unsigned int i = 0; i < 2; ++i ) {
+		plSetConsoleVariable( cv_physics_substeps, substeps[ i ] );
+		for ( unsigned int j = 0; j < TEST_NUM_DROPS; ++j ) {
+			PLVector3 rest = Drop(
+				PLVector3( 16640.0f + j * 256.0f, TEST_FALL_HEIGHT + j * 32.0f, 16640.0f ),
+				TEST_BODY_RADIUS, TEST_FALL_TICKS );
+			if ( rest.y < 0 ) {
+				num_tunnelled[ i ]++;
+			}
+		}
+	}
+
+	LogInfo( "%u of %u bodies went through with one substep\n", num_tunnelled[ 0 ], TEST_NUM_DROPS );
+	TEST_CHECK( num_tunnelled[ 0 ] > 0 );
+	TEST_CHECK( num_tunnelled[ 1 ] == 0 );
+
+	plSetConsoleVariable( cv_physics_continuous, old_continuous.c_str() );
+	plSetConsoleVariable( cv_physics_substeps, old_substeps.c_str() );
+
+	delete terrain;
+}
+
+REGISTER_TEST( "physics.substeps", Test_Substeps )
+
+// Falls freely, so each tick it's somewhere new to blend between
+static void Test_Interpolation() {
+	IPhysicsBody* body = Engine::Physics()->CreatePhysicsBody( PhysicsPrimitiveType::SPHERE,
+		PLVector3( TEST_BODY_RADIUS, TEST_BODY_RADIUS, TEST_BODY_RADIUS ), 10.0f,
+		PLVector3( 16640.0f, TEST_FALL_HEIGHT, 16640.0f ) );
+	TEST_CHECK( body->HasTransform() );
+
+	TickPhysics( 2 );
+	PLMatrix4 last = body->GetTransform();
+	TickPhysics( 1 );
+
+	const PLMatrix4& previous = body->GetPreviousTransform();
+	const PLMatrix4& current = body->GetTransform();
+	TEST_CHECK( previous.m[ 13 ] == last.m[ 13 ] );
+	TEST_CHECK( current.m[ 13 ] < previous.m[ 13 ] );
+
+	const float factors[] = { 0.0f, 0.25f, 0.5f, 1.0f };
+	for ( float factor : factors ) {
+		PLMatrix4 blended = body->GetInterpolatedTransform( factor );
+		for ( unsigned int i = 12; i < 15; ++i ) {
+			TEST_CHECK_NEAR( blended.m[ i ], previous.m[ i ] + ( current.m[ i ] - previous.m[ i ] ) * factor, 0.01 );
+		}
+		TEST_CHECK_NEAR( blended.m[ 0 ], 1.0, 0.001 );
+		TEST_CHECK_NEAR( blended.m[ 5 ], 1.0, 0.001 );
+		TEST_CHECK_NEAR( blended.m[ 10 ], 1.0, 0.001 );
+	}
+
+	Engine::Physics()->DestroyPhysicsBody( body );
+}
+
+REGISTER_TEST( "physics.interpolation", Test_Interpolation )
@@ -0,0 +1,157 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../engine.h"
+#include "../terrain.h"
+#include "../graphics/render_queue.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* Programs are only ever compared, and a model without any levels has no
+ * texture, so neither needs to be real for anything short of drawing.
+ */
+
+static ShaderProgram* GetFakeProgram( unsigned int i ) {
+	return reinterpret_cast<ShaderProgram*>(static_cast<uintptr_t>(( i + 1 ) * 16));
+}
+
+static unsigned int GetKeyLayer( uint64_t key ) {
+	return static_cast<unsigned int>(key >> 60U);
+}
+
+static bool IsKeyTranslucent( uint64_t key ) {
+	return ( ( key >> 59U ) & 1U ) != 0;
+}
+
+static void Test_KeyLayout() {
+	const uint64_t depth_max = ( 1ULL << RENDER_KEY_DEPTH_BITS ) - 1;
+	const uint64_t shader_max = ( 1ULL << RENDER_KEY_SHADER_BITS ) - 1;
+
+	// Each field where the layout says it is
+	uint64_t key = RenderQueue::BuildSortKey( 3, false, 5, 7, RENDER_KEY_MAX_DEPTH );
+	TEST_CHECK( GetKeyLayer( key ) == 3 );
+	TEST_CHECK( !IsKeyTranslucent( key ) );
+	TEST_CHECK( ( ( key >> ( RENDER_KEY_TEXTURE_BITS + RENDER_KEY_DEPTH_BITS ) ) & shader_max ) == 5 );
+	TEST_CHECK( ( ( key >> RENDER_KEY_DEPTH_BITS ) & 0xFFFF ) == 7 );
+	TEST_CHECK( ( key & depth_max ) == depth_max );
+
+	key = RenderQueue::BuildSortKey( 3, true, 5, 7, 0 );
+	TEST_CHECK( GetKeyLayer( key ) == 3 );
+	TEST_CHECK( IsKeyTranslucent( key ) );
+	TEST_CHECK( ( ( key >> ( RENDER_KEY_SHADER_BITS + RENDER_KEY_TEXTURE_BITS ) ) & depth_max ) == depth_max );
+	TEST_CHECK( ( ( key >> RENDER_KEY_TEXTURE_BITS ) & shader_max ) == 5 );
+	TEST_CHECK( ( key & 0xFFFF ) == 7 );
+
+	// Anything out of range is clamped rather than spilling into the next field
+	key = RenderQueue::BuildSortKey( 0, false, 100000, 100000, -10.0f );
+	TEST_CHECK( GetKeyLayer( key ) == 0 );
+	TEST_CHECK( !IsKeyTranslucent( key ) );
+	TEST_CHECK( ( ( key >> ( RENDER_KEY_TEXTURE_BITS + RENDER_KEY_DEPTH_BITS ) ) & shader_max ) == shader_max );
+	TEST_CHECK( ( ( key >> RENDER_KEY_DEPTH_BITS ) & 0xFFFF ) == 0xFFFF );
+	TEST_CHECK( ( key & depth_max ) == 0 );
+	TEST_CHECK( RenderQueue::BuildSortKey( 0, false, 0, 0, RENDER_KEY_MAX_DEPTH * 4.0f ) ==
+				RenderQueue::BuildSortKey( 0, false, 0, 0, RENDER_KEY_MAX_DEPTH ) );
+}
+
+REGISTER_TEST( "render_queue.key_layout", Test_KeyLayout )
+
+static void Test_KeyOrder() {
+	// Layers first, whatever else is in the key
+	TEST_CHECK( RenderQueue::BuildSortKey( 0, true, 2000, 60000, 0 ) <
+				RenderQueue::BuildSortKey( 1, false, 0, 0, 0 ) );
+	// Then everything opaque before anything translucent
+	TEST_CHECK( RenderQueue::BuildSortKey( 1, false, 2000, 60000, RENDER_KEY_MAX_DEPTH ) <
+				RenderQueue::BuildSortKey( 1, true, 0, 0, 0 ) );
+
+	// Opaque are grouped by shader, then texture, then drawn front-to-back
+	TEST_CHECK( RenderQueue::BuildSortKey( 1, false, 1, 9, 0 ) < RenderQueue::BuildSortKey( 1, false, 2, 0, 0 ) );
+	TEST_CHECK( RenderQueue::BuildSortKey( 1, false, 1, 1, 5000 ) < RenderQueue::BuildSortKey( 1, false, 1, 2, 0 ) );
+	TEST_CHECK( RenderQueue::BuildSortKey( 1, false, 1, 1, 100 ) < RenderQueue::BuildSortKey( 1, false, 1, 1, 200 ) );
+
+	// Translucent are always back-to-front, and only then by state
+	TEST_CHECK( RenderQueue::BuildSortKey( 1, true, 9, 9, 200 ) < RenderQueue::BuildSortKey( 1, true, 0, 0, 100 ) );
+	TEST_CHECK( RenderQueue::BuildSortKey( 1, true, 1, 9, 100 ) < RenderQueue::BuildSortKey( 1, true, 2, 0, 100 ) );
+}
+
+REGISTER_TEST( "render_queue.key_order", Test_KeyOrder )
+
+/**
+ * Submits a pile of commands in no particular order, and checks that what
+ * comes out is exactly what a stable std::sort on the same keys gives.
+ */
+static void Test_RadixSort() {
+	static PLModel model = {};
+	static PLMatrix4 transform = {};
+
+	struct Expected {
+		uint64_t key;
+		unsigned int index;
+	};
+	std::vector<Expected> expected;
+	std::vector<ShaderProgram*> programs;
+
+	RenderQueue queue;
+	queue.SetViewOrigin( { 0, 0, 0 } );
+
+	uint32_t seed = 0x52514B59;
+	const unsigned int num_commands = 5000;
+	for ( unsigned int i = 0; i < num_commands; ++i ) {
+		unsigned int layer = Fixture_Random( &seed ) % 4;
+		ShaderProgram* program = GetFakeProgram( Fixture_Random( &seed ) % 24 );
+		bool translucent = ( Fixture_Random( &seed ) % 4 ) == 0;
+		// Coarse, so that plenty of keys are shared and stability matters
+		float x = static_cast<float>(Fixture_Random( &seed ) % 64) * 128.0f;
+
+		PLColour tint = { static_cast<uint8_t>(i & 0xFF), static_cast<uint8_t>(i >> 8U), 0, 255 };
+		queue.Submit( layer, program, &model, transform, { x, 0, 0 }, translucent, tint );
+
+		// Shaders are numbered in the order they're first seen
+		auto shader = std::find( programs.begin(), programs.end(), program );
+		if ( shader == programs.end() ) {
+			shader = programs.insert( programs.end(), program );
+		}
+
+		float depth = std::sqrt( x * x + 0.0f * 0.0f + 0.0f * 0.0f );
+		unsigned int shader_index = static_cast<unsigned int>(shader - programs.begin());
+		expected.push_back( { RenderQueue::BuildSortKey( layer, translucent, shader_index, 0, depth ), i } );
+	}
+
+	queue.Sort();
+
+	std::stable_sort( expected.begin(), expected.end(), []( const Expected& a, const Expected& b ) {
+		return a.key < b.key;
+	} );
+
+	TEST_CHECK( queue.GetNumCommands() == num_commands );
+	unsigned int num_mismatches = 0;
+	for ( unsigned int i = 0; i < num_commands; ++i ) {
+		const PLColour& tint = queue.GetSortedCommand( i ).tint;
+		unsigned int index = tint.r | ( static_cast<unsigned int>(tint.g) << 8U );
+		if ( queue.GetSortedKey( i ) != expected[ i ].key || index != expected[ i ].index ) {
+			num_mismatches++;
+		}
+	}
+	TEST_CHECK( num_mismatches == 0 );
+
+	queue.Clear();
+	TEST_CHECK( queue.GetNumCommands() == 0 );
+}
+
+REGISTER_TEST( "render_queue.radix_sort", Test_RadixSort )
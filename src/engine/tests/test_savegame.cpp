@@ -0,0 +1,223 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+
+#include "../engine.h"
+#include "../journal.h"
+#include "../savegame.h"
+#include "../snapshot.h"
+#include "../terrain.h"
+#include "../Map.h"
+#include "../game/actor_manager.h"
+#include "../game/actors/actor.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* Games are started on the benchmark map, filled with actors and then
+ * saved. Everything's changed after the save's been written, so reading
+ * it back has to put it all back how it was, as far as the journal's
+ * checksum can tell, and carry on ticking exactly as it did before.
+ * Each test ends the game it started.
+ */
+
+#define TEST_NUM_ACTORS         200
+#define TEST_NUM_TILES          64
+#define TEST_NUM_TRUNCATIONS    64
+#define TEST_NUM_TICKS          ( TICKS_PER_SECOND * 2 )
+#define TEST_SAVE               "test.sav"
+
+using namespace openhow;
+
+static bool StartGame() {
+	Fixture_GetMap();
+	plParseConsoleString( "map " FIXTURE_MAP );
+	return Engine::Game()->IsModeActive();
+}
+
+static Terrain::Tile* GetRandomTile( Terrain* terrain, uint32_t* seed ) {
+	return terrain->GetTile( PLVector2(
+		static_cast<float>(Fixture_Random( seed ) % TERRAIN_PIXEL_WIDTH),
+		static_cast<float>(Fixture_Random( seed ) % TERRAIN_PIXEL_WIDTH) ) );
+}
+
+// Every fourth actor is linked to one spawned before it
+static void SpawnActors( uint32_t* seed ) {
+	std::vector<Actor*> actors;
+	for ( unsigned int i = 0; i < TEST_NUM_ACTORS; ++i ) {
+		Actor* actor = ActorManager::GetInstance()->CreateActor( "gr_me" );
+		actor->SetPosition( PLVector3(
+			static_cast<float>(Fixture_Random( seed ) % TERRAIN_PIXEL_WIDTH),
+			static_cast<float>(Fixture_Random( seed ) % 2048),
+			static_cast<float>(Fixture_Random( seed ) % TERRAIN_PIXEL_WIDTH) ) );
+		actor->SetHealth( static_cast<int16_t>(Fixture_Random( seed ) % 100) );
+
+		if ( !actors.empty() && ( i % 4 ) == 0 ) {
+			actors[ Fixture_Random( seed ) % actors.size() ]->LinkChild( actor );
+		}
+		actors.push_back( actor );
+	}
+}
+
+static unsigned int CountLinkedActors() {
+	unsigned int num_linked = 0;
+	for ( auto actor : ActorManager::GetInstance()->GetActors() ) {
+		if ( actor->GetParent() != nullptr ) {
+			num_linked++;
+		}
+	}
+	return num_linked;
+}
+
+static std::vector<uint32_t> TickGame() {
+	std::vector<uint32_t> checksums;
+	for ( unsigned int i = 0; i < TEST_NUM_TICKS; ++i ) {
+		Fixture_TickGame( 1 );
+		checksums.push_back( Journal_GetStateChecksum() );
+	}
+	return checksums;
+}
+
+static std::string GetTerrainState() {
+	SnapshotWriter writer;
+	Engine::Game()->GetCurrentMap()->GetTerrain()->SaveState( writer );
+	return std::string( reinterpret_cast<const char*>(writer.GetData()), writer.GetSize() );
+}
+
+static void Test_RoundTrip() {
+	// Nothing to save until there's a game going
+	TEST_CHECK( !Save_Write( Fixture_GetPath( TEST_SAVE ) ) );
+
+	TEST_CHECK( StartGame() );
+	if ( !Engine::Game()->IsModeActive() ) {
+		return;
+	}
+
+	uint32_t seed = 0x53415645;
+	SpawnActors( &seed );
+
+	Terrain* terrain = Engine::Game()->GetCurrentMap()->GetTerrain();
+	for ( unsigned int i = 0; i < TEST_NUM_TILES; ++i ) {
+		GetRandomTile( terrain, &seed )->height[ Fixture_Random( &seed ) % 4 ] -= 128.0f;
+	}
+	terrain->Update();
+
+	uint32_t checksum = Journal_GetStateChecksum();
+	size_t num_actors = ActorManager::GetInstance()->GetActors().size();
+	unsigned int num_linked = CountLinkedActors();
+	std::string terrain_state = GetTerrainState();
+
+	TEST_CHECK( Save_Write( Fixture_GetPath( TEST_SAVE ) ) );
+
+	// Left for the write to catch up with, as it would be in a game
+	std::vector<uint32_t> checksums = TickGame();
+	for ( auto actor : ActorManager::GetInstance()->GetActors() ) {
+		actor->SetHealth( 0 );
+	}
+	SpawnActors( &seed );
+	for ( unsigned int i = 0; i < TEST_NUM_TILES; ++i ) {
+		GetRandomTile( terrain, &seed )->height[ Fixture_Random( &seed ) % 4 ] += 256.0f;
+	}
+	terrain->Update();
+	Sim_Random();
+
+	TEST_CHECK( Journal_GetStateChecksum() != checksum );
+
+	TEST_CHECK( Save_Read( Fixture_GetPath( TEST_SAVE ) ) );
+	TEST_CHECK( Journal_GetStateChecksum() == checksum );
+	TEST_CHECK( ActorManager::GetInstance()->GetActors().size() == num_actors );
+	TEST_CHECK( CountLinkedActors() == num_linked );
+	TEST_CHECK( GetTerrainState() == terrain_state );
+
+	// Everything the checksum doesn't see has to have come back too, or it'll drift
+	std::vector<uint32_t> restored_checksums = TickGame();
+	for ( unsigned int i = 0; i < TEST_NUM_TICKS; ++i ) {
+		TEST_CHECK( restored_checksums[ i ] == checksums[ i ] );
+	}
+
+	Engine::Game()->EndMode();
+}
+
+REGISTER_TEST( "savegame.round_trip", Test_RoundTrip )
+
+/* The same again, but through saveVerify, which does it all in memory over the game's own ticks */
+static void Test_Verify() {
+	TEST_CHECK( StartGame() );
+	if ( !Engine::Game()->IsModeActive() ) {
+		return;
+	}
+
+	uint32_t seed = 0x56455249;
+	SpawnActors( &seed );
+
+	plParseConsoleString( ( "saveVerify " + std::to_string( TEST_NUM_TICKS ) ).c_str() );
+	TEST_CHECK( Save_IsVerifying() );
+
+	// Half the ticks to record, then the other half to compare against
+	Fixture_TickGame( TEST_NUM_TICKS * 2 );
+	TEST_CHECK( !Save_IsVerifying() );
+	TEST_CHECK( Save_HasVerifyPassed() );
+
+	Engine::Game()->EndMode();
+}
+
+REGISTER_TEST( "savegame.verify", Test_Verify )
+
+/**
+ * However much of the file's missing, it has to be turned away before
+ * anything in the running game is touched.
+ */
+static void Test_Truncated() {
+	TEST_CHECK( StartGame() );
+	if ( !Engine::Game()->IsModeActive() ) {
+		return;
+	}
+
+	uint32_t seed = 0x54525553;
+	SpawnActors( &seed );
+
+	TEST_CHECK( Save_Write( Fixture_GetPath( TEST_SAVE ) ) );
+
+	// Reading it back waits for the write to finish
+	uint32_t checksum = Journal_GetStateChecksum();
+	TEST_CHECK( Save_Read( Fixture_GetPath( TEST_SAVE ) ) );
+	TEST_CHECK( Journal_GetStateChecksum() == checksum );
+
+	std::ifstream input( Fixture_GetPath( TEST_SAVE ), std::ios::binary );
+	std::string save( ( std::istreambuf_iterator<char>( input ) ), std::istreambuf_iterator<char>() );
+	TEST_CHECK( !save.empty() );
+
+	size_t num_actors = ActorManager::GetInstance()->GetActors().size();
+	std::string path = Fixture_GetPath( "truncated.sav" );
+	for ( unsigned int i = 0; i <= TEST_NUM_TRUNCATIONS; ++i ) {
+		// Always including the last byte, as well as the very start
+		size_t size = ( i < TEST_NUM_TRUNCATIONS ) ? save.size() * i / TEST_NUM_TRUNCATIONS : save.size() - 1;
+
+		std::ofstream output( path, std::ios::binary | std::ios::trunc );
+		output.write( save.data(), size );
+		output.close();
+
+		TEST_CHECK( !Save_Read( path ) );
+		TEST_CHECK( Journal_GetStateChecksum() == checksum );
+		TEST_CHECK( ActorManager::GetInstance()->GetActors().size() == num_actors );
+	}
+
+	Engine::Game()->EndMode();
+}
+
+REGISTER_TEST( "savegame.truncated", Test_Truncated )
@@ -0,0 +1,211 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <map>
+
+#include "../engine.h"
+#include "../graphics/shaders.h"
+
+#include "test.h"
+
+/* Stands in for the platform library, so programs can be created without
+ * a graphics context, and counts what makes it through to the driver.
+ * Slots for each uniform move along whenever the program's rebuilt.
+ */
+
+static struct {
+	unsigned int num_programs;
+	unsigned int num_links;
+	std::map<std::string, unsigned int> lookups;
+	std::map<int, unsigned int> uploads;
+	std::map<int, float> last_float;
+} mock;
+
+static PLShaderProgram* Mock_CreateProgram() {
+	mock.num_programs++;
+	return reinterpret_cast<PLShaderProgram*>(static_cast<uintptr_t>(mock.num_programs * 16));
+}
+
+static void Mock_DestroyProgram( PLShaderProgram* ) {}
+
+static bool Mock_RegisterStage( PLShaderProgram*, const char*, PLShaderType ) {
+	return true;
+}
+
+static void Mock_LinkProgram( PLShaderProgram* ) {
+	mock.num_links++;
+}
+
+static void Mock_SetProgram( PLShaderProgram* ) {}
+
+static int Mock_GetUniformSlot( PLShaderProgram* program, const char* name ) {
+	mock.lookups[ name ]++;
+
+	int base = static_cast<int>(reinterpret_cast<uintptr_t>(program) / 16) * 100;
+	if ( strcmp( name, "tint" ) == 0 ) {
+		return base + 1;
+	} else if ( strcmp( name, "origin" ) == 0 ) {
+		return base + 2;
+	} else if ( strcmp( name, "pl_model" ) == 0 ) {
+		return base + 3;
+	}
+
+	return -1;
+}
+
+static void Mock_SetUniformFloat( PLShaderProgram*, int slot, float value ) {
+	mock.uploads[ slot ]++;
+	mock.last_float[ slot ] = value;
+}
+
+static void Mock_SetUniformVector3( PLShaderProgram*, int slot, const PLVector3& ) {
+	mock.uploads[ slot ]++;
+}
+
+static void Mock_SetUniformVector4( PLShaderProgram*, int slot, const PLVector4& ) {
+	mock.uploads[ slot ]++;
+}
+
+static void Mock_SetUniformMatrix4( PLShaderProgram*, int slot, const PLMatrix4& ) {
+	mock.uploads[ slot ]++;
+}
+
+static const ShaderBackend mockBackend = {
+	Mock_CreateProgram,
+	Mock_DestroyProgram,
+	Mock_RegisterStage,
+	Mock_LinkProgram,
+	Mock_SetProgram,
+	Mock_GetUniformSlot,
+	Mock_SetUniformFloat,
+	Mock_SetUniformVector3,
+	Mock_SetUniformVector4,
+	Mock_SetUniformMatrix4,
+};
+
+static unsigned int GetNumUploads() {
+	unsigned int total = 0;
+	for ( const auto& i : mock.uploads ) {
+		total += i.second;
+	}
+	return total;
+}
+
+static void ResetMock() {
+	mock.num_programs = 0;
+	mock.num_links = 0;
+	mock.lookups.clear();
+	mock.uploads.clear();
+	mock.last_float.clear();
+}
+
+static void Test_ShaderUniformCache() {
+	ResetMock();
+	Shaders_SetBackend( &mockBackend );
+
+	auto* program = new ShaderProgram( "test.vert", "test.frag" );
+	TEST_CHECK( mock.num_programs == 1 && mock.num_links == 1 );
+
+	// Indices are handed out once per name, and nothing's looked up until it's set
+	int tint = program->GetUniformIndex( "tint" );
+	TEST_CHECK( program->GetUniformIndex( "tint" ) == tint );
+	int origin = program->GetUniformIndex( "origin" );
+	TEST_CHECK( origin != tint );
+	TEST_CHECK( program->GetNumUniforms() == 2 );
+	TEST_CHECK( mock.lookups.empty() );
+
+	program->SetUniform( tint, 0.5f );
+	TEST_CHECK( mock.lookups[ "tint" ] == 1 );
+	TEST_CHECK( mock.uploads[ 101 ] == 1 );
+	TEST_CHECK( mock.last_float[ 101 ] == 0.5f );
+
+	// Same value again is skipped, and the slot comes from the cache
+	for ( unsigned int i = 0; i < 10; ++i ) {
+		program->SetUniform( tint, 0.5f );
+	}
+	TEST_CHECK( mock.lookups[ "tint" ] == 1 );
+	TEST_CHECK( mock.uploads[ 101 ] == 1 );
+
+	program->SetUniform( tint, 0.75f );
+	TEST_CHECK( mock.lookups[ "tint" ] == 1 );
+	TEST_CHECK( mock.uploads[ 101 ] == 2 );
+	TEST_CHECK( mock.last_float[ 101 ] == 0.75f );
+
+	// Only the components that make up the type are compared
+	program->SetUniform( origin, PLVector3( 1, 2, 3 ) );
+	program->SetUniform( origin, PLVector3( 1, 2, 3 ) );
+	TEST_CHECK( mock.uploads[ 102 ] == 1 );
+	program->SetUniform( origin, PLVector3( 1, 2, 4 ) );
+	TEST_CHECK( mock.uploads[ 102 ] == 2 );
+
+	// By name goes through the same cache
+	program->SetUniform( "pl_model", plMatrix4Identity() );
+	program->SetUniform( "pl_model", plMatrix4Identity() );
+	TEST_CHECK( mock.lookups[ "pl_model" ] == 1 );
+	TEST_CHECK( mock.uploads[ 103 ] == 1 );
+
+	// Missing uniforms are only ever looked up the once, and never uploaded
+	unsigned int num_uploads = GetNumUploads();
+	for ( unsigned int i = 0; i < 10; ++i ) {
+		program->SetUniform( "missing", static_cast<float>(i) );
+		program->SetUniform( "missing_vector", PLVector4( 0, 0, 0, i ) );
+	}
+	TEST_CHECK( mock.lookups[ "missing" ] == 1 );
+	TEST_CHECK( mock.lookups[ "missing_vector" ] == 1 );
+	TEST_CHECK( GetNumUploads() == num_uploads );
+
+	// Out of range does nothing at all
+	program->SetUniform( -1, 1.0f );
+	program->SetUniform( 1000, 1.0f );
+	TEST_CHECK( GetNumUploads() == num_uploads );
+
+	delete program;
+	Shaders_SetBackend( nullptr );
+}
+
+REGISTER_TEST( "shaders.uniform_cache", Test_ShaderUniformCache )
+
+static void Test_ShaderUniformRebuild() {
+	ResetMock();
+	Shaders_SetBackend( &mockBackend );
+
+	auto* program = new ShaderProgram( "test.vert", "test.frag" );
+	int tint = program->GetUniformIndex( "tint" );
+	program->SetUniform( tint, 0.5f );
+	program->SetUniform( "missing", 1.0f );
+
+	// Slots may have moved, and the new program has none of the old values
+	program->Rebuild();
+	TEST_CHECK( mock.num_programs == 2 && mock.num_links == 2 );
+
+	program->SetUniform( tint, 0.5f );
+	TEST_CHECK( mock.lookups[ "tint" ] == 2 );
+	TEST_CHECK( mock.uploads[ 101 ] == 1 );
+	TEST_CHECK( mock.uploads[ 201 ] == 1 );
+	TEST_CHECK( mock.last_float[ 201 ] == 0.5f );
+
+	// Could have been added in the rebuild, so it's worth one more look
+	program->SetUniform( "missing", 1.0f );
+	program->SetUniform( "missing", 2.0f );
+	TEST_CHECK( mock.lookups[ "missing" ] == 2 );
+
+	delete program;
+	Shaders_SetBackend( nullptr );
+}
+
+REGISTER_TEST( "shaders.uniform_rebuild", Test_ShaderUniformRebuild )
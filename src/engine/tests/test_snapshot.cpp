@@ -0,0 +1,256 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../engine.h"
+#include "../property.h"
+#include "../snapshot.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* Owners with one of every kind of property, set to random states and
+ * passed through snapshots, which should come out the other side the
+ * same, other than vectors being rounded to their precision.
+ */
+
+#define TEST_NUM_OWNERS     500
+
+class TestOwner : public PropertyOwner {
+public:
+	TestOwner() :
+		INIT_PROPERTY( health, PROP_PUSH | PROP_WRITE ),
+		INIT_PROPERTY( team, PROP_WRITE ),
+		INIT_PROPERTY( angle, PROP_WRITE ),
+		INIT_PROPERTY( fuse, PROP_WRITE ),
+		INIT_PROPERTY( is_visible, PROP_WRITE ),
+		INIT_PROPERTY( model_name, PROP_WRITE ),
+		INIT_PROPERTY( position, PROP_WRITE ),
+		INIT_PROPERTY( inventory, PROP_WRITE ),
+		INIT_PROPERTY( selection, PROP_LOCAL | PROP_WRITE ) {}
+
+	NumericProperty<int> health;
+	NumericProperty<unsigned int> team;
+	NumericProperty<float> angle;
+	NumericProperty<double> fuse;
+	BooleanProperty is_visible;
+	StringProperty model_name;
+	Vector3Property position;
+	VectorStringProperty inventory;
+	NumericProperty<int> selection;
+};
+
+static float GetRandomFloat( uint32_t* seed ) {
+	return static_cast<float>(static_cast<int>(Fixture_Random( seed ) % 2000001U) - 1000000) / 100.0f;
+}
+
+static std::string GetRandomString( uint32_t* seed ) {
+	std::string out( Fixture_Random( seed ) % 17, ' ' );
+	for ( auto& c : out ) {
+		c = static_cast<char>('a' + Fixture_Random( seed ) % 26);
+	}
+	return out;
+}
+
+/**
+ * Everything's set when it's not partial, otherwise each has a one
+ * in two chance of being left alone.
+ */
+static void Randomise( TestOwner* owner, uint32_t* seed, bool is_partial ) {
+	auto IsPicked = [ seed, is_partial ]() {
+		return !is_partial || ( Fixture_Random( seed ) % 2 ) == 0;
+	};
+
+	if ( IsPicked() ) {
+		owner->health = static_cast<int>(Fixture_Random( seed ));
+	}
+	if ( IsPicked() ) {
+		owner->team = Fixture_Random( seed );
+	}
+	if ( IsPicked() ) {
+		owner->angle = GetRandomFloat( seed );
+	}
+	if ( IsPicked() ) {
+		owner->fuse = static_cast<double>(GetRandomFloat( seed )) / 3.0;
+	}
+	if ( IsPicked() ) {
+		owner->is_visible = ( Fixture_Random( seed ) % 2 ) == 0;
+	}
+	if ( IsPicked() ) {
+		owner->model_name = GetRandomString( seed );
+	}
+	if ( IsPicked() ) {
+		owner->position = PLVector3( GetRandomFloat( seed ), GetRandomFloat( seed ), GetRandomFloat( seed ) );
+	}
+	if ( IsPicked() ) {
+		std::vector<std::string> inventory( Fixture_Random( seed ) % 5 );
+		for ( auto& item : inventory ) {
+			item = GetRandomString( seed );
+		}
+		owner->inventory = inventory;
+	}
+	if ( IsPicked() ) {
+		owner->selection = static_cast<int>(Fixture_Random( seed ));
+	}
+}
+
+static void CheckEqual( const TestOwner& a, const TestOwner& b, bool is_local ) {
+	TEST_CHECK( a.health == b.health );
+	TEST_CHECK( a.team == b.team );
+	TEST_CHECK( a.angle == b.angle );
+	TEST_CHECK( a.fuse == b.fuse );
+	TEST_CHECK( a.is_visible == b.is_visible );
+	TEST_CHECK( static_cast<const std::string&>(a.model_name) == static_cast<const std::string&>(b.model_name) );
+	TEST_CHECK( static_cast<const std::vector<std::string>&>(a.inventory) ==
+				static_cast<const std::vector<std::string>&>(b.inventory) );
+
+	const double precision = SNAPSHOT_VECTOR_PRECISION / 2 + 0.001;
+	TEST_CHECK_NEAR( a.position.GetValue().x, b.position.GetValue().x, precision );
+	TEST_CHECK_NEAR( a.position.GetValue().y, b.position.GetValue().y, precision );
+	TEST_CHECK_NEAR( a.position.GetValue().z, b.position.GetValue().z, precision );
+
+	if ( is_local ) {
+		TEST_CHECK( a.selection == b.selection );
+	}
+}
+
+static bool ReadSnapshot( TestOwner* owner, const SnapshotWriter& writer ) {
+	SnapshotReader reader( writer.GetData(), writer.GetSize() );
+	return owner->ReadSnapshot( reader ) && reader.IsAtEnd();
+}
+
+static void Test_RoundTrip() {
+	uint32_t seed = 0x534E4150;
+	for ( unsigned int i = 0; i < TEST_NUM_OWNERS; ++i ) {
+		TestOwner owner;
+		Randomise( &owner, &seed, false );
+
+		SnapshotWriter writer;
+		owner.WriteSnapshot( writer );
+
+		TestOwner copy;
+		TEST_CHECK( ReadSnapshot( &copy, writer ) );
+		CheckEqual( owner, copy, true );
+	}
+}
+
+REGISTER_TEST( "snapshot.round_trip", Test_RoundTrip )
+
+/**
+ * Only what's changed after the baseline should be written, and that
+ * should be enough to bring a copy that was up to date with it level.
+ */
+static void Test_Delta() {
+	unsigned int old_ticks = g_state.sim_ticks;
+
+	uint32_t seed = 0x44454C54;
+	for ( unsigned int i = 0; i < TEST_NUM_OWNERS; ++i ) {
+		g_state.sim_ticks = 10;
+
+		TestOwner owner;
+		Randomise( &owner, &seed, false );
+
+		SnapshotWriter writer;
+		owner.WriteSnapshot( writer );
+
+		TestOwner copy;
+		TEST_CHECK( ReadSnapshot( &copy, writer ) );
+
+		g_state.sim_ticks = 11;
+		Randomise( &owner, &seed, true );
+
+		SnapshotWriter delta;
+		owner.WriteSnapshot( delta, 10 );
+		TEST_CHECK( delta.GetSize() <= writer.GetSize() );
+		TEST_CHECK( owner.HasChangesSince( 10 ) == ( delta.GetSize() > 1 ) );
+		TEST_CHECK( !owner.HasChangesSince( 11 ) );
+
+		TEST_CHECK( ReadSnapshot( &copy, delta ) );
+		CheckEqual( owner, copy, true );
+	}
+
+	g_state.sim_ticks = old_ticks;
+}
+
+REGISTER_TEST( "snapshot.delta", Test_Delta )
+
+static void Test_ExcludeFlags() {
+	uint32_t seed = 0x4C4F4341;
+	for ( unsigned int i = 0; i < TEST_NUM_OWNERS; ++i ) {
+		TestOwner owner;
+		Randomise( &owner, &seed, false );
+
+		SnapshotWriter writer;
+		owner.WriteSnapshot( writer, SNAPSHOT_FULL, PROP_LOCAL );
+
+		TestOwner copy;
+		TEST_CHECK( ReadSnapshot( &copy, writer ) );
+		CheckEqual( owner, copy, false );
+		TEST_CHECK( copy.selection == 0 );
+	}
+}
+
+REGISTER_TEST( "snapshot.exclude_flags", Test_ExcludeFlags )
+
+/* Every byte's needed, so any shorter than the whole has to be turned away */
+static void Test_Truncated() {
+	uint32_t seed = 0x54525543;
+	for ( unsigned int i = 0; i < TEST_NUM_OWNERS / 10; ++i ) {
+		TestOwner owner;
+		Randomise( &owner, &seed, false );
+
+		SnapshotWriter writer;
+		owner.WriteSnapshot( writer );
+
+		for ( size_t size = 0; size < writer.GetSize(); ++size ) {
+			SnapshotReader reader( writer.GetData(), size );
+			TestOwner copy;
+			TEST_CHECK( !copy.ReadSnapshot( reader ) );
+		}
+	}
+}
+
+REGISTER_TEST( "snapshot.truncated", Test_Truncated )
+
+/**
+ * Saves and peers can hand over anything, so a serialised value
+ * that's the wrong length for its property should be left alone.
+ * Strings are the one kind where any length will do.
+ */
+static void Test_BadSerialised() {
+	uint32_t seed = 0x42414453;
+	for ( unsigned int i = 0; i < TEST_NUM_OWNERS / 10; ++i ) {
+		TestOwner owner;
+		Randomise( &owner, &seed, false );
+
+		for ( const auto& property : owner.GetProperties() ) {
+			if ( property.first == "model_name" ) {
+				continue;
+			}
+
+			std::string serialised = property.second->Serialise();
+			property.second->Deserialise( serialised + '\x01' );
+			TEST_CHECK( property.second->Serialise() == serialised );
+
+			if ( !serialised.empty() ) {
+				property.second->Deserialise( serialised.substr( 0, serialised.size() - 1 ) );
+				TEST_CHECK( property.second->Serialise() == serialised );
+			}
+		}
+	}
+}
+
+REGISTER_TEST( "snapshot.bad_serialised", Test_BadSerialised )
@@ -0,0 +1,226 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+
+#include "../engine.h"
+#include "../graphics/sprite_batch.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* Everything up to Build is done on the CPU, so the batches and vertex
+ * stream can be checked without ever drawing. Textures are only compared,
+ * so they don't need to be real.
+ */
+
+static PLTexture* GetFakeTexture( unsigned int i ) {
+	return reinterpret_cast<PLTexture*>(static_cast<uintptr_t>(( i + 1 ) * 16));
+}
+
+static float Dot( const PLVector3& a, const PLVector3& b ) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static PLVector3 Subtract( const PLVector3& a, const PLVector3& b ) {
+	return PLVector3( a.x - b.x, a.y - b.y, a.z - b.z );
+}
+
+static void CheckPosition( const PLVector3& position, float x, float y, float z ) {
+	TEST_CHECK_NEAR( position.x, x, 0.0001 );
+	TEST_CHECK_NEAR( position.y, y, 0.0001 );
+	TEST_CHECK_NEAR( position.z, z, 0.0001 );
+}
+
+static void Test_SpriteBatchBillboard() {
+	SpriteBatcher batcher;
+	// Looking down z, so right ends up along -x
+	batcher.SetView( PLVector3( 0, 0, 1 ) );
+	batcher.SubmitBillboard( GetFakeTexture( 0 ), SpriteBatcher::BLEND_ADDITIVE, PLVector3( 10, 20, 30 ), 4,
+							 PL_COLOUR_RED );
+	batcher.Build();
+
+	const std::vector<SpriteBatcher::Vertex>& vertices = batcher.GetVertices();
+	TEST_CHECK( vertices.size() == 4 );
+	if ( vertices.size() != 4 ) {
+		return;
+	}
+
+	CheckPosition( vertices[ 0 ].position, 12, 18, 30 );
+	CheckPosition( vertices[ 1 ].position, 12, 22, 30 );
+	CheckPosition( vertices[ 2 ].position, 8, 18, 30 );
+	CheckPosition( vertices[ 3 ].position, 8, 22, 30 );
+
+	const float sts[ 4 ][ 2 ] = { { 0, 1 }, { 0, 0 }, { 1, 1 }, { 1, 0 } };
+	for ( unsigned int i = 0; i < 4; ++i ) {
+		TEST_CHECK( vertices[ i ].s == sts[ i ][ 0 ] );
+		TEST_CHECK( vertices[ i ].t == sts[ i ][ 1 ] );
+		TEST_CHECK( vertices[ i ].colour.r == 255 && vertices[ i ].colour.g == 0 );
+	}
+
+	// Whichever way the camera's looking, billboards are square on to it
+	uint32_t seed = 0x42494C4C;
+	for ( unsigned int i = 0; i < 100; ++i ) {
+		PLVector3 forward(
+			static_cast<float>(Fixture_Random( &seed ) % 2001) / 1000.0f - 1.0f,
+			static_cast<float>(Fixture_Random( &seed ) % 2001) / 1000.0f - 1.0f,
+			static_cast<float>(Fixture_Random( &seed ) % 2001) / 1000.0f - 1.0f );
+		float length = std::sqrt( Dot( forward, forward ) );
+		if ( length < 0.01f ) {
+			continue;
+		}
+		forward = PLVector3( forward.x / length, forward.y / length, forward.z / length );
+
+		batcher.Clear();
+		batcher.SetView( forward );
+		batcher.SubmitBillboard( nullptr, SpriteBatcher::BLEND_DEFAULT, PLVector3( 0, 0, 0 ), 2, PL_COLOUR_WHITE );
+		batcher.Build();
+
+		const SpriteBatcher::Vertex* quad = batcher.GetVertices().data();
+		PLVector3 right = Subtract( quad[ 2 ].position, quad[ 0 ].position );
+		PLVector3 up = Subtract( quad[ 1 ].position, quad[ 0 ].position );
+		TEST_CHECK_NEAR( Dot( right, forward ), 0, 0.001 );
+		TEST_CHECK_NEAR( Dot( up, forward ), 0, 0.001 );
+		TEST_CHECK_NEAR( Dot( right, up ), 0, 0.001 );
+		TEST_CHECK_NEAR( Dot( right, right ), 4, 0.001 );
+		TEST_CHECK_NEAR( Dot( up, up ), 4, 0.001 );
+	}
+}
+
+REGISTER_TEST( "sprite_batch.billboard", Test_SpriteBatchBillboard )
+
+static void Test_SpriteBatchOriented() {
+	SpriteBatcher batcher;
+	batcher.SubmitOriented( nullptr, SpriteBatcher::BLEND_DEFAULT, PLVector3( 1, 2, 3 ), PLVector3( 0, 0, 0 ), 2,
+							PL_COLOUR_WHITE );
+	// A quarter turn about y puts right along -z
+	batcher.SubmitOriented( nullptr, SpriteBatcher::BLEND_DEFAULT, PLVector3( 0, 0, 0 ),
+							PLVector3( 0, plDegreesToRadians( 90.0f ), 0 ), 2, PL_COLOUR_WHITE );
+	// Nothing to draw
+	batcher.SubmitOriented( nullptr, SpriteBatcher::BLEND_DEFAULT, PLVector3( 0, 0, 0 ), PLVector3( 0, 0, 0 ), 0,
+							PL_COLOUR_WHITE );
+	batcher.SubmitBillboard( nullptr, SpriteBatcher::BLEND_DEFAULT, PLVector3( 0, 0, 0 ), -1, PL_COLOUR_WHITE );
+	TEST_CHECK( batcher.GetNumSprites() == 2 );
+
+	batcher.Build();
+	const std::vector<SpriteBatcher::Vertex>& vertices = batcher.GetVertices();
+	TEST_CHECK( vertices.size() == 8 );
+	if ( vertices.size() != 8 ) {
+		return;
+	}
+
+	CheckPosition( vertices[ 0 ].position, 0, 1, 3 );
+	CheckPosition( vertices[ 3 ].position, 2, 3, 3 );
+
+	CheckPosition( vertices[ 4 ].position, 0, -1, 1 );
+	CheckPosition( vertices[ 7 ].position, 0, 1, -1 );
+}
+
+REGISTER_TEST( "sprite_batch.oriented", Test_SpriteBatchOriented )
+
+static void Test_SpriteBatchOffset() {
+	SpriteBatcher batcher;
+	batcher.SetView( PLVector3( 0, 0, 1 ) );
+	// Offsets follow the quad's own axes, so right is -x for the billboard...
+	batcher.SubmitBillboard( nullptr, SpriteBatcher::BLEND_DEFAULT, PLVector3( 10, 20, 30 ), 4, PL_COLOUR_WHITE,
+							 PLVector2( 1, 2 ) );
+	// ...and -z after a quarter turn about y
+	batcher.SubmitOriented( nullptr, SpriteBatcher::BLEND_DEFAULT, PLVector3( 5, 0, 0 ),
+							PLVector3( 0, plDegreesToRadians( 90.0f ), 0 ), 2, PL_COLOUR_WHITE, PLVector2( 1, 2 ) );
+	batcher.Build();
+
+	const std::vector<SpriteBatcher::Vertex>& vertices = batcher.GetVertices();
+	TEST_CHECK( vertices.size() == 8 );
+	if ( vertices.size() != 8 ) {
+		return;
+	}
+
+	CheckPosition( vertices[ 0 ].position, 11, 20, 30 );
+	CheckPosition( vertices[ 3 ].position, 7, 24, 30 );
+
+	CheckPosition( vertices[ 4 ].position, 5, 1, 0 );
+	CheckPosition( vertices[ 7 ].position, 5, 3, -2 );
+}
+
+REGISTER_TEST( "sprite_batch.offset", Test_SpriteBatchOffset )
+
+static void Test_SpriteBatchGrouping() {
+	struct {
+		unsigned int texture;
+		SpriteBatcher::BlendMode blend;
+	} sprites[] = {
+		{ 0, SpriteBatcher::BLEND_ADDITIVE },
+		{ 1, SpriteBatcher::BLEND_DEFAULT },
+		{ 1, SpriteBatcher::BLEND_ADDITIVE },
+		{ 0, SpriteBatcher::BLEND_ADDITIVE },
+		{ 0, SpriteBatcher::BLEND_DEFAULT },
+		{ 1, SpriteBatcher::BLEND_DEFAULT },
+		{ 1, SpriteBatcher::BLEND_DEFAULT },
+	};
+
+	// Submission order goes in the colour, so it can be picked back out of the stream
+	SpriteBatcher batcher;
+	for ( unsigned int i = 0; i < plArrayElements( sprites ); ++i ) {
+		batcher.SubmitBillboard( GetFakeTexture( sprites[ i ].texture ), sprites[ i ].blend,
+								 PLVector3( 0, 0, 0 ), 1, PLColour( i, 0, 0, 255 ) );
+	}
+	batcher.Build();
+
+	// Blended sprites keep their order, whatever the texture, while additive
+	// ones don't need to, so they're grouped up
+	const struct {
+		unsigned int texture;
+		SpriteBatcher::BlendMode blend;
+		unsigned int first_sprite;
+		unsigned int num_sprites;
+	} expected_batches[] = {
+		{ 1, SpriteBatcher::BLEND_DEFAULT, 0, 1 },
+		{ 0, SpriteBatcher::BLEND_DEFAULT, 1, 1 },
+		{ 1, SpriteBatcher::BLEND_DEFAULT, 2, 2 },
+		{ 0, SpriteBatcher::BLEND_ADDITIVE, 4, 2 },
+		{ 1, SpriteBatcher::BLEND_ADDITIVE, 6, 1 },
+	};
+	const unsigned int expected_order[] = { 1, 4, 5, 6, 0, 3, 2 };
+
+	const std::vector<SpriteBatcher::Batch>& batches = batcher.GetBatches();
+	TEST_CHECK( batches.size() == plArrayElements( expected_batches ) );
+	if ( batches.size() != plArrayElements( expected_batches ) ) {
+		return;
+	}
+
+	for ( unsigned int i = 0; i < batches.size(); ++i ) {
+		TEST_CHECK( batches[ i ].texture == GetFakeTexture( expected_batches[ i ].texture ) );
+		TEST_CHECK( batches[ i ].blend == expected_batches[ i ].blend );
+		TEST_CHECK( batches[ i ].first_sprite == expected_batches[ i ].first_sprite );
+		TEST_CHECK( batches[ i ].num_sprites == expected_batches[ i ].num_sprites );
+	}
+
+	const std::vector<SpriteBatcher::Vertex>& vertices = batcher.GetVertices();
+	TEST_CHECK( vertices.size() == plArrayElements( sprites ) * 4 );
+	for ( unsigned int i = 0; i < vertices.size(); ++i ) {
+		TEST_CHECK( vertices[ i ].colour.r == expected_order[ i / 4 ] );
+	}
+
+	// Cleared for the next frame, but nothing's rebuilt until asked
+	batcher.Clear();
+	TEST_CHECK( batcher.GetNumSprites() == 0 );
+	batcher.Build();
+	TEST_CHECK( batcher.GetBatches().empty() );
+	TEST_CHECK( batcher.GetVertices().empty() );
+}
+
+REGISTER_TEST( "sprite_batch.grouping", Test_SpriteBatchGrouping )
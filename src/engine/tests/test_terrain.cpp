@@ -0,0 +1,134 @@
+/* OpenHoW
+ * Copyright (C) 2017-2020 Mark Sowden <markelswo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+
+#include "../engine.h"
+#include "../terrain.h"
+
+#include "../benchmark/fixtures.h"
+#include "test.h"
+
+/* Traces against terrain that's a single plane throughout, so where
+ * they should hit can be worked out directly, rather than going by
+ * the tiles at all.
+ */
+
+#define TEST_SPHERE_RADIUS  32.0f
+
+struct Plane {
+	float a, b, c;  // y = ax + bz + c
+};
+
+static const Plane flat_plane = { 0, 0, 256.0f };
+static const Plane sloped_plane = { 0.125f, 0.0625f, 128.0f };
+
+static float GetPlaneHeight( const Plane& plane, float x, float z ) {
+	return plane.a * x + plane.b * z + plane.c;
+}
+
+static float GetFlatHeight( float x, float z ) {
+	return GetPlaneHeight( flat_plane, x, z );
+}
+
+static float GetSlopedHeight( float x, float z ) {
+	return GetPlaneHeight( sloped_plane, x, z );
+}
+
+// Trace is the same as a sphere without any radius, but both get a go
+static bool TraceTerrain( Terrain* terrain, const PLVector3& start, const PLVector3& end, float radius,
+						  Terrain::TraceHit* hit ) {
+	if ( radius <= 0 ) {
+		return terrain->Trace( start, end, hit );
+	}
+
+	return terrain->TraceSphere( start, end, radius, hit );
+}
+
+static void CheckHit( Terrain* terrain, const Plane& plane, const PLVector3& start, const PLVector3& end, float radius ) {
+	float scale = std::sqrt( 1 + plane.a * plane.a + plane.b * plane.b );
+	PLVector3 normal( -plane.a / scale, 1 / scale, -plane.b / scale );
+
+	// Each end's distance from the plane, along its normal
+	float start_distance = ( start.y - GetPlaneHeight( plane, start.x, start.z ) ) / scale;
+	float end_distance = ( end.y - GetPlaneHeight( plane, end.x, end.z ) ) / scale;
+
+	float fraction = ( start_distance - radius ) / ( start_distance - end_distance );
+	PLVector3 contact(
+		start.x + ( end.x - start.x ) * fraction - normal.x * radius,
+		start.y + ( end.y - start.y ) * fraction - normal.y * radius,
+		start.z + ( end.z - start.z ) * fraction - normal.z * radius );
+
+	Terrain::TraceHit hit;
+	TEST_CHECK( TraceTerrain( terrain, start, end, radius, &hit ) );
+	TEST_CHECK_NEAR( hit.fraction, fraction, 0.0001 );
+	TEST_CHECK_NEAR( hit.position.x, contact.x, 0.1 );
+	TEST_CHECK_NEAR( hit.position.y, contact.y, 0.1 );
+	TEST_CHECK_NEAR( hit.position.z, contact.z, 0.1 );
+	TEST_CHECK_NEAR( hit.normal.x, normal.x, 0.001 );
+	TEST_CHECK_NEAR( hit.normal.y, normal.y, 0.001 );
+	TEST_CHECK_NEAR( hit.normal.z, normal.z, 0.001 );
+}
+
+static void CheckMiss( Terrain* terrain, const PLVector3& start, const PLVector3& end, float radius ) {
+	Terrain::TraceHit hit;
+	TEST_CHECK( !TraceTerrain( terrain, start, end, radius, &hit ) );
+}
+
+static void CheckPlane( const Plane& plane, float ( * height )( float x, float z ) ) {
+	Terrain* terrain = Fixture_CreateTerrain( height );
+
+	const float radii[] = { 0, TEST_SPHERE_RADIUS };
+	for ( float radius : radii ) {
+		// Straight down, in the middle of a tile
+		float y = GetPlaneHeight( plane, 5000.3f, 7000.7f );
+		CheckHit( terrain, plane, PLVector3( 5000.3f, y + 1000.0f, 7000.7f ), PLVector3( 5000.3f, y - 1000.0f, 7000.7f ), radius );
+
+		// And right on a corner, where four tiles meet
+		y = GetPlaneHeight( plane, 1024.0f, 1024.0f );
+		CheckHit( terrain, plane, PLVector3( 1024.0f, y + 1000.0f, 1024.0f ), PLVector3( 1024.0f, y - 1000.0f, 1024.0f ), radius );
+
+		// Across several chunks on the way down
+		PLVector3 start( 1000.0f, GetPlaneHeight( plane, 1000.0f, 1500.0f ) + 2000.0f, 1500.0f );
+		PLVector3 end( 9000.0f, GetPlaneHeight( plane, 9000.0f, 8500.0f ) - 2000.0f, 8500.0f );
+		CheckHit( terrain, plane, start, end, radius );
+
+		// Running alongside, just clear of it
+		float clearance = radius + 64.0f;
+		CheckMiss( terrain,
+				   PLVector3( 1000.0f, GetPlaneHeight( plane, 1000.0f, 1500.0f ) + clearance, 1500.0f ),
+				   PLVector3( 9000.0f, GetPlaneHeight( plane, 9000.0f, 8500.0f ) + clearance, 8500.0f ), radius );
+
+		// Only the side facing up is solid
+		y = GetPlaneHeight( plane, 5000.3f, 7000.7f );
+		CheckMiss( terrain, PLVector3( 5000.3f, y - 1000.0f, 7000.7f ), PLVector3( 5000.3f, y + 1000.0f, 7000.7f ), radius );
+	}
+
+	delete terrain;
+}
+
+static void Test_TraceFlat() {
+	CheckPlane( flat_plane, GetFlatHeight );
+}
+
+REGISTER_TEST( "terrain.trace_flat", Test_TraceFlat )
+
+static void Test_TraceSloped() {
+	CheckPlane( sloped_plane, GetSlopedHeight );
+}
+
+REGISTER_TEST( "terrain.trace_sloped", Test_TraceSloped )